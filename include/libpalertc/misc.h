@@ -13,12 +13,24 @@
 #include <stdint.h>
 #include <time.h>
 
+/* SIMD kernels are only available on x86 now */
+#if defined(__x86_64__) || defined(__i386__)
+#define PALERTC_SIMD_X86
+#endif
+
 /* */
 #define PALERTC_MISC_CRC16_INIT  0xFFFF
 #define PALERTC_MISC_CRC16_POLY  0xA001
+#define PALERTC_MISC_CRC16_SLICES     16
+#define PALERTC_MISC_CRC16_CLMUL_MIN  64
+/* Size of the block that is checked & then extracted while it's still in L1 cache */
+#define PALERTC_MISC_FUSED_BLOCK_SIZE  4096
 
 /* */
 time_t   misc_mktime( int, int, int, int, int, int );
 char    *misc_ipv4str_gen( char *, uint8_t, uint8_t, uint8_t, uint8_t );
-void     misc_crc16_init( void );
+void     misc_init( void );
 uint16_t misc_crc16_cal( const void *, const size_t );
+uint16_t misc_crc16_update( uint16_t, const void *, const size_t );
+int      misc_simd_level_get( void );
+int      misc_simd_level_set( const int );
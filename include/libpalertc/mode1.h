@@ -316,4 +316,7 @@ double pac_m1_chan_unit_get( const int );
 char  *pac_m1_trigmode_get( const PALERT_M1_HEADER * );
 char  *pac_m1_ip_get( const PALERT_M1_HEADER *, const int, char * );
 void   pac_m1_data_extract( const PALERT_M1_PACKET *, int32_t *[PALERT_M1_CHAN_COUNT] );
+void   pac_m1_sdata_extract( const PALERT_M1_PACKET *, int16_t *[PALERT_M1_CHAN_COUNT] );
 int    pac_m1_crc_check( const PALERT_M1_PACKET * );
+int    pac_m1_crc_data_extract( const PALERT_M1_PACKET *, int32_t *[PALERT_M1_CHAN_COUNT] );
+int    pac_m1_crc_sdata_extract( const PALERT_M1_PACKET *, int16_t *[PALERT_M1_CHAN_COUNT] );
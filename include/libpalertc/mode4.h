@@ -54,18 +54,48 @@ typedef struct {
 typedef PALERT_M4_HEADER PAM4H;
 
 /*
- * Definition of Streamline mini-SEED data record structure
+ * Definition of Streamline mini-SEED data record header, total size is 64 bytes
  */
-/*
 typedef struct {
-	struct fsdh_s fsdh;
-	uint16_t blkt_type;
-	uint16_t next_blkt;
-	struct blkt_1000_s blkt1000;
+/* fixed section of data header, 48 bytes */
+	uint8_t sequence_number[6];
+	uint8_t dataquality;
+	uint8_t reserved;
+	uint8_t station[5];
+	uint8_t location[2];
+	uint8_t channel[3];
+	uint8_t network[2];
+	uint8_t year[2];
+	uint8_t day[2];
+	uint8_t hour;
+	uint8_t min;
+	uint8_t sec;
+	uint8_t unused;
+	uint8_t fract[2];
+	uint8_t numsamples[2];
+	uint8_t samprate_fact[2];
+	uint8_t samprate_mult[2];
+	uint8_t act_flags;
+	uint8_t io_flags;
+	uint8_t dq_flags;
+	uint8_t numblockettes;
+	uint8_t time_correct[4];
+	uint8_t data_offset[2];
+	uint8_t blockette_offset[2];
+/* blockette 1000, 8 bytes */
+	uint8_t blkt_type[2];
+	uint8_t next_blkt[2];
+	uint8_t encoding;
+	uint8_t byteorder;
+	uint8_t reclen;
+	uint8_t blkt_reserved;
+/* streamline information, 8 bytes */
 	uint8_t smsrlength[2];
-	uint8_t reserved[6];
-} SMSRECORD;
-*/
+	uint8_t padding[6];
+} PALERT_M4_SMSR_HEADER;
+
+/* Alias of the structure above */
+typedef PALERT_M4_SMSR_HEADER PAM4SMSRH;
 
 /**
  * @brief Definition of Palert generic mode 16 packet structure, total size is 65536 bytes
@@ -146,6 +176,28 @@ typedef PALERT_M4_PACKET PAM4P;
 		((_PAM4H)->dio_status[0] & (0x01 << (_DIO_NUMBER))) : \
 		((_PAM4H)->dio_status[1] & (0x01 << (_DIO_NUMBER) - 8)))
 
+/**
+ * @brief Encoding formats of the data inside Streamline mini-SEED record
+ *
+ */
+#define PALERT_M4_ENCODING_INT16   1
+#define PALERT_M4_ENCODING_INT32   3
+#define PALERT_M4_ENCODING_STEIM1  10
+#define PALERT_M4_ENCODING_STEIM2  11
+
+/**
+ * @brief Size of the Steim compression frame in bytes
+ *
+ */
+#define PALERT_M4_STEIM_FRAME_LENGTH  64
+
+/**
+ * @brief The length of the Streamline mini-SEED record is always in big-endian
+ *
+ */
+#define PALERT_M4_SMSR_LENGTH_GET(_PAM4SMSRH) \
+		(((uint16_t)((_PAM4SMSRH)->smsrlength[0]) << 8) | (uint16_t)((_PAM4SMSRH)->smsrlength[1]))
+
 /**
  * @brief
  *
@@ -155,6 +207,12 @@ typedef PALERT_M4_PACKET PAM4P;
 		(((uint8_t *)(_PAPKT))[60] == PALERT_M4_SYNC_CHAR_2) && (((uint8_t *)(_PAPKT))[61] == PALERT_M4_SYNC_CHAR_3))
 
 /* Export functions's prototypes */
-char *pac_m4_trigmode_get( const PALERT_M4_HEADER * );
-char *pac_m4_ip_get( const PALERT_M4_HEADER *, const int, char * );
-int   pac_m4_crc_check( const PALERT_M4_PACKET * );
+char    *pac_m4_trigmode_get( const PALERT_M4_HEADER * );
+char    *pac_m4_ip_get( const PALERT_M4_HEADER *, const int, char * );
+int      pac_m4_crc_check( const PALERT_M4_PACKET * );
+int      pac_m4_data_extract( const PALERT_M4_PACKET *, int, int32_t *[] );
+int      pac_m4_smsr_nsamp_get( const PALERT_M4_SMSR_HEADER * );
+double   pac_m4_smsr_samprate_get( const PALERT_M4_SMSR_HEADER * );
+double   pac_m4_smsr_starttime_get( const PALERT_M4_SMSR_HEADER * );
+int      pac_m4_smsr_data_extract( const PALERT_M4_SMSR_HEADER *, int32_t *, const int );
+uint64_t pac_m4_steim_mismatch_get( void );
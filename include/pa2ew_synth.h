@@ -0,0 +1,57 @@
+/**
+ * @file pa2ew_synth.h
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Header file for the synthetic Palert packets of the testing tools.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdint.h>
+
+/**
+ * @name
+ *
+ */
+#define PA2EW_SYNTH_MAX_CHANNELS  8
+#define PA2EW_SYNTH_FIRMWARE      0x0100
+#define PA2EW_SYNTH_SIGNAL_AMP    1000.0  /* Counts of the synthetic sine wave in 1 Hz */
+#define PA2EW_SYNTH_NOISE_AMP     16      /* Counts of the synthetic noise      */
+#define PA2EW_SYNTH_STA_FORMAT    "L%05d"
+#define PA2EW_SYNTH_NETWORK       "TW"
+#define PA2EW_SYNTH_LOCATION      "--"
+
+/**
+ * @brief The simulated Palert
+ *
+ */
+typedef struct {
+	int      mode;
+	int      index;         /* Index of the station, for the station code */
+	uint32_t serial;
+	int      ntp_synced;
+	int      samprate;
+	int      nsamp;         /* Samples per packet, always 100 for mode 1 */
+	int      nchannel;
+	uint16_t packet_no;
+	uint64_t rand_state;
+} PA2EW_SYNTH;
+
+/**
+ * @name Export functions' prototype
+ *
+ */
+int         pa2ew_synth_init( PA2EW_SYNTH *, const int, const int, const uint32_t, const int, const int, const int );
+int         pa2ew_synth_length_get( const PA2EW_SYNTH * );
+int         pa2ew_synth_packet_build( PA2EW_SYNTH *, uint8_t *, const double );
+void        pa2ew_synth_packet_corrupt( PA2EW_SYNTH *, uint8_t *, const int );
+const char *pa2ew_synth_chan_code_get( const int, const int );
+int         pa2ew_synth_list_write( const char *, const int, const uint32_t, const int, const int );
+uint64_t    pa2ew_synth_rand( uint64_t * );
@@ -36,15 +36,23 @@
 #define PA2EW_MAX_CHAN_PER_STA    8
 #define PA2EW_TCP_SYNC_ERR_LIMIT  15
 #define PA2EW_NTP_SYNC_ERR_LIMIT  30
+#define PA2EW_DEF_STA_PRIORITY    0
+#define PA2EW_MAX_STA_PRIORITY    3
 /* */
 #define PA2EW_RECV_SERVER_CRC8_INIT  0x00
 #define PA2EW_RECV_SERVER_CRC8_POLY  0x07
+#define PA2EW_CRC8_SLICES            8
 /* */
 #define PA2EW_PALERT_PORT            "502"
 #define PA2EW_MAX_PALERTS_PER_THREAD  512
 #define PA2EW_IDLE_THRESHOLD          120
 #define PA2EW_RECONNECT_INTERVAL      15000
 /* */
+#define PA2EW_FLOOD_THROTTLE        0
+#define PA2EW_FLOOD_DISCONNECT      1
+#define PA2EW_FLOOD_BURST_SEC       10
+#define PA2EW_FLOOD_DISCONNECT_SEC  30
+/* */
 #define PA2EW_RECV_SERVER_OFF  0
 #define PA2EW_RECV_SERVER_ON   1
 /* */
@@ -63,6 +71,12 @@
 #define PA2EW_LITTLE_ENDIAN   1
 #define PA2EW_BIG_ENDIAN      2
 #define PA2EW_PDP_ENDIAN      3
+/* Max. number of 4 bytes samples that one output message can hold, it will be split when over one trace buffer */
+#define PA2EW_OUTMSG_MAX_SAMPLES    2000  /* Equal to the max. sampling rate of Palert, for one second packet */
+/* Max. number of samples that one trace buffer can hold, depends on the size of sample */
+#define PA2EW_TRACE_MAX_SAMPLES(_SAMP_SIZE)  ((int)((MAX_TRACEBUF_SIZ - sizeof(TRACE2_HEADER)) / (_SAMP_SIZE)))
+/* The active one of the double buffered tracebuf header templates of the channel */
+#define PA2EW_CHAINFO_TRH2_GET(_CHAINFO)  (&(_CHAINFO)->trh2[__atomic_load_n(&(_CHAINFO)->trh2_active, __ATOMIC_ACQUIRE)])
 
 /**
  * @brief
@@ -71,6 +85,9 @@
 typedef struct {
 	void    *staptr;
 	uint16_t packmode;
+/* The timestamps for measuring the latency, 0.0 for unknown */
+	double   recv_time;
+	double   enq_time;
 } LABEL;
 
 /**
@@ -82,6 +99,20 @@ typedef struct {
 	uint8_t recv_buffer[PA2EW_RECV_BUFFER_LENGTH];
 } LABELED_RECV_BUFFER;
 
+/**
+ * @brief Token bucket for limiting the intake rate
+ *
+ */
+typedef struct {
+	double byte_rate;    /* Bytes per second   */
+	double byte_tokens;
+	double pkt_rate;     /* Packets per second */
+	double pkt_tokens;
+	double burst;        /* Capacity of bucket in seconds */
+	double last_time;
+	double over_since;   /* The time when the budget was exhausted, 0.0 for normal */
+} PA2EW_TBUCKET;
+
 /**
  * @brief Station info related struct
  *
@@ -89,12 +120,16 @@ typedef struct {
 typedef struct {
 	uint8_t  update;
 	uint8_t  ntp_errors;
+	uint8_t  priority;
+	uint8_t  shard;      /* The wave ring shard, 0 for the default wave ring */
+	uint8_t  budget_seq; /* Bumped when the channel number changed, the intake budget should be resized */
 	char     sta[TRACE2_STA_LEN];
 	char     net[TRACE2_NET_LEN];
 	char     loc[TRACE2_LOC_LEN];
 	uint16_t serial;
 	uint16_t nchannel;
 	int64_t  timeshift;
+	uint32_t queued;
 /* */
 	void *chaptr;
 /* */
@@ -106,11 +141,47 @@ typedef struct {
  *
  */
 typedef struct {
-	uint8_t seq;
-	char    chan[TRACE2_CHAN_LEN];
-	double  last_endtime;
+	uint8_t       seq;
+	char          chan[TRACE2_CHAN_LEN];
+	double        last_endtime;
+	uint8_t       trh2_active;  /* Index of the template in use, the other one is only rebuilt by the list updating */
+	TRACE2_HEADER trh2[2];      /* Prebuilt templates with the SCNL */
+	void         *aggr;  /* Pending samples of the aggregation stage, only allocated when it's enabled */
+	void         *mseed; /* Record state of the mini-SEED output, only allocated when it's enabled */
 } _CHAINFO;
 
+/**
+ * @brief Output message of one channel, the payload is large enough for the samples of one packet
+ *
+ */
+typedef union {
+	TRACE2_HEADER trh2;
+	uint8_t       msg[sizeof(TRACE2_HEADER) + PA2EW_OUTMSG_MAX_SAMPLES * sizeof(int32_t)];
+} PA2EW_OUTMSG;
+
+/**
+ * @brief Pending contiguous samples of one channel, the header keeps the merged sampling information
+ *
+ */
+typedef struct {
+	double flush_time;  /* The time that the pending samples should be put no matter what */
+	union {
+		TRACE2_HEADER trh2;
+		uint8_t       msg[MAX_TRACEBUF_SIZ];
+	} outmsg;
+} PA2EW_AGGR;
+
+/**
+ * @brief Samples decoded from one packet, they are decoded straight into the payload of the output messages
+ *
+ */
+typedef struct {
+	uint16_t      nchannel;
+	uint16_t      nsamp;
+	PA2EW_OUTMSG *outmsg;                        /* Set of the worker's output messages, one for each channel */
+	void         *data[PA2EW_MAX_CHAN_PER_STA];  /* Payload of each message */
+} PA2EW_DECODED;
+
 /**
  * @brief Streamline mini-SEED data record structures
  *
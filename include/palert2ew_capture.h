@@ -0,0 +1,66 @@
+/**
+ * @file palert2ew_capture.h
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Header file for capturing the raw stream, each received chunk of each connection, into a file.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Where the chunk came from
+ *
+ */
+#define PA2EW_CAPTURE_SOURCE_SERVER  0  /* The connections of Palerts under server mode   */
+#define PA2EW_CAPTURE_SOURCE_CLIENT  1  /* The FW_PCK stream of forward server, client mode */
+
+/**
+ * @brief What happened to the connection
+ *
+ */
+#define PA2EW_CAPTURE_EVENT_DATA   0  /* The chunk that went into the framing      */
+#define PA2EW_CAPTURE_EVENT_FLUSH  1  /* The chunk that was flushed after sync error */
+#define PA2EW_CAPTURE_EVENT_CLOSE  2  /* The connection was closed, without chunk  */
+
+/**
+ * @name
+ *
+ */
+#define PA2EW_CAPTURE_MAGIC            0x52433250  /* "P2CR" in the file of little-endian host */
+#define PA2EW_CAPTURE_DEF_BUFFER_SIZE  (16 * 1024 * 1024)
+#define PA2EW_CAPTURE_MAX_PATH         256
+#define PA2EW_CAPTURE_DRAIN_MSEC       100
+#define PA2EW_CAPTURE_REPORT_SEC       60
+
+/**
+ * @brief Header in front of each chunk inside the file, in host byte order
+ *
+ */
+typedef struct {
+	uint32_t magic;
+	uint32_t length;    /* Bytes of the chunk following this header */
+	double   time;      /* Receiving time of the chunk */
+	uint16_t serial;    /* 0 before the Palert is identified, or for the forward stream */
+	uint16_t conn;      /* Index of the connection */
+	uint8_t  source;
+	uint8_t  event;
+	uint16_t reserved;
+} PA2EW_CAPTURE_RECORD_HEAD;
+
+/**
+ * @name Export functions' prototype
+ *
+ */
+int  pa2ew_capture_init( const char *, const size_t );
+void pa2ew_capture_end( void );
+void pa2ew_capture_write( const int, const int, const int, const int, const double, const void *, const size_t );
@@ -10,10 +10,38 @@
 
 #pragma once
 
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdint.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <palert2ew.h>
+
+/**
+ * @brief Framing state of the stream from the forward server, it's owned by the caller & one for each stream. Those
+ *        two pointers are aligned at the same receiving buffer.
+ *
+ */
+typedef struct {
+	uint8_t             *buffer;
+	LABELED_RECV_BUFFER *lrbuf;
+	void                *fwptr;
+	uint8_t              sync_errors;
+	uint32_t             recv_seq;
+} CLIENT_STREAM;
+
 /**
  * @name Export functions' prototype
  *
  */
-int  pa2ew_client_init( const char *, const char * );  /* Initialize the  */
-void pa2ew_client_end( void );                         /* End process of Palert client */
-int  pa2ew_client_stream( void );                      /* Read the data from Palert server and put it into queue */
+int  pa2ew_client_init( const char *, const char * );      /* Connect to the Palert server, return the socket */
+int  pa2ew_client_reconnect( const int );                  /* Close the socket & connect to the Palert server again */
+void pa2ew_client_end( const int );                        /* End process of Palert client */
+int  pa2ew_client_stream_init( CLIENT_STREAM * );          /* Allocate the receiving buffer & reset the framing state */
+void pa2ew_client_stream_end( CLIENT_STREAM * );           /* Free the receiving buffer of the stream */
+int  pa2ew_client_stream( CLIENT_STREAM *, const int );    /* Read the data from Palert server and put it into queue */
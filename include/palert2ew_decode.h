@@ -0,0 +1,23 @@
+/**
+ * @file palert2ew_decode.h
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Header file for decoding the samples of the Palert packets.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+/**
+ * @name Local header include
+ *
+ */
+#include <palert2ew.h>
+
+/**
+ * @name Export functions' prototype
+ *
+ */
+int pa2ew_decode_packet( const void *, const int, const _STAINFO *, const char [2], const int, PA2EW_DECODED * );
@@ -0,0 +1,73 @@
+/**
+ * @file palert2ew_latency.h
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Header file for measuring the latency of each stage, from the first sample of packet to the output.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * @brief Stages of the latency
+ *
+ */
+#define PA2EW_LATENCY_STAGE_SENSOR    0  /* From the first sample of packet to the receiving         */
+#define PA2EW_LATENCY_STAGE_ASSEMBLE  1  /* From the receiving to the main queue, with the reassembly */
+#define PA2EW_LATENCY_STAGE_QUEUE     2  /* Waiting inside the main queue                            */
+#define PA2EW_LATENCY_STAGE_PROCESS   3  /* From the main queue to the output, decoding & putting    */
+#define PA2EW_LATENCY_STAGE_COMMIT    4  /* Waiting for the batched commit of the rings              */
+#define PA2EW_LATENCY_STAGE_TOTAL     5  /* From the first sample of packet to the commit            */
+#define PA2EW_LATENCY_STAGE_NUM       6
+
+/**
+ * @brief Log-linear buckets just like HDR histogram, each power of 2 microseconds is split into 8 sub-buckets,
+ *        so the error of each value is within 12.5%.
+ *
+ */
+#define PA2EW_LATENCY_SUB_BITS      3
+#define PA2EW_LATENCY_SUB_COUNT     (1 << PA2EW_LATENCY_SUB_BITS)
+#define PA2EW_LATENCY_MAX_MSB       35  /* Up to 2^36 microseconds, about 19 hours */
+#define PA2EW_LATENCY_BUCKETS       ((PA2EW_LATENCY_MAX_MSB - PA2EW_LATENCY_SUB_BITS + 2) * PA2EW_LATENCY_SUB_COUNT)
+/* */
+#define PA2EW_LATENCY_MAX_SERIAL    65536
+#define PA2EW_LATENCY_TOP_STATIONS  5
+
+/**
+ * @brief
+ *
+ */
+typedef struct {
+	uint64_t count;
+	uint64_t negative;  /* The latencies below zero, e.g. the clock of station is ahead */
+	uint64_t sum;       /* In microseconds */
+	uint64_t max;       /* In microseconds */
+	uint64_t buckets[PA2EW_LATENCY_BUCKETS];
+} PA2EW_LATENCY_HIST;
+
+/**
+ * @name Export functions' prototype
+ *
+ */
+int         pa2ew_latency_init( const int, const int );
+void        pa2ew_latency_end( void );
+double      pa2ew_latency_timenow_get( void );
+void        pa2ew_latency_sock_setup( const int );
+ssize_t     pa2ew_latency_recv( const int, void *, const size_t, double * );
+void        pa2ew_latency_record( const uint16_t, const double, const double, const double, const double );
+void        pa2ew_latency_commit( void );
+void        pa2ew_latency_report( void );
+int         pa2ew_latency_stage_get( const int, PA2EW_LATENCY_HIST * );
+int         pa2ew_latency_station_get( const uint16_t, PA2EW_LATENCY_HIST * );
+double      pa2ew_latency_percentile_get( const PA2EW_LATENCY_HIST *, const double );
+const char *pa2ew_latency_stage_name_get( const int );
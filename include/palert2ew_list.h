@@ -35,6 +35,14 @@
  */
 #define PA2EW_PALERT_INFO_OBSOLETE 0
 #define PA2EW_PALERT_INFO_UPDATED  1
+#define PA2EW_PALERT_INFO_RESIZED  2
+
+/**
+ * @brief
+ *
+ */
+#define PA2EW_LIST_RULE_PRIORITY  0
+#define PA2EW_LIST_RULE_SHARD     1
 
 /**
  * @name Export functions' prototype
@@ -51,3 +59,4 @@ void      pa2ew_list_tree_abandon( void );
 int       pa2ew_list_total_station_get( void );
 double    pa2ew_list_timestamp_get( void );
 void      pa2ew_list_walk( void (*)(void *, const int, void *), void * );
+int       pa2ew_list_rule_line_parse( const char *, const int, const int );
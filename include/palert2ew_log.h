@@ -0,0 +1,38 @@
+/**
+ * @file palert2ew_log.h
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Header file for the asynchronous & rate-limited logging of the hot paths.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdint.h>
+
+/**
+ * @name
+ *
+ */
+#define PA2EW_LOG_MAX_THREADS      64    /* Max. threads that own their own buffer at the same time */
+#define PA2EW_LOG_THREAD_ENTRIES   256   /* Must be power of 2 */
+#define PA2EW_LOG_MAX_LENGTH       256
+#define PA2EW_LOG_RATE_SLOTS       64    /* Slots of the rate limiting table of each thread */
+#define PA2EW_LOG_DEF_INTERVAL     10.0  /* Default seconds between the same messages */
+#define PA2EW_LOG_DRAIN_MSEC       100
+/* Instead of the logit flags, for those messages only going to stdout */
+#define PA2EW_LOG_STDOUT           NULL
+
+/**
+ * @name Export functions' prototype
+ *
+ */
+int  pa2ew_log_init( const double );
+void pa2ew_log_end( void );
+void pa2ew_log( const char *, const char *, const char *, ... ) __attribute__((format(printf, 3, 4)));
@@ -0,0 +1,55 @@
+/**
+ * @file palert2ew_metrics.h
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Header file for the lock-free counters & the metrics endpoint in Prometheus text format.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * @brief Counters
+ *
+ */
+#define PA2EW_METRIC_RECV_BYTES        0   /* Bytes received from the Palerts or the forward server  */
+#define PA2EW_METRIC_RECV_PACKETS      1   /* Complete packets put into the main queue               */
+#define PA2EW_METRIC_SYNC_ERRORS       2   /* Sync. errors of the TCP stream or the packets          */
+#define PA2EW_METRIC_FRAMES_MODE1      3   /* Packets processed by the main thread, for each mode    */
+#define PA2EW_METRIC_FRAMES_MODE2      4
+#define PA2EW_METRIC_FRAMES_MODE4      5
+#define PA2EW_METRIC_FRAMES_MODE16     6
+#define PA2EW_METRIC_CRC_FAILURES      7
+#define PA2EW_METRIC_NTP_QUESTIONABLE  8   /* Packets from the stations without NTP synchronization  */
+#define PA2EW_METRIC_DECODE_NSEC       9   /* Nanoseconds of decoding & CRC checking                 */
+#define PA2EW_METRIC_DECODE_PACKETS    10
+#define PA2EW_METRIC_NUM               11
+
+/**
+ * @name
+ *
+ */
+#define PA2EW_METRICS_MAX_THREADS    64
+#define PA2EW_METRICS_POLL_MSEC      500
+#define PA2EW_METRICS_REQUEST_SIZE   4096
+#define PA2EW_METRICS_DEF_HOST       "127.0.0.1"
+#define PA2EW_METRICS_MAX_LISTEN     256
+
+/**
+ * @name Export functions' prototype
+ *
+ */
+int      pa2ew_metrics_init( const char *, void (*)( FILE * ) );
+void     pa2ew_metrics_end( void );
+void     pa2ew_metrics_add( const int, const uint64_t );
+uint64_t pa2ew_metrics_get( const int );
+uint64_t pa2ew_metrics_nsec_get( void );
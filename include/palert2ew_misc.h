@@ -22,6 +22,12 @@
  */
 #include <trace_buf.h>  /* For TRACE2_HEADER */
 
+/**
+ * @name Local header include
+ *
+ */
+#include <palert2ew.h>
+
 /**
  * @name Export functions' prototype
  *
@@ -29,8 +35,13 @@
 TRACE2_HEADER *pa2ew_trh2_init( TRACE2_HEADER * );
 TRACE2_HEADER *pa2ew_trh2_scn_enrich( TRACE2_HEADER *, const char *, const char *, const char * );
 TRACE2_HEADER *pa2ew_trh2_sampinfo_enrich( TRACE2_HEADER *, const int, const double, const double, const char [2] );
+TRACE2_HEADER *pa2ew_trh2_template_apply( TRACE2_HEADER *, const TRACE2_HEADER *, const TRACE2_HEADER * );
 double  pa2ew_timenow_get( void );
 int     pa2ew_recv_thrdnum_eval( int, const int );
 int     pa2ew_endian_get( void );
 void    pa2ew_crc8_init( void );
 uint8_t pa2ew_crc8_cal( const void *, const size_t );
+void    pa2ew_tbucket_init( PA2EW_TBUCKET *, const double, const double, const double, const double );
+void    pa2ew_tbucket_resize( PA2EW_TBUCKET *, const double, const double );
+int     pa2ew_tbucket_refill( PA2EW_TBUCKET *, const double );
+void    pa2ew_tbucket_consume( PA2EW_TBUCKET *, const double, const double );
@@ -0,0 +1,45 @@
+/**
+ * @file palert2ew_mseed.h
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Header file for packing the output samples into Steim2 mini-SEED records.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdint.h>
+
+/**
+ * @name Earthworm environment header include
+ *
+ */
+#include <trace_buf.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <palert2ew.h>
+
+/**
+ * @name
+ *
+ */
+#define PA2EW_MSEED_RECORD_LENGTH  512
+#define PA2EW_MSEED_DEF_LATENCY    10.0  /* Default max. seconds that the partial record can be held */
+
+/**
+ * @name Export functions' prototype
+ *
+ */
+void pa2ew_mseed_init( void (*)( char *, int, void * ), void *, const double );
+void pa2ew_mseed_append( _CHAINFO *, const TRACE2_HEADER * );
+void pa2ew_mseed_flush( _CHAINFO *, const double );
+void pa2ew_mseed_state_free( void * );
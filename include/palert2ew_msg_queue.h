@@ -10,12 +10,28 @@
 
 #pragma once
 
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdint.h>
+
 /**
  * @name Earthworm environment header include
  *
  */
 #include <mem_circ_queue.h>
 
+/**
+ * @brief Overload policies of the main queue
+ *
+ */
+#define PA2EW_QUEUE_DROP_OLDEST    0
+#define PA2EW_QUEUE_DROP_PRIORITY  1
+#define PA2EW_QUEUE_FAIR_SHARE     2
+/* */
+#define PA2EW_QUEUE_SHED          -4
+
 /**
  * @brief
  *
@@ -23,13 +39,30 @@
 #define PA2EW_GEN_MSG_LOGO_BY_SRC(PA2EW_MSG_SRC) \
 		((MSG_LOGO){ (PA2EW_MSG_SRC), (PA2EW_MSG_SRC), (PA2EW_MSG_SRC) })
 
+/**
+ * @brief Counters of the main queue
+ *
+ */
+typedef struct {
+	uint64_t enqueued;
+	uint64_t dequeued;
+	uint64_t drop_oldest;     /* Dropped the oldest message to make room for the new one */
+	uint64_t drop_priority;   /* Dropped the new message from the low priority station   */
+	uint64_t drop_fairshare;  /* Dropped the new message from the over-share station     */
+	uint64_t wait_count;      /* Times of waiting for the room                           */
+	uint64_t wait_timeout;    /* Times of waiting for the room without success           */
+	uint32_t depth;
+	uint32_t high_water;
+} PA2EW_MSGQUEUE_STATS;
+
 /**
  * @name Export functions' prototype
  *
  */
-int  pa2ew_msgqueue_init( const unsigned long, const unsigned long );  /* Initialization function of message queue and mutex */
+int  pa2ew_msgqueue_init( const unsigned long, const unsigned long, const int, const unsigned int );  /* Initialization function of message queue and mutex */
 void pa2ew_msgqueue_end( void );                                  /* End process of message queue */
 int  pa2ew_msgqueue_dequeue( void *, size_t *, MSG_LOGO * );    /* Pop-out received message from main queue */
 int  pa2ew_msgqueue_enqueue( void *, size_t, MSG_LOGO );        /* Put the compelete packet into the main queue. */
 int  pa2ew_msgqueue_rawpacket( void *, size_t, MSG_LOGO );
 void pa2ew_msgqueue_lastbufs_reset( void * );
+void pa2ew_msgqueue_stats_get( PA2EW_MSGQUEUE_STATS * );
@@ -0,0 +1,61 @@
+/**
+ * @file palert2ew_ring.h
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Header file for writing batches of messages into the Earthworm shared memory ring.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @name Earthworm environment header include
+ *
+ */
+#include <transport.h>
+
+/**
+ * @name
+ *
+ */
+#define PA2EW_RING_DEF_BATCH_SIZE  65536
+#define PA2EW_RING_MAX_TRACKS      64  /* Pairs of ring & logo tracked for the sequence number */
+/* Besides the PUT_* of transport.h */
+#define PA2EW_RING_LOCK_ERROR     -8
+#define PA2EW_RING_UNSUPPORTED    -9
+#define PA2EW_RING_CORRUPTED      -10  /* The oldest key is not at the first byte, tport_putmsg would exit */
+#define PA2EW_RING_KEY_EXHAUSTED  -11  /* The key of insertion would overflow the long */
+
+/**
+ * @brief Writer of one ring, the staging area has the same layout as the ring, so the whole batch can be
+ *        copied in under one lock
+ *
+ */
+typedef struct {
+	SHM_INFO *region;
+	uint8_t  *buffer;    /* Staging area of the batch */
+	size_t    capacity;
+	size_t    used;
+	uint32_t  nmsg;
+/* */
+	uint64_t  commits;
+	uint64_t  committed;
+} PA2EW_RING_WRITER;
+
+/**
+ * @name Export functions' prototype
+ *
+ */
+int  pa2ew_ring_writer_init( PA2EW_RING_WRITER *, SHM_INFO *, const size_t );
+void pa2ew_ring_writer_free( PA2EW_RING_WRITER * );
+int  pa2ew_ring_writer_add( PA2EW_RING_WRITER *, const MSG_LOGO *, const long, const void * );
+int  pa2ew_ring_writer_commit( PA2EW_RING_WRITER * );
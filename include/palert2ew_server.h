@@ -28,6 +28,19 @@
  */
 #define LISTENQ  128
 
+/**
+ * @brief Intake budget of the connection, the rates are split into the fixed part & the part of each channel
+ *
+ */
+typedef struct {
+	double   byte_fixed;
+	double   byte_per_chan;
+	double   pkt_fixed;
+	double   pkt_per_chan;
+	uint16_t min_nchannel;  /* Palert might send more channels than we need */
+	uint8_t  seq;           /* The budget sequence of the station that the bucket is sized for */
+} INTAKE_BUDGET;
+
 /**
  * @brief Connection descriptors struct
  *
@@ -39,6 +52,12 @@ typedef struct {
 	uint8_t  sync_errors;
 	double   last_act;
 	LABEL    label;
+	PA2EW_TBUCKET bucket;
+	INTAKE_BUDGET budget;
+/* Only written by the receiving thread */
+	uint16_t serial;        /* Copied once the Palert is identified, 0 before that */
+	uint64_t recv_bytes;
+	uint64_t recv_packets;
 } CONNDESCRIP;
 
 /**
@@ -67,7 +86,7 @@ typedef struct {
  * @name Export functions' prototype
  *
  */
-int  pa2ew_server_init( const int, const char * ); /* Initialize the independent Palert server */
+int  pa2ew_server_init( const int, const char *, const double, const int ); /* Initialize the independent Palert server */
 void pa2ew_server_end( void );                                                   /* End process of Palert server */
 void pa2ew_server_pconnect_walk( void (*)(const void *, const int, void *), void * );
 int  pa2ew_server_proc( const int, const int );                                  /* Read the data from each Palert and put it into queue */
@@ -0,0 +1,106 @@
+/**
+ * @file palert2ew_sink.h
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Header file for the output sinks, where the output messages go.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @name Earthworm environment header include
+ *
+ */
+#include <transport.h>
+
+/**
+ * @brief Backends of the output sink
+ *
+ */
+#define PA2EW_SINK_TPORT      0  /* The Earthworm shared memory ring           */
+#define PA2EW_SINK_MEMRING    1  /* The lock-free ring inside this process     */
+#define PA2EW_SINK_FILE       2  /* The file of records (header + message)     */
+#define PA2EW_SINK_DISCARD    3  /* Just count the messages, then drop them    */
+/* */
+#define PA2EW_SINK_DEF_MEMRING_SIZE  (16 * 1024 * 1024)
+#define PA2EW_SINK_FILE_BUFFER_SIZE  (1024 * 1024)
+#define PA2EW_SINK_MAX_PATH          256
+
+/**
+ * @brief Header in front of each message inside the memory ring & the file
+ *
+ */
+typedef struct {
+	uint8_t  type;
+	uint8_t  mod;
+	uint8_t  instid;
+	uint8_t  reserved;
+	uint32_t size;
+} PA2EW_SINK_RECORD_HEAD;
+
+/**
+ * @brief
+ *
+ */
+typedef struct pa2ew_sink PA2EW_SINK;
+
+/**
+ * @brief Operations of each backend, commit & close can be NULL
+ *
+ */
+typedef struct {
+	const char *name;
+	int  (*put)( PA2EW_SINK *, const MSG_LOGO *, const long, const void * );
+	int  (*commit)( PA2EW_SINK * );
+	void (*close)( PA2EW_SINK * );
+} PA2EW_SINK_OPS;
+
+/**
+ * @brief
+ *
+ */
+struct pa2ew_sink {
+	const PA2EW_SINK_OPS *ops;
+	void                 *backend;
+/* Counters, only updated & read by the atomic operations */
+	uint64_t              nmsg;
+	uint64_t              nbytes;
+	uint64_t              nfail;
+};
+
+/**
+ * @brief Reader of the memory ring, it might miss the messages once the writer overruns it just like transport
+ *
+ */
+typedef struct {
+	const PA2EW_SINK *sink;
+	uint64_t          pos;
+	uint64_t          missed;
+} PA2EW_MEMRING_READER;
+
+/**
+ * @name Export functions' prototype
+ *
+ */
+PA2EW_SINK *pa2ew_sink_tport_open( const long, const int );
+PA2EW_SINK *pa2ew_sink_memring_open( const size_t );
+PA2EW_SINK *pa2ew_sink_file_open( const char * );
+PA2EW_SINK *pa2ew_sink_discard_open( void );
+int         pa2ew_sink_put( PA2EW_SINK *, const MSG_LOGO *, const long, const void * );
+int         pa2ew_sink_commit( PA2EW_SINK * );
+void        pa2ew_sink_close( PA2EW_SINK * );
+int         pa2ew_sink_backend_get( const char * );
+SHM_INFO   *pa2ew_sink_region_get( PA2EW_SINK * );
+
+void        pa2ew_memring_reader_init( PA2EW_MEMRING_READER *, const PA2EW_SINK * );
+int         pa2ew_memring_getmsg( PA2EW_MEMRING_READER *, MSG_LOGO *, long *, void *, const long );
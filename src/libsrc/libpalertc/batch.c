@@ -0,0 +1,319 @@
+/**
+ * @file batch.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Program for decoding a batch of Palert packets into structure-of-arrays buffer.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/* Standard C header include */
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+/* Local header include */
+#include "libpalertc.h"
+#include "batch.h"
+#include "misc.h"
+
+/* Internal functions' prototypes */
+static int  decode_m1( PALERT_BATCH *, const int, const PALERT_M1_PACKET * );
+static int  decode_m4( PALERT_BATCH *, const int, const PALERT_M4_PACKET * );
+static int  decode_m16( PALERT_BATCH *, const int, const PALERT_M16_PACKET * );
+static void reset_packet( PALERT_BATCH *, const int );
+static void prefetch_packet( const void *, const int );
+
+/**
+ * @brief Allocate the batch buffer with all the arrays in one memory block.
+ *
+ * @param max_packets
+ * @param max_nchannel
+ * @param max_nsamp
+ * @return PALERT_BATCH* NULL for the failure of allocation or wrong arguments.
+ */
+PALERT_BATCH *pac_batch_create( const int max_packets, const int max_nchannel, const int max_nsamp )
+{
+	PALERT_BATCH *result;
+	const size_t  nchan_total = (size_t)max_packets * max_nchannel;
+	const size_t  nwords      = (max_packets + 63) >> 6;
+	uint8_t      *ptr;
+
+/* */
+	if ( max_packets <= 0 || max_nchannel <= 0 || max_nsamp <= 0 )
+		return NULL;
+/* The arrays are placed by the size of their element, so every one is aligned */
+	result = calloc(
+		1,
+		sizeof(PALERT_BATCH) +
+		nchan_total * max_nsamp * sizeof(int32_t) +
+		nchan_total * (sizeof(double) + sizeof(uint16_t)) +
+		max_packets * (sizeof(double) + sizeof(uint16_t)) +
+		nwords * 2 * sizeof(uint64_t)
+	);
+	if ( !result )
+		return NULL;
+/* */
+	ptr = (uint8_t *)(result + 1);
+	result->starttime    = (double *)ptr;
+	ptr += nchan_total * sizeof(double);
+	result->samprate     = (double *)ptr;
+	ptr += max_packets * sizeof(double);
+	result->crc_pass     = (uint64_t *)ptr;
+	ptr += nwords * sizeof(uint64_t);
+	result->ntp_sync     = (uint64_t *)ptr;
+	ptr += nwords * sizeof(uint64_t);
+	result->data         = (int32_t *)ptr;
+	ptr += nchan_total * max_nsamp * sizeof(int32_t);
+	result->nsamp        = (uint16_t *)ptr;
+	ptr += nchan_total * sizeof(uint16_t);
+	result->nchannel     = (uint16_t *)ptr;
+	result->max_packets  = max_packets;
+	result->max_nchannel = max_nchannel;
+	result->max_nsamp    = max_nsamp;
+
+	return result;
+}
+
+/**
+ * @brief
+ *
+ * @param batch
+ */
+void pac_batch_free( PALERT_BATCH *batch )
+{
+	free(batch);
+
+	return;
+}
+
+/**
+ * @brief Decode the packets of the same mode (but could be from different stations) into the batch buffer. While
+ *        decoding one packet, the next one is prefetched. The channels without enough capacity & the packets
+ *        with different mode are left with zero sample number. The skipped, broken & CRC mismatched packets
+ *        are left with zero channel number, zero sampling rate & zero sample number, nothing from the previous
+ *        batch remains. For mode 1, the start time is without any time zone shift, the caller should apply it
+ *        by the station.
+ *
+ * @param batch
+ * @param packets
+ * @param npackets
+ * @param mode
+ * @param flags
+ * @return int The number of the packets that have been put into the batch, it could be less than the input one
+ *         when the batch is full.
+ */
+int pac_batch_decode( PALERT_BATCH *batch, const void * const packets[], const int npackets, const int mode, const int flags )
+{
+	const int nwords = (batch->max_packets + 63) >> 6;
+	int       ret;
+
+/* Reset the batch */
+	batch->mode    = mode;
+	batch->flags   = flags;
+	batch->npacket = npackets < batch->max_packets ? npackets : batch->max_packets;
+	memset(batch->crc_pass, 0, nwords * sizeof(uint64_t));
+	memset(batch->ntp_sync, 0, nwords * sizeof(uint64_t));
+/* The dispatching is done once for the whole batch */
+	for ( int i = 0; i < batch->npacket; i++ ) {
+		if ( i + 1 < batch->npacket )
+			prefetch_packet( packets[i + 1], mode );
+		reset_packet( batch, i );
+		if ( !packets[i] || pac_mode_get( packets[i] ) != mode )
+			continue;
+	/* */
+		switch ( mode ) {
+		case PALERT_PKT_MODE1:
+			ret = decode_m1( batch, i, packets[i] );
+			break;
+		case PALERT_PKT_MODE4:
+			ret = decode_m4( batch, i, packets[i] );
+			break;
+		case PALERT_PKT_MODE16:
+			ret = decode_m16( batch, i, packets[i] );
+			break;
+		default:
+			ret = 0;
+			break;
+		}
+	/* The partially decoded channels of the failed one shouldn't be used */
+		if ( ret )
+			PALERT_BATCH_BIT_SET( batch->crc_pass, i );
+		else
+			reset_packet( batch, i );
+		if ( pac_ntp_sync_check( packets[i] ) )
+			PALERT_BATCH_BIT_SET( batch->ntp_sync, i );
+	}
+
+	return batch->npacket;
+}
+
+/**
+ * @brief
+ *
+ * @param batch
+ * @param index
+ * @param packet
+ * @return int 1 for the correct packet or no checking, 0 for the CRC mismatched one.
+ */
+static int decode_m1( PALERT_BATCH *batch, const int index, const PALERT_M1_PACKET *packet )
+{
+	const int nchannel = batch->max_nchannel < PALERT_M1_CHAN_COUNT ? batch->max_nchannel : PALERT_M1_CHAN_COUNT;
+	int32_t  *buffer[PALERT_M1_CHAN_COUNT] = { NULL };
+	int       result = 1;
+
+/* */
+	if ( PALERT_M1_PACKETLEN_GET( &packet->header ) <= PALERT_M1_HEADER_LENGTH || batch->max_nsamp < PALERT_M1_SAMPLE_NUMBER )
+		return (batch->flags & PALERT_BATCH_CHECK_CRC) ? pac_m1_crc_check( packet ) : 1;
+/* */
+	for ( int i = 0; i < nchannel; i++ )
+		buffer[i] = PALERT_BATCH_DATA_GET( batch, index, i );
+	if ( batch->flags & PALERT_BATCH_CHECK_CRC )
+		result = pac_m1_crc_data_extract( packet, buffer );
+	else
+		pac_m1_data_extract( packet, buffer );
+/* */
+	batch->nchannel[index] = nchannel;
+	batch->samprate[index] = PALERT_M1_SAMPRATE_GET( &packet->header );
+	for ( int i = 0; i < nchannel; i++ ) {
+		batch->nsamp[PALERT_BATCH_INDEX( batch, index, i )]     = PALERT_M1_SAMPLE_NUMBER;
+		batch->starttime[PALERT_BATCH_INDEX( batch, index, i )] = pac_m1_systime_get( &packet->header, 0 );
+	}
+
+	return result;
+}
+
+/**
+ * @brief Each Streamline mini-SEED record is one channel, it carries its own start time.
+ *
+ * @param batch
+ * @param index
+ * @param packet
+ * @return int 1 for the correct packet or no checking, 0 for the CRC mismatched or broken one.
+ */
+static int decode_m4( PALERT_BATCH *batch, const int index, const PALERT_M4_PACKET *packet )
+{
+	const uint8_t       *data_ptr = &packet->bytes[PALERT_M4_HEADER_LENGTH];
+	const uint8_t * const data_end = &packet->bytes[PALERT_M4_PACKETLEN_GET( &packet->header )];
+	const PALERT_M4_SMSR_HEADER *smsrh;
+/* */
+	int msrlength;
+	int nsamp;
+	int chan = 0;
+
+/* The CRC only covers the first 8 bytes */
+	if ( (batch->flags & PALERT_BATCH_CHECK_CRC) && !pac_m4_crc_check( packet ) )
+		return 0;
+/* */
+	for ( ; data_ptr < data_end && chan < batch->max_nchannel; data_ptr += msrlength ) {
+		smsrh     = (const PALERT_M4_SMSR_HEADER *)data_ptr;
+		msrlength = PALERT_M4_SMSR_LENGTH_GET( smsrh );
+		if ( msrlength < (int)sizeof(PALERT_M4_SMSR_HEADER) || (data_ptr + msrlength) > data_end )
+			return 0;
+	/* */
+		if ( (nsamp = pac_m4_smsr_data_extract( smsrh, PALERT_BATCH_DATA_GET( batch, index, chan ), batch->max_nsamp )) < 0 )
+			return 0;
+		if ( !chan )
+			batch->samprate[index] = pac_m4_smsr_samprate_get( smsrh );
+		batch->nsamp[PALERT_BATCH_INDEX( batch, index, chan )]     = nsamp;
+		batch->starttime[PALERT_BATCH_INDEX( batch, index, chan )] = pac_m4_smsr_starttime_get( smsrh );
+		batch->nchannel[index] = ++chan;
+	}
+
+	return 1;
+}
+
+/**
+ * @brief
+ *
+ * @param batch
+ * @param index
+ * @param packet
+ * @return int 1 for the correct packet or no checking, 0 for the CRC mismatched or broken one.
+ */
+static int decode_m16( PALERT_BATCH *batch, const int index, const PALERT_M16_PACKET *packet )
+{
+	const int nchannel = batch->max_nchannel < packet->header.nchannel ? batch->max_nchannel : packet->header.nchannel;
+	const int nsamp    = packet->header.nchannel ? PALERT_M16_SAMPNUM_GET( &packet->header ) : 0;
+	const int data_len = PALERT_M16_WORD_GET( packet->header.data_len );
+	const int check    = batch->flags & PALERT_BATCH_CHECK_CRC;
+	void     *buffer[nchannel ? nchannel : 1];
+	int       result = 1;
+
+/* */
+	if ( !nchannel || nsamp > batch->max_nsamp || nsamp > PALERT_MAX_SAMPRATE )
+		return check ? pac_m16_crc_check( packet ) : 1;
+/*
+ * The extracting goes by the data length, so it should be exactly the complete rows of the sample number & inside
+ * the packet, otherwise the incomplete row would be written after the last sample of each channel.
+ */
+	if ( data_len != nsamp * packet->header.nchannel * (int)sizeof(PALERT_M16_DATA) ||
+		PALERT_M16_HEADER_LENGTH + data_len > PALERT_M16_PACKETLEN_GET( &packet->header ) )
+		return 0;
+/* */
+	for ( int i = 0; i < nchannel; i++ )
+		buffer[i] = PALERT_BATCH_DATA_GET( batch, index, i );
+	if ( batch->flags & PALERT_BATCH_INT_DATA ) {
+		if ( check )
+			result = pac_m16_crc_idata_extract( packet, nchannel, (int32_t **)buffer );
+		else
+			pac_m16_idata_extract( packet, nchannel, (int32_t **)buffer );
+	}
+	else {
+		if ( check )
+			result = pac_m16_crc_data_extract( packet, nchannel, (float **)buffer );
+		else
+			pac_m16_data_extract( packet, nchannel, (float **)buffer );
+	}
+/* */
+	batch->nchannel[index] = nchannel;
+	batch->samprate[index] = PALERT_M16_SAMPRATE_GET( &packet->header );
+	for ( int i = 0; i < nchannel; i++ ) {
+		batch->nsamp[PALERT_BATCH_INDEX( batch, index, i )]     = nsamp;
+		batch->starttime[PALERT_BATCH_INDEX( batch, index, i )] = pac_m16_sptime_get( &packet->header );
+	}
+
+	return result;
+}
+
+/**
+ * @brief Clear all the fields of the packet, including the channels over the decoded number.
+ *
+ * @param batch
+ * @param index
+ */
+static void reset_packet( PALERT_BATCH *batch, const int index )
+{
+	const size_t base = PALERT_BATCH_INDEX( batch, index, 0 );
+
+/* */
+	batch->nchannel[index] = 0;
+	batch->samprate[index] = 0.0;
+	memset(&batch->nsamp[base], 0, batch->max_nchannel * sizeof(uint16_t));
+	memset(&batch->starttime[base], 0, batch->max_nchannel * sizeof(double));
+
+	return;
+}
+
+/**
+ * @brief Prefetch the header & the beginning of the data, the hardware prefetcher will follow the rest.
+ *
+ * @param packet
+ * @param mode
+ */
+static void prefetch_packet( const void *packet, const int mode )
+{
+	const uint8_t *ptr = packet;
+
+/* */
+	if ( ptr ) {
+		__builtin_prefetch(ptr, 0, 3);
+		__builtin_prefetch(ptr + 64, 0, 3);
+		__builtin_prefetch(ptr + 128, 0, 3);
+		__builtin_prefetch(ptr + 192, 0, 3);
+		if ( mode != PALERT_PKT_MODE16 )
+			__builtin_prefetch(ptr + 256, 0, 3);
+	}
+
+	return;
+}
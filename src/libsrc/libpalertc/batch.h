@@ -0,0 +1,71 @@
+/**
+ * @file batch.h
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Header file for decoding a batch of Palert packets into structure-of-arrays buffer.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+/* */
+#include <stdint.h>
+
+/* Flags of batch decoding */
+#define PALERT_BATCH_CHECK_CRC  0x01  /* Check the CRC of each packet in the same pass */
+#define PALERT_BATCH_INT_DATA   0x02  /* Output the scaled integer samples for mode 16 instead of float */
+
+/**
+ * @brief Structure-of-arrays buffer of the decoded packets. All the samples are stored in one contiguous
+ *        array which is indexed by packet, channel & sample. For mode 16 without PALERT_BATCH_INT_DATA,
+ *        the samples are float in the same space.
+ *
+ */
+typedef struct {
+	int       mode;
+	int       flags;
+	int       npacket;       /* Number of the packets in this batch */
+	int       max_packets;
+	int       max_nchannel;
+	int       max_nsamp;     /* Capacity of samples per channel */
+/* Indexed by packet */
+	uint16_t *nchannel;
+	double   *samprate;
+/* Indexed by packet & channel */
+	uint16_t *nsamp;
+	double   *starttime;
+/* Bitmaps indexed by packet */
+	uint64_t *crc_pass;
+	uint64_t *ntp_sync;
+/* Indexed by packet, channel & sample */
+	int32_t  *data;
+} PALERT_BATCH;
+
+/**
+ * @brief Index of the arrays that indexed by packet & channel
+ *
+ */
+#define PALERT_BATCH_INDEX(_BATCH, _PKT, _CHAN) \
+		((size_t)(_PKT) * (_BATCH)->max_nchannel + (_CHAN))
+
+/**
+ * @brief Samples of the channel inside the packet
+ *
+ */
+#define PALERT_BATCH_DATA_GET(_BATCH, _PKT, _CHAN) \
+		((_BATCH)->data + PALERT_BATCH_INDEX(_BATCH, _PKT, _CHAN) * (_BATCH)->max_nsamp)
+
+/**
+ * @brief Bit operation of the status bitmaps
+ *
+ */
+#define PALERT_BATCH_BIT_GET(_BITMAP, _INDEX) \
+		(((_BITMAP)[(_INDEX) >> 6] >> ((_INDEX) & 0x3f)) & 0x01)
+
+#define PALERT_BATCH_BIT_SET(_BITMAP, _INDEX) \
+		((_BITMAP)[(_INDEX) >> 6] |= (uint64_t)0x01 << ((_INDEX) & 0x3f))
+
+/* Export functions's prototypes */
+PALERT_BATCH *pac_batch_create( const int, const int, const int );
+void          pac_batch_free( PALERT_BATCH * );
+int           pac_batch_decode( PALERT_BATCH *, const void * const [], const int, const int, const int );
@@ -12,6 +12,7 @@
 #include "mode1.h"
 #include "mode4.h"
 #include "mode16.h"
+#include "misc.h"
 
 /**
  * @brief
@@ -130,3 +131,48 @@ int pac_cwb2020_int_trans( const int raw_intensity )
 
 	return 0;
 }
+
+/**
+ * @brief Get the SIMD level used by the data extracting functions.
+ *
+ * @return int
+ */
+int pac_simd_level_get( void )
+{
+	return misc_simd_level_get();
+}
+
+/**
+ * @brief Limit the SIMD level used by the data extracting functions, mostly for testing & benchmark.
+ *
+ * @param level PALERT_SIMD_NONE ~ PALERT_SIMD_AVX2, or a negative value for the best one.
+ * @return int The applied level.
+ */
+int pac_simd_level_set( const int level )
+{
+	return misc_simd_level_set( level );
+}
+
+/**
+ * @brief Initialize the library (CRC tables & SIMD detection) once. It should be called at startup before
+ *        spawning the decoding threads, otherwise it will be done at the first use.
+ *
+ */
+void pac_init( void )
+{
+	misc_init();
+
+	return;
+}
+
+/**
+ * @brief The CRC-16 used by Palert packets, the result of a packet with the correct check sum inside is zero.
+ *
+ * @param data
+ * @param size
+ * @return uint16_t
+ */
+uint16_t pac_crc16_cal( const void *data, const size_t size )
+{
+	return misc_crc16_cal( data, size );
+}
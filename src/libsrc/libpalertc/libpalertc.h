@@ -10,11 +10,15 @@
  */
 #pragma once
 /* */
+#include <stdint.h>
+#include <stddef.h>
+/* */
 #include "samprate.h"
 #include "trigmode.h"
 #include "mode1.h"
 #include "mode4.h"
 #include "mode16.h"
+#include "batch.h"
 /* Library version */
 #define LIBPALERTC_VERSION "2.0.0"
 /* Library release date */
@@ -36,11 +40,21 @@
 #define PALERT_ALLOW0_IP  8
 #define PALERT_ALLOW1_IP  9
 #define PALERT_ALLOW2_IP  10
+/* SIMD levels of the data extracting kernels */
+#define PALERT_SIMD_NONE   0
+#define PALERT_SIMD_SSE2   1
+#define PALERT_SIMD_SSSE3  2
+#define PALERT_SIMD_SSE41  3
+#define PALERT_SIMD_AVX2   4
 
 /* Export functions's prototypes, which are inside general.c */
+void pac_init( void );
 int pac_mode_get( const void * );
 int pac_sync_check( const void * );
 int pac_ntp_sync_check( const void * );
 int pac_pktlen_get( const void * );
 int pac_serial_get( const void * );
 int pac_cwb2020_int_trans( const int );
+int pac_simd_level_get( void );
+int pac_simd_level_set( const int );
+uint16_t pac_crc16_cal( const void *, const size_t );
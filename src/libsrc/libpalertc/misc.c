@@ -13,14 +13,34 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <time.h>
+#include <pthread.h>
 /* */
+#include "libpalertc.h"
 #include "misc.h"
+/* SIMD header include */
+#ifdef PALERTC_SIMD_X86
+#include <immintrin.h>
+#endif
 
 /* */
+static void     init_once( void );
+static void     crc16_table_build( void );
 static uint16_t cal_crc16_low( const uint8_t );
+static uint16_t crc16_slicing( uint16_t, const uint8_t *, size_t );
+static int      simd_level_detect( void );
+#ifdef PALERTC_SIMD_X86
+static uint64_t crc16_clmul_const( const int );
+static uint16_t crc16_clmul( uint16_t, const uint8_t *, size_t ) __attribute__((target("sse4.1,pclmul")));
+#endif
 /* */
-static uint16_t CRC16_Table[256] = { 0 };
-static uint8_t  CRC16_Ready = 0;
+static pthread_once_t Init_Once = PTHREAD_ONCE_INIT;
+static uint16_t CRC16_Table[PALERTC_MISC_CRC16_SLICES][256] = { { 0 } };
+#ifdef PALERTC_SIMD_X86
+static uint8_t  CRC16_CLMUL = 0;
+static uint64_t CRC16_Fold1[2] __attribute__((aligned(16))) = { 0 };  /* For folding 128 bits  */
+static uint64_t CRC16_Fold4[2] __attribute__((aligned(16))) = { 0 };  /* For folding 512 bits */
+#endif
+static int      SIMD_Level  = -1;
 
 /**
  * @brief Turn the broken time structure into calendar time(UTC)
@@ -63,16 +83,13 @@ char *misc_ipv4str_gen( char *dest, uint8_t first_num, uint8_t second_num, uint8
 
 
 /**
- * @brief
+ * @brief Build the CRC-16 tables & detect the SIMD level only once, no matter how many threads call it at
+ *        the same time. After this, all the functions are reentrant.
  *
  */
-void misc_crc16_init( void )
+void misc_init( void )
 {
-/* */
-	for ( int i = 0x00; i <= 0xFF; i++ )
-		CRC16_Table[i & 0xFF] = cal_crc16_low( i & 0xFF );
-/* */
-	CRC16_Ready = 1;
+	pthread_once(&Init_Once, init_once);
 
 	return;
 }
@@ -85,25 +102,102 @@ void misc_crc16_init( void )
  * @return uint8_t
  */
 uint16_t misc_crc16_cal( const void *data, const size_t size )
+{
+	return misc_crc16_update( PALERTC_MISC_CRC16_INIT, data, size );
+}
+
+/**
+ * @brief Keep calculating the CRC-16 from the previous result, so a packet can be checked block by block.
+ *
+ * @param crc The previous result, or PALERTC_MISC_CRC16_INIT for the first block.
+ * @param data
+ * @param size
+ * @return uint16_t
+ */
+uint16_t misc_crc16_update( uint16_t crc, const void *data, const size_t size )
 {
 	const uint8_t *ptr = data;
-	const uint8_t *end;
-	uint16_t       result = PALERTC_MISC_CRC16_INIT;
 
 /* */
-	if ( !CRC16_Ready )
-		misc_crc16_init();
-/* */
+	misc_init();
 	if ( ptr ) {
-	/* */
-		end = ptr + size;
-		while ( ptr < end )
-			result = (result >> 8) ^ CRC16_Table[(result ^ (uint16_t)*ptr++) & 0x00FF];
+#ifdef PALERTC_SIMD_X86
+		if ( size >= PALERTC_MISC_CRC16_CLMUL_MIN && CRC16_CLMUL && misc_simd_level_get() >= PALERT_SIMD_SSE41 )
+			return crc16_clmul( crc, ptr, size );
+#endif
+		crc = crc16_slicing( crc, ptr, size );
 	}
 
+	return crc;
+}
+
+/**
+ * @brief Get the SIMD level of the data extracting kernels, it's detected inside the initialization.
+ *
+ * @return int
+ */
+int misc_simd_level_get( void )
+{
+	misc_init();
+
+	return __atomic_load_n(&SIMD_Level, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Limit the SIMD level of the data extracting kernels, it can't exceed what the CPU supports.
+ *
+ * @param level A negative value means using the best one.
+ * @return int The applied level.
+ */
+int misc_simd_level_set( const int level )
+{
+	const int max_level = simd_level_detect();
+	const int result    = (level < 0 || level > max_level) ? max_level : level;
+
+/* The detection inside the initialization shouldn't override this one */
+	misc_init();
+	__atomic_store_n(&SIMD_Level, result, __ATOMIC_RELAXED);
+
 	return result;
 }
 
+/**
+ * @brief
+ *
+ */
+static void init_once( void )
+{
+	crc16_table_build();
+	__atomic_store_n(&SIMD_Level, simd_level_detect(), __ATOMIC_RELAXED);
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ */
+static void crc16_table_build( void )
+{
+/* */
+	for ( int i = 0x00; i <= 0xFF; i++ )
+		CRC16_Table[0][i & 0xFF] = cal_crc16_low( i & 0xFF );
+/* The table of each slice is the CRC of the byte followed by zero bytes */
+	for ( int i = 1; i < PALERTC_MISC_CRC16_SLICES; i++ )
+		for ( int j = 0x00; j <= 0xFF; j++ )
+			CRC16_Table[i][j] = (CRC16_Table[i - 1][j] >> 8) ^ CRC16_Table[0][CRC16_Table[i - 1][j] & 0xFF];
+#ifdef PALERTC_SIMD_X86
+/* The folding constants are about x^(n + 64) & x^n mod P */
+	CRC16_Fold1[0] = crc16_clmul_const( 128 + 64 );
+	CRC16_Fold1[1] = crc16_clmul_const( 128 );
+	CRC16_Fold4[0] = crc16_clmul_const( 512 + 64 );
+	CRC16_Fold4[1] = crc16_clmul_const( 512 );
+	__builtin_cpu_init();
+	CRC16_CLMUL = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+#endif
+
+	return;
+}
 
 /**
  * @brief
@@ -124,3 +218,160 @@ static uint16_t cal_crc16_low( const uint8_t data )
 
 	return result;
 }
+
+/**
+ * @brief Detect the best SIMD level supported by the running CPU.
+ *
+ * @return int
+ */
+static int simd_level_detect( void )
+{
+#ifdef PALERTC_SIMD_X86
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports("avx2") )
+		return PALERT_SIMD_AVX2;
+	else if ( __builtin_cpu_supports("sse4.1") )
+		return PALERT_SIMD_SSE41;
+	else if ( __builtin_cpu_supports("ssse3") )
+		return PALERT_SIMD_SSSE3;
+	else if ( __builtin_cpu_supports("sse2") )
+		return PALERT_SIMD_SSE2;
+#endif
+
+	return PALERT_SIMD_NONE;
+}
+
+/**
+ * @brief Slicing-by-16 CRC-16, the remains will be done byte by byte.
+ *
+ * @param crc
+ * @param ptr
+ * @param size
+ * @return uint16_t
+ */
+static uint16_t crc16_slicing( uint16_t crc, const uint8_t *ptr, size_t size )
+{
+/* */
+	for ( ; size >= 16; size -= 16, ptr += 16 ) {
+	/* Only the first two bytes are mixed with the CRC */
+		crc ^= ptr[0] | ((uint16_t)ptr[1] << 8);
+		crc =
+			CRC16_Table[15][crc & 0xFF] ^ CRC16_Table[14][crc >> 8] ^
+			CRC16_Table[13][ptr[2]] ^ CRC16_Table[12][ptr[3]] ^
+			CRC16_Table[11][ptr[4]] ^ CRC16_Table[10][ptr[5]] ^
+			CRC16_Table[9][ptr[6]] ^ CRC16_Table[8][ptr[7]] ^
+			CRC16_Table[7][ptr[8]] ^ CRC16_Table[6][ptr[9]] ^
+			CRC16_Table[5][ptr[10]] ^ CRC16_Table[4][ptr[11]] ^
+			CRC16_Table[3][ptr[12]] ^ CRC16_Table[2][ptr[13]] ^
+			CRC16_Table[1][ptr[14]] ^ CRC16_Table[0][ptr[15]];
+	}
+/* */
+	for ( ; size >= 8; size -= 8, ptr += 8 ) {
+		crc ^= ptr[0] | ((uint16_t)ptr[1] << 8);
+		crc =
+			CRC16_Table[7][crc & 0xFF] ^ CRC16_Table[6][crc >> 8] ^
+			CRC16_Table[5][ptr[2]] ^ CRC16_Table[4][ptr[3]] ^
+			CRC16_Table[3][ptr[4]] ^ CRC16_Table[2][ptr[5]] ^
+			CRC16_Table[1][ptr[6]] ^ CRC16_Table[0][ptr[7]];
+	}
+/* */
+	while ( size-- )
+		crc = (crc >> 8) ^ CRC16_Table[0][(crc ^ (uint16_t)*ptr++) & 0x00FF];
+
+	return crc;
+}
+
+#ifdef PALERTC_SIMD_X86
+/**
+ * @brief Generate the folding constant x^(n - 1) mod P for the bit-reflected carry-less multiplication. The
+ *        product of two reflected operands is one bit shifted, that is multiplied by x.
+ *
+ * @param n
+ * @return uint64_t The reflected constant, the coefficient of degree d is at bit 63 - d.
+ */
+static uint64_t crc16_clmul_const( const int n )
+{
+/* The normal form of the polynomial without x^16, reflection of PALERTC_MISC_CRC16_POLY */
+	uint32_t poly   = 0;
+	uint32_t rem    = 1;
+	uint64_t result = 0;
+
+/* */
+	for ( int i = 0; i < 16; i++ )
+		if ( PALERTC_MISC_CRC16_POLY & (1 << i) )
+			poly |= 1 << (15 - i);
+/* */
+	for ( int i = 0; i < n - 1; i++ ) {
+		rem <<= 1;
+		if ( rem & 0x10000 )
+			rem ^= 0x10000 | poly;
+	}
+/* Then reflect it */
+	for ( int i = 0; i < 16; i++ )
+		if ( rem & (1 << i) )
+			result |= (uint64_t)1 << (63 - i);
+
+	return result;
+}
+
+/**
+ * @brief CRC-16 by folding 128 bits blocks with carry-less multiplication. The initial value is mixed into the
+ *        first two bytes, then the blocks are folded into the last one which has the same remainder, finally
+ *        the last block & the remains are done by slicing-by-16 from zero.
+ *
+ * @param crc
+ * @param ptr
+ * @param size Should be at least 64 bytes.
+ * @return uint16_t
+ */
+static uint16_t crc16_clmul( uint16_t crc, const uint8_t *ptr, size_t size )
+{
+	const __m128i fold1 = _mm_load_si128((const __m128i *)CRC16_Fold1);
+	const __m128i fold4 = _mm_load_si128((const __m128i *)CRC16_Fold4);
+	__m128i       x0, x1, x2, x3;
+	uint8_t       last[16];
+
+/* */
+	x0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)ptr), _mm_cvtsi32_si128(crc));
+	x1 = _mm_loadu_si128((const __m128i *)(ptr + 16));
+	x2 = _mm_loadu_si128((const __m128i *)(ptr + 32));
+	x3 = _mm_loadu_si128((const __m128i *)(ptr + 48));
+	ptr  += 64;
+	size -= 64;
+/* Fold 4 lanes of 512 bits forward */
+	for ( ; size >= 64; size -= 64, ptr += 64 ) {
+		x0 = _mm_xor_si128(
+			_mm_xor_si128(_mm_clmulepi64_si128(x0, fold4, 0x00), _mm_clmulepi64_si128(x0, fold4, 0x11)),
+			_mm_loadu_si128((const __m128i *)ptr)
+		);
+		x1 = _mm_xor_si128(
+			_mm_xor_si128(_mm_clmulepi64_si128(x1, fold4, 0x00), _mm_clmulepi64_si128(x1, fold4, 0x11)),
+			_mm_loadu_si128((const __m128i *)(ptr + 16))
+		);
+		x2 = _mm_xor_si128(
+			_mm_xor_si128(_mm_clmulepi64_si128(x2, fold4, 0x00), _mm_clmulepi64_si128(x2, fold4, 0x11)),
+			_mm_loadu_si128((const __m128i *)(ptr + 32))
+		);
+		x3 = _mm_xor_si128(
+			_mm_xor_si128(_mm_clmulepi64_si128(x3, fold4, 0x00), _mm_clmulepi64_si128(x3, fold4, 0x11)),
+			_mm_loadu_si128((const __m128i *)(ptr + 48))
+		);
+	}
+/* Fold 4 lanes into one */
+	x1 = _mm_xor_si128(x1, _mm_xor_si128(_mm_clmulepi64_si128(x0, fold1, 0x00), _mm_clmulepi64_si128(x0, fold1, 0x11)));
+	x2 = _mm_xor_si128(x2, _mm_xor_si128(_mm_clmulepi64_si128(x1, fold1, 0x00), _mm_clmulepi64_si128(x1, fold1, 0x11)));
+	x3 = _mm_xor_si128(x3, _mm_xor_si128(_mm_clmulepi64_si128(x2, fold1, 0x00), _mm_clmulepi64_si128(x2, fold1, 0x11)));
+/* Fold the remained 128 bits blocks */
+	for ( ; size >= 16; size -= 16, ptr += 16 ) {
+		x3 = _mm_xor_si128(
+			_mm_xor_si128(_mm_clmulepi64_si128(x3, fold1, 0x00), _mm_clmulepi64_si128(x3, fold1, 0x11)),
+			_mm_loadu_si128((const __m128i *)ptr)
+		);
+	}
+/* */
+	_mm_storeu_si128((__m128i *)last, x3);
+	crc = crc16_slicing( 0, last, 16 );
+
+	return crc16_slicing( crc, ptr, size );
+}
+#endif
@@ -12,10 +12,53 @@
 /* Standard C header include */
 #include <stdio.h>
 #include <stdint.h>
+#include <stddef.h>
 /* Local header include */
 #include "libpalertc.h"
 #include "mode1.h"
 #include "misc.h"
+/* SIMD header include */
+#ifdef PALERTC_SIMD_X86
+#include <immintrin.h>
+#endif
+
+/* Data blocks of each fused step, the multiple of the SIMD kernels' step (8 blocks) */
+#define M1_FUSED_BLOCK_SAMPLES  16
+
+/* Internal functions' prototypes */
+static uint16_t crc16_header_cal( const PALERT_M1_HEADER * );
+static uint16_t crc16_rest_get( const PALERT_M1_PACKET * );
+static void extract_dispatch( const PALERT_M1_DATA *, int32_t *[PALERT_M1_CHAN_COUNT], const int, const int );
+static void sextract_dispatch( const PALERT_M1_DATA *, int16_t *[PALERT_M1_CHAN_COUNT], const int, const int );
+static void extract_scalar( const PALERT_M1_DATA *, int32_t *[PALERT_M1_CHAN_COUNT], int, const int );
+static void sextract_scalar( const PALERT_M1_DATA *, int16_t *[PALERT_M1_CHAN_COUNT], int, const int );
+#ifdef PALERTC_SIMD_X86
+static void extract_ssse3( const PALERT_M1_DATA *, int32_t *[PALERT_M1_CHAN_COUNT], const int, const int ) __attribute__((target("ssse3")));
+static void extract_avx2( const PALERT_M1_DATA *, int32_t *[PALERT_M1_CHAN_COUNT], const int, const int ) __attribute__((target("avx2")));
+static void sextract_ssse3( const PALERT_M1_DATA *, int16_t *[PALERT_M1_CHAN_COUNT], const int, const int ) __attribute__((target("ssse3")));
+
+/*
+ * Shuffling masks for the SSSE3 kernel, every 8 data blocks (80 bytes) are loaded into 5 vectors, then the
+ * 16-bit words of each channel are picked from these vectors. 0x80 means zeroing the byte.
+ */
+#define M1_SHUF_SRC(_CHAN, _BYTE) \
+		(10 * ((_BYTE) >> 1) + ((_CHAN) << 1) + ((_BYTE) & 1))
+#define M1_SHUF_IDX(_CHAN, _VEC, _BYTE) \
+		((M1_SHUF_SRC(_CHAN, _BYTE) >> 4) == (_VEC) ? (M1_SHUF_SRC(_CHAN, _BYTE) & 0x0f) : 0x80)
+#define M1_SHUF_ROW(_CHAN, _VEC) \
+		{ \
+			M1_SHUF_IDX(_CHAN, _VEC, 0),  M1_SHUF_IDX(_CHAN, _VEC, 1),  M1_SHUF_IDX(_CHAN, _VEC, 2),  M1_SHUF_IDX(_CHAN, _VEC, 3), \
+			M1_SHUF_IDX(_CHAN, _VEC, 4),  M1_SHUF_IDX(_CHAN, _VEC, 5),  M1_SHUF_IDX(_CHAN, _VEC, 6),  M1_SHUF_IDX(_CHAN, _VEC, 7), \
+			M1_SHUF_IDX(_CHAN, _VEC, 8),  M1_SHUF_IDX(_CHAN, _VEC, 9),  M1_SHUF_IDX(_CHAN, _VEC, 10), M1_SHUF_IDX(_CHAN, _VEC, 11), \
+			M1_SHUF_IDX(_CHAN, _VEC, 12), M1_SHUF_IDX(_CHAN, _VEC, 13), M1_SHUF_IDX(_CHAN, _VEC, 14), M1_SHUF_IDX(_CHAN, _VEC, 15) \
+		}
+#define M1_SHUF_CHAN(_CHAN) \
+		{ M1_SHUF_ROW(_CHAN, 0), M1_SHUF_ROW(_CHAN, 1), M1_SHUF_ROW(_CHAN, 2), M1_SHUF_ROW(_CHAN, 3), M1_SHUF_ROW(_CHAN, 4) }
+
+static const uint8_t M1_Shuffle_Masks[PALERT_M1_CHAN_COUNT][5][16] __attribute__((aligned(16))) = {
+	M1_SHUF_CHAN(0), M1_SHUF_CHAN(1), M1_SHUF_CHAN(2), M1_SHUF_CHAN(3), M1_SHUF_CHAN(4)
+};
+#endif
 
 /**
  * @brief Parse the Palert Mode 1 system time to calendar time(UTC)
@@ -158,39 +201,35 @@ char *pac_m1_ip_get( const PALERT_M1_HEADER *pam1h, const int iptype, char *dest
  */
 void pac_m1_data_extract( const PALERT_M1_PACKET *packet, int32_t *buffer[PALERT_M1_CHAN_COUNT] )
 {
-/* Shortcut for the packet data */
-	const PALERT_M1_DATA *_data = packet->data;
-/* */
 	int32_t  dumping[PALERT_M1_SAMPLE_NUMBER];  /* Zero init. is unnecessary */
-	uint16_t word;
+	int32_t *_buffer[PALERT_M1_CHAN_COUNT];
 
 /* */
 	for ( int i = 0; i < PALERT_M1_CHAN_COUNT; i++ )
-		if ( !buffer[i] )
-			buffer[i] = dumping;
-
-/* Go thru all the data */
-	for ( int i = 0; i < PALERT_M1_SAMPLE_NUMBER; i++, _data++ ) {
-	/* Channel HLZ(0) */
-		word = ((uint16_t)_data->cmp[0][1] << 8) | _data->cmp[0][0];
-		buffer[0][i] = *(int16_t *)&word;
-	/* Channel HLN(1) */
-		word = ((uint16_t)_data->cmp[1][1] << 8) | _data->cmp[1][0];
-		buffer[1][i] = *(int16_t *)&word;
-	/* Channel HLE(2) */
-		word = ((uint16_t)_data->cmp[2][1] << 8) | _data->cmp[2][0];
-		buffer[2][i] = *(int16_t *)&word;
-	/* Channel PD(3) */
-		word = ((uint16_t)_data->cmp[3][1] << 8) | _data->cmp[3][0];
-		buffer[3][i] = *(int16_t *)&word;
-	/* Channel Disp(4) */
-		word = ((uint16_t)_data->cmp[4][1] << 8) | _data->cmp[4][0];
-		buffer[4][i] = *(int16_t *)&word;
-	}
+		_buffer[i] = buffer[i] ? buffer[i] : dumping;
+	extract_dispatch( packet->data, _buffer, 0, PALERT_M1_SAMPLE_NUMBER );
 
 	return;
 }
 
+/**
+ * @brief Extract the samples as the native 16-bit words without any widening.
+ *
+ * @param packet
+ * @param buffer
+ */
+void pac_m1_sdata_extract( const PALERT_M1_PACKET *packet, int16_t *buffer[PALERT_M1_CHAN_COUNT] )
+{
+	int16_t  dumping[PALERT_M1_SAMPLE_NUMBER];  /* Zero init. is unnecessary */
+	int16_t *_buffer[PALERT_M1_CHAN_COUNT];
+
+/* */
+	for ( int i = 0; i < PALERT_M1_CHAN_COUNT; i++ )
+		_buffer[i] = buffer[i] ? buffer[i] : dumping;
+	sextract_dispatch( packet->data, _buffer, 0, PALERT_M1_SAMPLE_NUMBER );
+
+	return;
+}
 
 /**
  * @brief
@@ -200,18 +239,300 @@ void pac_m1_data_extract( const PALERT_M1_PACKET *packet, int32_t *buffer[PALERT
  */
 int pac_m1_crc_check( const PALERT_M1_PACKET *packet )
 {
+	uint16_t crc = crc16_header_cal( &packet->header );
+
 /* */
-	PALERT_M1_HEADER *header = (PALERT_M1_HEADER *)&packet->header;
-	const uint8_t     crc16_byte[2] = { header->crc16_byte[0], header->crc16_byte[1] };
-	int               result;
+	if ( PALERT_M1_PACKETLEN_GET( &packet->header ) > PALERT_M1_HEADER_LENGTH )
+		crc = misc_crc16_update( crc, packet->data, PALERT_M1_PACKETLEN_GET( &packet->header ) - PALERT_M1_HEADER_LENGTH );
 
+	return crc == crc16_rest_get( packet ) ? 1 : 0;
+}
+
+/**
+ * @brief Check the CRC & extract the samples in the same pass, the packet won't be touched. The data blocks
+ *        are processed block by block, each block is checked first & then extracted while it's still in L1
+ *        cache, so the data is only read from memory once. Once the CRC mismatched, the contents of the
+ *        buffers are meaningless & should be discarded.
+ *
+ * @param packet
+ * @param buffer
+ * @return int 1 for the correct packet, 0 for the CRC mismatched one.
+ */
+int pac_m1_crc_data_extract( const PALERT_M1_PACKET *packet, int32_t *buffer[PALERT_M1_CHAN_COUNT] )
+{
+	int32_t  dumping[PALERT_M1_SAMPLE_NUMBER];  /* Zero init. is unnecessary */
+	int32_t *_buffer[PALERT_M1_CHAN_COUNT];
+	uint16_t crc;
+	int      end;
+
+/* Only the standard length one carries exactly the data blocks, the others go the separate way */
+	if ( PALERT_M1_PACKETLEN_GET( &packet->header ) != PALERT_M1_PACKET_LENGTH ) {
+		if ( PALERT_M1_PACKETLEN_GET( &packet->header ) > PALERT_M1_HEADER_LENGTH )
+			pac_m1_data_extract( packet, buffer );
+		return pac_m1_crc_check( packet );
+	}
 /* */
-	header->crc16_byte[0] = header->crc16_byte[1] = 0x00;
-	result = misc_crc16_cal( packet, PALERT_M1_PACKETLEN_GET( header ) );
-	result = result == (crc16_byte[0] | (crc16_byte[1] << 8)) ? 1 : 0;
+	for ( int i = 0; i < PALERT_M1_CHAN_COUNT; i++ )
+		_buffer[i] = buffer[i] ? buffer[i] : dumping;
+	crc = crc16_header_cal( &packet->header );
+	for ( int i = 0; i < PALERT_M1_SAMPLE_NUMBER; i = end ) {
+		end = i + M1_FUSED_BLOCK_SAMPLES < PALERT_M1_SAMPLE_NUMBER ? i + M1_FUSED_BLOCK_SAMPLES : PALERT_M1_SAMPLE_NUMBER;
+		crc = misc_crc16_update( crc, packet->data + i, (end - i) * sizeof(PALERT_M1_DATA) );
+		extract_dispatch( packet->data, _buffer, i, end );
+	}
+
+	return crc == crc16_rest_get( packet ) ? 1 : 0;
+}
+
+/**
+ * @brief Check the CRC & extract the samples as 16-bit words in the same pass, just like the one above.
+ *
+ * @param packet
+ * @param buffer
+ * @return int 1 for the correct packet, 0 for the CRC mismatched one.
+ */
+int pac_m1_crc_sdata_extract( const PALERT_M1_PACKET *packet, int16_t *buffer[PALERT_M1_CHAN_COUNT] )
+{
+	int16_t  dumping[PALERT_M1_SAMPLE_NUMBER];  /* Zero init. is unnecessary */
+	int16_t *_buffer[PALERT_M1_CHAN_COUNT];
+	uint16_t crc;
+	int      end;
+
+/* */
+	if ( PALERT_M1_PACKETLEN_GET( &packet->header ) != PALERT_M1_PACKET_LENGTH ) {
+		if ( PALERT_M1_PACKETLEN_GET( &packet->header ) > PALERT_M1_HEADER_LENGTH )
+			pac_m1_sdata_extract( packet, buffer );
+		return pac_m1_crc_check( packet );
+	}
+/* */
+	for ( int i = 0; i < PALERT_M1_CHAN_COUNT; i++ )
+		_buffer[i] = buffer[i] ? buffer[i] : dumping;
+	crc = crc16_header_cal( &packet->header );
+	for ( int i = 0; i < PALERT_M1_SAMPLE_NUMBER; i = end ) {
+		end = i + M1_FUSED_BLOCK_SAMPLES < PALERT_M1_SAMPLE_NUMBER ? i + M1_FUSED_BLOCK_SAMPLES : PALERT_M1_SAMPLE_NUMBER;
+		crc = misc_crc16_update( crc, packet->data + i, (end - i) * sizeof(PALERT_M1_DATA) );
+		sextract_dispatch( packet->data, _buffer, i, end );
+	}
+
+	return crc == crc16_rest_get( packet ) ? 1 : 0;
+}
+
+/**
+ * @brief Calculate the CRC-16 of the header only as the check sum bytes are zero, the data blocks should be
+ *        continued by the caller.
+ *
+ * @param header
+ * @return uint16_t
+ */
+static uint16_t crc16_header_cal( const PALERT_M1_HEADER *header )
+{
+	static const uint8_t zeros[sizeof(header->crc16_byte)] = { 0 };
+	const uint8_t       *ptr = (const uint8_t *)header;
+	const size_t         crc_pos = offsetof(PALERT_M1_HEADER, crc16_byte);
+	const size_t         crc_end = crc_pos + sizeof(header->crc16_byte);
+	uint16_t             result;
+
 /* */
-	header->crc16_byte[0] = crc16_byte[0];
-	header->crc16_byte[1] = crc16_byte[1];
+	result = misc_crc16_update( PALERTC_MISC_CRC16_INIT, ptr, crc_pos );
+	result = misc_crc16_update( result, zeros, sizeof(zeros) );
+	result = misc_crc16_update( result, ptr + crc_end, PALERT_M1_HEADER_LENGTH - crc_end );
 
 	return result;
 }
+
+/**
+ * @brief
+ *
+ * @param packet
+ * @return uint16_t The check sum inside the header.
+ */
+static uint16_t crc16_rest_get( const PALERT_M1_PACKET *packet )
+{
+	return packet->header.crc16_byte[0] | (packet->header.crc16_byte[1] << 8);
+}
+
+/**
+ * @brief Extract the data blocks within the range by the fastest kernel that the running CPU supports.
+ *
+ * @param data
+ * @param buffer
+ * @param start
+ * @param end
+ */
+static void extract_dispatch( const PALERT_M1_DATA *data, int32_t *buffer[PALERT_M1_CHAN_COUNT], const int start, const int end )
+{
+	switch ( misc_simd_level_get() ) {
+#ifdef PALERTC_SIMD_X86
+	case PALERT_SIMD_AVX2:
+		extract_avx2( data, buffer, start, end );
+		break;
+	case PALERT_SIMD_SSE41: case PALERT_SIMD_SSSE3:
+		extract_ssse3( data, buffer, start, end );
+		break;
+#endif
+	case PALERT_SIMD_SSE2: case PALERT_SIMD_NONE: default:
+		extract_scalar( data, buffer, start, end );
+		break;
+	}
+
+	return;
+}
+
+/**
+ * @brief Extract the data blocks within the range as 16-bit words. Without the widening, the shuffling is
+ *        already the whole job, even for the AVX2 capable CPU.
+ *
+ * @param data
+ * @param buffer
+ * @param start
+ * @param end
+ */
+static void sextract_dispatch( const PALERT_M1_DATA *data, int16_t *buffer[PALERT_M1_CHAN_COUNT], const int start, const int end )
+{
+	switch ( misc_simd_level_get() ) {
+#ifdef PALERTC_SIMD_X86
+	case PALERT_SIMD_AVX2: case PALERT_SIMD_SSE41: case PALERT_SIMD_SSSE3:
+		sextract_ssse3( data, buffer, start, end );
+		break;
+#endif
+	case PALERT_SIMD_SSE2: case PALERT_SIMD_NONE: default:
+		sextract_scalar( data, buffer, start, end );
+		break;
+	}
+
+	return;
+}
+
+/**
+ * @brief Extract the data blocks one by one, from the assigned sample to the end one (excluded).
+ *
+ * @param data
+ * @param buffer
+ * @param start
+ */
+static void extract_scalar( const PALERT_M1_DATA *data, int32_t *buffer[PALERT_M1_CHAN_COUNT], int start, const int end )
+{
+	uint16_t word;
+
+/* */
+	for ( int i = start; i < end; i++ ) {
+		for ( int j = 0; j < PALERT_M1_CHAN_COUNT; j++ ) {
+			word         = ((uint16_t)data[i].cmp[j][1] << 8) | data[i].cmp[j][0];
+			buffer[j][i] = (int16_t)word;
+		}
+	}
+
+	return;
+}
+
+/**
+ * @brief Extract the data blocks one by one as 16-bit words, from the assigned sample to the end one (excluded).
+ *
+ * @param data
+ * @param buffer
+ * @param start
+ */
+static void sextract_scalar( const PALERT_M1_DATA *data, int16_t *buffer[PALERT_M1_CHAN_COUNT], int start, const int end )
+{
+/* */
+	for ( int i = start; i < end; i++ )
+		for ( int j = 0; j < PALERT_M1_CHAN_COUNT; j++ )
+			buffer[j][i] = (int16_t)(((uint16_t)data[i].cmp[j][1] << 8) | data[i].cmp[j][0]);
+
+	return;
+}
+
+#ifdef PALERTC_SIMD_X86
+/**
+ * @brief De-interleave 8 data blocks at once by shuffling, then extend the sign of the 16-bit words.
+ *
+ * @param data
+ * @param buffer
+ */
+static void extract_ssse3( const PALERT_M1_DATA *data, int32_t *buffer[PALERT_M1_CHAN_COUNT], const int start, const int end )
+{
+	int            i;
+	const uint8_t *src = (const uint8_t *)(data + start);
+	__m128i        vec[5];
+	__m128i        words;
+
+/* */
+	for ( i = start; i + 8 <= end; i += 8, src += 8 * sizeof(PALERT_M1_DATA) ) {
+		for ( int j = 0; j < 5; j++ )
+			vec[j] = _mm_loadu_si128((const __m128i *)(src + (j << 4)));
+	/* */
+		for ( int j = 0; j < PALERT_M1_CHAN_COUNT; j++ ) {
+			words = _mm_shuffle_epi8(vec[0], _mm_load_si128((const __m128i *)M1_Shuffle_Masks[j][0]));
+			for ( int k = 1; k < 5; k++ )
+				words = _mm_or_si128(words, _mm_shuffle_epi8(vec[k], _mm_load_si128((const __m128i *)M1_Shuffle_Masks[j][k])));
+		/* Put the word into the upper half then shift it back arithmetically */
+			_mm_storeu_si128((__m128i *)(buffer[j] + i), _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16));
+			_mm_storeu_si128((__m128i *)(buffer[j] + i + 4), _mm_srai_epi32(_mm_unpackhi_epi16(words, words), 16));
+		}
+	}
+/* The remains */
+	extract_scalar( data, buffer, i, end );
+
+	return;
+}
+
+/**
+ * @brief De-interleave 8 data blocks at once by shuffling, the 8 words of each channel are stored as they are.
+ *
+ * @param data
+ * @param buffer
+ */
+static void sextract_ssse3( const PALERT_M1_DATA *data, int16_t *buffer[PALERT_M1_CHAN_COUNT], const int start, const int end )
+{
+	int            i;
+	const uint8_t *src = (const uint8_t *)(data + start);
+	__m128i        vec[5];
+	__m128i        words;
+
+/* */
+	for ( i = start; i + 8 <= end; i += 8, src += 8 * sizeof(PALERT_M1_DATA) ) {
+		for ( int j = 0; j < 5; j++ )
+			vec[j] = _mm_loadu_si128((const __m128i *)(src + (j << 4)));
+	/* */
+		for ( int j = 0; j < PALERT_M1_CHAN_COUNT; j++ ) {
+			words = _mm_shuffle_epi8(vec[0], _mm_load_si128((const __m128i *)M1_Shuffle_Masks[j][0]));
+			for ( int k = 1; k < 5; k++ )
+				words = _mm_or_si128(words, _mm_shuffle_epi8(vec[k], _mm_load_si128((const __m128i *)M1_Shuffle_Masks[j][k])));
+			_mm_storeu_si128((__m128i *)(buffer[j] + i), words);
+		}
+	}
+/* The remains */
+	sextract_scalar( data, buffer, i, end );
+
+	return;
+}
+
+/**
+ * @brief Gather 8 samples of one channel at once. The gathering starts 2 bytes before the word, so the word
+ *        lands in the upper half and never reads over the end of packet; the former 2 bytes are still inside
+ *        the packet header or the last data block.
+ *
+ * @param data
+ * @param buffer
+ */
+static void extract_avx2( const PALERT_M1_DATA *data, int32_t *buffer[PALERT_M1_CHAN_COUNT], const int start, const int end )
+{
+	int            i;
+	const uint8_t *src = (const uint8_t *)(data + start) - 2;
+	const __m256i  idx = _mm256_setr_epi32(0, 10, 20, 30, 40, 50, 60, 70);
+
+/* */
+	for ( i = start; i + 8 <= end; i += 8, src += 8 * sizeof(PALERT_M1_DATA) ) {
+		for ( int j = 0; j < PALERT_M1_CHAN_COUNT; j++ ) {
+			_mm256_storeu_si256(
+				(__m256i *)(buffer[j] + i),
+				_mm256_srai_epi32(_mm256_i32gather_epi32((const int *)(src + (j << 1)), idx, 1), 16)
+			);
+		}
+	}
+/* The remains */
+	extract_scalar( data, buffer, i, end );
+
+	return;
+}
+#endif
@@ -15,6 +15,19 @@
 #include "libpalertc.h"
 #include "misc.h"
 #include "mode16.h"
+/* SIMD header include */
+#ifdef PALERTC_SIMD_X86
+#include <immintrin.h>
+#endif
+
+/* Internal functions' prototypes */
+static int  extract_dispatch( const PALERT_M16_PACKET *, int, void *[], const int, const int );
+static void extract_block( const PALERT_M16_DATA *, const PALERT_M16_DATA *, const int, void *[], const int );
+static void extract_scalar( const PALERT_M16_DATA *, const PALERT_M16_DATA *, const int, void *[], int, const int );
+#ifdef PALERTC_SIMD_X86
+static int  extract_sse2_4ch( const PALERT_M16_DATA *, const int, void *[], const int ) __attribute__((target("sse2")));
+static int  extract_avx2( const PALERT_M16_DATA *, const int, const int, void *[], const int ) __attribute__((target("avx2")));
+#endif
 
 /**
  * @brief Parse the palert mode 16 timestamp to calendar time(UTC)
@@ -66,28 +79,7 @@ double pac_m16_ntp_offset_get( const PALERT_M16_HEADER *pam16h )
  */
 void pac_m16_data_extract( const PALERT_M16_PACKET *packet, int nbuf, float *buffer[] )
 {
-/* Shortcut for the packet data */
-	const PALERT_M16_DATA *       data_ptr = (PALERT_M16_DATA *)&packet->bytes[PALERT_M16_HEADER_LENGTH];
-	const PALERT_M16_DATA * const data_end = (PALERT_M16_DATA *)((uint8_t *)data_ptr + PALERT_M16_WORD_GET( packet->header.data_len ));
-	PALERT_M16_DATA               data_buf;
-/* */
-	float *_buffer[packet->header.nchannel];
-	float  dumping[PALERT_MAX_SAMPRATE];  /* Zero init. is unnecessary */
-
-/* */
-	for ( int i = 0; i < packet->header.nchannel; i++ )
-		_buffer[i] = dumping;
-/* */
-	for ( int i = 0; nbuf > 0 && i < packet->header.nchannel; nbuf--, i++ )
-		if ( buffer[i] )
-			_buffer[i] = buffer[i];
-/* Go thru all the packet data */
-	for ( int i = 0; data_ptr < data_end; i++ ) {
-		for ( int j = 0; j < packet->header.nchannel; j++, data_ptr++ ) {
-			data_buf.data_dword = PALERT_M16_DWORD_GET( data_ptr->data_byte );
-			_buffer[j][i]       = data_buf.data_real;
-		}
-	}
+	extract_dispatch( packet, nbuf, (void **)buffer, 0, 0 );
 
 	return;
 }
@@ -100,42 +92,307 @@ void pac_m16_data_extract( const PALERT_M16_PACKET *packet, int nbuf, float *buf
  * @param buffer
  */
 void pac_m16_idata_extract( const PALERT_M16_PACKET *packet, int nbuf, int32_t *buffer[] )
+{
+	extract_dispatch( packet, nbuf, (void **)buffer, 1, 0 );
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param packet
+ * @return int
+ */
+int pac_m16_crc_check( const PALERT_M16_PACKET *packet )
+{
+	return misc_crc16_cal( packet, PALERT_M16_PACKETLEN_GET( &packet->header ) ) ? 0 : 1;
+}
+
+/**
+ * @brief Check the CRC & extract the samples in the same pass, the packet won't be touched. Once the
+ *        CRC mismatched, the contents of the buffers are meaningless & should be discarded.
+ *
+ * @param packet
+ * @param nbuf
+ * @param buffer
+ * @return int 1 for the correct packet, 0 for the CRC mismatched one.
+ */
+int pac_m16_crc_data_extract( const PALERT_M16_PACKET *packet, int nbuf, float *buffer[] )
+{
+	return extract_dispatch( packet, nbuf, (void **)buffer, 0, 1 );
+}
+
+/**
+ * @brief Just like pac_m16_crc_data_extract(), but output the scaled integer samples.
+ *
+ * @param packet
+ * @param nbuf
+ * @param buffer
+ * @return int 1 for the correct packet, 0 for the CRC mismatched one.
+ */
+int pac_m16_crc_idata_extract( const PALERT_M16_PACKET *packet, int nbuf, int32_t *buffer[] )
+{
+	return extract_dispatch( packet, nbuf, (void **)buffer, 1, 1 );
+}
+
+/**
+ * @brief De-interleave the samples by channel. When the CRC is also required, the data is processed block by
+ *        block, each block is checked first & then extracted while it's still in L1 cache, so the packet is only
+ *        read from memory once.
+ *
+ * @param packet
+ * @param nbuf
+ * @param buffer
+ * @param to_int Converting the samples to scaled integer or not.
+ * @param check_crc
+ * @return int 1 for the correct packet or no checking, 0 for the CRC mismatched one.
+ */
+static int extract_dispatch( const PALERT_M16_PACKET *packet, int nbuf, void *buffer[], const int to_int, const int check_crc )
 {
 /* Shortcut for the packet data */
-	const PALERT_M16_DATA *       data_ptr = (PALERT_M16_DATA *)&packet->bytes[PALERT_M16_HEADER_LENGTH];
+	const PALERT_M16_DATA * const data_ptr = (PALERT_M16_DATA *)&packet->bytes[PALERT_M16_HEADER_LENGTH];
 	const PALERT_M16_DATA * const data_end = (PALERT_M16_DATA *)((uint8_t *)data_ptr + PALERT_M16_WORD_GET( packet->header.data_len ));
-	PALERT_M16_DATA               data_buf;
+	const uint8_t * const         pkt_end  = &packet->bytes[PALERT_M16_PACKETLEN_GET( &packet->header )];
+	const int                     nchannel = packet->header.nchannel;
 /* */
-	int32_t *_buffer[packet->header.nchannel];
-	int32_t  dumping[PALERT_MAX_SAMPRATE];  /* Zero init. is unnecessary */
+	void    *_buffer[nchannel ? nchannel : 1];
+	void    *block_buffer[nchannel ? nchannel : 1];
+	uint32_t dumping[PALERT_MAX_SAMPRATE];  /* Zero init. is unnecessary */
+	uint16_t crc = PALERTC_MISC_CRC16_INIT;
+	int      nrows;
+	int      block_rows;
+	const uint8_t *tail;
 
 /* */
-	for ( int i = 0; i < packet->header.nchannel; i++ )
+	if ( !nchannel )
+		return check_crc ? !misc_crc16_cal( packet, PALERT_M16_PACKETLEN_GET( &packet->header ) ) : 1;
+	for ( int i = 0; i < nchannel; i++ )
 		_buffer[i] = dumping;
 /* */
-	for ( int i = 0; nbuf > 0 && i < packet->header.nchannel; nbuf--, i++ )
+	for ( int i = 0; nbuf > 0 && i < nchannel; nbuf--, i++ )
 		if ( buffer[i] )
 			_buffer[i] = buffer[i];
-/* Go thru all the packet data */
-	for ( int i = 0; data_ptr < data_end; i++ ) {
-		for ( int j = 0; j < packet->header.nchannel; j++, data_ptr++ ) {
+/* */
+	if ( !check_crc ) {
+		extract_block( data_ptr, data_end, nchannel, _buffer, to_int );
+		return 1;
+	}
+/* The data part is cut at the row boundary, so the kernels won't notice the blocks */
+	crc        = misc_crc16_update( crc, packet, PALERT_M16_HEADER_LENGTH );
+	nrows      = (data_end - data_ptr) / nchannel;
+	block_rows = PALERTC_MISC_FUSED_BLOCK_SIZE / (nchannel * sizeof(PALERT_M16_DATA));
+	block_rows = block_rows ? block_rows : 1;
+	for ( int row = 0; row < nrows; row += block_rows ) {
+		const PALERT_M16_DATA *block_ptr = data_ptr + row * nchannel;
+		const PALERT_M16_DATA *block_end = row + block_rows < nrows ? block_ptr + block_rows * nchannel : data_end;
+
+		for ( int i = 0; i < nchannel; i++ )
+			block_buffer[i] = (uint32_t *)_buffer[i] + row;
+		crc = misc_crc16_update( crc, block_ptr, (const uint8_t *)block_end - (const uint8_t *)block_ptr );
+		extract_block( block_ptr, block_end, nchannel, block_buffer, to_int );
+	}
+/* The last block already contains the incomplete row, then the check sum bytes at the end */
+	if ( !nrows )
+		extract_block( data_ptr, data_end, nchannel, _buffer, to_int );
+	tail = nrows ? (const uint8_t *)data_end : (const uint8_t *)data_ptr;
+	if ( pkt_end < tail )
+		return 0;
+	crc = misc_crc16_update( crc, tail, pkt_end - tail );
+
+	return crc ? 0 : 1;
+}
+
+/**
+ * @brief Extract the data with the fastest kernel that the running CPU supports. The data of mode 16 is
+ *        little-endian, so there is no need to swap bytes for x86 kernels.
+ *
+ * @param data_ptr
+ * @param data_end
+ * @param nchannel
+ * @param buffer
+ * @param to_int
+ */
+static void extract_block(
+	const PALERT_M16_DATA *data_ptr, const PALERT_M16_DATA *data_end, const int nchannel, void *buffer[], const int to_int
+) {
+	int nrows;
+	int done = 0;
+
+/* Only the complete rows go into SIMD kernels */
+	switch ( misc_simd_level_get() ) {
+#ifdef PALERTC_SIMD_X86
+	case PALERT_SIMD_AVX2:
+		nrows = (data_end - data_ptr) / nchannel;
+		if ( nchannel == 4 )
+			done = extract_sse2_4ch( data_ptr, nrows, buffer, to_int );
+		else
+			done = extract_avx2( data_ptr, nrows, nchannel, buffer, to_int );
+		break;
+	case PALERT_SIMD_SSE41: case PALERT_SIMD_SSSE3: case PALERT_SIMD_SSE2:
+		nrows = (data_end - data_ptr) / nchannel;
+		if ( nchannel == 4 )
+			done = extract_sse2_4ch( data_ptr, nrows, buffer, to_int );
+		break;
+#endif
+	case PALERT_SIMD_NONE: default:
+		break;
+	}
+/* The remains */
+	extract_scalar( data_ptr, data_end, nchannel, buffer, done, to_int );
+
+	return;
+}
+
+/**
+ * @brief The original interleaved loop, starting from the assigned row.
+ *
+ * @param data_ptr
+ * @param data_end
+ * @param nchannel
+ * @param buffer
+ * @param start
+ * @param to_int
+ */
+static void extract_scalar(
+	const PALERT_M16_DATA *data_ptr, const PALERT_M16_DATA *data_end, const int nchannel, void *buffer[], int start,
+	const int to_int
+) {
+	PALERT_M16_DATA data_buf;
+
+/* */
+	for ( data_ptr += start * nchannel; data_ptr < data_end; start++ ) {
+		for ( int j = 0; j < nchannel; j++, data_ptr++ ) {
 			data_buf.data_dword = PALERT_M16_DWORD_GET( data_ptr->data_byte );
-			data_buf.data_real *= PALERT_M16_COUNT_OVER_GAL;
-			data_buf.data_real += data_buf.data_real > 0.0 ? 0.9 : -0.9;
-			_buffer[j][i]       = (int32_t)data_buf.data_real;
+			if ( to_int ) {
+				data_buf.data_real *= PALERT_M16_COUNT_OVER_GAL;
+				data_buf.data_real += data_buf.data_real > 0.0 ? 0.9 : -0.9;
+				((int32_t *)buffer[j])[start] = (int32_t)data_buf.data_real;
+			}
+			else {
+				((float *)buffer[j])[start] = data_buf.data_real;
+			}
 		}
 	}
 
 	return;
 }
 
+#ifdef PALERTC_SIMD_X86
+/**
+ * @brief Scale the samples to integer just like the scalar one: multiply in float, add the +-0.9 in double,
+ *        round back to float & truncate to integer.
+ *
+ */
+static inline __m128i ftoi_sse2( __m128 data ) __attribute__((target("sse2")));
+static inline __m128i ftoi_sse2( __m128 data )
+{
+	const __m128d pos = _mm_set1_pd(0.9);
+	const __m128d neg = _mm_set1_pd(-0.9);
+	__m128d       lo, hi, mask;
+
+/* */
+	data = _mm_mul_ps(data, _mm_set1_ps((float)PALERT_M16_COUNT_OVER_GAL));
+	lo   = _mm_cvtps_pd(data);
+	hi   = _mm_cvtps_pd(_mm_movehl_ps(data, data));
+/* NaN is not larger than zero, so as the scalar one */
+	mask = _mm_cmpgt_pd(lo, _mm_setzero_pd());
+	lo   = _mm_add_pd(lo, _mm_or_pd(_mm_and_pd(mask, pos), _mm_andnot_pd(mask, neg)));
+	mask = _mm_cmpgt_pd(hi, _mm_setzero_pd());
+	hi   = _mm_add_pd(hi, _mm_or_pd(_mm_and_pd(mask, pos), _mm_andnot_pd(mask, neg)));
+
+	return _mm_cvttps_epi32(_mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)));
+}
+
 /**
  * @brief
  *
- * @param packet
- * @return int
  */
-int pac_m16_crc_check( const PALERT_M16_PACKET *packet )
+static inline __m256i ftoi_avx2( __m256 data ) __attribute__((target("avx2")));
+static inline __m256i ftoi_avx2( __m256 data )
 {
-	return misc_crc16_cal( packet, PALERT_M16_PACKETLEN_GET( &packet->header ) ) ? 0 : 1;
+	const __m256d pos = _mm256_set1_pd(0.9);
+	const __m256d neg = _mm256_set1_pd(-0.9);
+	__m256d       lo, hi;
+
+/* */
+	data = _mm256_mul_ps(data, _mm256_set1_ps((float)PALERT_M16_COUNT_OVER_GAL));
+	lo   = _mm256_cvtps_pd(_mm256_castps256_ps128(data));
+	hi   = _mm256_cvtps_pd(_mm256_extractf128_ps(data, 1));
+	lo   = _mm256_add_pd(lo, _mm256_blendv_pd(neg, pos, _mm256_cmp_pd(lo, _mm256_setzero_pd(), _CMP_GT_OQ)));
+	hi   = _mm256_add_pd(hi, _mm256_blendv_pd(neg, pos, _mm256_cmp_pd(hi, _mm256_setzero_pd(), _CMP_GT_OQ)));
+
+	return _mm256_cvttps_epi32(_mm256_set_m128(_mm256_cvtpd_ps(hi), _mm256_cvtpd_ps(lo)));
+}
+
+/**
+ * @brief Transpose every 4 rows of the 4 channels packet at once.
+ *
+ * @param data
+ * @param nrows
+ * @param buffer
+ * @param to_int
+ * @return int The number of processed rows.
+ */
+static int extract_sse2_4ch( const PALERT_M16_DATA *data, const int nrows, void *buffer[], const int to_int )
+{
+	int          i;
+	const float *src = (const float *)data;
+	__m128       row0, row1, row2, row3;
+
+/* */
+	for ( i = 0; i + 4 <= nrows; i += 4, src += 16 ) {
+		row0 = _mm_loadu_ps(src);
+		row1 = _mm_loadu_ps(src + 4);
+		row2 = _mm_loadu_ps(src + 8);
+		row3 = _mm_loadu_ps(src + 12);
+		_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+	/* */
+		if ( to_int ) {
+			_mm_storeu_si128((__m128i *)((int32_t *)buffer[0] + i), ftoi_sse2( row0 ));
+			_mm_storeu_si128((__m128i *)((int32_t *)buffer[1] + i), ftoi_sse2( row1 ));
+			_mm_storeu_si128((__m128i *)((int32_t *)buffer[2] + i), ftoi_sse2( row2 ));
+			_mm_storeu_si128((__m128i *)((int32_t *)buffer[3] + i), ftoi_sse2( row3 ));
+		}
+		else {
+			_mm_storeu_ps((float *)buffer[0] + i, row0);
+			_mm_storeu_ps((float *)buffer[1] + i, row1);
+			_mm_storeu_ps((float *)buffer[2] + i, row2);
+			_mm_storeu_ps((float *)buffer[3] + i, row3);
+		}
+	}
+
+	return i;
+}
+
+/**
+ * @brief Gather 8 rows of each channel at once, it works for any channel number.
+ *
+ * @param data
+ * @param nrows
+ * @param nchannel
+ * @param buffer
+ * @param to_int
+ * @return int The number of processed rows.
+ */
+static int extract_avx2( const PALERT_M16_DATA *data, const int nrows, const int nchannel, void *buffer[], const int to_int )
+{
+	int           i;
+	const float  *src = (const float *)data;
+	const __m256i idx = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(nchannel));
+	__m256        samples;
+
+/* */
+	for ( i = 0; i + 8 <= nrows; i += 8, src += nchannel << 3 ) {
+		for ( int j = 0; j < nchannel; j++ ) {
+			samples = _mm256_i32gather_ps(src + j, idx, 4);
+			if ( to_int )
+				_mm256_storeu_si256((__m256i *)((int32_t *)buffer[j] + i), ftoi_avx2( samples ));
+			else
+				_mm256_storeu_ps((float *)buffer[j] + i, samples);
+		}
+	}
+
+	return i;
 }
+#endif
@@ -17,6 +17,30 @@
 #include "libpalertc.h"
 #include "mode4.h"
 #include "misc.h"
+/* SIMD header include */
+#ifdef PALERTC_SIMD_X86
+#include <immintrin.h>
+#endif
+
+/* Internal functions' prototypes */
+static int      smsr_header_is_little( const PALERT_M4_SMSR_HEADER * );
+static uint16_t smsr_word_get( const uint8_t *, const int );
+static uint32_t smsr_dword_get( const uint8_t *, const int );
+static int      steim_word_unpack( const uint32_t, const int, const int, int32_t * );
+static int      steim_decode( const uint8_t *, const int, const int, const int, const int, int32_t * );
+static void     steim_integrate( int32_t *, const int );
+static void     steim_integrate_scalar( int32_t *, const int );
+#ifdef PALERTC_SIMD_X86
+static void     steim_integrate_sse2( int32_t *, const int ) __attribute__((target("sse2")));
+static void     steim_integrate_avx2( int32_t *, const int ) __attribute__((target("avx2")));
+#endif
+
+/* Internal static variables */
+static uint64_t Steim_Mismatches = 0;  /* Records of which the last sample is different from the reverse constant */
+
+/* Sign extension for the n-bits integer inside the Steim word */
+#define STEIM_SIGN_EXTEND(_WORD, _NBITS) \
+		((int32_t)((uint32_t)(_WORD) << (32 - (_NBITS))) >> (32 - (_NBITS)))
 
 /**
  * @brief
@@ -96,3 +120,453 @@ int pac_m4_crc_check( const PALERT_M4_PACKET *packet )
 {
 	return misc_crc16_cal( packet, PALERT_M4_CRC16_CAL_LENGTH ) ? 0 : 1;
 }
+
+/**
+ * @brief Decode all the Streamline mini-SEED records inside the packet, one record for one channel. Each
+ *        buffer should be able to hold PALERT_MAX_SAMPRATE samples.
+ *
+ * @param packet
+ * @param nbuf
+ * @param buffer
+ * @return int The number of the decoded records, or -1 for the broken packet.
+ */
+int pac_m4_data_extract( const PALERT_M4_PACKET *packet, int nbuf, int32_t *buffer[] )
+{
+/* Shortcut for the packet data */
+	const uint8_t       *data_ptr = &packet->bytes[PALERT_M4_HEADER_LENGTH];
+	const uint8_t * const data_end = &packet->bytes[PALERT_M4_PACKETLEN_GET( &packet->header )];
+	const PALERT_M4_SMSR_HEADER *smsrh;
+/* */
+	int      result = 0;
+	int      msrlength;
+	int32_t  dumping[PALERT_MAX_SAMPRATE];  /* Zero init. is unnecessary */
+
+/* Go thru all the records */
+	for ( int i = 0; data_ptr < data_end; i++, data_ptr += msrlength ) {
+		smsrh     = (const PALERT_M4_SMSR_HEADER *)data_ptr;
+		msrlength = PALERT_M4_SMSR_LENGTH_GET( smsrh );
+		if ( msrlength < (int)sizeof(PALERT_M4_SMSR_HEADER) || (data_ptr + msrlength) > data_end )
+			return -1;
+	/* */
+		if ( pac_m4_smsr_data_extract( smsrh, (i < nbuf && buffer[i]) ? buffer[i] : dumping, PALERT_MAX_SAMPRATE ) < 0 )
+			return -1;
+		result++;
+	}
+
+	return result;
+}
+
+/**
+ * @brief Get the sample number of the Streamline mini-SEED record.
+ *
+ * @param smsrh
+ * @return int
+ */
+int pac_m4_smsr_nsamp_get( const PALERT_M4_SMSR_HEADER *smsrh )
+{
+	return smsr_word_get( smsrh->numsamples, smsr_header_is_little( smsrh ) );
+}
+
+/**
+ * @brief Get the nominal sampling rate of the Streamline mini-SEED record.
+ *
+ * @param smsrh
+ * @return double
+ */
+double pac_m4_smsr_samprate_get( const PALERT_M4_SMSR_HEADER *smsrh )
+{
+	const int     little = smsr_header_is_little( smsrh );
+	const int16_t factor = (int16_t)smsr_word_get( smsrh->samprate_fact, little );
+	const int16_t mult   = (int16_t)smsr_word_get( smsrh->samprate_mult, little );
+	double        result = 0.0;
+
+/* The same as the definition in SEED manual */
+	if ( factor > 0 )
+		result = (double)factor;
+	else if ( factor < 0 )
+		result = -1.0 / (double)factor;
+/* */
+	if ( mult > 0 )
+		result *= (double)mult;
+	else if ( mult < 0 )
+		result = -1.0 * (result / (double)mult);
+
+	return result;
+}
+
+/**
+ * @brief Parse the start time of the Streamline mini-SEED record to calendar time(UTC)
+ *
+ * @param smsrh
+ * @return double
+ */
+double pac_m4_smsr_starttime_get( const PALERT_M4_SMSR_HEADER *smsrh )
+{
+	const int little = smsr_header_is_little( smsrh );
+	double    result =
+		misc_mktime(
+			smsr_word_get( smsrh->year, little ),
+			1,
+			smsr_word_get( smsrh->day, little ),
+			smsrh->hour,
+			smsrh->min,
+			smsrh->sec
+		) + smsr_word_get( smsrh->fract, little ) / 10000.0;
+
+/* Bit 1 of the activity flags indicates if the time correction has been applied */
+	if ( !(smsrh->act_flags & 0x02) )
+		result += (int32_t)smsr_dword_get( smsrh->time_correct, little ) / 10000.0;
+
+	return result;
+}
+
+/**
+ * @brief Get the number of the Steim records that failed the integrity check since the start. Those records are
+ *        still decoded, this is the only sign of them.
+ *
+ * @return uint64_t
+ */
+uint64_t pac_m4_steim_mismatch_get( void )
+{
+	return __atomic_load_n(&Steim_Mismatches, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Decode the samples of the Streamline mini-SEED record into the buffer without any allocation.
+ *
+ * @param smsrh
+ * @param buffer
+ * @param max_samples
+ * @return int The number of decoded samples, or -1 for the unsupported or broken record.
+ */
+int pac_m4_smsr_data_extract( const PALERT_M4_SMSR_HEADER *smsrh, int32_t *buffer, const int max_samples )
+{
+	const int      little   = smsr_header_is_little( smsrh );
+	const int      nsamp    = smsr_word_get( smsrh->numsamples, little );
+	const int      offset   = smsr_word_get( smsrh->data_offset, little );
+	const int      length   = PALERT_M4_SMSR_LENGTH_GET( smsrh );
+	const int      data_len = length - offset;
+	const uint8_t *data_ptr = (uint8_t *)smsrh + offset;
+/* The byte order of data is defined in blockette 1000, 1 for big-endian & 0 for little-endian */
+	const int      data_little = !smsrh->byteorder;
+
+/* */
+	if ( nsamp > max_samples || offset < (int)sizeof(PALERT_M4_SMSR_HEADER) || data_len < 0 )
+		return -1;
+/* */
+	switch ( smsrh->encoding ) {
+	case PALERT_M4_ENCODING_INT16:
+		if ( (nsamp << 1) > data_len )
+			return -1;
+		for ( int i = 0; i < nsamp; i++, data_ptr += 2 )
+			buffer[i] = (int16_t)smsr_word_get( data_ptr, data_little );
+		break;
+	case PALERT_M4_ENCODING_INT32:
+		if ( (nsamp << 2) > data_len )
+			return -1;
+		for ( int i = 0; i < nsamp; i++, data_ptr += 4 )
+			buffer[i] = (int32_t)smsr_dword_get( data_ptr, data_little );
+		break;
+	case PALERT_M4_ENCODING_STEIM1:
+		return steim_decode( data_ptr, data_len / PALERT_M4_STEIM_FRAME_LENGTH, nsamp, data_little, 0, buffer );
+	case PALERT_M4_ENCODING_STEIM2:
+		return steim_decode( data_ptr, data_len / PALERT_M4_STEIM_FRAME_LENGTH, nsamp, data_little, 1, buffer );
+	default:
+		return -1;
+	}
+
+	return nsamp;
+}
+
+/**
+ * @brief Check the byte order of the record header by the year field, just like what libmseed does.
+ *
+ * @param smsrh
+ * @return int 1 for little-endian, 0 for big-endian.
+ */
+static int smsr_header_is_little( const PALERT_M4_SMSR_HEADER *smsrh )
+{
+	const uint16_t year = smsr_word_get( smsrh->year, 0 );
+
+	return year < 1900 || year > 2100;
+}
+
+/**
+ * @brief
+ *
+ * @param word
+ * @param little
+ * @return uint16_t
+ */
+static uint16_t smsr_word_get( const uint8_t *word, const int little )
+{
+	return little ?
+		(((uint16_t)word[1] << 8) | (uint16_t)word[0]) :
+		(((uint16_t)word[0] << 8) | (uint16_t)word[1]);
+}
+
+/**
+ * @brief
+ *
+ * @param dword
+ * @param little
+ * @return uint32_t
+ */
+static uint32_t smsr_dword_get( const uint8_t *dword, const int little )
+{
+	return little ?
+		(((uint32_t)dword[3] << 24) | ((uint32_t)dword[2] << 16) | ((uint32_t)dword[1] << 8) | (uint32_t)dword[0]) :
+		(((uint32_t)dword[0] << 24) | ((uint32_t)dword[1] << 16) | ((uint32_t)dword[2] << 8) | (uint32_t)dword[3]);
+}
+
+/**
+ * @brief Unpack the differences inside one Steim data word by its nibble.
+ *
+ * @param word
+ * @param nibble
+ * @param steim2
+ * @param diffs
+ * @return int The number of differences, or -1 for the illegal word.
+ */
+static int steim_word_unpack( const uint32_t word, const int nibble, const int steim2, int32_t *diffs )
+{
+	int nbits;
+	int ndiffs;
+
+/* */
+	switch ( nibble ) {
+	case 0:
+		return 0;
+	case 1:
+		nbits  = 8;
+		ndiffs = 4;
+		break;
+	case 2:
+		if ( !steim2 ) {
+			nbits  = 16;
+			ndiffs = 2;
+			break;
+		}
+	/* Steim2 use the first two bits as the sub-nibble */
+		switch ( word >> 30 ) {
+		case 1:
+			nbits  = 30;
+			ndiffs = 1;
+			break;
+		case 2:
+			nbits  = 15;
+			ndiffs = 2;
+			break;
+		case 3:
+			nbits  = 10;
+			ndiffs = 3;
+			break;
+		default:
+			return -1;
+		}
+		break;
+	case 3: default:
+		if ( !steim2 ) {
+			nbits  = 32;
+			ndiffs = 1;
+			break;
+		}
+	/* */
+		switch ( word >> 30 ) {
+		case 0:
+			nbits  = 6;
+			ndiffs = 5;
+			break;
+		case 1:
+			nbits  = 5;
+			ndiffs = 6;
+			break;
+		case 2:
+			nbits  = 4;
+			ndiffs = 7;
+			break;
+		default:
+			return -1;
+		}
+		break;
+	}
+/* The first difference is in the most significant bits */
+	for ( int i = 0; i < ndiffs; i++ )
+		diffs[i] = STEIM_SIGN_EXTEND( word >> (nbits * (ndiffs - 1 - i)), nbits );
+
+	return ndiffs;
+}
+
+/**
+ * @brief Decode the Steim1 or Steim2 frames. The differences are unpacked into the output first, then the
+ *        first difference is replaced by the forward integration constant and the whole output is integrated
+ *        at once. Finally, the last sample should be equal to the reverse integration constant. Just like
+ *        libmseed, the mismatched one is only counted but not dropped, the samples before the damaged one are
+ *        still good.
+ *
+ * @param frames
+ * @param nframes
+ * @param nsamp
+ * @param little
+ * @param steim2
+ * @param output
+ * @return int The number of decoded samples, or -1 for the broken frames.
+ */
+static int steim_decode(
+	const uint8_t *frames, const int nframes, const int nsamp, const int little, const int steim2, int32_t *output
+) {
+	int      result = 0;
+	int      ndiffs;
+	int32_t  diffs[7];
+	int32_t  x0;
+	int32_t  xn;
+	uint32_t ctrl;
+
+/* */
+	if ( nsamp <= 0 )
+		return 0;
+	if ( nframes <= 0 )
+		return -1;
+/* Forward & reverse integration constants, they are also the first & last samples */
+	x0 = (int32_t)smsr_dword_get( frames + 4, little );
+	xn = (int32_t)smsr_dword_get( frames + 8, little );
+/* */
+	for ( int i = 0; i < nframes && result < nsamp; i++, frames += PALERT_M4_STEIM_FRAME_LENGTH ) {
+		ctrl = smsr_dword_get( frames, little );
+	/* Word 1 & 2 of the first frame are the integration constants */
+		for ( int j = i ? 1 : 3; j < 16 && result < nsamp; j++ ) {
+			ndiffs = steim_word_unpack(
+				smsr_dword_get( frames + (j << 2), little ), (ctrl >> (30 - (j << 1))) & 0x03, steim2, diffs
+			);
+			if ( ndiffs < 0 )
+				return -1;
+		/* */
+			for ( int k = 0; k < ndiffs && result < nsamp; k++ )
+				output[result++] = diffs[k];
+		}
+	}
+/* */
+	if ( result != nsamp )
+		return -1;
+/* */
+	output[0] = x0;
+	steim_integrate( output, nsamp );
+	if ( output[nsamp - 1] != xn )
+		__atomic_fetch_add(&Steim_Mismatches, 1, __ATOMIC_RELAXED);
+
+	return nsamp;
+}
+
+/**
+ * @brief Integrate the differences by the fastest kernel that the running CPU supports.
+ *
+ * @param data
+ * @param nsamp
+ */
+static void steim_integrate( int32_t *data, const int nsamp )
+{
+	switch ( misc_simd_level_get() ) {
+#ifdef PALERTC_SIMD_X86
+	case PALERT_SIMD_AVX2:
+		steim_integrate_avx2( data, nsamp );
+		break;
+	case PALERT_SIMD_SSE41: case PALERT_SIMD_SSSE3: case PALERT_SIMD_SSE2:
+		steim_integrate_sse2( data, nsamp );
+		break;
+#endif
+	case PALERT_SIMD_NONE: default:
+		steim_integrate_scalar( data, nsamp );
+		break;
+	}
+
+	return;
+}
+
+/**
+ * @brief In-place prefix sum of the differences, the overflow is wrapped around just like the encoder.
+ *
+ * @param data
+ * @param nsamp
+ */
+static void steim_integrate_scalar( int32_t *data, const int nsamp )
+{
+	uint32_t sum = 0;
+
+	for ( int i = 0; i < nsamp; i++ ) {
+		sum    += (uint32_t)data[i];
+		data[i] = (int32_t)sum;
+	}
+
+	return;
+}
+
+#ifdef PALERTC_SIMD_X86
+/**
+ * @brief In-place prefix sum of the differences with four lanes, then carry the last lane to the next block.
+ *
+ * @param data
+ * @param nsamp
+ */
+static void steim_integrate_sse2( int32_t *data, const int nsamp )
+{
+	int     i = 0;
+	__m128i carry = _mm_setzero_si128();
+	__m128i block;
+
+/* */
+	for ( ; i + 4 <= nsamp; i += 4 ) {
+		block = _mm_loadu_si128((__m128i *)(data + i));
+		block = _mm_add_epi32(block, _mm_slli_si128(block, 4));
+		block = _mm_add_epi32(block, _mm_slli_si128(block, 8));
+		block = _mm_add_epi32(block, carry);
+		_mm_storeu_si128((__m128i *)(data + i), block);
+		carry = _mm_shuffle_epi32(block, 0xFF);
+	}
+/* The remains */
+	if ( i < nsamp ) {
+		if ( i )
+			data[i] = (int32_t)((uint32_t)data[i] + (uint32_t)data[i - 1]);
+		steim_integrate_scalar( data + i, nsamp - i );
+	}
+
+	return;
+}
+
+/**
+ * @brief In-place prefix sum of the differences with eight lanes.
+ *
+ * @param data
+ * @param nsamp
+ */
+static void steim_integrate_avx2( int32_t *data, const int nsamp )
+{
+	int           i = 0;
+	const __m256i last_lo = _mm256_setr_epi32(0, 0, 0, 0, 3, 3, 3, 3);
+	const __m256i last_hi = _mm256_set1_epi32(7);
+	__m256i       carry   = _mm256_setzero_si256();
+	__m256i       block;
+
+/* */
+	for ( ; i + 8 <= nsamp; i += 8 ) {
+		block = _mm256_loadu_si256((__m256i *)(data + i));
+	/* Prefix sum inside each 128 bits lane */
+		block = _mm256_add_epi32(block, _mm256_slli_si256(block, 4));
+		block = _mm256_add_epi32(block, _mm256_slli_si256(block, 8));
+	/* Then add the sum of lower lane to the upper lane */
+		block = _mm256_add_epi32(
+			block, _mm256_blend_epi32(_mm256_setzero_si256(), _mm256_permutevar8x32_epi32(block, last_lo), 0xF0)
+		);
+		block = _mm256_add_epi32(block, carry);
+		_mm256_storeu_si256((__m256i *)(data + i), block);
+		carry = _mm256_permutevar8x32_epi32(block, last_hi);
+	}
+/* The remains */
+	if ( i < nsamp ) {
+		if ( i )
+			data[i] = (int32_t)((uint32_t)data[i] + (uint32_t)data[i - 1]);
+		steim_integrate_scalar( data + i, nsamp - i );
+	}
+
+	return;
+}
+#endif
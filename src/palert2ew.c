@@ -25,6 +25,7 @@
 #include <signal.h>
 #include <ctype.h>
 #include <time.h>
+#include <float.h>
 
 /**
  * @name Earthworm environment header include
@@ -46,8 +47,15 @@
 #include <palert2ew_misc.h>
 #include <palert2ew_list.h>
 #include <palert2ew_client.h>
+#include <palert2ew_decode.h>
 #include <palert2ew_server.h>
 #include <palert2ew_msg_queue.h>
+#include <palert2ew_mseed.h>
+#include <palert2ew_sink.h>
+#include <palert2ew_log.h>
+#include <palert2ew_latency.h>
+#include <palert2ew_metrics.h>
+#include <palert2ew_capture.h>
 
 /**
  * @brief Internal stack related struct
@@ -60,6 +68,15 @@ typedef struct {
 	uint8_t buffer[65536];
 } LABELED_DATA;
 
+/**
+ * @brief Argument of writing the metrics of each connection
+ *
+ */
+typedef struct {
+	FILE *fp;
+	int   packets;  /* 0 for the bytes, 1 for the packets */
+} CONN_METRICS_ARG;
+
 /**
  * @name Internal functions' prototype
  *
@@ -68,6 +85,10 @@ static void palert2ew_config( char * );
 static void palert2ew_lookup( void );
 static void palert2ew_status( unsigned char, short, char * );
 static void palert2ew_end( void );                /* Free all the local memory & close socket */
+static void report_queue_overload( void );
+static void report_metrics( void );
+static void write_metrics( FILE * );
+static void write_conn_metrics( const void *, const int, void * );
 
 static void    check_receiver_client( const int );
 static void    check_receiver_server( const int );
@@ -76,12 +97,21 @@ static thr_ret receiver_server_thread( void * );  /* Read messages from the sock
 static thr_ret update_list_thread( void * );
 
 static int     update_list_configfile( char * );
-static void    process_packet_pm1( const void *, _STAINFO *, const char [2] );
-static void    process_packet_pm4( const void *, _STAINFO *, const char [2] );
-static void    process_packet_pm16( const void *, _STAINFO *, const char [2] );
+static void    process_packet_pm1( const void *, _STAINFO *, const PA2EW_DECODED *, const char [2] );
+static void    process_packet_pm4( const void *, _STAINFO *, const PA2EW_DECODED *, const char [2] );
+static void    process_packet_pm16( const void *, _STAINFO *, const PA2EW_DECODED *, const char [2] );
+static void    output_wave_message( PA2EW_OUTMSG *, _CHAINFO *, const int );
+static void    put_wave_message( TRACE2_HEADER *, const int );
+static int     aggregate_wave_message( const TRACE2_HEADER *, _CHAINFO *, const int );
+static void    flush_pending_act( void *, const int, void * );
+static int     sink_putmsg( const int, const long, char * );
+static void    sink_commit_all( void );
+static void    mseed_record_handler( char *, int, void * );
 static int     examine_ntp_status( _STAINFO *, const void *, const int );
-static int     check_pkt_crc( const void *, const int );
+static double  packet_sample_time_get( const void *, const int, const _STAINFO * );
+static int     wave_output_index_get( const _STAINFO * );
 static void    handle_signal( void );
+static void    handle_terminate_signal( int );
 
 /**
  * @name Ring messages things
@@ -89,9 +119,17 @@ static void    handle_signal( void );
  */
 #define WAVE_MSG_LOGO  0
 #define RAW_MSG_LOGO   1
-
-static SHM_INFO Region[2];      /* shared memory region to use for i/o       */
-static MSG_LOGO Putlogo[2];     /* array for requesting module, type, instid */
+#define MSEED_MSG_LOGO 2
+#define SHARD_MSG_LOGO 3  /* The first extra wave ring, the others follow it */
+#define MAX_WAVE_SHARDS 8
+#define OUTPUT_NUM     (SHARD_MSG_LOGO + MAX_WAVE_SHARDS)
+/* The output index of the station's wave ring, the default one or the extra shards */
+#define WAVE_OUTPUT_INDEX(STAINFO) \
+		wave_output_index_get( STAINFO )
+
+static PA2EW_SINK *Sink[OUTPUT_NUM];     /* output sinks, the Earthworm rings by default */
+static SHM_INFO   *FlagRegion;  /* ring for the termination flag, NULL without Earthworm ring */
+static MSG_LOGO Putlogo[OUTPUT_NUM];    /* array for requesting module, type, instid */
 static pid_t    MyPid;          /* for restarts by startstop                 */
 
 /**
@@ -103,6 +141,8 @@ static pid_t    MyPid;          /* for restarts by startstop                 */
 #define THREAD_ALIVE  1         /* Thread alive and well                     */
 #define THREAD_ERR   -1         /* Thread encountered error quit             */
 static volatile int     ReceiverThreadsNum = 0;
+static int              ClientSocket = -1;            /* Socket connected to the forward server in client mode */
+static CLIENT_STREAM    ClientStream = { 0 };         /* Framing state of the stream from the forward server */
 static volatile int8_t *MessageReceiverStatus = NULL;
 #if defined( _V710 )
 static ew_thread_t      UpdateThreadID      = 0;          /* Thread id for updating the Palert list       */
@@ -116,17 +156,38 @@ static unsigned        *ReceiverThreadID    = NULL;       /* Thread id for recei
  * @name Things to read or derive from configuration file
  *
  */
-static char     RingName[2][MAX_RING_STR];   /* name of transport ring for i/o    */
+static char     RingName[OUTPUT_NUM][MAX_RING_STR];  /* name of transport ring for i/o */
 static char     MyModName[MAX_MOD_STR];      /* speak as this module name/id      */
 static uint8_t  LogSwitch;                   /* 0 if no logfile should be written */
 static uint64_t HeartBeatInterval;           /* seconds between heartbeats        */
 static uint64_t UpdateInterval = 0;          /* seconds between updating check    */
 static uint64_t QueueSize;                   /* max messages in output circular buffer */
+static uint8_t  QueuePolicy = PA2EW_QUEUE_DROP_OLDEST;  /* overload policy of the main queue */
+static uint32_t QueueMaxWait = 0;            /* max microseconds waiting for the room of main queue */
 static uint8_t  ServerSwitch;                /* 0 connect to Palert server; 1 as the server of Palert */
+static double   FloodLimitFactor = 0.0;      /* multiple of the expected data rate allowed for each Palert, 0.0 for no limit */
+static uint8_t  FloodLimitAction = PA2EW_FLOOD_THROTTLE;  /* 0 throttle the flooding Palert; 1 disconnect it */
 static uint8_t  RawOutputSwitch = 0;
+static uint8_t  MseedOutputSwitch = 0;
+static int      WaveShardNum = 0;            /* number of the extra wave rings */
+static uint8_t  RingBatchSwitch = 0;         /* 0 put each message by transport; 1 commit the messages by batch */
+static int      SinkBackend = PA2EW_SINK_TPORT;  /* backend of the output sinks */
+static char     SinkFile[PA2EW_SINK_MAX_PATH];  /* path of the file sink        */
+static uint64_t SinkMemringSize = PA2EW_SINK_DEF_MEMRING_SIZE;  /* bytes of the memory ring sink */
+static double   MseedFlushLatency = PA2EW_MSEED_DEF_LATENCY;  /* max seconds that the partial record can be held */
 static uint8_t  CheckCRCSwitch = 1;          /* 0 disable the CRC checking; 1 enable the CRC checking */
 static uint8_t  OutputTimeQuestionable = 0;  /* 0 filter out NTP unsychronized stations; 1 allow these stations */
 static uint8_t  ForceOutputIntData = 0;      /* 0 keep the raw data type; 1 force to output integer data type */
+static uint8_t  OutputShortM1Data = 0;       /* 0 widen mode 1 data to 4 bytes integer; 1 keep its native 2 bytes integer */
+static double   AggregateWindow = 0.0;       /* seconds of contiguous data merged into one trace buffer, 0.0 for no merging */
+static double   AggregateLatency = 0.0;      /* max seconds that the merged data can be held */
+static double   LogRateInterval = PA2EW_LOG_DEF_INTERVAL;  /* seconds between the same messages of the hot paths */
+static uint64_t LatencyReportInterval = 0;   /* minutes between the latency summaries, 0 for no measuring */
+static uint8_t  LatencyKernelStamp = 0;      /* 0 stamp the receiving in user space; 1 take the kernel timestamp */
+static char     MetricsListen[PA2EW_METRICS_MAX_LISTEN] = { 0 };  /* port, host:port or UNIX socket of the metrics endpoint */
+static uint8_t  MetricsHeartbeatSwitch = 0;  /* 1 log the summary of metrics with each heartbeat */
+static char     CaptureFile[PA2EW_CAPTURE_MAX_PATH] = { 0 };  /* path of the raw stream capture, empty for no capture */
+static uint64_t CaptureBufferSize = PA2EW_CAPTURE_DEF_BUFFER_SIZE;  /* bytes of the capture ring in memory */
 static char     ServerIP[INET6_ADDRSTRLEN];
 static char     ServerPort[8] = { 0 };
 static uint64_t MaxStationNum;
@@ -139,13 +200,14 @@ static char     SQLChannelTable[MAX_TABLE_LEGTH];
  * @name Things to look up in the earthworm.h tables with getutil.c functions
  *
  */
-static int64_t RingKey[2];      /* key of transport ring for i/o     */
+static int64_t RingKey[OUTPUT_NUM];     /* key of transport ring for i/o     */
 static uint8_t InstId;          /* local installation id             */
 static uint8_t MyModId;         /* Module Id for this program        */
 static uint8_t TypeHeartBeat;
 static uint8_t TypeError;
 static uint8_t TypeTracebuf2 = 0;
 static uint8_t TypePalertRaw = 0;
+static uint8_t TypeMseed = 0;
 
 /**
  * @name Error messages used by palert2ew
@@ -169,6 +231,7 @@ static uint8_t TypePalertRaw = 0;
  *
  */
 static volatile _Bool   Finish = 1;
+static volatile sig_atomic_t TerminateSignal = 0;
 static volatile uint8_t UpdateFlag = LIST_IS_UPDATED;
 
 /**
@@ -184,6 +247,12 @@ int main ( int argc, char **argv )
 	time_t   timeNow;          /* current time                              */
 	time_t   timeLastBeat;     /* time last heartbeat was sent              */
 	time_t   timeLastUpd;      /* time last checked updating list           */
+	time_t   timeLastAggr = 0; /* time last checked the aggregation stage   */
+	time_t   timeLastLatency;  /* time last summarized the latency          */
+	double   aggr_deadline;
+	double   deq_time;
+	uint64_t decode_nsec;
+	int      ntp_synced;
 	char    *lockfile;
 	int32_t  lockfile_fd;
 
@@ -193,8 +262,11 @@ int main ( int argc, char **argv )
 	MSG_LOGO msg_logo   = { 0 };
 	char     idatatype[2];
 	char     fdatatype[2];
+	char     sdatatype[2];
+	char    *datatype;
 
 	LABELED_DATA *data_ptr = NULL;
+	PA2EW_DECODED decoded  = { 0 };
 	void (*check_receiver_func)( const int ) = NULL;
 
 /* Check command line arguments */
@@ -222,6 +294,9 @@ int main ( int argc, char **argv )
 		fdatatype[0] = ForceOutputIntData ? idatatype[0] : 'f';
 		idatatype[1] = fdatatype[1] = '4';
 	}
+/* The datatype of mode 1 packets, it might keep the native 2 bytes integer */
+	sdatatype[0] = idatatype[0];
+	sdatatype[1] = OutputShortM1Data ? '2' : '4';
 /* Read the station list from remote database */
 	if ( pa2ew_list_db_fetch( SQLStationTable, SQLChannelTable, &DBInfo, PA2EW_LIST_INITIALIZING ) < 0 ) {
 		fprintf(stderr, "Something error when fetching station list. Exiting!\n");
@@ -241,6 +316,9 @@ int main ( int argc, char **argv )
 	palert2ew_lookup();
 /* Reinitialize logit to desired logging level */
 	logit_init(argv[1], 0, 256, LogSwitch);
+/* The messages of the hot paths are logged by the background writer */
+	if ( pa2ew_log_init( LogRateInterval ) )
+		logit("e", "palert2ew: Cannot start the background log writer, log the messages directly!\n");
 	lockfile = ew_lockfile_path(argv[1]);
 	if ( (lockfile_fd = ew_lockfile(lockfile) ) == -1 ) {
 		fprintf(stderr, "One instance of %s is already running. Exiting!\n", argv[0]);
@@ -266,21 +344,87 @@ int main ( int argc, char **argv )
 	Putlogo[RAW_MSG_LOGO].instid  = InstId;
 	Putlogo[RAW_MSG_LOGO].mod     = MyModId;
 	Putlogo[RAW_MSG_LOGO].type    = TypePalertRaw;
-/* Attach to Output shared memory ring */
-	for ( i = 0; i < 2; i++ ) {
-		if ( RingKey[i] == -1 ) {
-			Region[i].key = RingKey[i];
+	Putlogo[MSEED_MSG_LOGO].instid = InstId;
+	Putlogo[MSEED_MSG_LOGO].mod    = MyModId;
+	Putlogo[MSEED_MSG_LOGO].type   = TypeMseed;
+	for ( i = SHARD_MSG_LOGO; i < OUTPUT_NUM; i++ )
+		Putlogo[i] = Putlogo[WAVE_MSG_LOGO];
+/* Attach to Output shared memory ring, or open the other sink shared by all the outputs */
+	for ( i = 0; i < OUTPUT_NUM; i++ ) {
+		if ( RingKey[i] == -1 )
+			continue;
+		if ( SinkBackend == PA2EW_SINK_TPORT ) {
+			Sink[i] = pa2ew_sink_tport_open( RingKey[i], RingBatchSwitch );
+			logit("", "palert2ew: Attached to public memory region %s: %ld\n", &RingName[i][0], RingKey[i]);
+		}
+		else if ( i != WAVE_MSG_LOGO ) {
+			Sink[i] = Sink[WAVE_MSG_LOGO];
+			continue;
+		}
+		else if ( SinkBackend == PA2EW_SINK_MEMRING ) {
+			Sink[i] = pa2ew_sink_memring_open( SinkMemringSize );
+		}
+		else if ( SinkBackend == PA2EW_SINK_FILE ) {
+			Sink[i] = pa2ew_sink_file_open( SinkFile );
 		}
 		else {
-			tport_attach(&Region[i], RingKey[i]);
-			logit("", "palert2ew: Attached to public memory region %s: %ld\n", &RingName[i][0], RingKey[i]);
+			Sink[i] = pa2ew_sink_discard_open();
+		}
+	/* */
+		if ( !Sink[i] ) {
+			logit("e", "palert2ew: Cannot open the output sink of %s. Exiting!\n", &RingName[i][0]);
+			while ( --i >= 0 )
+				pa2ew_sink_close( Sink[i] );
+			pa2ew_list_end();
+			exit(-1);
 		}
 	}
+/* Without the Earthworm ring, there is no termination flag; take the signals instead */
+	if ( !(FlagRegion = pa2ew_sink_region_get( Sink[WAVE_MSG_LOGO] )) ) {
+		logit("o", "palert2ew: Output to the %s sink, terminate it by SIGINT or SIGTERM.\n", Sink[WAVE_MSG_LOGO]->ops->name);
+		signal(SIGINT, handle_terminate_signal);
+		signal(SIGTERM, handle_terminate_signal);
+	}
+/* The mini-SEED records of each channel will be put into its own ring */
+	if ( MseedOutputSwitch )
+		pa2ew_mseed_init( mseed_record_handler, NULL, MseedFlushLatency );
+/* Build the CRC tables & detect the SIMD level before any receiving or decoding thread */
+	pac_init();
+	pa2ew_crc8_init();
+/* Measure the latency of each stage, it should be ready before any receiving thread */
+	if ( LatencyReportInterval && (i = pa2ew_latency_init( LatencyKernelStamp, MaxStationNum )) ) {
+		if ( i < 0 ) {
+			logit("e", "palert2ew: Cannot allocate the latency histograms, skip the measuring!\n");
+			LatencyReportInterval = 0;
+		}
+		else {
+			logit("e", "palert2ew: The kernel timestamp is not supported, stamp the receiving in user space!\n");
+		}
+	}
+/* Capture the raw stream, it should be ready before any receiving thread */
+	if ( strlen(CaptureFile) && pa2ew_capture_init( CaptureFile, CaptureBufferSize ) ) {
+		logit("e", "palert2ew: Cannot open the capture file %s, skip the capturing!\n", CaptureFile);
+		CaptureFile[0] = '\0';
+	}
 /* Initialize the message queue */
-	pa2ew_msgqueue_init( (unsigned long)QueueSize, sizeof(LABELED_DATA) );
+	if ( pa2ew_msgqueue_init( (unsigned long)QueueSize, sizeof(LABELED_DATA), QueuePolicy, QueueMaxWait ) ) {
+		logit("e", "palert2ew: Cannot initialize the main queue. Exiting!\n");
+		pa2ew_list_end();
+		exit(-1);
+	}
+/* Start counting before any receiving thread, the endpoint reads the sinks & the main queue */
+	if ( pa2ew_metrics_init( MetricsListen, write_metrics ) )
+		logit("e", "palert2ew: Cannot start the metrics endpoint on %s, skip it!\n", MetricsListen);
 /* */
 	buffer   = calloc(1, sizeof(LABELED_DATA));
 	data_ptr = (LABELED_DATA *)buffer;
+/* The set of output messages for decoding, one for each channel */
+	if ( (decoded.outmsg = calloc(PA2EW_MAX_CHAN_PER_STA, sizeof(PA2EW_OUTMSG))) == NULL ) {
+		logit("e", "palert2ew: Cannot allocate the output messages. Exiting!\n");
+		pa2ew_msgqueue_end();
+		pa2ew_list_end();
+		exit(-1);
+	}
 
 /* Initialize the threads' parameters */
 	MessageReceiverStatus = calloc(ReceiverThreadsNum, sizeof(int8_t));
@@ -293,12 +437,16 @@ int main ( int argc, char **argv )
 /* Force a heartbeat to be issued in first pass thru main loop */
 	timeLastBeat   = time(&timeNow) - HeartBeatInterval - 1;
 	timeLastUpd    = timeNow + 1;
+	timeLastLatency = timeNow;
 /*----------------------- setup done; start main loop -------------------------*/
 	while ( 1 ) {
 	/* Send palert2ew's heartbeat */
 		if ( time(&timeNow) - timeLastBeat >= (int64_t)HeartBeatInterval ) {
 			timeLastBeat = timeNow;
 			palert2ew_status( TypeHeartBeat, 0, "" );
+			report_queue_overload();
+			if ( MetricsHeartbeatSwitch )
+				report_metrics();
 		}
 	/* Start the check of updating list thread */
 		if ( UpdateInterval && UpdateFlag == LIST_NEED_UPDATED && (timeNow - timeLastUpd) >= (int64_t)UpdateInterval ) {
@@ -306,14 +454,26 @@ int main ( int argc, char **argv )
 			if ( StartThreadWithArg(update_list_thread, argv[1], (uint32_t)THREAD_STACK, &UpdateThreadID) == -1 )
 				logit("e", "palert2ew: Error starting update_list thread, just skip it!\n");
 		}
+	/* Summarize the latency of each stage */
+		if ( LatencyReportInterval && (timeNow - timeLastLatency) >= (int64_t)LatencyReportInterval * 60 ) {
+			timeLastLatency = timeNow;
+			pa2ew_latency_report();
+		}
 	/* Start the message receiving thread if it isn't running. */
 		check_receiver_func( 50 );
+	/* Put those merged data & partial records which have been held over the latency cap */
+		if ( (AggregateWindow > 0.0 || MseedOutputSwitch) && timeNow != timeLastAggr ) {
+			timeLastAggr  = timeNow;
+			aggr_deadline = pa2ew_timenow_get();
+			pa2ew_list_walk( flush_pending_act, &aggr_deadline );
+			sink_commit_all();
+		}
 
 	/* Process all new messages */
 		count = 0;
 		do {
 		/* See if a termination has been requested */
-			i = tport_getflag( &Region[0] );
+			i = FlagRegion ? tport_getflag( FlagRegion ) : TerminateSignal ? TERMINATE : 0;
 			if ( i == TERMINATE || i == MyPid ) {
 			/* Write a termination msg to log file */
 				logit("t", "palert2ew: Termination requested; exiting!\n");
@@ -323,6 +483,7 @@ int main ( int argc, char **argv )
 		/* */
 			if ( pa2ew_msgqueue_dequeue( buffer, &msg_size, &msg_logo ) < 0 )
 				break;
+			deq_time = pa2ew_latency_timenow_get();
 		/* Just in case */
 			if ( data_ptr->label.staptr == NULL )
 				continue;
@@ -330,44 +491,78 @@ int main ( int argc, char **argv )
 			if ( msg_logo.type == PA2EW_MSG_CLIENT_STREAM || msg_logo.type == PA2EW_MSG_SERVER_NORMAL ) {
 				count++;
 				msg_size -= data_ptr->buffer - (uint8_t *)data_ptr;
-			/* Check the CRC of the packet if enable this function */
-				if ( CheckCRCSwitch && !check_pkt_crc( data_ptr->buffer, data_ptr->label.packmode ) )
+				datatype  = data_ptr->label.packmode == PALERT_PKT_MODE16 ? fdatatype :
+					data_ptr->label.packmode == PALERT_PKT_MODE4 ? idatatype : sdatatype;
+				pa2ew_metrics_add(
+					data_ptr->label.packmode == PALERT_PKT_MODE16 ? PA2EW_METRIC_FRAMES_MODE16 :
+					data_ptr->label.packmode == PALERT_PKT_MODE4 ? PA2EW_METRIC_FRAMES_MODE4 :
+					data_ptr->label.packmode == PALERT_PKT_MODE2 ? PA2EW_METRIC_FRAMES_MODE2 : PA2EW_METRIC_FRAMES_MODE1, 1
+				);
+			/* Decode the samples & check the CRC of the packet (if enable this function) in the same pass */
+				decode_nsec = pa2ew_metrics_nsec_get();
+				i = pa2ew_decode_packet(
+					data_ptr->buffer, data_ptr->label.packmode, (_STAINFO *)data_ptr->label.staptr, datatype, CheckCRCSwitch, &decoded
+				);
+				pa2ew_metrics_add( PA2EW_METRIC_DECODE_NSEC, pa2ew_metrics_nsec_get() - decode_nsec );
+				pa2ew_metrics_add( PA2EW_METRIC_DECODE_PACKETS, 1 );
+				if ( i < 0 ) {
+					pa2ew_metrics_add( PA2EW_METRIC_CRC_FAILURES, 1 );
 					continue;
+				}
 			/* Put the raw data to the raw ring */
 				if (
 					RawOutputSwitch &&
-					tport_putmsg(&Region[RAW_MSG_LOGO], &Putlogo[RAW_MSG_LOGO], msg_size, (char *)data_ptr->buffer) != PUT_OK
+					sink_putmsg( RAW_MSG_LOGO, msg_size, (char *)data_ptr->buffer ) != PUT_OK
 				) {
-					logit("e", "palert2ew: Error putting message in region %ld\n", RingKey[RAW_MSG_LOGO]);
+					pa2ew_log("e", &RingName[RAW_MSG_LOGO][0], "palert2ew: Error putting message in region %ld\n", RingKey[RAW_MSG_LOGO]);
 				}
 			/* Examine the NTP status; No matter what, here should check the NTP status first */
-				if ( examine_ntp_status( data_ptr->label.staptr, data_ptr->buffer, data_ptr->label.packmode ) || OutputTimeQuestionable ) {
+				if ( !(ntp_synced = examine_ntp_status( data_ptr->label.staptr, data_ptr->buffer, data_ptr->label.packmode )) )
+					pa2ew_metrics_add( PA2EW_METRIC_NTP_QUESTIONABLE, 1 );
+				if ( ntp_synced || OutputTimeQuestionable ) {
 				/* Parse the raw packet to trace buffer */
 					switch ( data_ptr->label.packmode ) {
 					case PALERT_PKT_MODE1:
 					/* We only deal with the Normal Streaming packet(1) in this program!! */
 						if ( PALERT_M1_PACKETTYPE_GET( (PALERT_M1_HEADER *)data_ptr->buffer ) == PALERT_M1_PACKETTYPE_NORMAL )
-							process_packet_pm1( data_ptr->buffer, (_STAINFO *)data_ptr->label.staptr, idatatype );
+							process_packet_pm1( data_ptr->buffer, (_STAINFO *)data_ptr->label.staptr, &decoded, datatype );
 						break;
 					case PALERT_PKT_MODE4:
-						process_packet_pm4( data_ptr->buffer, (_STAINFO *)data_ptr->label.staptr, idatatype );
+						process_packet_pm4( data_ptr->buffer, (_STAINFO *)data_ptr->label.staptr, &decoded, datatype );
 						break;
 					case PALERT_PKT_MODE16:
-						process_packet_pm16( data_ptr->buffer, (_STAINFO *)data_ptr->label.staptr, fdatatype );
+						process_packet_pm16( data_ptr->buffer, (_STAINFO *)data_ptr->label.staptr, &decoded, datatype );
 						break;
 					default:
 						break;
 					}
+				/* Stamp the end of processing, the latency to the output is recorded after the commit */
+					if ( LatencyReportInterval )
+						pa2ew_latency_record(
+							((_STAINFO *)data_ptr->label.staptr)->serial,
+							packet_sample_time_get( data_ptr->buffer, data_ptr->label.packmode, (_STAINFO *)data_ptr->label.staptr ),
+							data_ptr->label.recv_time, data_ptr->label.enq_time, deq_time
+						);
 				}
 			}
 		} while ( count < MaxStationNum ); /* end of message-processing-loop */
+	/* Commit all the messages of these packets under one lock for each ring, then their latency is complete */
+		sink_commit_all();
+		pa2ew_latency_commit();
 	}
 /*-----------------------------end of main loop-------------------------------*/
 exit_procedure:
 	Finish = 0;
 	sleep_ew(1000);
+/* Put all the remaining merged data & partial records */
+	if ( AggregateWindow > 0.0 || MseedOutputSwitch ) {
+		aggr_deadline = DBL_MAX;
+		pa2ew_list_walk( flush_pending_act, &aggr_deadline );
+	}
+	sink_commit_all();
 /* Free local memory */
 	free(buffer);
+	free(decoded.outmsg);
 /* Detach from all the shared memory */
 	palert2ew_end();
 /* Close & remove the locking file descriptor */
@@ -393,6 +588,10 @@ static void palert2ew_config( char *configfile )
 	int   nmiss;        /* number of required commands that were missed   */
 	int   nfiles;
 	int   success;
+/* The wave ring shard lines are resolved after all the files, the default wave ring might be given later */
+	char (*shard_rings)[MAX_RING_STR] = NULL;
+	char **shard_rules = NULL;
+	int    nshard_lines = 0;
 
 /* Set to zero one init flag for each required command */
 	ncommand = 14;
@@ -451,12 +650,72 @@ static void palert2ew_config( char *configfile )
 					strcpy(&RingName[WAVE_MSG_LOGO][0], str);
 				init[2] = 1;
 			}
+			else if ( k_its("OutWaveRingShard") ) {
+				if ( !(str = k_str()) ) {
+					logit("e", "palert2ew: ERROR, the wave ring shard needs the ring name in <%s>. Exiting!\n", configfile);
+					exit(-1);
+				}
+			/* Keep the ring name & the rest (the station rule) until all the files are read */
+				shard_rings = realloc(shard_rings, (nshard_lines + 1) * sizeof(*shard_rings));
+				shard_rules = realloc(shard_rules, (nshard_lines + 1) * sizeof(*shard_rules));
+				if ( !shard_rings || !shard_rules ) {
+					logit("e", "palert2ew: ERROR, allocating the wave ring shard lines. Exiting!\n");
+					exit(-1);
+				}
+				strncpy(shard_rings[nshard_lines], str, MAX_RING_STR - 1);
+				shard_rings[nshard_lines][MAX_RING_STR - 1] = '\0';
+				str = k_get();
+				for ( str += strlen(str) + 1; isspace(*str); str++ );
+				if ( !(shard_rules[nshard_lines++] = strdup(str)) ) {
+					logit("e", "palert2ew: ERROR, allocating the wave ring shard lines. Exiting!\n");
+					exit(-1);
+				}
+			}
 			else if ( k_its("OutRawRing") ) {
 				str = k_str();
 				if ( str )
 					strcpy(&RingName[RAW_MSG_LOGO][0], str);
 				RawOutputSwitch = 1;
 			}
+			else if ( k_its("OutMseedRing") ) {
+				str = k_str();
+				if ( str )
+					strcpy(&RingName[MSEED_MSG_LOGO][0], str);
+				MseedOutputSwitch = 1;
+			}
+			else if ( k_its("RingBatchCommit") ) {
+				RingBatchSwitch = k_int();
+				if ( RingBatchSwitch )
+					logit("o", "palert2ew: Committing the output messages by batch under one ring lock.\n");
+			}
+			else if ( k_its("OutputSink") ) {
+				str = k_str();
+				if ( !str || (SinkBackend = pa2ew_sink_backend_get( str )) < 0 ) {
+					logit("e", "palert2ew: ERROR, unknown output sink <%s> in <%s>. Exiting!\n", str ? str : "", configfile);
+					exit(-1);
+				}
+				logit("o", "palert2ew: Output to the %s sink.\n", str);
+			/* The path of file sink & the size (MB) of memory ring sink */
+				if ( SinkBackend == PA2EW_SINK_FILE ) {
+					if ( !(str = k_str()) ) {
+						logit("e", "palert2ew: ERROR, the file sink needs the path in <%s>. Exiting!\n", configfile);
+						exit(-1);
+					}
+					strncpy(SinkFile, str, PA2EW_SINK_MAX_PATH - 1);
+				}
+				else if ( SinkBackend == PA2EW_SINK_MEMRING ) {
+					if ( (SinkMemringSize = k_long()) > 0 )
+						SinkMemringSize *= 1024 * 1024;
+					else
+						SinkMemringSize = PA2EW_SINK_DEF_MEMRING_SIZE;
+				}
+			}
+			else if ( k_its("MseedFlushLatency") ) {
+				MseedFlushLatency = k_val();
+				if ( MseedFlushLatency <= 0.0 )
+					MseedFlushLatency = PA2EW_MSEED_DEF_LATENCY;
+				logit("o", "palert2ew: Holding the partial mini-SEED record at most %.1f seconds.\n", MseedFlushLatency);
+			}
 		/* 3 */
 			else if ( k_its("HeartBeatInterval") ) {
 				HeartBeatInterval = k_long();
@@ -467,6 +726,130 @@ static void palert2ew_config( char *configfile )
 				QueueSize = k_long();
 				init[4] = 1;
 			}
+			else if ( k_its("QueueOverloadPolicy") ) {
+				QueuePolicy = k_int();
+				switch ( QueuePolicy ) {
+				case PA2EW_QUEUE_DROP_PRIORITY:
+					logit("o", "palert2ew: Main queue overload policy: dropping by station priority.\n");
+					break;
+				case PA2EW_QUEUE_FAIR_SHARE:
+					logit("o", "palert2ew: Main queue overload policy: per-station fair share.\n");
+					break;
+				case PA2EW_QUEUE_DROP_OLDEST: default:
+					QueuePolicy = PA2EW_QUEUE_DROP_OLDEST;
+					logit("o", "palert2ew: Main queue overload policy: dropping the oldest message.\n");
+					break;
+				}
+			}
+			else if ( k_its("QueueMaxWait") ) {
+				QueueMaxWait = k_long();
+				if ( QueueMaxWait )
+					logit("o", "palert2ew: Waiting for the room of main queue at most %u microseconds.\n", QueueMaxWait);
+			}
+			else if ( k_its("StationPriority") ) {
+				int priority = k_int();
+				if ( priority < 0 || priority > PA2EW_MAX_STA_PRIORITY ) {
+					logit(
+						"e", "palert2ew: ERROR, the station priority should be between 0 and %d in <%s>. Exiting!\n",
+						PA2EW_MAX_STA_PRIORITY, configfile
+					);
+					exit(-1);
+				}
+				str = k_get();
+				for ( str += strlen(str) + 1; isspace(*str); str++ );
+				if ( pa2ew_list_rule_line_parse( str, PA2EW_LIST_RULE_PRIORITY, priority ) ) {
+					logit("e", "palert2ew: ERROR, bad station priority rule in <%s>. Exiting!\n", configfile);
+					exit(-1);
+				}
+			}
+			else if ( k_its("FloodLimitFactor") ) {
+				FloodLimitFactor = k_val();
+				if ( FloodLimitFactor > 0.0 ) {
+				/* Less than the expected rate is meaningless */
+					if ( FloodLimitFactor < 1.0 )
+						FloodLimitFactor = 1.0;
+					logit("o", "palert2ew: Limiting the intake of each Palert to %.1f times its expected rate.\n", FloodLimitFactor);
+				}
+				else {
+					FloodLimitFactor = 0.0;
+				}
+			}
+			else if ( k_its("AggregateWindow") ) {
+				AggregateWindow = k_val();
+				if ( AggregateWindow > 0.0 )
+					logit("o", "palert2ew: Merging the contiguous data of each channel up to %.1f seconds.\n", AggregateWindow);
+				else
+					AggregateWindow = 0.0;
+			}
+			else if ( k_its("LogRateInterval") ) {
+				LogRateInterval = k_val();
+				if ( LogRateInterval > 0.0 )
+					logit("o", "palert2ew: Logging the same message of the hot paths at most once per %.1f seconds.\n", LogRateInterval);
+				else
+					LogRateInterval = 0.0;
+			}
+			else if ( k_its("LatencyReportInterval") ) {
+				LatencyReportInterval = k_long();
+				if ( LatencyReportInterval )
+					logit("o", "palert2ew: Measuring the latency of each stage, summarize it every %lu minutes.\n", LatencyReportInterval);
+			}
+			else if ( k_its("LatencyKernelStamp") ) {
+				if ( (LatencyKernelStamp = k_int()) )
+					logit("o", "palert2ew: Take the receiving timestamp from the kernel.\n");
+			}
+			else if ( k_its("MetricsListen") ) {
+				str = k_str();
+				if ( str && strlen(str) < PA2EW_METRICS_MAX_LISTEN ) {
+					strcpy(MetricsListen, str);
+					logit("o", "palert2ew: Serving the metrics on %s.\n", MetricsListen);
+				}
+				else {
+					logit("e", "palert2ew: Invalid metrics endpoint, exiting!\n");
+					exit(-1);
+				}
+			}
+			else if ( k_its("CaptureRawStream") ) {
+				str = k_str();
+				if ( str && strlen(str) < PA2EW_CAPTURE_MAX_PATH ) {
+					strcpy(CaptureFile, str);
+					if ( (CaptureBufferSize = k_long()) > 0 )
+						CaptureBufferSize *= 1024 * 1024;
+					else
+						CaptureBufferSize = PA2EW_CAPTURE_DEF_BUFFER_SIZE;
+					logit(
+						"o", "palert2ew: Capturing the raw stream into %s with %lu MB buffer.\n",
+						CaptureFile, (unsigned long)(CaptureBufferSize / (1024 * 1024))
+					);
+				}
+				else {
+					logit("e", "palert2ew: Invalid capture file, exiting!\n");
+					exit(-1);
+				}
+			}
+			else if ( k_its("MetricsHeartbeatLog") ) {
+				if ( (MetricsHeartbeatSwitch = k_int()) )
+					logit("o", "palert2ew: Log the summary of metrics with each heartbeat.\n");
+			}
+			else if ( k_its("AggregateLatency") ) {
+				AggregateLatency = k_val();
+				if ( AggregateLatency > 0.0 )
+					logit("o", "palert2ew: Holding the merged data at most %.1f seconds.\n", AggregateLatency);
+				else
+					AggregateLatency = 0.0;
+			}
+			else if ( k_its("FloodLimitAction") ) {
+				FloodLimitAction = k_int();
+				if ( FloodLimitAction == PA2EW_FLOOD_DISCONNECT ) {
+					logit(
+						"o", "palert2ew: Disconnecting the Palert which keeps flooding over %d seconds.\n",
+						PA2EW_FLOOD_DISCONNECT_SEC
+					);
+				}
+				else {
+					FloodLimitAction = PA2EW_FLOOD_THROTTLE;
+					logit("o", "palert2ew: Throttling the flooding Palert.\n");
+				}
+			}
 		/* 5 */
 			else if ( k_its("MaxStationNum") ) {
 				MaxStationNum = k_long();
@@ -502,6 +885,11 @@ static void palert2ew_config( char *configfile )
 				if ( ForceOutputIntData )
 					logit("o", "palert2ew: NOTICE!! Forcing all the output data to integer type!\n");
 			}
+			else if ( k_its("OutputShortM1Data") ) {
+				OutputShortM1Data = k_int();
+				if ( OutputShortM1Data )
+					logit("o", "palert2ew: Output the mode 1 data as 2 bytes integer type.\n");
+			}
 		/* 6 */
 			else if ( k_its("ServerSwitch") ) {
 				if ( (ServerSwitch = k_int()) >= 1 ) {
@@ -626,6 +1014,35 @@ static void palert2ew_config( char *configfile )
 		logit("e", "command(s) in <%s>; exiting!\n", configfile);
 		exit(-1);
 	}
+/* Now the default wave ring is known, the same ring shares the same shard, and the default one is shard 0 */
+	for ( int i = 0; i < nshard_lines; i++ ) {
+		int shard;
+		for ( shard = 1; shard <= WaveShardNum; shard++ )
+			if ( !strcmp(&RingName[SHARD_MSG_LOGO + shard - 1][0], shard_rings[i]) )
+				break;
+		if ( !strcmp(&RingName[WAVE_MSG_LOGO][0], shard_rings[i]) ) {
+			shard = 0;
+		}
+		else if ( shard > WaveShardNum ) {
+			if ( WaveShardNum >= MAX_WAVE_SHARDS ) {
+				logit("e", "palert2ew: ERROR, too many wave ring shards (max. %d) in <%s>. Exiting!\n", MAX_WAVE_SHARDS, configfile);
+				exit(-1);
+			}
+			strcpy(&RingName[SHARD_MSG_LOGO + WaveShardNum][0], shard_rings[i]);
+			shard = ++WaveShardNum;
+		}
+	/* */
+		if ( pa2ew_list_rule_line_parse( shard_rules[i], PA2EW_LIST_RULE_SHARD, shard ) ) {
+			logit("e", "palert2ew: ERROR, bad wave ring shard rule <%s> in <%s>. Exiting!\n", shard_rules[i], configfile);
+			exit(-1);
+		}
+		free(shard_rules[i]);
+	}
+	free(shard_rings);
+	free(shard_rules);
+/* Without the latency cap, the merged data can be held as long as the window */
+	if ( AggregateWindow > 0.0 && AggregateLatency <= 0.0 )
+		AggregateLatency = AggregateWindow;
 
 	return;
 }
@@ -654,6 +1071,26 @@ static void palert2ew_lookup( void )
 	else if ( !RawOutputSwitch ) {
 		RingKey[RAW_MSG_LOGO] = -1;
 	}
+	if ( MseedOutputSwitch && (RingKey[MSEED_MSG_LOGO] = GetKey(&RingName[MSEED_MSG_LOGO][0])) == -1 ) {
+		fprintf(
+			stderr, "palert2ew: Invalid ring name <%s>; exiting!\n", &RingName[MSEED_MSG_LOGO][0]
+		);
+		exit(-1);
+	}
+	else if ( !MseedOutputSwitch ) {
+		RingKey[MSEED_MSG_LOGO] = -1;
+	}
+	for ( int i = SHARD_MSG_LOGO; i < OUTPUT_NUM; i++ ) {
+		if ( i >= SHARD_MSG_LOGO + WaveShardNum ) {
+			RingKey[i] = -1;
+		}
+		else if ( (RingKey[i] = GetKey(&RingName[i][0])) == -1 ) {
+			fprintf(
+				stderr, "palert2ew: Invalid ring name <%s>; exiting!\n", &RingName[i][0]
+			);
+			exit(-1);
+		}
+	}
 
 /* Look up installations of interest */
 	if ( GetLocalInst( &InstId ) != 0 ) {
@@ -684,6 +1121,10 @@ static void palert2ew_lookup( void )
 		fprintf(stderr, "palert2ew: Invalid message type <TYPE_PALERTRAW>; exiting!\n");
 		exit(-1);
 	}
+	if ( MseedOutputSwitch && GetType( "TYPE_MSEED", &TypeMseed ) != 0 ) {
+		fprintf(stderr, "palert2ew: Invalid message type <TYPE_MSEED>; exiting!\n");
+		exit(-1);
+	}
 
 	return;
 }
@@ -723,7 +1164,7 @@ static void palert2ew_status( unsigned char type, short ierr, char *note )
 	size = strlen(msg);  /* don't include the null byte in the message */
 
 /* Write the message to shared memory */
-	if ( tport_putmsg(&Region[0], &logo, (long)size, msg) != PUT_OK ) {
+	if ( pa2ew_sink_put( Sink[WAVE_MSG_LOGO], &logo, (long)size, msg ) != PUT_OK ) {
 		if ( type == TypeHeartBeat )
 			logit("et","palert2ew: Error sending heartbeat.\n");
 		else if ( type == TypeError )
@@ -741,9 +1182,14 @@ static void palert2ew_status( unsigned char type, short ierr, char *note )
  */
 static void palert2ew_end( void )
 {
-	tport_detach( &Region[WAVE_MSG_LOGO] );
-	if ( RawOutputSwitch )
-		tport_detach( &Region[RAW_MSG_LOGO] );
+/* The endpoint reads the sinks, the main queue & the connections */
+	pa2ew_metrics_end();
+/* The other sinks are shared by all the outputs */
+	for ( int i = OUTPUT_NUM - 1; i >= 0; i-- ) {
+		if ( Sink[i] && (i == WAVE_MSG_LOGO || Sink[i] != Sink[WAVE_MSG_LOGO]) )
+			pa2ew_sink_close( Sink[i] );
+		Sink[i] = NULL;
+	}
 
 	pa2ew_msgqueue_end();
 	pa2ew_list_end();
@@ -753,6 +1199,185 @@ static void palert2ew_end( void )
 
 	free(ReceiverThreadID);
 	free((int8_t *)MessageReceiverStatus);
+	pa2ew_latency_end();
+	pa2ew_capture_end();
+/* Drain the remaining messages */
+	pa2ew_log_end();
+
+	return;
+}
+
+/**
+ * @brief Report the overload situation of main queue if there is any new dropping.
+ *
+ * @par Returns
+ * 	Nothing.
+ */
+static void report_queue_overload( void )
+{
+	static uint64_t      last_dropped = 0;
+	PA2EW_MSGQUEUE_STATS stats;
+	uint64_t             dropped;
+
+/* */
+	pa2ew_msgqueue_stats_get( &stats );
+	dropped = stats.drop_oldest + stats.drop_priority + stats.drop_fairshare;
+	if ( dropped != last_dropped ) {
+		logit(
+			"et", "palert2ew: Main queue overloaded! Total dropped %lu oldest, %lu by priority & %lu by fair share; "
+			"waited %lu times (%lu timeout); depth %u, high water %u of %lu.\n",
+			stats.drop_oldest, stats.drop_priority, stats.drop_fairshare,
+			stats.wait_count, stats.wait_timeout, stats.depth, stats.high_water, QueueSize
+		);
+		last_dropped = dropped;
+	}
+
+	return;
+}
+
+/**
+ * @brief Log the summary of counters, the main queue & the output sinks.
+ *
+ * @par Returns
+ * 	Nothing.
+ */
+static void report_metrics( void )
+{
+	PA2EW_MSGQUEUE_STATS stats;
+	uint64_t             nfail = 0;
+
+/* */
+	pa2ew_msgqueue_stats_get( &stats );
+	for ( int i = 0; i < OUTPUT_NUM; i++ ) {
+		if ( Sink[i] && (i == WAVE_MSG_LOGO || Sink[i] != Sink[WAVE_MSG_LOGO]) )
+			nfail += __atomic_load_n(&Sink[i]->nfail, __ATOMIC_RELAXED);
+	}
+	logit(
+		"o", "palert2ew: Received %lu bytes & %lu packets (%lu sync errors); processed %lu/%lu/%lu/%lu packets of mode 1/2/4/16, "
+		"%lu CRC failures, %lu NTP questionable, %lu Steim integrity warnings; queue depth %u, high water %u, dropped %lu; "
+		"%lu put failures.\n",
+		(unsigned long)pa2ew_metrics_get( PA2EW_METRIC_RECV_BYTES ),
+		(unsigned long)pa2ew_metrics_get( PA2EW_METRIC_RECV_PACKETS ),
+		(unsigned long)pa2ew_metrics_get( PA2EW_METRIC_SYNC_ERRORS ),
+		(unsigned long)pa2ew_metrics_get( PA2EW_METRIC_FRAMES_MODE1 ),
+		(unsigned long)pa2ew_metrics_get( PA2EW_METRIC_FRAMES_MODE2 ),
+		(unsigned long)pa2ew_metrics_get( PA2EW_METRIC_FRAMES_MODE4 ),
+		(unsigned long)pa2ew_metrics_get( PA2EW_METRIC_FRAMES_MODE16 ),
+		(unsigned long)pa2ew_metrics_get( PA2EW_METRIC_CRC_FAILURES ),
+		(unsigned long)pa2ew_metrics_get( PA2EW_METRIC_NTP_QUESTIONABLE ),
+		(unsigned long)pac_m4_steim_mismatch_get(),
+		stats.depth, stats.high_water, (unsigned long)(stats.drop_oldest + stats.drop_priority + stats.drop_fairshare),
+		(unsigned long)nfail
+	);
+
+	return;
+}
+
+/**
+ * @brief Write the gauges & the counters which are not kept by the metrics module, it's called by the endpoint thread.
+ *
+ * @param fp
+ * @par Returns
+ * 	Nothing.
+ */
+static void write_metrics( FILE *fp )
+{
+	static const double  quantiles[]    = { 0.5, 0.9, 0.99 };
+	static const char   *sink_metrics[] = { "messages", "bytes", "failures" };
+	static const char   *sink_helps[]   = {
+		"Messages put into the output.", "Bytes put into the output.", "Failures of putting into the output."
+	};
+	PA2EW_MSGQUEUE_STATS stats;
+	PA2EW_LATENCY_HIST   hist;
+	const PA2EW_SINK    *sink;
+	CONN_METRICS_ARG     conn_arg;
+
+/* The main queue */
+	pa2ew_msgqueue_stats_get( &stats );
+	fprintf(fp, "# HELP palert2ew_queue_depth Messages inside the main queue.\n# TYPE palert2ew_queue_depth gauge\n");
+	fprintf(fp, "palert2ew_queue_depth %u\n", stats.depth);
+	fprintf(fp, "# HELP palert2ew_queue_high_water The highest depth of the main queue.\n# TYPE palert2ew_queue_high_water gauge\n");
+	fprintf(fp, "palert2ew_queue_high_water %u\n", stats.high_water);
+	fprintf(fp, "# HELP palert2ew_queue_capacity The capacity of the main queue.\n# TYPE palert2ew_queue_capacity gauge\n");
+	fprintf(fp, "palert2ew_queue_capacity %lu\n", (unsigned long)QueueSize);
+	fprintf(fp, "# HELP palert2ew_queue_enqueued_total Messages put into the main queue.\n# TYPE palert2ew_queue_enqueued_total counter\n");
+	fprintf(fp, "palert2ew_queue_enqueued_total %lu\n", (unsigned long)stats.enqueued);
+	fprintf(fp, "# HELP palert2ew_queue_dropped_total Messages dropped by the main queue.\n# TYPE palert2ew_queue_dropped_total counter\n");
+	fprintf(fp, "palert2ew_queue_dropped_total{reason=\"oldest\"} %lu\n", (unsigned long)stats.drop_oldest);
+	fprintf(fp, "palert2ew_queue_dropped_total{reason=\"priority\"} %lu\n", (unsigned long)stats.drop_priority);
+	fprintf(fp, "palert2ew_queue_dropped_total{reason=\"fairshare\"} %lu\n", (unsigned long)stats.drop_fairshare);
+	fprintf(fp, "palert2ew_queue_dropped_total{reason=\"timeout\"} %lu\n", (unsigned long)stats.wait_timeout);
+/* The mode 4 records are kept even when the last sample is different from the reverse integration constant */
+	fprintf(fp, "# HELP palert2ew_steim_integrity_failures_total Steim records failed the integrity check, but still decoded.\n");
+	fprintf(fp, "# TYPE palert2ew_steim_integrity_failures_total counter\n");
+	fprintf(fp, "palert2ew_steim_integrity_failures_total %lu\n", (unsigned long)pac_m4_steim_mismatch_get());
+/* The output sinks, the other sinks are shared by all the outputs. The samples of one metric should be together */
+	for ( int i = 0; i < 3; i++ ) {
+		fprintf(fp, "# HELP palert2ew_output_%s_total %s\n", sink_metrics[i], sink_helps[i]);
+		fprintf(fp, "# TYPE palert2ew_output_%s_total counter\n", sink_metrics[i]);
+		for ( int j = 0; j < OUTPUT_NUM; j++ ) {
+			if ( !(sink = Sink[j]) || (j != WAVE_MSG_LOGO && sink == Sink[WAVE_MSG_LOGO]) )
+				continue;
+			fprintf(
+				fp, "palert2ew_output_%s_total{ring=\"%s\"} %lu\n", sink_metrics[i], RingName[j],
+				(unsigned long)__atomic_load_n(i == 0 ? &sink->nmsg : i == 1 ? &sink->nbytes : &sink->nfail, __ATOMIC_RELAXED)
+			);
+		}
+	}
+/* The connections of Palerts, only under the server mode */
+	if ( ServerSwitch ) {
+		fprintf(fp, "# HELP palert2ew_conn_recv_bytes_total Bytes received from each Palert connection.\n# TYPE palert2ew_conn_recv_bytes_total counter\n");
+		conn_arg.fp      = fp;
+		conn_arg.packets = 0;
+		pa2ew_server_pconnect_walk( write_conn_metrics, &conn_arg );
+		fprintf(fp, "# HELP palert2ew_conn_recv_packets_total Packets received from each Palert connection.\n# TYPE palert2ew_conn_recv_packets_total counter\n");
+		conn_arg.packets = 1;
+		pa2ew_server_pconnect_walk( write_conn_metrics, &conn_arg );
+	}
+/* The latency of each stage, if it's measured */
+	if ( LatencyReportInterval ) {
+		fprintf(fp, "# HELP palert2ew_latency_seconds The latency of each stage.\n# TYPE palert2ew_latency_seconds summary\n");
+		for ( int i = 0; i < PA2EW_LATENCY_STAGE_NUM; i++ ) {
+			if ( pa2ew_latency_stage_get( i, &hist ) )
+				continue;
+			for ( int j = 0; j < (int)(sizeof(quantiles) / sizeof(quantiles[0])); j++ )
+				fprintf(
+					fp, "palert2ew_latency_seconds{stage=\"%s\",quantile=\"%g\"} %.6f\n",
+					pa2ew_latency_stage_name_get( i ), quantiles[j], pa2ew_latency_percentile_get( &hist, quantiles[j] )
+				);
+			fprintf(fp, "palert2ew_latency_seconds_sum{stage=\"%s\"} %.6f\n", pa2ew_latency_stage_name_get( i ), hist.sum * 1.0e-6);
+			fprintf(fp, "palert2ew_latency_seconds_count{stage=\"%s\"} %lu\n", pa2ew_latency_stage_name_get( i ), (unsigned long)hist.count);
+		}
+	}
+
+	return;
+}
+
+/**
+ * @brief Only the fields of the connection itself are used, the station might be freed or replaced by the list
+ *        updating at the same time.
+ *
+ * @param node
+ * @param index
+ * @param arg
+ * @par Returns
+ * 	Nothing.
+ */
+static void write_conn_metrics( const void *node, const int index, void *arg )
+{
+	const CONNDESCRIP      *conn   = (const CONNDESCRIP *)node;
+	const CONN_METRICS_ARG *_arg   = (const CONN_METRICS_ARG *)arg;
+	const uint16_t          serial = __atomic_load_n(&conn->serial, __ATOMIC_RELAXED);
+
+/* Only those connected & identified Palerts */
+	if ( conn->sock < 0 || !serial )
+		return;
+/* */
+	fprintf(
+		_arg->fp, "palert2ew_conn_recv_%s_total{ip=\"%s\",serial=\"%u\"} %lu\n",
+		_arg->packets ? "packets" : "bytes", conn->ip, serial,
+		(unsigned long)__atomic_load_n(_arg->packets ? &conn->recv_packets : &conn->recv_bytes, __ATOMIC_RELAXED)
+	);
 
 	return;
 }
@@ -767,7 +1392,7 @@ static void palert2ew_end( void )
 static void check_receiver_client( const int wait_msec )
 {
 	if ( MessageReceiverStatus[0] != THREAD_ALIVE ) {
-		if ( pa2ew_client_init( ServerIP, ServerPort ) < 0 ) {
+		if ( (ClientSocket = pa2ew_client_init( ServerIP, ServerPort )) < 0 || pa2ew_client_stream_init( &ClientStream ) ) {
 			if ( MessageReceiverStatus[0] != THREAD_ERR ) {
 				logit("e", "palert2ew: Cannot initialize the connection to Palert server. Exiting!\n");
 				palert2ew_end();
@@ -820,7 +1445,7 @@ static void check_receiver_server( const int wait_msec )
 	 * 'cause these sockets are local, it should be much more stable.
 	 * Therefore we just need to check once in the beginning
 	 */
-		if ( pa2ew_server_init( MaxStationNum, PA2EW_PALERT_PORT ) < 1 ) {
+		if ( pa2ew_server_init( MaxStationNum, PA2EW_PALERT_PORT, FloodLimitFactor, FloodLimitAction ) < 1 ) {
 			logit("e","palert2ew: Cannot initialize the Palert server process. Exiting!\n");
 			palert2ew_end();
 			exit(-1);
@@ -864,17 +1489,22 @@ static thr_ret receiver_client_thread( void *dummy )
 	MessageReceiverStatus[0] = THREAD_ALIVE;
 /* Main service loop */
 	do {
-		if ( (ret = pa2ew_client_stream()) ) {
+		if ( (ret = pa2ew_client_stream( &ClientStream, ClientSocket )) ) {
 			if ( ret == PA2EW_RECV_NEED_UPDATE ) {
 				if ( UpdateFlag == LIST_IS_UPDATED )
 					UpdateFlag = LIST_NEED_UPDATED;
 				continue;
 			}
+		/* The framing state goes on with the new connection, just like the seq. of the forward server */
+			if ( ret == PA2EW_RECV_CONNECT_ERROR && (ClientSocket = pa2ew_client_reconnect( ClientSocket )) >= 0 )
+				continue;
 			break;
 		}
 	} while ( Finish );
 /* we're quitting */
-	pa2ew_client_end();
+	pa2ew_client_end( ClientSocket );
+	ClientSocket = -1;
+	pa2ew_client_stream_end( &ClientStream );
 /* File a complaint to the main thread */
 	if ( Finish ) {
 		sleep_ew(1000);
@@ -1031,56 +1661,33 @@ static int update_list_configfile( char *configfile )
  *
  * @param packet
  * @param stainfo
+ * @param decoded
  * @param datatype
  * @par Returns
  * 	Nothing.
  */
-static void process_packet_pm1( const void *packet, _STAINFO *stainfo, const char datatype[2] )
+static void process_packet_pm1( const void *packet, _STAINFO *stainfo, const PA2EW_DECODED *decoded, const char datatype[2] )
 {
-	TracePacket tracebuf;  /* Trace message which is sent to share ring */
-	size_t      data_size  = PALERT_M1_SAMPLE_NUMBER << 2;
-	size_t      total_size = data_size + sizeof(TRACE2_HEADER);
-	_CHAINFO   *chaptr     = (_CHAINFO *)stainfo->chaptr;
-	int32_t    *tb_data    = (int32_t *)(&tracebuf.trh2 + 1);
-	int32_t    *_databuf[PALERT_M1_CHAN_COUNT] = {
-		tb_data + (PALERT_M1_SAMPLE_NUMBER * 0),
-		tb_data + (PALERT_M1_SAMPLE_NUMBER * 1),
-		tb_data + (PALERT_M1_SAMPLE_NUMBER * 2),
-		tb_data + (PALERT_M1_SAMPLE_NUMBER * 3),
-		tb_data + (PALERT_M1_SAMPLE_NUMBER * 4)
-	};
+	TRACE2_HEADER sampinfo;  /* Only the sampling information & the quality are used */
+	PA2EW_OUTMSG *outmsg = decoded->outmsg;  /* The samples are already inside the payload */
+	_CHAINFO     *chaptr = (_CHAINFO *)stainfo->chaptr;
 
-/* Common information part */
-	pa2ew_trh2_init( &tracebuf.trh2 );
-	pa2ew_trh2_scn_enrich( &tracebuf.trh2, stainfo->sta, stainfo->net, stainfo->loc );
+/* Sampling information part, it's common for all the channels */
 	pa2ew_trh2_sampinfo_enrich(
-		&tracebuf.trh2,
-		PALERT_M1_SAMPLE_NUMBER,
+		&sampinfo,
+		decoded->nsamp,
 		UniSampRate ? (double)UniSampRate : (double)PALERT_M1_SAMPRATE_GET( (PALERT_M1_HEADER *)packet ),
 		pac_m1_systime_get( packet, stainfo->timeshift ),
 		datatype
 	);
 /* Time sync. tag */
-	tracebuf.trh2.quality[0] |= stainfo->ntp_errors >= PA2EW_NTP_SYNC_ERR_LIMIT ? TIME_TAG_QUESTIONABLE : 0;
-
-/* Extract all the channels' data */
-	pac_m1_data_extract( packet, _databuf );
+	sampinfo.quality[0] = stainfo->ntp_errors >= PA2EW_NTP_SYNC_ERR_LIMIT ? TIME_TAG_QUESTIONABLE : 0;
 
 /* Output for each channel */
-	for ( int i = 0; i < stainfo->nchannel && i < PALERT_M1_CHAN_COUNT; i++, chaptr++ ) {
-	/* First, enrich the channel code */
-		memcpy(tracebuf.trh2.chan, chaptr->chan, TRACE2_CHAN_LEN);
-		if ( tport_putmsg(&Region[WAVE_MSG_LOGO], &Putlogo[WAVE_MSG_LOGO], total_size, tracebuf.msg) != PUT_OK )
-			logit("e", "palert2ew: Error putting message in region %ld\n", RingKey[WAVE_MSG_LOGO]);
-	/*
-	 * 'cause the total size of tracepacket is 4096 bytes,
-	 * larger than total occupied size of mode 1 data which is 2000 bytes.
-	 * therefore, here we don't need to care about the edge condition (i == 4).
-	 */
-		memcpy(tb_data, _databuf[i + 1], data_size);
-	/* Only keep the end time that is larger than the last end time */
-		chaptr->last_endtime =
-			tracebuf.trh2.endtime > chaptr->last_endtime ? tracebuf.trh2.endtime : chaptr->last_endtime;
+	for ( int i = 0; i < decoded->nchannel; i++, chaptr++, outmsg++ ) {
+	/* Patch the sampling information onto the channel's template, in front of the samples */
+		pa2ew_trh2_template_apply( &outmsg->trh2, PA2EW_CHAINFO_TRH2_GET( chaptr ), &sampinfo );
+		output_wave_message( outmsg, chaptr, WAVE_OUTPUT_INDEX( stainfo ) );
 	}
 
 	return;
@@ -1091,63 +1698,46 @@ static void process_packet_pm1( const void *packet, _STAINFO *stainfo, const cha
  *
  * @param packet
  * @param stainfo
+ * @param decoded Only the output messages are used, the records are decoded here.
  * @param datatype
  * @par Returns
  * 	Nothing.
  */
-static void process_packet_pm4( const void *packet, _STAINFO *stainfo, const char datatype[2] )
+static void process_packet_pm4( const void *packet, _STAINFO *stainfo, const PA2EW_DECODED *decoded, const char datatype[2] )
 {
-	TracePacket       tracebuf;  /* message which is sent to share ring */
-	size_t            msg_size;
-	_CHAINFO         *chaptr   = (_CHAINFO *)stainfo->chaptr;
-	_CHAINFO         *cha_last = (_CHAINFO *)stainfo->chaptr + stainfo->nchannel;
-	PALERT_M4_HEADER *pah4     = (PALERT_M4_HEADER *)packet;
-	uint8_t          *dataptr  = (uint8_t *)(pah4 + 1);
-	uint8_t          *endptr   = (uint8_t *)pah4 + PALERT_M4_PACKETLEN_GET( pah4 );
-	int32_t          *tb_data  = (int32_t *)(&tracebuf.trh2 + 1);
+	PA2EW_OUTMSG          *outmsg   = decoded->outmsg;  /* message which is sent to share ring */
+	TRACE2_HEADER          sampinfo;  /* Only the sampling information & the quality are used */
+	int                    nsamp;
+	_CHAINFO              *chaptr   = (_CHAINFO *)stainfo->chaptr;
+	_CHAINFO              *cha_last = (_CHAINFO *)stainfo->chaptr + stainfo->nchannel;
+	PALERT_M4_HEADER      *pah4     = (PALERT_M4_HEADER *)packet;
+	uint8_t               *dataptr  = (uint8_t *)(pah4 + 1);
+	uint8_t               *endptr   = (uint8_t *)pah4 + PALERT_M4_PACKETLEN_GET( pah4 );
 /* */
-	uint8_t    msbuffer[512];
-	uint16_t   msrlength;
-	MSRecord  *msr  = NULL;
-	SMSRECORD *smsr = NULL;
-
-/* Common information part */
-	pa2ew_trh2_init( &tracebuf.trh2 );
-	pa2ew_trh2_scn_enrich( &tracebuf.trh2, stainfo->sta, stainfo->net, stainfo->loc );
+	uint16_t               msrlength;
+	PALERT_M4_SMSR_HEADER *smsrh = NULL;
+
 /* Time sync. tag */
-	tracebuf.trh2.quality[0] |= stainfo->ntp_errors >= PA2EW_NTP_SYNC_ERR_LIMIT ? TIME_TAG_QUESTIONABLE : 0;
+	sampinfo.quality[0] = stainfo->ntp_errors >= PA2EW_NTP_SYNC_ERR_LIMIT ? TIME_TAG_QUESTIONABLE : 0;
 /* */
 	do {
-		smsr = (SMSRECORD *)dataptr;
-	/* Need to check the byte order */
-		msrlength = (smsr->smsrlength[0] << 8) + smsr->smsrlength[1];
+		smsrh     = (PALERT_M4_SMSR_HEADER *)dataptr;
+		msrlength = PALERT_M4_SMSR_LENGTH_GET( smsrh );
 	/* */
-		if ( msrlength > sizeof(msbuffer) ) {
-			logit("et", "palert2ew: Unexpected error with the mode 4 packet from %s, skip it!\n", stainfo->sta);
+		if ( msrlength < sizeof(PALERT_M4_SMSR_HEADER) || (dataptr + msrlength) > endptr ) {
+			pa2ew_log("et", stainfo->sta, "palert2ew: Unexpected error with the mode 4 packet from %s, skip it!\n", stainfo->sta);
 			break;
 		}
-	/* */
-		memset(msbuffer, 0, sizeof(msbuffer));
-		memcpy(msbuffer, dataptr, msrlength);
-	/* */
-		if ( msr_parse((char *)msbuffer, msrlength, &msr, msrlength, 1, 0) )
-			continue;
-	/* */
-		pa2ew_trh2_sampinfo_enrich(
-			&tracebuf.trh2, msr->numsamples, msr->samprate, (double)(MS_HPTIME2EPOCH(msr->starttime)), datatype
-		);
-		memcpy(tracebuf.trh2.chan, chaptr->chan, TRACE2_CHAN_LEN);
-	/* */
-		msg_size = tracebuf.trh2.nsamp * ms_samplesize(msr->sampletype);
-		memcpy(tb_data, msr->datasamples, msg_size);
-		msr_free(&msr);
-		msg_size += sizeof(TRACE2_HEADER);
-		if ( tport_putmsg(&Region[WAVE_MSG_LOGO], &Putlogo[WAVE_MSG_LOGO], msg_size, tracebuf.msg) != PUT_OK )
-			logit("e", "palert2ew: Error putting message in region %ld\n", RingKey[WAVE_MSG_LOGO]);
-	/* Only keep the end time that is larger than the last end time */
-		chaptr->last_endtime =
-			tracebuf.trh2.endtime > chaptr->last_endtime ? tracebuf.trh2.endtime : chaptr->last_endtime;
+	/* Decode the samples directly into the payload of the output message, the bad record still takes its channel */
+		if ( (nsamp = pac_m4_smsr_data_extract( smsrh, (int32_t *)(&outmsg->trh2 + 1), PA2EW_OUTMSG_MAX_SAMPLES )) >= 0 ) {
+			pa2ew_trh2_sampinfo_enrich(
+				&sampinfo, nsamp, pac_m4_smsr_samprate_get( smsrh ), pac_m4_smsr_starttime_get( smsrh ), datatype
+			);
+			pa2ew_trh2_template_apply( &outmsg->trh2, PA2EW_CHAINFO_TRH2_GET( chaptr ), &sampinfo );
+			output_wave_message( outmsg, chaptr, WAVE_OUTPUT_INDEX( stainfo ) );
+		}
 		chaptr++;
+		outmsg++;
 	} while ( (dataptr += msrlength) < endptr && chaptr < cha_last );
 
 	return;
@@ -1158,70 +1748,240 @@ static void process_packet_pm4( const void *packet, _STAINFO *stainfo, const cha
  *
  * @param packet
  * @param stainfo
+ * @param decoded
  * @param datatype
  * @par Returns
  * 	Nothing.
  */
-static void process_packet_pm16( const void *packet, _STAINFO *stainfo, const char datatype[2] )
+static void process_packet_pm16( const void *packet, _STAINFO *stainfo, const PA2EW_DECODED *decoded, const char datatype[2] )
 {
-/* */
-	static uint8_t databuf[sizeof(PALERT_M16_PACKET)];
-/* */
-	TracePacket    tracebuf;  /* Trace message which is sent to share ring */
-	uint16_t       nsamp      = PALERT_M16_SAMPNUM_GET( (PALERT_M16_HEADER *)packet );
-	size_t         data_size  = nsamp << 2;
-	size_t         total_size = data_size + sizeof(TRACE2_HEADER);
-	_CHAINFO      *chaptr     = (_CHAINFO *)stainfo->chaptr;
-	int32_t       *tb_data    = (int32_t *)(&tracebuf.trh2 + 1);
-	void          *_databuf[stainfo->nchannel];
-
-/* Common information part */
-	pa2ew_trh2_init( &tracebuf.trh2 );
-	pa2ew_trh2_scn_enrich( &tracebuf.trh2, stainfo->sta, stainfo->net, stainfo->loc );
-/* */
+	TRACE2_HEADER sampinfo;  /* Only the sampling information & the quality are used */
+	PA2EW_OUTMSG *outmsg = decoded->outmsg;  /* The samples are already inside the payload */
+	_CHAINFO     *chaptr = (_CHAINFO *)stainfo->chaptr;
+
+/* Sampling information part, it's common for all the channels */
 	pa2ew_trh2_sampinfo_enrich(
-		&tracebuf.trh2,
-		nsamp,
+		&sampinfo,
+		decoded->nsamp,
 		PALERT_M16_SAMPRATE_GET( (PALERT_M16_HEADER *)packet ),
 		pac_m16_sptime_get( (PALERT_M16_HEADER *)packet ),
 		datatype
 	);
 /* Time sync. tag */
-	tracebuf.trh2.quality[0] |= stainfo->ntp_errors >= PA2EW_NTP_SYNC_ERR_LIMIT ? TIME_TAG_QUESTIONABLE : 0;
-
-/* Extract all the channels' data */
-	for ( int i = 0; i < stainfo->nchannel; i++ )
-	/* 'cause the size of data is the same between float & int32_t, here we use the same buffer space */
-		_databuf[i] = (int32_t *)databuf + (nsamp * i);
-/* Select the extract method by pre-defined data type flag */
-	switch ( tracebuf.trh2.datatype[0] ) {
-/* Extract the raw type of data */
-	case 'f': case 't': default:
-		pac_m16_data_extract( packet, stainfo->nchannel, (float **)_databuf );
-		break;
-/* If set to forcing output integer data, then extract the integer data */
-	case 'i': case 's':
-		pac_m16_idata_extract( packet, stainfo->nchannel, (int32_t **)_databuf );
-		break;
-	}
+	sampinfo.quality[0] = stainfo->ntp_errors >= PA2EW_NTP_SYNC_ERR_LIMIT ? TIME_TAG_QUESTIONABLE : 0;
 
 /* Output for each channel */
-	for ( int i = 0; i < stainfo->nchannel; i++, chaptr++ ) {
-	/* First, enrich the channel code */
-		memcpy(tracebuf.trh2.chan, chaptr->chan, TRACE2_CHAN_LEN);
-	/* Then, copy the data from the buffer to the trace buffer */
-		memcpy(tb_data, _databuf[i], data_size);
-	/* Put it into the share ring */
-		if ( tport_putmsg(&Region[WAVE_MSG_LOGO], &Putlogo[WAVE_MSG_LOGO], total_size, tracebuf.msg) != PUT_OK )
-			logit("e", "palert2ew: Error putting message in region %ld\n", RingKey[WAVE_MSG_LOGO]);
-	/* Only keep the end time that is larger than the last end time */
-		chaptr->last_endtime =
-			tracebuf.trh2.endtime > chaptr->last_endtime ? tracebuf.trh2.endtime : chaptr->last_endtime;
+	for ( int i = 0; i < decoded->nchannel; i++, chaptr++, outmsg++ ) {
+	/* Patch the sampling information onto the channel's template, in front of the samples */
+		pa2ew_trh2_template_apply( &outmsg->trh2, PA2EW_CHAINFO_TRH2_GET( chaptr ), &sampinfo );
+	/* Put it into the share ring, it might be split into several messages */
+		output_wave_message( outmsg, chaptr, WAVE_OUTPUT_INDEX( stainfo ) );
 	}
 
 	return;
 }
 
+/**
+ * @brief Output the channel block inside the output message, either merged by the aggregation stage or put
+ *        into the share ring directly.
+ *
+ * @param outmsg The header should be already applied.
+ * @param chaptr
+ * @param index The output index of the station's wave ring.
+ * @par Returns
+ * 	Nothing.
+ */
+static void output_wave_message( PA2EW_OUTMSG *outmsg, _CHAINFO *chaptr, const int index )
+{
+/* Before the output, 'cause the splitting might overwrite some samples */
+	if ( MseedOutputSwitch )
+		pa2ew_mseed_append( chaptr, &outmsg->trh2 );
+/* */
+	if ( AggregateWindow <= 0.0 || aggregate_wave_message( &outmsg->trh2, chaptr, index ) )
+		put_wave_message( &outmsg->trh2, index );
+/* Only keep the end time that is larger than the last end time */
+	chaptr->last_endtime = outmsg->trh2.endtime > chaptr->last_endtime ? outmsg->trh2.endtime : chaptr->last_endtime;
+
+	return;
+}
+
+/**
+ * @brief Put the header & the samples behind it into the share ring. When the payload is larger than one
+ *        trace buffer can hold, it will be split into consecutive trace buffers in place: each piece's header
+ *        is written right in front of its samples, over the tail of the piece which has just been put.
+ *
+ * @param trh2 The header will be restored after output, but the samples under those pieces' header won't.
+ * @param index The output index of the wave ring.
+ * @par Returns
+ * 	Nothing.
+ */
+static void put_wave_message( TRACE2_HEADER *trh2, const int index )
+{
+	const TRACE2_HEADER _trh2     = *trh2;
+	const int           samp_size = _trh2.datatype[1] - '0';
+	const int           max_nsamp = PA2EW_TRACE_MAX_SAMPLES( samp_size );
+	const double        delta     = _trh2.samprate > 0.0 ? 1.0 / _trh2.samprate : 0.0;
+	TRACE2_HEADER      *trh2_ptr  = trh2;
+	int                 offset    = 0;
+
+/* */
+	do {
+		*trh2_ptr = _trh2;
+		if ( _trh2.nsamp > max_nsamp ) {
+			trh2_ptr->nsamp     = _trh2.nsamp - offset > max_nsamp ? max_nsamp : _trh2.nsamp - offset;
+			trh2_ptr->starttime = _trh2.starttime + offset * delta;
+			trh2_ptr->endtime   = trh2_ptr->starttime + (trh2_ptr->nsamp - 1) * delta;
+		}
+	/* */
+		if ( sink_putmsg( index, trh2_ptr->nsamp * samp_size + sizeof(TRACE2_HEADER), (char *)trh2_ptr ) != PUT_OK )
+			pa2ew_log("e", &RingName[index][0], "palert2ew: Error putting message in region %ld\n", RingKey[index]);
+	/* The next header will be placed in front of the next piece of samples */
+		offset  += trh2_ptr->nsamp;
+		trh2_ptr = (TRACE2_HEADER *)((uint8_t *)(trh2 + 1) + offset * samp_size) - 1;
+	} while ( offset < _trh2.nsamp );
+/* Restore the full header for those who still need it */
+	*trh2 = _trh2;
+
+	return;
+}
+
+/**
+ * @brief Append the block behind the pending samples of the channel when they are contiguous, and put the
+ *        merged data once it covers the aggregation window or fills one trace buffer.
+ *
+ * @param trh2 The header & the samples behind it.
+ * @param chaptr
+ * @param index The output index of the wave ring.
+ * @return int
+ * @retval 0 The block is merged.
+ * @retval -1 The block can't be merged, it should be put directly.
+ */
+static int aggregate_wave_message( const TRACE2_HEADER *trh2, _CHAINFO *chaptr, const int index )
+{
+	PA2EW_AGGR   *aggr      = (PA2EW_AGGR *)chaptr->aggr;
+	const int     samp_size = trh2->datatype[1] - '0';
+	const int     max_nsamp = PA2EW_TRACE_MAX_SAMPLES( samp_size );
+	const double  delta     = trh2->samprate > 0.0 ? 1.0 / trh2->samprate : 0.0;
+	double        gap;
+	int           pending;
+
+/* Those blocks already cover the window or fill the trace buffer, just bypass */
+	if ( delta <= 0.0 || trh2->nsamp * delta >= AggregateWindow || trh2->nsamp >= max_nsamp )
+		return -1;
+	if ( !aggr && !(aggr = chaptr->aggr = calloc(1, sizeof(PA2EW_AGGR))) )
+		return -1;
+/* Put the pending samples first when the block can't be appended behind them */
+	if ( (pending = aggr->outmsg.trh2.nsamp) ) {
+		gap = trh2->starttime - aggr->outmsg.trh2.endtime - delta;
+		if (
+			gap > delta * 0.5 || gap < -delta * 0.5 ||
+			pending + trh2->nsamp > max_nsamp ||
+			trh2->samprate != aggr->outmsg.trh2.samprate ||
+			trh2->datatype[0] != aggr->outmsg.trh2.datatype[0] ||
+			trh2->datatype[1] != aggr->outmsg.trh2.datatype[1] ||
+			trh2->quality[0] != aggr->outmsg.trh2.quality[0]
+		) {
+			put_wave_message( &aggr->outmsg.trh2, index );
+			pending = 0;
+		}
+	}
+/* */
+	if ( !pending ) {
+		aggr->outmsg.trh2 = *trh2;
+		aggr->flush_time  = pa2ew_timenow_get() + AggregateLatency;
+	}
+	else {
+		aggr->outmsg.trh2.nsamp  += trh2->nsamp;
+		aggr->outmsg.trh2.endtime = trh2->endtime;
+	}
+	memcpy((uint8_t *)(&aggr->outmsg.trh2 + 1) + pending * samp_size, trh2 + 1, trh2->nsamp * samp_size);
+/* Once the window is covered, or there is no room for the next block */
+	if (
+		aggr->outmsg.trh2.nsamp * delta >= AggregateWindow - delta * 0.5 ||
+		aggr->outmsg.trh2.nsamp + trh2->nsamp > max_nsamp
+	) {
+		put_wave_message( &aggr->outmsg.trh2, index );
+		aggr->outmsg.trh2.nsamp = 0;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Put the merged data & the partial mini-SEED records of the station which have been held until
+ *        the deadline.
+ *
+ * @param node
+ * @param index
+ * @param arg The deadline.
+ */
+static void flush_pending_act( void *node, const int index, void *arg )
+{
+	_STAINFO    *stainfo  = (_STAINFO *)node;
+	_CHAINFO    *chaptr   = (_CHAINFO *)stainfo->chaptr;
+	const double deadline = *(double *)arg;
+	PA2EW_AGGR  *aggr;
+
+/* */
+	for ( int i = 0; chaptr && i < stainfo->nchannel; i++, chaptr++ ) {
+		if ( (aggr = (PA2EW_AGGR *)chaptr->aggr) && aggr->outmsg.trh2.nsamp && aggr->flush_time <= deadline ) {
+			put_wave_message( &aggr->outmsg.trh2, WAVE_OUTPUT_INDEX( stainfo ) );
+			aggr->outmsg.trh2.nsamp = 0;
+		}
+		if ( MseedOutputSwitch )
+			pa2ew_mseed_flush( chaptr, deadline );
+	}
+
+	return;
+}
+
+/**
+ * @brief Put the message into the sink of output, it might be staged until committing.
+ *
+ * @param index
+ * @param size
+ * @param msg
+ * @return int
+ */
+static int sink_putmsg( const int index, const long size, char *msg )
+{
+	return pa2ew_sink_put( Sink[index], &Putlogo[index], size, msg );
+}
+
+/**
+ * @brief Commit the staged messages of all the sinks.
+ *
+ * @par Returns
+ * 	Nothing.
+ */
+static void sink_commit_all( void )
+{
+/* The shared sink only needs once */
+	for ( int i = 0; i < OUTPUT_NUM; i++ ) {
+		if ( !Sink[i] || (i != WAVE_MSG_LOGO && Sink[i] == Sink[WAVE_MSG_LOGO]) )
+			continue;
+		if ( pa2ew_sink_commit( Sink[i] ) != PUT_OK )
+			pa2ew_log("e", &RingName[i][0], "palert2ew: Error committing messages in region %ld\n", RingKey[i]);
+	}
+
+	return;
+}
+
+/**
+ * @brief Put the packed mini-SEED record into the ring.
+ *
+ * @param record
+ * @param reclen
+ * @param arg
+ */
+static void mseed_record_handler( char *record, int reclen, void *arg )
+{
+	if ( sink_putmsg( MSEED_MSG_LOGO, reclen, record ) != PUT_OK )
+		pa2ew_log("e", &RingName[MSEED_MSG_LOGO][0], "palert2ew: Error putting message in region %ld\n", RingKey[MSEED_MSG_LOGO]);
+
+	return;
+}
+
 /**
  * @brief
  *
@@ -1253,7 +2013,7 @@ static int examine_ntp_status( _STAINFO *stainfo, const void *packet, const int
 
 /* Good NTP status */
 	if ( *ntp_errors >= PA2EW_NTP_SYNC_ERR_LIMIT )
-		logit("ot", "palert2ew: Station %s reconnect to NTP server & time re-synchronized!\n", stainfo->sta);
+		pa2ew_log("ot", stainfo->sta, "palert2ew: Station %s reconnect to NTP server & time re-synchronized!\n", stainfo->sta);
 	*ntp_errors = 0;
 /* If the NTP status is good, we should accept this waveform */
 	goto pass;
@@ -1261,13 +2021,13 @@ static int examine_ntp_status( _STAINFO *stainfo, const void *packet, const int
 not_sync:
 	if ( (*ntp_errors)++ >= pre_threshold ) {
 		if ( *ntp_errors < PA2EW_NTP_SYNC_ERR_LIMIT ) {
-			printf("palert2ew: Station %s lost connection to NTP server, please check it!\n", stainfo->sta);
+			pa2ew_log(PA2EW_LOG_STDOUT, stainfo->sta, "palert2ew: Station %s lost connection to NTP server, please check it!\n", stainfo->sta);
 		/* Even NTP status is not good but it still under the error limit, we also accept this waveform */
 			goto pass;
 		}
 		else if ( *ntp_errors == PA2EW_NTP_SYNC_ERR_LIMIT ) {
-			logit(
-				"et",
+			pa2ew_log(
+				"et", stainfo->sta,
 				OutputTimeQuestionable ?
 				"palert2ew: NOTICE!! Station %s time unsynchronized, the waveforms will be marked.\n" :
 				"palert2ew: NOTICE!! Station %s time unsynchronized, reject the waveforms.\n",
@@ -1285,31 +2045,38 @@ pass:
 }
 
 /**
- * @brief
+ * @brief The time of the first sample inside the packet.
  *
  * @param packet
  * @param packet_mode
- * @return int
+ * @param stainfo
+ * @return double
  */
-static int check_pkt_crc( const void *packet, const int packet_mode )
+static double packet_sample_time_get( const void *packet, const int packet_mode, const _STAINFO *stainfo )
 {
-/* Check CRC number. depends on its packet mode */
 	switch ( packet_mode ) {
 	case PALERT_PKT_MODE1: default:
-		if ( pac_m1_crc_check( packet ) )
-			return 1;
-		break;
+		return pac_m1_systime_get( packet, stainfo->timeshift );
 	case PALERT_PKT_MODE4:
-		if ( pac_m4_crc_check( packet ) )
-			return 1;
-		break;
+		return pac_m4_smsr_starttime_get( (PALERT_M4_SMSR_HEADER *)((PALERT_M4_HEADER *)packet + 1) );
 	case PALERT_PKT_MODE16:
-		if ( pac_m16_crc_check( packet ) )
-			return 1;
-		break;
+		return pac_m16_sptime_get( (PALERT_M16_HEADER *)packet );
 	}
+}
 
-	return 0;
+/**
+ * @brief The output index of the wave ring that the station goes to, the shard is loaded only once 'cause it
+ *        might be changed by the list updating at any time.
+ *
+ * @param stainfo
+ * @return int
+ */
+static int wave_output_index_get( const _STAINFO *stainfo )
+{
+	const uint8_t shard = __atomic_load_n(&stainfo->shard, __ATOMIC_RELAXED);
+
+/* The default wave ring for shard 0, otherwise those extra ones */
+	return shard ? SHARD_MSG_LOGO + shard - 1 : WAVE_MSG_LOGO;
 }
 
 /**
@@ -1332,3 +2099,15 @@ static void handle_signal( void )
 
 	return;
 }
+
+/**
+ * @brief Only for those sinks without the termination flag of Earthworm ring.
+ *
+ * @param sig
+ */
+static void handle_terminate_signal( int sig )
+{
+	TerminateSignal = 1;
+
+	return;
+}
@@ -0,0 +1,241 @@
+/**
+ * @file palert2ew_capture.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Capture the raw stream for reproducing. The receiving threads copy each chunk (with its receiving time,
+ *        serial & connection) into a shared ring in memory, and a background writer appends the ring to the file,
+ *        so the receiving never blocks on the file I/O. The chunks are dropped & counted once the ring is full.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+/**
+ * @name Earthworm environment header include
+ *
+ */
+#include <earthworm.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <palert2ew_capture.h>
+
+/**
+ * @name Internal functions' prototype
+ *
+ */
+static void  ring_copy_in( const uint64_t, const void *, const size_t );
+static void  drain_ring( void );
+static void *writer_thread( void * );
+
+/**
+ * @name Internal static variables
+ *
+ */
+static FILE           *CaptureFile  = NULL;
+static uint8_t        *Ring         = NULL;
+static size_t          RingSize     = 0;
+static uint64_t        Head         = 0;  /* Only moved by the receiving threads under the mutex */
+static uint64_t        Tail         = 0;  /* Only moved by the writer thread */
+static uint64_t        Dropped      = 0;
+static uint64_t        Reported     = 0;
+static time_t          LastReport   = 0;
+static int             WriteFailed  = 0;
+static pthread_mutex_t RingMutex    = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t       WriterThread;
+static volatile int    Running      = 0;
+
+/**
+ * @brief Open the capture file for appending & start the background writer.
+ *
+ * @param path
+ * @param ring_size Bytes of the ring in memory, 0 for the default size.
+ * @return int
+ */
+int pa2ew_capture_init( const char *path, const size_t ring_size )
+{
+/* */
+	if ( Running )
+		return 0;
+	if ( !path || !strlen(path) )
+		return -1;
+/* */
+	RingSize = ring_size ? ring_size : PA2EW_CAPTURE_DEF_BUFFER_SIZE;
+	if ( (Ring = malloc(RingSize)) == NULL )
+		return -1;
+	if ( (CaptureFile = fopen(path, "ab")) == NULL ) {
+		free(Ring);
+		Ring = NULL;
+		return -1;
+	}
+/* */
+	Head        = Tail = 0;
+	Dropped     = Reported = 0;
+	WriteFailed = 0;
+	time(&LastReport);
+	Running = 1;
+	if ( pthread_create(&WriterThread, NULL, writer_thread, NULL) ) {
+		Running = 0;
+		fclose(CaptureFile);
+		CaptureFile = NULL;
+		free(Ring);
+		Ring = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Stop the background writer, append all the remaining chunks & close the file.
+ *
+ */
+void pa2ew_capture_end( void )
+{
+	if ( Running ) {
+		__atomic_store_n(&Running, 0, __ATOMIC_RELEASE);
+		pthread_join(WriterThread, NULL);
+	/* Those threads which have already passed the checking are still able to put */
+		pthread_mutex_lock(&RingMutex);
+		drain_ring();
+		fclose(CaptureFile);
+		CaptureFile = NULL;
+		free(Ring);
+		Ring = NULL;
+		pthread_mutex_unlock(&RingMutex);
+	}
+
+	return;
+}
+
+/**
+ * @brief Put the chunk into the ring, it will be dropped when the ring is full.
+ *
+ * @param source PA2EW_CAPTURE_SOURCE_SERVER or PA2EW_CAPTURE_SOURCE_CLIENT.
+ * @param event PA2EW_CAPTURE_EVENT_DATA, PA2EW_CAPTURE_EVENT_FLUSH or PA2EW_CAPTURE_EVENT_CLOSE.
+ * @param conn Index of the connection.
+ * @param serial 0 for unknown.
+ * @param time Receiving time of the chunk.
+ * @param chunk
+ * @param length
+ */
+void pa2ew_capture_write(
+	const int source, const int event, const int conn, const int serial, const double time, const void *chunk, const size_t length
+) {
+	PA2EW_CAPTURE_RECORD_HEAD head;
+	const size_t              total = sizeof(PA2EW_CAPTURE_RECORD_HEAD) + length;
+
+/* */
+	if ( !__atomic_load_n(&Running, __ATOMIC_ACQUIRE) )
+		return;
+/* */
+	head.magic    = PA2EW_CAPTURE_MAGIC;
+	head.length   = length;
+	head.time     = time;
+	head.serial   = serial;
+	head.conn     = conn;
+	head.source   = source;
+	head.event    = event;
+	head.reserved = 0;
+/* */
+	pthread_mutex_lock(&RingMutex);
+	if ( Ring && RingSize - (Head - __atomic_load_n(&Tail, __ATOMIC_ACQUIRE)) >= total ) {
+		ring_copy_in( Head, &head, sizeof(PA2EW_CAPTURE_RECORD_HEAD) );
+		if ( length )
+			ring_copy_in( Head + sizeof(PA2EW_CAPTURE_RECORD_HEAD), chunk, length );
+		__atomic_store_n(&Head, Head + total, __ATOMIC_RELEASE);
+	}
+	else {
+		__atomic_fetch_add(&Dropped, 1, __ATOMIC_RELAXED);
+	}
+	pthread_mutex_unlock(&RingMutex);
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param pos
+ * @param src
+ * @param length
+ */
+static void ring_copy_in( const uint64_t pos, const void *src, const size_t length )
+{
+	const size_t offset = pos % RingSize;
+	const size_t first  = RingSize - offset < length ? RingSize - offset : length;
+
+/* */
+	memcpy(Ring + offset, src, first);
+	if ( first < length )
+		memcpy(Ring, (const uint8_t *)src + first, length - first);
+
+	return;
+}
+
+/**
+ * @brief Append all the chunks inside the ring to the file, and report the dropped chunks.
+ *
+ */
+static void drain_ring( void )
+{
+	const uint64_t head = __atomic_load_n(&Head, __ATOMIC_ACQUIRE);
+	uint64_t       tail = Tail;
+	uint64_t       dropped;
+	size_t         offset;
+	size_t         length;
+	time_t         time_now;
+
+/* */
+	while ( tail != head ) {
+		offset = tail % RingSize;
+		length = RingSize - offset < head - tail ? RingSize - offset : head - tail;
+		if ( fwrite(Ring + offset, 1, length, CaptureFile) != length && !WriteFailed ) {
+			logit("e", "palert2ew: Error writing the capture file, the chunks will be lost!\n");
+			WriteFailed = 1;
+		}
+		tail += length;
+	}
+	__atomic_store_n(&Tail, tail, __ATOMIC_RELEASE);
+	fflush(CaptureFile);
+/* */
+	if (
+		(dropped = __atomic_load_n(&Dropped, __ATOMIC_RELAXED)) != Reported &&
+		(time(&time_now) - LastReport >= PA2EW_CAPTURE_REPORT_SEC || !Running)
+	) {
+		logit("e", "palert2ew: %lu captured chunks were dropped, the capture buffer is full!\n", (unsigned long)(dropped - Reported));
+		Reported   = dropped;
+		LastReport = time_now;
+	}
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param arg
+ * @return void*
+ */
+static void *writer_thread( void *arg )
+{
+	while ( __atomic_load_n(&Running, __ATOMIC_ACQUIRE) ) {
+		drain_ring();
+		sleep_ew(PA2EW_CAPTURE_DRAIN_MSEC);
+	}
+
+	return NULL;
+}
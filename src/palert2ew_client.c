@@ -14,6 +14,7 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
@@ -41,6 +42,11 @@
 #include <palert2ew_list.h>
 #include <palert2ew_misc.h>
 #include <palert2ew_msg_queue.h>
+#include <palert2ew_log.h>
+#include <palert2ew_latency.h>
+#include <palert2ew_metrics.h>
+#include <palert2ew_capture.h>
+#include <palert2ew_client.h>
 
 /**
  * @brief
@@ -72,73 +78,129 @@ typedef struct {
  * @name Internal functions' prototype
  *
  */
+static void stream_state_init( CLIENT_STREAM *, uint8_t * );
 static void flush_sock_buffer( const int );
-static int  reconstruct_connect_sock( void );
 static int  construct_connect_sock( const char *, const char * );
 
 /**
  * @name Internal static variables
  *
  */
-static volatile int  ClientSocket = -1;
-static const char   *_ServerIP    = NULL;
-static const char   *_ServerPort  = NULL;
-static uint8_t      *Buffer       = NULL;
-static size_t        BufferSize   = 0;
+static const char *_ServerIP   = NULL;
+static const char *_ServerPort = NULL;
 
 /**
  * @brief Initialize the dependent Palert client.
  *
  * @param ip
  * @param port
- * @return int
+ * @return int The connected socket, -1 for the failure.
  */
 int pa2ew_client_init( const char *ip, const char *port )
 {
 /* Setup constants */
 	_ServerIP   = ip;
 	_ServerPort = port;
-/* Construct the accept socket */
-	ClientSocket = construct_connect_sock( ip, port );
-/* Initialize the receiving buffer */
-	if ( Buffer == NULL ) {
-	/* */
-		BufferSize = sizeof(LABELED_RECV_BUFFER) > sizeof(FW_PCK) ? sizeof(LABELED_RECV_BUFFER) : sizeof(FW_PCK);
-		Buffer = (uint8_t *)calloc(1, BufferSize + 1);  /* Plus one just in case */
+/* Construct the connect socket */
+	return construct_connect_sock( ip, port );
+}
+
+/**
+ * @brief Reconstruct the socket connect to the Palert server.
+ *
+ * @param sock The broken one, it will be closed.
+ * @return int The new socket, -1 for the failure.
+ */
+int pa2ew_client_reconnect( const int sock )
+{
+	int result;
+	int count = 0;
+
+/* */
+	if ( sock > 0 ) {
+		pa2ew_capture_write( PA2EW_CAPTURE_SOURCE_CLIENT, PA2EW_CAPTURE_EVENT_CLOSE, 0, 0, pa2ew_timenow_get(), NULL, 0 );
+		close(sock);
+		sleep_ew(RECONNECT_INTERVAL_MSEC);
 	}
+/* Do until we success getting socket or exceed RECONNECT_TIMES_LIMIT */
+	while ( (result = construct_connect_sock( _ServerIP, _ServerPort )) == -1 ) {
+	/* Try RECONNECT_TIMES_LIMIT */
+		if ( ++count > RECONNECT_TIMES_LIMIT ) {
+			logit("et", "palert2ew: Reconstruct socket failed; exiting this session!\n");
+			return -1;
+		}
+	/* Waiting for a while */
+		sleep_ew(RECONNECT_INTERVAL_MSEC);
+	}
+	logit("ot", "palert2ew: Reconstruct socket success!\n");
 
-	return ClientSocket;
+	return result;
 }
 
 /**
  * @brief End process of Palert client.
  *
+ * @param sock
  */
-void pa2ew_client_end( void )
+void pa2ew_client_end( const int sock )
 {
 	logit("o", "palert2ew: Closing the connections to Palert server!\n");
-	close(ClientSocket);
-	ClientSocket = -1;
+	if ( sock >= 0 )
+		close(sock);
+
+	return;
+}
+
+/**
+ * @brief Allocate the receiving buffer of the stream if it doesn't have one, and reset the framing state.
+ *
+ * @param stream
+ * @return int 0 for success, -1 for the allocating failure.
+ */
+int pa2ew_client_stream_init( CLIENT_STREAM *stream )
+{
+	size_t size;
+
 /* */
-	if ( Buffer != NULL ) {
-		free(Buffer);
-		Buffer = NULL;
+	if ( stream->buffer == NULL ) {
+		size = sizeof(LABELED_RECV_BUFFER) > sizeof(FW_PCK) ? sizeof(LABELED_RECV_BUFFER) : sizeof(FW_PCK);
+		if ( (stream->buffer = (uint8_t *)calloc(1, size + 1)) == NULL )  /* Plus one just in case */
+			return -1;
 	}
+/* */
+	stream_state_init( stream, stream->buffer );
+
+	return 0;
+}
+
+/**
+ * @brief Free the receiving buffer of the stream.
+ *
+ * @param stream
+ */
+void pa2ew_client_stream_end( CLIENT_STREAM *stream )
+{
+	if ( stream->buffer != NULL ) {
+		free(stream->buffer);
+		stream->buffer = NULL;
+	}
+	stream_state_init( stream, NULL );
 
 	return;
 }
 
 /**
- * @brief Receive the messages from the socket of forward server and send it to the queue.
+ * @brief Receive one message of the stream from the socket of forward server and send it to the queue. All the
+ *        framing state is inside the stream, so each stream can be read by its own thread.
  *
- * @return int
+ * @param stream
+ * @param sock
+ * @return int PA2EW_RECV_CONNECT_ERROR means the connection is broken & should be reconstructed by the caller.
  */
-int pa2ew_client_stream( void )
+int pa2ew_client_stream( CLIENT_STREAM *stream, const int sock )
 {
-	static LABELED_RECV_BUFFER *lrbuf = NULL;
-	static FW_PCK              *fwptr = NULL;
-	static uint8_t              sync_errors = 0;
-	static uint32_t             recv_seq = 0;
+	LABELED_RECV_BUFFER * const lrbuf = stream->lrbuf;
+	FW_PCK * const              fwptr = (FW_PCK *)stream->fwptr;
 
 	int       ret       = 0;
 	int       retry     = 0;
@@ -146,22 +208,15 @@ int pa2ew_client_stream( void )
 	int       data_read = 0;
 	int       data_req  = FW_PCK_HEADER_LENGTH;
 	uint16_t  packmode  = 0;
+	double    recv_time = 0.0;
 	_STAINFO *staptr    = NULL;
 
-/* Try to align the two different data structure pointer */
-	if ( (uint8_t *)lrbuf != Buffer && (uint8_t *)fwptr != Buffer ) {
-	/* */
-		lrbuf = (LABELED_RECV_BUFFER *)Buffer;
-		fwptr = (FW_PCK *)Buffer;
-	/* */
-		if ( lrbuf->recv_buffer > fwptr->recv_buffer )
-			fwptr = (FW_PCK *)(Buffer + (lrbuf->recv_buffer - fwptr->recv_buffer));
-		else
-			lrbuf = (LABELED_RECV_BUFFER *)(Buffer + (fwptr->recv_buffer - lrbuf->recv_buffer));
-	}
+/* */
+	if ( !lrbuf || !fwptr )
+		return PA2EW_RECV_FATAL_ERROR;
 /* */
 	do {
-		if ( (ret = recv(ClientSocket, (uint8_t *)fwptr + data_read, data_req, 0)) <= 0 ) {
+		if ( (ret = pa2ew_latency_recv( sock, (uint8_t *)fwptr + data_read, data_req, &recv_time )) <= 0 ) {
 			if ( errno == EINTR ) {
 				sleep_ew(100);
 			}
@@ -184,31 +239,37 @@ int pa2ew_client_stream( void )
 			continue;
 		}
 	/* */
+		pa2ew_metrics_add( PA2EW_METRIC_RECV_BYTES, ret );
+		pa2ew_capture_write(
+			PA2EW_CAPTURE_SOURCE_CLIENT, PA2EW_CAPTURE_EVENT_DATA, 0,
+			data_read >= FW_PCK_HEADER_LENGTH ? fwptr->serial : 0, recv_time, (uint8_t *)fwptr + data_read, ret
+		);
 		if ( (data_read += ret) >= FW_PCK_HEADER_LENGTH ) {
 			if ( !checked ) {
-				if ( fwptr->seq != recv_seq && pa2ew_crc8_cal( fwptr, FW_PCK_HEADER_LENGTH ) ) {
-					logit("et", "palert2ew: TCP connection sync error, flushing the buffer...\n");
-					flush_sock_buffer( ClientSocket );
+				if ( fwptr->seq != stream->recv_seq && pa2ew_crc8_cal( fwptr, FW_PCK_HEADER_LENGTH ) ) {
+					pa2ew_log("et", NULL, "palert2ew: TCP connection sync error, flushing the buffer...\n");
+					pa2ew_metrics_add( PA2EW_METRIC_SYNC_ERRORS, 1 );
+					flush_sock_buffer( sock );
 					pa2ew_msgqueue_lastbufs_reset( NULL );
 				/* */
-					if ( ++sync_errors >= PA2EW_TCP_SYNC_ERR_LIMIT ) {
-						logit("et", "palert2ew: TCP connection sync error over %u times, reconnecting...\n", sync_errors);
-						sync_errors = 0;
+					if ( ++stream->sync_errors >= PA2EW_TCP_SYNC_ERR_LIMIT ) {
+						logit("et", "palert2ew: TCP connection sync error over %u times, reconnecting...\n", stream->sync_errors);
+						stream->sync_errors = 0;
 						goto reconnect;
 					}
 				/* */
 					return PA2EW_RECV_NORMAL;
 				}
 			/* */
-				checked  = 1;
-				recv_seq = fwptr->seq;
+				checked          = 1;
+				stream->recv_seq = fwptr->seq;
 			}
 			data_req = fwptr->length + FW_PCK_HEADER_LENGTH - data_read;
 		}
 	} while ( data_req > 0 );
 
 /* */
-	recv_seq++;
+	stream->recv_seq++;
 /* Serial should always larger than 0 & ignore keep-alive (serial = 0) packet */
 	if ( fwptr->serial ) {
 	/* Find which one palert */
@@ -218,17 +279,22 @@ int pa2ew_client_stream( void )
 		/* Get the time shift in seconds between UTC & palert timezone */
 			staptr->timeshift = -(fwptr->tzoffset * 3600);
 		/* These should be done after the statement above 'cause it use the same memory space */
-			lrbuf->label.staptr   = staptr;
-			lrbuf->label.packmode = packmode;
+			lrbuf->label.staptr    = staptr;
+			lrbuf->label.packmode  = packmode;
+			lrbuf->label.recv_time = recv_time;
 		/* Packet type should be provided by server side */
-			if ( pa2ew_msgqueue_rawpacket( lrbuf, ret, PA2EW_GEN_MSG_LOGO_BY_SRC( PA2EW_MSG_CLIENT_STREAM ) ) ) {
-				logit("et", "palert2ew: Serial(%d) packet sync error, flushing the last buffer...\n", staptr->serial);
+			if ( (ret = pa2ew_msgqueue_rawpacket( lrbuf, ret, PA2EW_GEN_MSG_LOGO_BY_SRC( PA2EW_MSG_CLIENT_STREAM ) )) < 0 ) {
+				pa2ew_log("et", staptr->sta, "palert2ew: Serial(%d) packet sync error, flushing the last buffer...\n", staptr->serial);
+				pa2ew_metrics_add( PA2EW_METRIC_SYNC_ERRORS, 1 );
 				pa2ew_msgqueue_lastbufs_reset( staptr );
 			}
-			sync_errors = 0;
+			else {
+				pa2ew_metrics_add( PA2EW_METRIC_RECV_PACKETS, ret );
+			}
+			stream->sync_errors = 0;
 		}
 		else {
-			printf("palert2ew: Serial(%d) not found in station list, maybe it's a new palert.\n", fwptr->serial);
+			pa2ew_log(PA2EW_LOG_STDOUT, NULL, "palert2ew: Serial(%d) not found in station list, maybe it's a new palert.\n", fwptr->serial);
 			return PA2EW_RECV_NEED_UPDATE;
 		}
 	}
@@ -239,13 +305,34 @@ int pa2ew_client_stream( void )
 #endif
 
 	return PA2EW_RECV_NORMAL;
-/* */
+/* The partial packets are useless after the connection is broken */
 reconnect:
 	pa2ew_msgqueue_lastbufs_reset( NULL );
-	if ( reconstruct_connect_sock() < 0 )
-		return PA2EW_RECV_CONNECT_ERROR;
-	else
-		return PA2EW_RECV_NORMAL;
+	return PA2EW_RECV_CONNECT_ERROR;
+}
+
+/**
+ * @brief Align the two different data structure pointers at the receiving buffer & reset the framing state.
+ *
+ * @param stream
+ * @param buffer
+ */
+static void stream_state_init( CLIENT_STREAM *stream, uint8_t *buffer )
+{
+/* */
+	stream->lrbuf       = (LABELED_RECV_BUFFER *)buffer;
+	stream->fwptr       = (FW_PCK *)buffer;
+	stream->sync_errors = 0;
+	stream->recv_seq    = 0;
+/* */
+	if ( buffer ) {
+		if ( offsetof(LABELED_RECV_BUFFER, recv_buffer) > offsetof(FW_PCK, recv_buffer) )
+			stream->fwptr = (FW_PCK *)(buffer + (offsetof(LABELED_RECV_BUFFER, recv_buffer) - offsetof(FW_PCK, recv_buffer)));
+		else
+			stream->lrbuf = (LABELED_RECV_BUFFER *)(buffer + (offsetof(FW_PCK, recv_buffer) - offsetof(LABELED_RECV_BUFFER, recv_buffer)));
+	}
+
+	return;
 }
 
 /**
@@ -256,13 +343,16 @@ reconnect:
 static void flush_sock_buffer( const int sock )
 {
 	int      times;
+	int      ret;
 	uint8_t *buf = (uint8_t *)malloc(SOCKET_RCVBUFFER_LENGTH + 1);
 
 	if ( sock > 0 && buf ) {
 		times = 0;
 		do {
 			logit("ot", "palert2ew: NOTICE! Flushing socket(%d) buffer #%d...\n", sock, ++times);
-		} while ( recv(sock, buf, SOCKET_RCVBUFFER_LENGTH, 0) >= SOCKET_RCVBUFFER_LENGTH );
+			if ( (ret = recv(sock, buf, SOCKET_RCVBUFFER_LENGTH, 0)) > 0 )
+				pa2ew_capture_write( PA2EW_CAPTURE_SOURCE_CLIENT, PA2EW_CAPTURE_EVENT_FLUSH, 0, 0, pa2ew_timenow_get(), buf, ret );
+		} while ( ret >= SOCKET_RCVBUFFER_LENGTH );
 	}
 /* */
 	if ( buf )
@@ -271,37 +361,6 @@ static void flush_sock_buffer( const int sock )
 	return;
 }
 
-/**
- * @brief Reconstruct the socket connect to the Palert server.
- *
- * @return int
- */
-static int reconstruct_connect_sock( void )
-{
-	static uint8_t count = 0;
-
-/* */
-	if ( ClientSocket > 0 ) {
-		close(ClientSocket);
-		sleep_ew(RECONNECT_INTERVAL_MSEC);
-	}
-/* Do until we success getting socket or exceed RECONNECT_TIMES_LIMIT */
-	while ( (ClientSocket = construct_connect_sock( _ServerIP, _ServerPort )) == -1 ) {
-	/* Try RECONNECT_TIMES_LIMIT */
-		if ( ++count > RECONNECT_TIMES_LIMIT ) {
-			logit("et", "palert2ew: Reconstruct socket failed; exiting this session!\n");
-			ClientSocket = -1;
-			return ClientSocket;
-		}
-	/* Waiting for a while */
-		sleep_ew(RECONNECT_INTERVAL_MSEC);
-	}
-	logit("ot", "palert2ew: Reconstruct socket success!\n");
-	count = 0;
-
-	return ClientSocket;
-}
-
 /**
  * @brief Construct the socket connect to the Palert server.
  *
@@ -352,6 +411,7 @@ static int construct_connect_sock( const char *ip, const char *port )
 			logit("et", "palert2ew: Construct Palert server connection socket(%s) error(setsockopt: SO_RCVBUFFORCE)!\n", port);
 			logit("et", "palert2ew: Work under system default receiving buffer size!!\n");
 		}
+		pa2ew_latency_sock_setup( result );
 	/* Connect to the Palert server if we are using dependent client mode */
 		if ( connect(result, p->ai_addr, p->ai_addrlen) < 0 ) {
 			logit("et", "palert2ew: Connect to Palert server error!\n");
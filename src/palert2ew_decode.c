@@ -0,0 +1,100 @@
+/**
+ * @file palert2ew_decode.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Decode the samples of the Palert packets into the payload of the output messages, shared by palert2ew
+ *        & the offline replay.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdint.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <libpalertc/libpalertc.h>
+#include <palert2ew.h>
+#include <palert2ew_log.h>
+#include <palert2ew_decode.h>
+
+/**
+ * @brief Extract the samples of the packet into the decoding buffer. The CRC is also checked in the same pass
+ *        if enable this function, so the packet is only read once & never modified.
+ *
+ * @param packet
+ * @param packet_mode
+ * @param stainfo
+ * @param datatype
+ * @param check_crc 0 for skipping the CRC checking.
+ * @param decoded
+ * @return int 0 for the good packet, -1 for the CRC mismatched one.
+ */
+int pa2ew_decode_packet(
+	const void *packet, const int packet_mode, const _STAINFO *stainfo, const char datatype[2], const int check_crc,
+	PA2EW_DECODED *decoded
+) {
+/* 'cause the size of data is the same between float & int32_t, the payload can hold both of them */
+	for ( int i = 0; i < PA2EW_MAX_CHAN_PER_STA; i++ )
+		decoded->data[i] = &decoded->outmsg[i].trh2 + 1;
+/* */
+	decoded->nchannel = decoded->nsamp = 0;
+	switch ( packet_mode ) {
+	case PALERT_PKT_MODE1: default:
+	/* We only deal with the Normal Streaming packet(1) in this program!! */
+		if ( PALERT_M1_PACKETTYPE_GET( (PALERT_M1_HEADER *)packet ) != PALERT_M1_PACKETTYPE_NORMAL )
+			return check_crc && !pac_m1_crc_check( packet ) ? -1 : 0;
+	/* */
+		decoded->nchannel = stainfo->nchannel < PALERT_M1_CHAN_COUNT ? stainfo->nchannel : PALERT_M1_CHAN_COUNT;
+		decoded->nsamp    = PALERT_M1_SAMPLE_NUMBER;
+		for ( int i = decoded->nchannel; i < PALERT_M1_CHAN_COUNT; i++ )
+			decoded->data[i] = NULL;
+	/* Keep the native 16-bit words without widening, if the datatype asks for it */
+		if ( datatype[1] == '2' ) {
+			if ( check_crc )
+				return pac_m1_crc_sdata_extract( packet, (int16_t **)decoded->data ) ? 0 : -1;
+			pac_m1_sdata_extract( packet, (int16_t **)decoded->data );
+		}
+		else {
+			if ( check_crc )
+				return pac_m1_crc_data_extract( packet, (int32_t **)decoded->data ) ? 0 : -1;
+			pac_m1_data_extract( packet, (int32_t **)decoded->data );
+		}
+		break;
+	case PALERT_PKT_MODE4:
+	/* The CRC only covers the first 8 bytes, and the records will be decoded straight into the trace buffer */
+		return check_crc && !pac_m4_crc_check( packet ) ? -1 : 0;
+	case PALERT_PKT_MODE16:
+		decoded->nchannel = stainfo->nchannel < PA2EW_MAX_CHAN_PER_STA ? stainfo->nchannel : PA2EW_MAX_CHAN_PER_STA;
+		decoded->nsamp    = ((PALERT_M16_HEADER *)packet)->nchannel ? PALERT_M16_SAMPNUM_GET( (PALERT_M16_HEADER *)packet ) : 0;
+		if ( decoded->nsamp > PA2EW_OUTMSG_MAX_SAMPLES ) {
+			pa2ew_log("et", stainfo->sta, "palert2ew: Too many samples inside the mode 16 packet from %s, skip it!\n", stainfo->sta);
+			decoded->nchannel = decoded->nsamp = 0;
+			return check_crc && !pac_m16_crc_check( packet ) ? -1 : 0;
+		}
+	/* Select the extract method by pre-defined data type flag */
+		switch ( datatype[0] ) {
+	/* Extract the raw type of data */
+		case 'f': case 't': default:
+			if ( check_crc )
+				return pac_m16_crc_data_extract( packet, decoded->nchannel, (float **)decoded->data ) ? 0 : -1;
+			pac_m16_data_extract( packet, decoded->nchannel, (float **)decoded->data );
+			break;
+	/* If set to forcing output integer data, then extract the integer data */
+		case 'i': case 's':
+			if ( check_crc )
+				return pac_m16_crc_idata_extract( packet, decoded->nchannel, (int32_t **)decoded->data ) ? 0 : -1;
+			pac_m16_idata_extract( packet, decoded->nchannel, (int32_t **)decoded->data );
+			break;
+		}
+		break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,590 @@
+/**
+ * @file palert2ew_latency.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Measuring the latency of each stage, from the first sample of packet to the output. Each packet
+ *        carries its receiving & enqueuing timestamps inside the label, then the main thread puts the latency
+ *        of each stage into the HDR-style histograms of stages & stations when the packet is output.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+/**
+ * @name Earthworm environment header include
+ *
+ */
+#include <earthworm.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <palert2ew_latency.h>
+
+/**
+ * @brief The histograms of each station, the last one is the snapshot of the last report
+ *
+ */
+typedef struct {
+	PA2EW_LATENCY_HIST hist;
+	PA2EW_LATENCY_HIST last;
+} STATION_LATENCY;
+
+/**
+ * @brief The stamps of one processed packet, waiting for the commit of the rings
+ *
+ */
+typedef struct {
+	uint16_t serial;
+	double   sample_time;
+	double   recv_time;
+	double   enq_time;
+	double   deq_time;
+	double   proc_time;
+} PENDING_STAMP;
+
+/**
+ * @brief
+ *
+ */
+typedef struct {
+	uint16_t serial;
+	uint64_t count;
+	double   p99;
+	double   max;
+} TOP_STATION;
+
+/**
+ * @name Internal functions' prototype
+ *
+ */
+static int      bucket_index( const uint64_t );
+static uint64_t bucket_upper( const int );
+static void     hist_add( PA2EW_LATENCY_HIST *, const double );
+static void     hist_copy( PA2EW_LATENCY_HIST *, const PA2EW_LATENCY_HIST * );
+static void     hist_interval( const PA2EW_LATENCY_HIST *, PA2EW_LATENCY_HIST *, PA2EW_LATENCY_HIST * );
+static void     top_station_insert( TOP_STATION *, const uint16_t, const PA2EW_LATENCY_HIST * );
+static void     stamp_record( const PENDING_STAMP *, const double );
+
+/**
+ * @name Internal static variables
+ *
+ */
+static volatile int       Enabled     = 0;
+static int                KernelStamp = 0;  /* Take the receiving timestamp from the kernel */
+static double             LastReport  = 0.0;
+static PA2EW_LATENCY_HIST Stages[PA2EW_LATENCY_STAGE_NUM];
+static PA2EW_LATENCY_HIST StagesLast[PA2EW_LATENCY_STAGE_NUM];
+static STATION_LATENCY  **Stations    = NULL;  /* Indexed by the serial */
+static PENDING_STAMP     *Pending     = NULL;  /* Only touched by the main thread */
+static int                PendingMax  = 0;
+static int                PendingNum  = 0;
+static const char        *StageNames[PA2EW_LATENCY_STAGE_NUM] = {
+	"sensor", "assemble", "queue", "process", "commit", "total"
+};
+
+/**
+ * @brief Start measuring, it should be called before any receiving thread.
+ *
+ * @param kernel_stamp Take the receiving timestamp from the kernel (SO_TIMESTAMPNS) instead of the user space.
+ * @param batch_size Max. packets processed between two commits of the rings.
+ * @return int
+ */
+int pa2ew_latency_init( const int kernel_stamp, const int batch_size )
+{
+/* */
+	if ( !Stations && !(Stations = calloc(PA2EW_LATENCY_MAX_SERIAL, sizeof(STATION_LATENCY *))) )
+		return -1;
+	if ( batch_size > 0 && !Pending ) {
+		if ( !(Pending = calloc(batch_size, sizeof(PENDING_STAMP))) )
+			return -1;
+		PendingMax = batch_size;
+	}
+	PendingNum = 0;
+/* */
+	memset(Stages, 0, sizeof(Stages));
+	memset(StagesLast, 0, sizeof(StagesLast));
+#if defined( SO_TIMESTAMPNS )
+	KernelStamp = kernel_stamp;
+#else
+	KernelStamp = 0;
+#endif
+	Enabled     = 1;
+	LastReport  = pa2ew_latency_timenow_get();
+
+	return KernelStamp == kernel_stamp ? 0 : 1;
+}
+
+/**
+ * @brief
+ *
+ */
+void pa2ew_latency_end( void )
+{
+	Enabled = 0;
+/* */
+	if ( Stations ) {
+		for ( int i = 0; i < PA2EW_LATENCY_MAX_SERIAL; i++ )
+			free(Stations[i]);
+		free(Stations);
+		Stations = NULL;
+	}
+	free(Pending);
+	Pending    = NULL;
+	PendingMax = 0;
+	PendingNum = 0;
+
+	return;
+}
+
+/**
+ * @brief Unlike pa2ew_timenow_get, it's in the resolution of microseconds.
+ *
+ * @return double 0.0 if the measuring is off.
+ */
+double pa2ew_latency_timenow_get( void )
+{
+	struct timespec time_sp;
+
+/* */
+	if ( !Enabled )
+		return 0.0;
+	clock_gettime(CLOCK_REALTIME, &time_sp);
+
+	return (double)time_sp.tv_sec + (double)time_sp.tv_nsec * 1.0e-9;
+}
+
+/**
+ * @brief Ask the kernel to stamp the incoming data of the socket, if it's requested.
+ *
+ * @param sock
+ */
+void pa2ew_latency_sock_setup( const int sock )
+{
+#if defined( SO_TIMESTAMPNS )
+	int sock_opt = 1;
+
+/* Without it, the timestamp will be taken in the user space */
+	if ( Enabled && KernelStamp && sock >= 0 )
+		setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &sock_opt, sizeof(sock_opt));
+#endif
+
+	return;
+}
+
+/**
+ * @brief Just like recv, and stamp the receiving time.
+ *
+ * @param sock
+ * @param buffer
+ * @param length
+ * @param recv_time The receiving time, it will be 0.0 if the measuring is off.
+ * @return ssize_t
+ */
+ssize_t pa2ew_latency_recv( const int sock, void *buffer, const size_t length, double *recv_time )
+{
+	ssize_t result;
+
+#if defined( SO_TIMESTAMPNS )
+	if ( Enabled && KernelStamp ) {
+		struct iovec    iov = { buffer, length };
+		struct msghdr   msg;
+		struct cmsghdr *cmsg;
+		struct timespec time_sp;
+		union {
+			char           buf[CMSG_SPACE(sizeof(struct timespec))];
+			struct cmsghdr align;
+		} control;
+
+	/* */
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov        = &iov;
+		msg.msg_iovlen     = 1;
+		msg.msg_control    = control.buf;
+		msg.msg_controllen = sizeof(control.buf);
+		if ( (result = recvmsg(sock, &msg, 0)) > 0 ) {
+			*recv_time = 0.0;
+			for ( cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg) ) {
+				if ( cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS ) {
+					memcpy(&time_sp, CMSG_DATA(cmsg), sizeof(time_sp));
+					*recv_time = (double)time_sp.tv_sec + (double)time_sp.tv_nsec * 1.0e-9;
+				}
+			}
+		/* The kernel didn't stamp it */
+			if ( *recv_time == 0.0 )
+				*recv_time = pa2ew_latency_timenow_get();
+		}
+
+		return result;
+	}
+#endif
+/* */
+	if ( (result = recv(sock, buffer, length, 0)) > 0 )
+		*recv_time = pa2ew_latency_timenow_get();
+
+	return result;
+}
+
+/**
+ * @brief Stamp the packet right after it is output, the latency of each stage will be put into the histograms
+ *        by the following commit. It should only be called by the main thread. The stage with zero timestamp
+ *        will be skipped.
+ *
+ * @param serial
+ * @param sample_time The time of the first sample inside the packet.
+ * @param recv_time
+ * @param enq_time
+ * @param deq_time
+ */
+void pa2ew_latency_record(
+	const uint16_t serial, const double sample_time, const double recv_time, const double enq_time, const double deq_time
+) {
+	PENDING_STAMP  _stamp;
+	PENDING_STAMP *stamp = PendingNum < PendingMax ? &Pending[PendingNum] : &_stamp;
+
+/* */
+	if ( !Enabled || deq_time <= 0.0 )
+		return;
+/* */
+	stamp->serial      = serial;
+	stamp->sample_time = sample_time;
+	stamp->recv_time   = recv_time;
+	stamp->enq_time    = enq_time;
+	stamp->deq_time    = deq_time;
+	stamp->proc_time   = pa2ew_latency_timenow_get();
+/* Without the room, take it as committed right now */
+	if ( stamp == &_stamp )
+		stamp_record( stamp, stamp->proc_time );
+	else
+		PendingNum++;
+
+	return;
+}
+
+/**
+ * @brief Record the latency of those stamped packets, it should be called right after the commit of the rings.
+ *
+ */
+void pa2ew_latency_commit( void )
+{
+	double time_now;
+
+/* */
+	if ( !Enabled || !PendingNum )
+		return;
+	time_now = pa2ew_latency_timenow_get();
+/* */
+	for ( int i = 0; i < PendingNum; i++ )
+		stamp_record( &Pending[i], time_now );
+	PendingNum = 0;
+
+	return;
+}
+
+/**
+ * @brief Log the percentiles of each stage within the last interval, and those stations with the largest
+ *        total latency. It should only be called by the main thread.
+ *
+ */
+void pa2ew_latency_report( void )
+{
+	PA2EW_LATENCY_HIST interval;
+	TOP_STATION        top[PA2EW_LATENCY_TOP_STATIONS];
+	STATION_LATENCY   *station;
+	const double       time_now = pa2ew_latency_timenow_get();
+	const double       minutes  = (time_now - LastReport) / 60.0;
+
+/* */
+	if ( !Enabled )
+		return;
+	LastReport = time_now;
+/* */
+	for ( int i = 0; i < PA2EW_LATENCY_STAGE_NUM; i++ ) {
+		hist_interval( &Stages[i], &StagesLast[i], &interval );
+		if ( !interval.count )
+			continue;
+		logit(
+			"o", "palert2ew: Latency of %s stage in the last %.1f min: %lu packets, p50 %.1f ms, p90 %.1f ms, "
+			"p99 %.1f ms, max %.1f ms.\n",
+			StageNames[i], minutes, (unsigned long)interval.count,
+			pa2ew_latency_percentile_get( &interval, 0.50 ) * 1.0e3,
+			pa2ew_latency_percentile_get( &interval, 0.90 ) * 1.0e3,
+			pa2ew_latency_percentile_get( &interval, 0.99 ) * 1.0e3,
+			interval.max * 1.0e-3
+		);
+		if ( i == PA2EW_LATENCY_STAGE_SENSOR && interval.negative )
+			logit(
+				"o", "palert2ew: %lu packets were received before their first sample, check the clock of stations!\n",
+				(unsigned long)interval.negative
+			);
+	}
+/* */
+	memset(top, 0, sizeof(top));
+	for ( int i = 0; i < PA2EW_LATENCY_MAX_SERIAL; i++ ) {
+		if ( !(station = Stations[i]) )
+			continue;
+		hist_interval( &station->hist, &station->last, &interval );
+		if ( interval.count )
+			top_station_insert( top, (uint16_t)i, &interval );
+	}
+	for ( int i = 0; i < PA2EW_LATENCY_TOP_STATIONS && top[i].count; i++ )
+		logit(
+			"o", "palert2ew: Latency top %d station Serial(%u): %lu packets, p99 %.1f ms, max %.1f ms.\n",
+			i + 1, top[i].serial, (unsigned long)top[i].count, top[i].p99 * 1.0e3, top[i].max * 1.0e3
+		);
+
+	return;
+}
+
+/**
+ * @brief Copy the cumulative histogram of the stage, it can be called by any thread.
+ *
+ * @param stage
+ * @param dest
+ * @return int
+ */
+int pa2ew_latency_stage_get( const int stage, PA2EW_LATENCY_HIST *dest )
+{
+	if ( !Enabled || stage < 0 || stage >= PA2EW_LATENCY_STAGE_NUM )
+		return -1;
+/* */
+	hist_copy( dest, &Stages[stage] );
+
+	return 0;
+}
+
+/**
+ * @brief Copy the cumulative histogram of the station's total latency, it can be called by any thread.
+ *
+ * @param serial
+ * @param dest
+ * @return int -1 if there is no packet from this station yet.
+ */
+int pa2ew_latency_station_get( const uint16_t serial, PA2EW_LATENCY_HIST *dest )
+{
+	STATION_LATENCY *station;
+
+/* */
+	if ( !Enabled || !(station = __atomic_load_n(&Stations[serial], __ATOMIC_ACQUIRE)) )
+		return -1;
+/* */
+	hist_copy( dest, &station->hist );
+
+	return 0;
+}
+
+/**
+ * @brief The highest equivalent value of the percentile, just like HDR histogram.
+ *
+ * @param hist
+ * @param quantile Between 0.0 & 1.0.
+ * @return double In seconds.
+ */
+double pa2ew_latency_percentile_get( const PA2EW_LATENCY_HIST *hist, const double quantile )
+{
+	uint64_t target;
+	uint64_t count = 0;
+	uint64_t result;
+
+/* */
+	if ( !hist->count )
+		return 0.0;
+	target = (uint64_t)(quantile * hist->count);
+	target = target < quantile * hist->count ? target + 1 : target;
+	target = target ? target : 1;
+/* */
+	for ( int i = 0; i < PA2EW_LATENCY_BUCKETS; i++ ) {
+		if ( (count += hist->buckets[i]) >= target ) {
+			result = bucket_upper( i );
+			return (hist->max && result > hist->max ? hist->max : result) * 1.0e-6;
+		}
+	}
+
+	return hist->max * 1.0e-6;
+}
+
+/**
+ * @brief
+ *
+ * @param stage
+ * @return const char*
+ */
+const char *pa2ew_latency_stage_name_get( const int stage )
+{
+	return stage >= 0 && stage < PA2EW_LATENCY_STAGE_NUM ? StageNames[stage] : "unknown";
+}
+
+/**
+ * @brief The values below the sub-bucket count are exact, then each power of 2 is split into the sub-buckets.
+ *
+ * @param usec
+ * @return int
+ */
+static int bucket_index( const uint64_t usec )
+{
+	int msb;
+
+/* */
+	if ( usec < PA2EW_LATENCY_SUB_COUNT )
+		return (int)usec;
+/* */
+	if ( (msb = 63 - __builtin_clzll(usec)) > PA2EW_LATENCY_MAX_MSB )
+		return PA2EW_LATENCY_BUCKETS - 1;
+
+	return (msb - PA2EW_LATENCY_SUB_BITS + 1) * PA2EW_LATENCY_SUB_COUNT +
+		(int)((usec >> (msb - PA2EW_LATENCY_SUB_BITS)) & (PA2EW_LATENCY_SUB_COUNT - 1));
+}
+
+/**
+ * @brief
+ *
+ * @param index
+ * @return uint64_t The highest value of the bucket in microseconds.
+ */
+static uint64_t bucket_upper( const int index )
+{
+	const int shift = index / PA2EW_LATENCY_SUB_COUNT - 1;
+
+/* */
+	if ( index < PA2EW_LATENCY_SUB_COUNT )
+		return (uint64_t)index;
+
+	return (((uint64_t)(PA2EW_LATENCY_SUB_COUNT + index % PA2EW_LATENCY_SUB_COUNT) + 1) << shift) - 1;
+}
+
+/**
+ * @brief Only the main thread writes the histograms, the stores are atomic for the readers of other threads.
+ *
+ * @param hist
+ * @param latency In seconds.
+ */
+static void hist_add( PA2EW_LATENCY_HIST *hist, const double latency )
+{
+	const uint64_t usec  = latency <= 0.0 ? 0 : latency < 1.0e12 ? (uint64_t)(latency * 1.0e6) : UINT64_MAX >> 1;
+	const int      index = bucket_index( usec );
+
+/* */
+	if ( latency < 0.0 )
+		__atomic_store_n(&hist->negative, hist->negative + 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&hist->buckets[index], hist->buckets[index] + 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&hist->sum, hist->sum + usec, __ATOMIC_RELAXED);
+	if ( usec > hist->max )
+		__atomic_store_n(&hist->max, usec, __ATOMIC_RELAXED);
+	__atomic_store_n(&hist->count, hist->count + 1, __ATOMIC_RELAXED);
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param dest
+ * @param src
+ */
+static void hist_copy( PA2EW_LATENCY_HIST *dest, const PA2EW_LATENCY_HIST *src )
+{
+	dest->count    = __atomic_load_n(&src->count, __ATOMIC_RELAXED);
+	dest->negative = __atomic_load_n(&src->negative, __ATOMIC_RELAXED);
+	dest->sum      = __atomic_load_n(&src->sum, __ATOMIC_RELAXED);
+	dest->max      = __atomic_load_n(&src->max, __ATOMIC_RELAXED);
+	for ( int i = 0; i < PA2EW_LATENCY_BUCKETS; i++ )
+		dest->buckets[i] = __atomic_load_n(&src->buckets[i], __ATOMIC_RELAXED);
+
+	return;
+}
+
+/**
+ * @brief The difference between the current histogram & the last snapshot, then take the new snapshot. The
+ *        maximum of the interval is the highest value of its last non-empty bucket.
+ *
+ * @param hist
+ * @param last
+ * @param dest
+ */
+static void hist_interval( const PA2EW_LATENCY_HIST *hist, PA2EW_LATENCY_HIST *last, PA2EW_LATENCY_HIST *dest )
+{
+	dest->count    = hist->count - last->count;
+	dest->negative = hist->negative - last->negative;
+	dest->sum      = hist->sum - last->sum;
+	dest->max      = 0;
+	for ( int i = 0; i < PA2EW_LATENCY_BUCKETS; i++ ) {
+		if ( (dest->buckets[i] = hist->buckets[i] - last->buckets[i]) )
+			dest->max = bucket_upper( i );
+	}
+/* The maximum of the interval can't be larger than the exact one */
+	dest->max = dest->max > hist->max ? hist->max : dest->max;
+	*last = *hist;
+
+	return;
+}
+
+/**
+ * @brief Keep the stations with the largest p99 in descending order.
+ *
+ * @param top
+ * @param serial
+ * @param hist
+ */
+static void top_station_insert( TOP_STATION *top, const uint16_t serial, const PA2EW_LATENCY_HIST *hist )
+{
+	const double p99 = pa2ew_latency_percentile_get( hist, 0.99 );
+	int          i   = PA2EW_LATENCY_TOP_STATIONS - 1;
+
+/* */
+	if ( top[i].count && p99 <= top[i].p99 )
+		return;
+	for ( ; i > 0 && (!top[i - 1].count || p99 > top[i - 1].p99); i-- )
+		top[i] = top[i - 1];
+/* */
+	top[i].serial = serial;
+	top[i].count  = hist->count;
+	top[i].p99    = p99;
+	top[i].max    = hist->max * 1.0e-6;
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param stamp
+ * @param commit_time
+ */
+static void stamp_record( const PENDING_STAMP *stamp, const double commit_time )
+{
+	STATION_LATENCY *station;
+
+/* */
+	if ( stamp->recv_time > 0.0 ) {
+		hist_add( &Stages[PA2EW_LATENCY_STAGE_SENSOR], stamp->recv_time - stamp->sample_time );
+		if ( stamp->enq_time > 0.0 )
+			hist_add( &Stages[PA2EW_LATENCY_STAGE_ASSEMBLE], stamp->enq_time - stamp->recv_time );
+	}
+	if ( stamp->enq_time > 0.0 )
+		hist_add( &Stages[PA2EW_LATENCY_STAGE_QUEUE], stamp->deq_time - stamp->enq_time );
+	hist_add( &Stages[PA2EW_LATENCY_STAGE_PROCESS], stamp->proc_time - stamp->deq_time );
+	hist_add( &Stages[PA2EW_LATENCY_STAGE_COMMIT], commit_time - stamp->proc_time );
+	hist_add( &Stages[PA2EW_LATENCY_STAGE_TOTAL], commit_time - stamp->sample_time );
+/* The station's histogram only keeps the total latency */
+	if ( !(station = Stations[stamp->serial]) ) {
+		if ( !(station = calloc(1, sizeof(STATION_LATENCY))) )
+			return;
+		__atomic_store_n(&Stations[stamp->serial], station, __ATOMIC_RELEASE);
+	}
+	hist_add( &station->hist, commit_time - stamp->sample_time );
+
+	return;
+}
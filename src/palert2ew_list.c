@@ -35,6 +35,7 @@
 #include <dl_chain_list.h>
 #include <palert2ew_misc.h>
 #include <palert2ew_list.h>
+#include <palert2ew_mseed.h>
 
 /**
  * @brief
@@ -46,8 +47,30 @@ typedef struct {
 	void   *entry;      /* Pointer to first client       */
 	void   *root;       /* Root of binary searching tree */
 	void   *root_t;     /* Temporary root of binary searching tree */
+	void   *rules;      /* Chain list of station rules   */
 } StaList;
 
+/**
+ * @brief Station rule, matching by network, serial range or station code
+ *
+ */
+typedef struct {
+	int  target;
+	int  value;
+	int  type;
+	int  serial_lo;
+	int  serial_hi;
+	char code[TRACE2_NET_LEN > TRACE2_STA_LEN ? TRACE2_NET_LEN : TRACE2_STA_LEN];
+} StaRule;
+
+/**
+ * @brief
+ *
+ */
+#define RULE_BY_NETWORK  0
+#define RULE_BY_SERIAL   1
+#define RULE_BY_STATION  2
+
 /**
  * @name Internal functions' prototype
  *
@@ -60,11 +83,15 @@ static _STAINFO *create_new_stainfo( const int, const char *, const char *, cons
 static _CHAINFO *enrich_chainfo_default( _STAINFO * );
 static _STAINFO *enrich_stainfo_raw( _STAINFO *, const int, const char *, const char *, const char * );
 static _CHAINFO *enrich_chainfo_raw( _STAINFO *, const int, const char *[] );
+static void      enrich_chainfo_trh2( _STAINFO * );
 static _STAINFO *update_stainfo_and_chainfo( _STAINFO *, const _STAINFO * );
+static StaRule  *append_rule_list( StaList *, const int, const int, const int, const char *, const int, const int );
+static void      apply_station_rules( _STAINFO *, const DL_NODE * );
 static int       obsolete_clear_cond( void *, void * );
 static int       compare_serial( const void *, const void * );	/* The compare function of binary tree search */
 static void      dummy_func( void * );
 static void      free_stainfo_and_chainfo( void * );
+static void      free_chainfo( void *, const int );
 /* */
 #if defined( _USE_SQL )
 static void extract_stainfo_mysql( int *, char *, char *, char *, const MYSQL_ROW, const unsigned long * );
@@ -248,8 +275,20 @@ void pa2ew_list_obsolete_clear( void )
  */
 void pa2ew_list_tree_activate( void )
 {
-	void *_root = SList->root;
+	void     *_root = SList->root;
+	DL_NODE  *node  = NULL;
+	_STAINFO *stainfo;
 
+/* Apply the station rules before the new tree going online */
+	DL_LIST_FOR_EACH_DATA( (DL_NODE *)SList->entry, node, stainfo ) {
+		apply_station_rules( stainfo, (DL_NODE *)SList->rules );
+	/* The intake budget belongs to the receiving thread, it will be resized there by the new channel number */
+		if ( stainfo->update == PA2EW_PALERT_INFO_RESIZED ) {
+			__atomic_add_fetch(&stainfo->budget_seq, 1, __ATOMIC_RELAXED);
+			stainfo->update = PA2EW_PALERT_INFO_UPDATED;
+		}
+	}
+/* */
 	SList->root      = SList->root_t;
 	SList->root_t    = NULL;
 	SList->timestamp = pa2ew_timenow_get();
@@ -325,6 +364,71 @@ void pa2ew_list_walk( void (*action)( void *, const int, void * ), void *arg )
 	return;
 }
 
+/**
+ * @brief Parse the station rule line, like "net TW", "serial 1000 1999" or "station TEST TEST2".
+ *
+ * @param line
+ * @param target
+ * @param value
+ * @return int
+ */
+int pa2ew_list_rule_line_parse( const char *line, const int target, const int value )
+{
+	int  result = 0;
+	int  offset = 0;
+	int  serial_lo;
+	int  serial_hi;
+	char type[16] = { 0 };
+	char code[TRACE2_NET_LEN > TRACE2_STA_LEN ? TRACE2_NET_LEN : TRACE2_STA_LEN] = { 0 };
+
+/* */
+	if ( !SList ) {
+		SList = init_sta_list();
+		if ( !SList ) {
+			logit("e", "palert2ew: Fatal! Station list memory initialized error!\n");
+			return -3;
+		}
+	}
+/* */
+	if ( sscanf(line, "%15s %n", type, &offset) < 1 ) {
+		logit("e", "palert2ew: ERROR, empty station rule!\n");
+		return -1;
+	}
+	line += offset;
+/* */
+	if ( !strcmp(type, "net") ) {
+		if ( sscanf(line, "%8s", code) == 1 )
+			result = append_rule_list( SList, target, value, RULE_BY_NETWORK, code, 0, 0 ) ? 0 : -2;
+		else
+			result = -1;
+	}
+	else if ( !strcmp(type, "serial") ) {
+		if ( sscanf(line, "%d %d", &serial_lo, &serial_hi) == 2 && serial_lo <= serial_hi )
+			result = append_rule_list( SList, target, value, RULE_BY_SERIAL, NULL, serial_lo, serial_hi ) ? 0 : -2;
+		else
+			result = -1;
+	}
+	else if ( !strcmp(type, "station") ) {
+		result = -1;
+		while ( sscanf(line, "%6s %n", code, &offset) == 1 ) {
+			if ( !append_rule_list( SList, target, value, RULE_BY_STATION, code, 0, 0 ) ) {
+				result = -2;
+				break;
+			}
+			line  += offset;
+			result = 0;
+		}
+	}
+	else {
+		result = -1;
+	}
+/* */
+	if ( result == -1 )
+		logit("e", "palert2ew: ERROR, unknown or incomplete station rule <%s %s>!\n", type, line);
+
+	return result;
+}
+
 #if defined( _USE_SQL )
 /**
  * @brief
@@ -500,6 +604,7 @@ static StaList *init_sta_list( void )
 		result->entry     = NULL;
 		result->root      = NULL;
 		result->root_t    = NULL;
+		result->rules     = NULL;
 	}
 
 	return result;
@@ -516,6 +621,7 @@ static void destroy_sta_list( StaList *list )
 	/* */
 		tdestroy(list->root, dummy_func);
 		dl_list_destroy( (DL_NODE **)&list->entry, free_stainfo_and_chainfo );
+		dl_list_destroy( (DL_NODE **)&list->rules, free );
 		free(list);
 	}
 
@@ -642,8 +748,11 @@ static _STAINFO *enrich_stainfo_raw(
 	_STAINFO *stainfo, const int serial, const char *sta, const char *net, const char *loc
 ) {
 /* */
-	stainfo->update = PA2EW_PALERT_INFO_UPDATED;
-	stainfo->serial = serial;
+	stainfo->update   = PA2EW_PALERT_INFO_UPDATED;
+	stainfo->priority = PA2EW_DEF_STA_PRIORITY;
+	stainfo->shard    = 0;
+	stainfo->queued   = 0;
+	stainfo->serial   = serial;
 	stainfo->chaptr = NULL;
 	stainfo->buffer = NULL;
 	strncpy(stainfo->sta, sta, TRACE2_STA_LEN);
@@ -679,11 +788,40 @@ static _CHAINFO *enrich_chainfo_raw( _STAINFO *stainfo, const int nchannel, cons
 			chainfo[i].chan[TRACE2_CHAN_LEN - 1] = '\0';
 			chainfo[i].last_endtime = -1.0;
 		}
+		enrich_chainfo_trh2( stainfo );
 	}
 
 	return chainfo;
 }
 
+/**
+ * @brief Build the tracebuf header templates of all the channels, only the sampling information is left for
+ *        the packets. The templates are built into the inactive slot and then swapped in, so the processing
+ *        threads never copy a half-built one.
+ *
+ * @param stainfo
+ */
+static void enrich_chainfo_trh2( _STAINFO *stainfo )
+{
+	_CHAINFO     *chainfo = (_CHAINFO *)stainfo->chaptr;
+	TRACE2_HEADER trh2;
+	uint8_t       inactive;
+
+/* */
+	for ( int i = 0; chainfo && i < stainfo->nchannel; i++ ) {
+		memset(&trh2, 0, sizeof(TRACE2_HEADER));
+		pa2ew_trh2_init( &trh2 );
+		pa2ew_trh2_scn_enrich( &trh2, stainfo->sta, stainfo->net, stainfo->loc );
+		memcpy(trh2.chan, chainfo[i].chan, TRACE2_CHAN_LEN);
+	/* */
+		inactive = !__atomic_load_n(&chainfo[i].trh2_active, __ATOMIC_ACQUIRE);
+		chainfo[i].trh2[inactive] = trh2;
+		__atomic_store_n(&chainfo[i].trh2_active, inactive, __ATOMIC_RELEASE);
+	}
+
+	return;
+}
+
 /**
  * @brief
  *
@@ -693,36 +831,140 @@ static _CHAINFO *enrich_chainfo_raw( _STAINFO *stainfo, const int nchannel, cons
  */
 static _STAINFO *update_stainfo_and_chainfo( _STAINFO *dest, const _STAINFO *src )
 {
+	int scnl_changed = 0;
+
 /* */
-	if ( strcmp(dest->sta, src->sta) )
+	if ( strcmp(dest->sta, src->sta) ) {
 		strcpy(dest->sta, src->sta);
-	if ( strcmp(dest->net, src->net) )
+		scnl_changed = 1;
+	}
+	if ( strcmp(dest->net, src->net) ) {
 		strcpy(dest->net, src->net);
-	if ( strcmp(dest->loc, src->loc) )
+		scnl_changed = 1;
+	}
+	if ( strcmp(dest->loc, src->loc) ) {
 		strcpy(dest->loc, src->loc);
+		scnl_changed = 1;
+	}
 /* */
 	if ( dest->nchannel != src->nchannel ) {
-		free(dest->chaptr);
+		free_chainfo( dest->chaptr, dest->nchannel );
 		dest->chaptr = NULL;
 	}
 	else {
 		for ( int i = 0; i < dest->nchannel; i++ ) {
 			if ( strcmp(((_CHAINFO *)dest->chaptr)[i].chan, ((_CHAINFO *)src->chaptr)[i].chan) ) {
-				free(dest->chaptr);
+				free_chainfo( dest->chaptr, dest->nchannel );
 				dest->chaptr = NULL;
 				break;
 			}
 		}
 	}
-/* */
-	if ( !dest->chaptr )
-		dest->chaptr = src->chaptr;
-/* */
-	dest->update = PA2EW_PALERT_INFO_UPDATED;
+/* The new channels already have their templates with the new SCNL */
+	if ( !dest->chaptr ) {
+		dest->update   = dest->nchannel != src->nchannel ? PA2EW_PALERT_INFO_RESIZED : PA2EW_PALERT_INFO_UPDATED;
+		dest->chaptr   = src->chaptr;
+		dest->nchannel = src->nchannel;
+	}
+	else {
+		if ( scnl_changed )
+			enrich_chainfo_trh2( dest );
+		dest->update = PA2EW_PALERT_INFO_UPDATED;
+	}
 
 	return dest;
 }
 
+/**
+ * @brief Appending the new rule to the rule list.
+ *
+ * @param list
+ * @param target
+ * @param value
+ * @param type
+ * @param code
+ * @param serial_lo
+ * @param serial_hi
+ * @return StaRule*
+ */
+static StaRule *append_rule_list(
+	StaList *list, const int target, const int value, const int type,
+	const char *code, const int serial_lo, const int serial_hi
+) {
+	StaRule *result = (StaRule *)calloc(1, sizeof(StaRule));
+
+/* */
+	if ( result ) {
+		result->target    = target;
+		result->value     = value;
+		result->type      = type;
+		result->serial_lo = serial_lo;
+		result->serial_hi = serial_hi;
+		if ( code ) {
+			strncpy(result->code, code, sizeof(result->code));
+			result->code[sizeof(result->code) - 1] = '\0';
+		}
+	/* */
+		if ( dl_node_append( (DL_NODE **)&list->rules, result ) == NULL ) {
+			logit("e", "palert2ew: Error insert station rule into linked list!\n");
+			free(result);
+			result = NULL;
+		}
+	}
+
+	return result;
+}
+
+/**
+ * @brief Apply all the matched rules to the station, the later rule will override the former one.
+ *
+ * @param stainfo
+ * @param rules
+ */
+static void apply_station_rules( _STAINFO *stainfo, const DL_NODE *rules )
+{
+	const DL_NODE *node     = NULL;
+	const StaRule *rule     = NULL;
+	uint8_t        priority = PA2EW_DEF_STA_PRIORITY;
+	uint8_t        shard    = 0;
+
+/* Resolve in the locals, the receivers & the main thread keep reading the live ones during the updating */
+	DL_LIST_FOR_EACH_DATA( rules, node, rule ) {
+		switch ( rule->type ) {
+		case RULE_BY_NETWORK:
+			if ( strcmp(stainfo->net, rule->code) )
+				continue;
+			break;
+		case RULE_BY_SERIAL:
+			if ( stainfo->serial < rule->serial_lo || stainfo->serial > rule->serial_hi )
+				continue;
+			break;
+		case RULE_BY_STATION:
+			if ( strcmp(stainfo->sta, rule->code) )
+				continue;
+			break;
+		default:
+			continue;
+		}
+	/* */
+		switch ( rule->target ) {
+		case PA2EW_LIST_RULE_PRIORITY:
+			priority = rule->value;
+			break;
+		case PA2EW_LIST_RULE_SHARD:
+			shard = rule->value;
+			break;
+		default:
+			break;
+		}
+	}
+/* Each one is stored only once, so the readers never see the default value in the middle */
+	__atomic_store_n(&stainfo->priority, priority, __ATOMIC_RELAXED);
+	__atomic_store_n(&stainfo->shard, shard, __ATOMIC_RELAXED);
+
+	return;
+}
+
 /**
  * @brief
  *
@@ -783,8 +1025,28 @@ static void free_stainfo_and_chainfo( void *node )
 	if ( stainfo->buffer )
 		free(stainfo->buffer);
 /* */
-	free(stainfo->chaptr);
+	free_chainfo( stainfo->chaptr, stainfo->nchannel );
 	free(stainfo);
 
 	return;
 }
+
+/**
+ * @brief Free the channel info array with the pending samples of the aggregation stage & the mini-SEED output.
+ *
+ * @param chaptr
+ * @param nchannel
+ */
+static void free_chainfo( void *chaptr, const int nchannel )
+{
+	_CHAINFO *chainfo = (_CHAINFO *)chaptr;
+
+/* */
+	for ( int i = 0; chainfo && i < nchannel; i++ ) {
+		free(chainfo[i].aggr);
+		pa2ew_mseed_state_free( chainfo[i].mseed );
+	}
+	free(chaptr);
+
+	return;
+}
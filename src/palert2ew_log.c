@@ -0,0 +1,352 @@
+/**
+ * @file palert2ew_log.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Asynchronous & rate-limited logging. Each thread formats its messages into its own lock-free buffer,
+ *        and a background writer drains all the buffers into logit (or stdout). The same message of the same
+ *        key (e.g. station) is only logged once within the interval, the suppressed count comes with the next one.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <pthread.h>
+
+/**
+ * @name Earthworm environment header include
+ *
+ */
+#include <earthworm.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <palert2ew_misc.h>
+#include <palert2ew_log.h>
+
+/**
+ * @name States of the buffer
+ *
+ */
+#define LOG_BUFFER_FREE      0
+#define LOG_BUFFER_OWNED     1
+#define LOG_BUFFER_RELEASED  2  /* The owner thread is gone, it will be free after drained */
+
+/**
+ * @brief
+ *
+ */
+typedef struct {
+	char    flag[4];
+	uint8_t to_stdout;
+	char    text[PA2EW_LOG_MAX_LENGTH];
+} LOG_ENTRY;
+
+/**
+ * @brief
+ *
+ */
+typedef struct {
+	uint64_t id;
+	double   until;
+	uint32_t suppressed;
+} RATE_SLOT;
+
+/**
+ * @brief Single producer (the owner thread) & single consumer (the writer thread) buffer
+ *
+ */
+typedef struct {
+	uint32_t  head;      /* Only moved by the owner thread  */
+	uint32_t  tail;      /* Only moved by the writer thread */
+	uint64_t  dropped;   /* Messages dropped while the buffer is full */
+	uint64_t  reported;
+	RATE_SLOT rates[PA2EW_LOG_RATE_SLOTS];  /* Only touched by the owner thread */
+	LOG_ENTRY entries[PA2EW_LOG_THREAD_ENTRIES];
+} LOG_BUFFER;
+
+/**
+ * @name Internal functions' prototype
+ *
+ */
+static LOG_BUFFER *get_thread_buffer( void );
+static void        release_thread_buffer( void * );
+static int         rate_limit_check( LOG_BUFFER *, const char *, const char *, uint32_t * );
+static void        write_entry( const char *, const int, const char * );
+static void        drain_buffers( void );
+static void       *writer_thread( void * );
+
+/**
+ * @name Internal static variables
+ *
+ */
+static LOG_BUFFER         *Buffers[PA2EW_LOG_MAX_THREADS];
+static int                 States[PA2EW_LOG_MAX_THREADS];
+static __thread LOG_BUFFER *ThreadBuffer = NULL;
+static pthread_key_t       ReleaseKey;
+static pthread_t           WriterThread;
+static volatile int        Running  = 0;
+static double              Interval = PA2EW_LOG_DEF_INTERVAL;
+
+/**
+ * @brief Start the background writer.
+ *
+ * @param interval Seconds between the same messages, 0 for no rate limiting.
+ * @return int
+ */
+int pa2ew_log_init( const double interval )
+{
+/* */
+	Interval = interval > 0.0 ? interval : 0.0;
+	if ( Running )
+		return 0;
+	if ( pthread_key_create(&ReleaseKey, release_thread_buffer) )
+		return -1;
+/* */
+	Running = 1;
+	if ( pthread_create(&WriterThread, NULL, writer_thread, NULL) ) {
+		Running = 0;
+		pthread_key_delete(ReleaseKey);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Stop the background writer & drain all the remaining messages, the later messages will be logged directly.
+ *
+ */
+void pa2ew_log_end( void )
+{
+	if ( Running ) {
+		__atomic_store_n(&Running, 0, __ATOMIC_RELEASE);
+		pthread_join(WriterThread, NULL);
+		drain_buffers();
+	}
+
+	return;
+}
+
+/**
+ * @brief Log the message like logit without blocking on the file I/O.
+ *
+ * @param flag The flag of logit, or PA2EW_LOG_STDOUT for printf.
+ * @param key The messages with the same format & key are rate-limited together, it can be NULL.
+ * @param format
+ * @param ...
+ */
+void pa2ew_log( const char *flag, const char *key, const char *format, ... )
+{
+	LOG_BUFFER *buffer = __atomic_load_n(&Running, __ATOMIC_ACQUIRE) ? get_thread_buffer() : NULL;
+	LOG_ENTRY  *entry;
+	LOG_ENTRY   _entry;
+	uint32_t    head;
+	uint32_t    suppressed = 0;
+	size_t      len;
+	va_list     ap;
+
+/* */
+	if ( buffer && rate_limit_check( buffer, format, key, &suppressed ) )
+		return;
+/* Without the room, just count it */
+	if ( buffer ) {
+		head = buffer->head;
+		if ( head - __atomic_load_n(&buffer->tail, __ATOMIC_ACQUIRE) >= PA2EW_LOG_THREAD_ENTRIES ) {
+			__atomic_fetch_add(&buffer->dropped, 1, __ATOMIC_RELAXED);
+			return;
+		}
+		entry = &buffer->entries[head & (PA2EW_LOG_THREAD_ENTRIES - 1)];
+	}
+	else {
+		entry = &_entry;
+	}
+/* */
+	va_start(ap, format);
+	vsnprintf(entry->text, PA2EW_LOG_MAX_LENGTH, format, ap);
+	va_end(ap);
+	if ( suppressed ) {
+		len = strlen(entry->text);
+		if ( len && entry->text[len - 1] == '\n' )
+			len--;
+		snprintf(entry->text + len, PA2EW_LOG_MAX_LENGTH - len, " (%u similar messages suppressed)\n", suppressed);
+	}
+	entry->to_stdout = flag == PA2EW_LOG_STDOUT;
+	if ( flag )
+		strncpy(entry->flag, flag, sizeof(entry->flag) - 1);
+	entry->flag[sizeof(entry->flag) - 1] = '\0';
+/* */
+	if ( buffer )
+		__atomic_store_n(&buffer->head, head + 1, __ATOMIC_RELEASE);
+	else
+		write_entry( entry->flag, entry->to_stdout, entry->text );
+
+	return;
+}
+
+/**
+ * @brief Get the buffer of this thread, or claim a free one.
+ *
+ * @return LOG_BUFFER* NULL if there is no free buffer, then the messages will be logged directly.
+ */
+static LOG_BUFFER *get_thread_buffer( void )
+{
+	int expected;
+
+/* */
+	if ( ThreadBuffer )
+		return ThreadBuffer;
+	for ( int i = 0; i < PA2EW_LOG_MAX_THREADS; i++ ) {
+		expected = LOG_BUFFER_FREE;
+		if ( !__atomic_compare_exchange_n(&States[i], &expected, LOG_BUFFER_OWNED, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED) )
+			continue;
+	/* The keys of the previous owner are meaningless */
+		if ( Buffers[i] ) {
+			memset(Buffers[i]->rates, 0, sizeof(Buffers[i]->rates));
+		}
+		else {
+			LOG_BUFFER *buffer = calloc(1, sizeof(LOG_BUFFER));
+			if ( !buffer ) {
+				__atomic_store_n(&States[i], LOG_BUFFER_FREE, __ATOMIC_RELEASE);
+				return NULL;
+			}
+			__atomic_store_n(&Buffers[i], buffer, __ATOMIC_RELEASE);
+		}
+	/* Release it when this thread exits */
+		ThreadBuffer = Buffers[i];
+		pthread_setspecific(ReleaseKey, (void *)(intptr_t)(i + 1));
+		return ThreadBuffer;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief
+ *
+ * @param arg The index of buffer plus one.
+ */
+static void release_thread_buffer( void *arg )
+{
+	__atomic_store_n(&States[(intptr_t)arg - 1], LOG_BUFFER_RELEASED, __ATOMIC_RELEASE);
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param buffer
+ * @param format
+ * @param key
+ * @param suppressed Output the suppressed count of the last interval.
+ * @return int 1 for suppressing the message, 0 for logging it.
+ */
+static int rate_limit_check( LOG_BUFFER *buffer, const char *format, const char *key, uint32_t *suppressed )
+{
+	uint64_t   id = (uint64_t)(uintptr_t)format * 0x9e3779b97f4a7c15ULL;
+	RATE_SLOT *slot;
+	double     now;
+
+/* */
+	if ( Interval <= 0.0 )
+		return 0;
+/* FNV-1a of the key, mixed with the format */
+	for ( ; key && *key; key++ )
+		id = (id ^ (uint8_t)*key) * 0x100000001b3ULL;
+	slot = &buffer->rates[id % PA2EW_LOG_RATE_SLOTS];
+	now  = pa2ew_timenow_get();
+/* */
+	if ( slot->id == id && now < slot->until ) {
+		slot->suppressed++;
+		return 1;
+	}
+	*suppressed      = slot->id == id ? slot->suppressed : 0;
+	slot->id         = id;
+	slot->until      = now + Interval;
+	slot->suppressed = 0;
+
+	return 0;
+}
+
+/**
+ * @brief
+ *
+ * @param flag
+ * @param to_stdout
+ * @param text
+ */
+static void write_entry( const char *flag, const int to_stdout, const char *text )
+{
+	if ( to_stdout )
+		printf("%s", text);
+	else
+		logit(flag, "%s", text);
+
+	return;
+}
+
+/**
+ * @brief Drain all the buffers, and free those buffers whose owner is gone.
+ *
+ */
+static void drain_buffers( void )
+{
+	LOG_BUFFER *buffer;
+	LOG_ENTRY  *entry;
+	uint32_t    head;
+	uint64_t    dropped;
+
+/* */
+	for ( int i = 0; i < PA2EW_LOG_MAX_THREADS; i++ ) {
+		if ( !(buffer = __atomic_load_n(&Buffers[i], __ATOMIC_ACQUIRE)) )
+			continue;
+	/* */
+		head = __atomic_load_n(&buffer->head, __ATOMIC_ACQUIRE);
+		for ( uint32_t tail = buffer->tail; tail != head; tail++ ) {
+			entry = &buffer->entries[tail & (PA2EW_LOG_THREAD_ENTRIES - 1)];
+			write_entry( entry->flag, entry->to_stdout, entry->text );
+			__atomic_store_n(&buffer->tail, tail + 1, __ATOMIC_RELEASE);
+		}
+	/* */
+		if ( (dropped = __atomic_load_n(&buffer->dropped, __ATOMIC_RELAXED)) != buffer->reported ) {
+			logit("e", "palert2ew: %lu log messages were dropped, the log buffer is full!\n", (unsigned long)(dropped - buffer->reported));
+			buffer->reported = dropped;
+		}
+	/* The owner is gone, and everything it left is drained */
+		if (
+			__atomic_load_n(&States[i], __ATOMIC_ACQUIRE) == LOG_BUFFER_RELEASED &&
+			buffer->tail == __atomic_load_n(&buffer->head, __ATOMIC_ACQUIRE)
+		) {
+			__atomic_store_n(&States[i], LOG_BUFFER_FREE, __ATOMIC_RELEASE);
+		}
+	}
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param arg
+ * @return void*
+ */
+static void *writer_thread( void *arg )
+{
+	while ( __atomic_load_n(&Running, __ATOMIC_ACQUIRE) ) {
+		drain_buffers();
+		sleep_ew(PA2EW_LOG_DRAIN_MSEC);
+	}
+
+	return NULL;
+}
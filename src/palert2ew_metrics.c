@@ -0,0 +1,435 @@
+/**
+ * @file palert2ew_metrics.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Lock-free counters & the metrics endpoint. Each thread adds to its own block of counters, and the
+ *        endpoint thread sums up all the blocks then serves them in Prometheus text format by HTTP over the
+ *        local TCP or UNIX socket.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/**
+ * @name Network related header include
+ *
+ */
+#include <netdb.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**
+ * @name Earthworm environment header include
+ *
+ */
+#include <earthworm.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <palert2ew_metrics.h>
+
+/**
+ * @brief Only written by its owner thread, one cache line at least
+ *
+ */
+typedef struct {
+	uint64_t counters[PA2EW_METRIC_NUM];
+} __attribute__((aligned(64))) COUNTER_BLOCK;
+
+/**
+ * @brief
+ *
+ */
+typedef struct {
+	const char *name;
+	const char *labels;
+	const char *help;
+	double      scale;  /* 0.0 for the integer */
+} COUNTER_INFO;
+
+/**
+ * @name Internal functions' prototype
+ *
+ */
+static COUNTER_BLOCK *get_thread_block( void );
+static void           release_thread_block( void * );
+static void           write_counters( FILE * );
+static int            listen_socket_open( const char * );
+static void           serve_request( const int );
+static int            send_all( const int, const char *, size_t );
+static void          *endpoint_thread( void * );
+
+/**
+ * @name Internal static variables
+ *
+ */
+static COUNTER_BLOCK          Blocks[PA2EW_METRICS_MAX_THREADS];
+static int                    Claimed[PA2EW_METRICS_MAX_THREADS];
+static COUNTER_BLOCK          SharedBlock;  /* For those threads without their own block, added atomically */
+static __thread COUNTER_BLOCK *ThreadBlock = NULL;
+static pthread_key_t          ReleaseKey;
+static volatile int           Ready        = 0;
+static volatile int           Running      = 0;
+static pthread_t              EndpointThread;
+static int                    ListenSocket = -1;
+static char                   UnixPath[sizeof(((struct sockaddr_un *)0)->sun_path)] = { 0 };
+static void                 (*Provider)( FILE * ) = NULL;
+static const COUNTER_INFO     Counters[PA2EW_METRIC_NUM] = {
+	{ "palert2ew_recv_bytes_total", NULL, "Bytes received from the Palerts or the forward server.", 0.0 },
+	{ "palert2ew_recv_packets_total", NULL, "Complete packets put into the main queue.", 0.0 },
+	{ "palert2ew_sync_errors_total", NULL, "Sync. errors of the TCP stream or the packets.", 0.0 },
+	{ "palert2ew_frames_total", "mode=\"1\"", "Packets processed by the main thread for each packet mode.", 0.0 },
+	{ "palert2ew_frames_total", "mode=\"2\"", NULL, 0.0 },
+	{ "palert2ew_frames_total", "mode=\"4\"", NULL, 0.0 },
+	{ "palert2ew_frames_total", "mode=\"16\"", NULL, 0.0 },
+	{ "palert2ew_crc_failures_total", NULL, "Packets failed the CRC checking.", 0.0 },
+	{ "palert2ew_ntp_questionable_total", NULL, "Packets from the stations without NTP synchronization.", 0.0 },
+	{ "palert2ew_decode_seconds_total", NULL, "Seconds of decoding & CRC checking the packets.", 1.0e-9 },
+	{ "palert2ew_decode_packets_total", NULL, "Packets decoded by the main thread.", 0.0 }
+};
+
+/**
+ * @brief Start counting, and serve the metrics on the endpoint if it's given.
+ *
+ * @param listen_str Port or host:port of the local HTTP endpoint, or the path of UNIX socket; NULL or empty for
+ *               counting only.
+ * @param provider The function writes the other metrics (e.g. gauges) in Prometheus text format, it can be NULL.
+ * @return int
+ */
+int pa2ew_metrics_init( const char *listen_str, void (*provider)( FILE * ) )
+{
+/* */
+	if ( !Ready ) {
+		if ( pthread_key_create(&ReleaseKey, release_thread_block) )
+			return -1;
+		__atomic_store_n(&Ready, 1, __ATOMIC_RELEASE);
+	}
+	Provider = provider;
+/* */
+	if ( !listen_str || !listen_str[0] || Running )
+		return 0;
+	if ( (ListenSocket = listen_socket_open( listen_str )) < 0 )
+		return -1;
+/* */
+	Running = 1;
+	if ( pthread_create(&EndpointThread, NULL, endpoint_thread, NULL) ) {
+		Running = 0;
+		close(ListenSocket);
+		ListenSocket = -1;
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Stop the endpoint, the counting still works after it.
+ *
+ */
+void pa2ew_metrics_end( void )
+{
+	if ( Running ) {
+		__atomic_store_n(&Running, 0, __ATOMIC_RELEASE);
+		pthread_join(EndpointThread, NULL);
+		close(ListenSocket);
+		ListenSocket = -1;
+		if ( UnixPath[0] )
+			unlink(UnixPath);
+	}
+
+	return;
+}
+
+/**
+ * @brief Add the value to the counter of this thread without any lock.
+ *
+ * @param metric
+ * @param value
+ */
+void pa2ew_metrics_add( const int metric, const uint64_t value )
+{
+	COUNTER_BLOCK *block = ThreadBlock ? ThreadBlock : get_thread_block();
+
+/* */
+	if ( block )
+		__atomic_store_n(&block->counters[metric], block->counters[metric] + value, __ATOMIC_RELAXED);
+	else
+		__atomic_fetch_add(&SharedBlock.counters[metric], value, __ATOMIC_RELAXED);
+
+	return;
+}
+
+/**
+ * @brief The sum of all the threads.
+ *
+ * @param metric
+ * @return uint64_t
+ */
+uint64_t pa2ew_metrics_get( const int metric )
+{
+	uint64_t result = __atomic_load_n(&SharedBlock.counters[metric], __ATOMIC_RELAXED);
+
+/* The blocks keep their counts after released, so the sum never goes back */
+	for ( int i = 0; i < PA2EW_METRICS_MAX_THREADS; i++ )
+		result += __atomic_load_n(&Blocks[i].counters[metric], __ATOMIC_RELAXED);
+
+	return result;
+}
+
+/**
+ * @brief Monotonic clock for measuring the duration.
+ *
+ * @return uint64_t In nanoseconds.
+ */
+uint64_t pa2ew_metrics_nsec_get( void )
+{
+	struct timespec time_sp;
+
+	clock_gettime(CLOCK_MONOTONIC, &time_sp);
+
+	return (uint64_t)time_sp.tv_sec * 1000000000ULL + (uint64_t)time_sp.tv_nsec;
+}
+
+/**
+ * @brief Claim a free block for this thread, the counts of its previous owner are kept.
+ *
+ * @return COUNTER_BLOCK* NULL if there is no free block or it's not initialized yet.
+ */
+static COUNTER_BLOCK *get_thread_block( void )
+{
+	int expected;
+
+/* */
+	if ( !__atomic_load_n(&Ready, __ATOMIC_ACQUIRE) )
+		return NULL;
+	for ( int i = 0; i < PA2EW_METRICS_MAX_THREADS; i++ ) {
+		expected = 0;
+		if ( __atomic_compare_exchange_n(&Claimed[i], &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED) ) {
+			ThreadBlock = &Blocks[i];
+			pthread_setspecific(ReleaseKey, (void *)(intptr_t)(i + 1));
+			return ThreadBlock;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief
+ *
+ * @param arg The index of block plus one.
+ */
+static void release_thread_block( void *arg )
+{
+	__atomic_store_n(&Claimed[(intptr_t)arg - 1], 0, __ATOMIC_RELEASE);
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param fp
+ */
+static void write_counters( FILE *fp )
+{
+	uint64_t value;
+
+/* */
+	for ( int i = 0; i < PA2EW_METRIC_NUM; i++ ) {
+		if ( Counters[i].help ) {
+			fprintf(fp, "# HELP %s %s\n", Counters[i].name, Counters[i].help);
+			fprintf(fp, "# TYPE %s counter\n", Counters[i].name);
+		}
+	/* */
+		value = pa2ew_metrics_get( i );
+		fprintf(fp, "%s", Counters[i].name);
+		if ( Counters[i].labels )
+			fprintf(fp, "{%s}", Counters[i].labels);
+		if ( Counters[i].scale > 0.0 )
+			fprintf(fp, " %.9f\n", value * Counters[i].scale);
+		else
+			fprintf(fp, " %lu\n", (unsigned long)value);
+	}
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param listen_str
+ * @return int
+ */
+static int listen_socket_open( const char *listen_str )
+{
+	int              result   = -1;
+	int              sock_opt = 1;
+	char             host[NI_MAXHOST] = PA2EW_METRICS_DEF_HOST;
+	const char      *port     = listen_str;
+	const char      *sep;
+	struct addrinfo  hints;
+	struct addrinfo *servinfo, *p;
+
+/* The path of UNIX socket */
+	if ( listen_str[0] == '/' ) {
+		struct sockaddr_un addr;
+
+		if ( strlen(listen_str) >= sizeof(addr.sun_path) ) {
+			logit("e", "palert2ew: The path of metrics socket %s is too long!\n", listen_str);
+			return -1;
+		}
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strcpy(addr.sun_path, listen_str);
+	/* Remove the one left by the last run */
+		unlink(listen_str);
+		if ( (result = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 )
+			return -1;
+		if ( bind(result, (struct sockaddr *)&addr, sizeof(addr)) || listen(result, 8) ) {
+			logit("e", "palert2ew: Cannot listen on the metrics socket %s (%s)!\n", listen_str, strerror(errno));
+			close(result);
+			return -1;
+		}
+		strcpy(UnixPath, listen_str);
+
+		return result;
+	}
+/* Port or host:port */
+	if ( (sep = strrchr(listen_str, ':')) ) {
+		snprintf(host, sizeof(host), "%.*s", (int)(sep - listen_str), listen_str);
+		port = sep + 1;
+	}
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family   = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags    = AI_PASSIVE;
+	if ( getaddrinfo(host, port, &hints, &servinfo) ) {
+		logit("e", "palert2ew: Get the metrics endpoint address info of %s error!\n", listen_str);
+		return -1;
+	}
+	for ( p = servinfo; p != NULL; p = p->ai_next ) {
+		if ( (result = socket(p->ai_family, p->ai_socktype, p->ai_protocol)) < 0 )
+			continue;
+		setsockopt(result, SOL_SOCKET, SO_REUSEADDR, &sock_opt, sizeof(sock_opt));
+		if ( !bind(result, p->ai_addr, p->ai_addrlen) && !listen(result, 8) )
+			break;
+		close(result);
+		result = -1;
+	}
+	freeaddrinfo(servinfo);
+/* */
+	if ( result < 0 )
+		logit("e", "palert2ew: Cannot listen on the metrics endpoint %s:%s (%s)!\n", host, port, strerror(errno));
+
+	return result;
+}
+
+/**
+ * @brief Any GET request gets all the metrics, then the connection will be closed.
+ *
+ * @param sock
+ */
+static void serve_request( const int sock )
+{
+	static const char not_allowed[] =
+		"HTTP/1.0 405 Method Not Allowed\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+	char           request[PA2EW_METRICS_REQUEST_SIZE];
+	char           header[256];
+	char          *body = NULL;
+	size_t         size = 0;
+	int            len;
+	FILE          *fp;
+	struct timeval timeout = { 1, 0 };
+
+/* Never be blocked by the slow client */
+	setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+	if ( (len = recv(sock, request, sizeof(request) - 1, 0)) <= 0 )
+		return;
+	request[len] = '\0';
+	if ( strncmp(request, "GET ", 4) ) {
+		send_all( sock, not_allowed, sizeof(not_allowed) - 1 );
+		return;
+	}
+/* */
+	if ( !(fp = open_memstream(&body, &size)) )
+		return;
+	write_counters( fp );
+	if ( Provider )
+		Provider( fp );
+	fclose(fp);
+/* */
+	len = snprintf(
+		header, sizeof(header),
+		"HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %lu\r\nConnection: close\r\n\r\n",
+		(unsigned long)size
+	);
+	if ( !send_all( sock, header, len ) )
+		send_all( sock, body, size );
+	free(body);
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param sock
+ * @param data
+ * @param size
+ * @return int
+ */
+static int send_all( const int sock, const char *data, size_t size )
+{
+	ssize_t ret;
+
+	for ( ; size; data += ret, size -= ret ) {
+		if ( (ret = send(sock, data, size, MSG_NOSIGNAL)) <= 0 )
+			return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief
+ *
+ * @param arg
+ * @return void*
+ */
+static void *endpoint_thread( void *arg )
+{
+	struct pollfd pfd = { .fd = ListenSocket, .events = POLLIN };
+	int           sock;
+
+/* */
+	while ( __atomic_load_n(&Running, __ATOMIC_ACQUIRE) ) {
+		if ( poll(&pfd, 1, PA2EW_METRICS_POLL_MSEC) <= 0 )
+			continue;
+		if ( (sock = accept(ListenSocket, NULL, NULL)) < 0 )
+			continue;
+		serve_request( sock );
+		close(sock);
+	}
+
+	return NULL;
+}
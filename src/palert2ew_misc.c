@@ -16,6 +16,7 @@
 #include <string.h>
 #include <stdint.h>
 #include <time.h>
+#include <pthread.h>
 
 /**
  * @name Earthworm environment header include
@@ -34,13 +35,14 @@
  *
  */
 static uint8_t cal_crc8_high( const uint8_t );
+static void    crc8_table_build( void );
 
 /**
  * @name Internal static variables
  *
  */
-static uint8_t CRC8_Table[256] = { 0 };
-static uint8_t CRC8_Ready = 0;
+static uint8_t        CRC8_Table[PA2EW_CRC8_SLICES][256] = { { 0 } };
+static pthread_once_t CRC8_Once = PTHREAD_ONCE_INIT;
 
 /**
  * @brief
@@ -108,6 +110,27 @@ TRACE2_HEADER *pa2ew_trh2_sampinfo_enrich(
 	return dest;
 }
 
+/**
+ * @brief Copy the prebuilt template of the channel, then patch the sampling information & the quality.
+ *
+ * @param dest
+ * @param tmpl
+ * @param sampinfo
+ * @return TRACE2_HEADER*
+ */
+TRACE2_HEADER *pa2ew_trh2_template_apply( TRACE2_HEADER *dest, const TRACE2_HEADER *tmpl, const TRACE2_HEADER *sampinfo )
+{
+/* */
+	*dest = *tmpl;
+	dest->nsamp      = sampinfo->nsamp;
+	dest->samprate   = sampinfo->samprate;
+	dest->starttime  = sampinfo->starttime;
+	dest->endtime    = sampinfo->endtime;
+	dest->quality[0] = sampinfo->quality[0];
+	memcpy(dest->datatype, sampinfo->datatype, sizeof(dest->datatype));
+
+	return dest;
+}
 
 /**
  * @brief
@@ -161,16 +184,12 @@ int pa2ew_endian_get( void )
 }
 
 /**
- * @brief A CRC-8 initialization function
+ * @brief A CRC-8 initialization function, the table is only built once even it's called by several threads.
  *
  */
 void pa2ew_crc8_init( void )
 {
-/* */
-	for ( int i = 0x00; i <= 0xff; i++ )
-		CRC8_Table[i & 0xff] = cal_crc8_high( i & 0xff );
-/* */
-	CRC8_Ready = 1;
+	pthread_once(&CRC8_Once, crc8_table_build);
 
 	return;
 }
@@ -189,19 +208,119 @@ uint8_t pa2ew_crc8_cal( const void *data, const size_t size )
 	uint8_t        result = PA2EW_RECV_SERVER_CRC8_INIT;
 
 /* */
-	if ( !CRC8_Ready )
-		pa2ew_crc8_init();
-/* */
+	pa2ew_crc8_init();
 	if ( ptr ) {
+	/* Slicing-by-8, the 16 bytes header just takes two rounds */
+		end = ptr + (size & ~(size_t)0x07);
+		for ( ; ptr < end; ptr += 8 ) {
+			result =
+				CRC8_Table[7][result ^ ptr[0]] ^ CRC8_Table[6][ptr[1]] ^
+				CRC8_Table[5][ptr[2]] ^ CRC8_Table[4][ptr[3]] ^
+				CRC8_Table[3][ptr[4]] ^ CRC8_Table[2][ptr[5]] ^
+				CRC8_Table[1][ptr[6]] ^ CRC8_Table[0][ptr[7]];
+		}
 	/* */
-		end = ptr + size;
+		end = (const uint8_t *)data + size;
 		while ( ptr < end )
-			result = CRC8_Table[result ^ *ptr++];
+			result = CRC8_Table[0][result ^ *ptr++];
 	}
 
 	return result;
 }
 
+/**
+ * @brief Initialize the token bucket with full tokens.
+ *
+ * @param bucket
+ * @param byte_rate
+ * @param pkt_rate
+ * @param burst_sec
+ * @param time_now
+ */
+void pa2ew_tbucket_init(
+	PA2EW_TBUCKET *bucket, const double byte_rate, const double pkt_rate, const double burst_sec, const double time_now
+) {
+	bucket->byte_rate   = byte_rate;
+	bucket->pkt_rate    = pkt_rate;
+	bucket->burst       = burst_sec;
+	bucket->byte_tokens = byte_rate * burst_sec;
+	bucket->pkt_tokens  = pkt_rate * burst_sec;
+	bucket->last_time   = time_now;
+	bucket->over_since  = 0.0;
+
+	return;
+}
+
+/**
+ * @brief Change the rates of the token bucket, the remained tokens are kept but limited to the new capacity.
+ *
+ * @param bucket
+ * @param byte_rate
+ * @param pkt_rate
+ */
+void pa2ew_tbucket_resize( PA2EW_TBUCKET *bucket, const double byte_rate, const double pkt_rate )
+{
+	bucket->byte_rate = byte_rate;
+	bucket->pkt_rate  = pkt_rate;
+/* */
+	if ( bucket->byte_tokens > byte_rate * bucket->burst )
+		bucket->byte_tokens = byte_rate * bucket->burst;
+	else if ( bucket->byte_tokens < -byte_rate * bucket->burst )
+		bucket->byte_tokens = -byte_rate * bucket->burst;
+	if ( bucket->pkt_tokens > pkt_rate * bucket->burst )
+		bucket->pkt_tokens = pkt_rate * bucket->burst;
+	else if ( bucket->pkt_tokens < -pkt_rate * bucket->burst )
+		bucket->pkt_tokens = -pkt_rate * bucket->burst;
+
+	return;
+}
+
+/**
+ * @brief Refill the token bucket by the elapsed time.
+ *
+ * @param bucket
+ * @param time_now
+ * @return int 1 for there are still tokens in the bucket, 0 for the budget is exhausted.
+ */
+int pa2ew_tbucket_refill( PA2EW_TBUCKET *bucket, const double time_now )
+{
+	double elapsed = time_now - bucket->last_time;
+
+/* */
+	if ( elapsed > 0.0 ) {
+		bucket->byte_tokens += bucket->byte_rate * elapsed;
+		bucket->pkt_tokens  += bucket->pkt_rate * elapsed;
+	/* Don't overflow the bucket */
+		if ( bucket->byte_tokens > bucket->byte_rate * bucket->burst )
+			bucket->byte_tokens = bucket->byte_rate * bucket->burst;
+		if ( bucket->pkt_tokens > bucket->pkt_rate * bucket->burst )
+			bucket->pkt_tokens = bucket->pkt_rate * bucket->burst;
+		bucket->last_time = time_now;
+	}
+
+	return bucket->byte_tokens > 0.0 && bucket->pkt_tokens > 0.0;
+}
+
+/**
+ * @brief Take the tokens from the bucket, the debt is allowed but limited to one bucket.
+ *
+ * @param bucket
+ * @param bytes
+ * @param packets
+ */
+void pa2ew_tbucket_consume( PA2EW_TBUCKET *bucket, const double bytes, const double packets )
+{
+	bucket->byte_tokens -= bytes;
+	bucket->pkt_tokens  -= packets;
+/* */
+	if ( bucket->byte_tokens < -bucket->byte_rate * bucket->burst )
+		bucket->byte_tokens = -bucket->byte_rate * bucket->burst;
+	if ( bucket->pkt_tokens < -bucket->pkt_rate * bucket->burst )
+		bucket->pkt_tokens = -bucket->pkt_rate * bucket->burst;
+
+	return;
+}
+
 /**
  * @brief A real CRC-8 calculation function
  *
@@ -223,3 +342,20 @@ static uint8_t cal_crc8_high( const uint8_t data )
 
 	return result;
 }
+
+/**
+ * @brief
+ *
+ */
+static void crc8_table_build( void )
+{
+/* */
+	for ( int i = 0x00; i <= 0xff; i++ )
+		CRC8_Table[0][i & 0xff] = cal_crc8_high( i & 0xff );
+/* The table of each slice is the CRC of the byte followed by zero bytes */
+	for ( int i = 1; i < PA2EW_CRC8_SLICES; i++ )
+		for ( int j = 0x00; j <= 0xff; j++ )
+			CRC8_Table[i][j] = CRC8_Table[0][CRC8_Table[i - 1][j]];
+
+	return;
+}
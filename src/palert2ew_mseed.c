@@ -0,0 +1,246 @@
+/**
+ * @file palert2ew_mseed.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Pack the output samples of each channel into 512 bytes Steim2 mini-SEED records by libmseed.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @name Earthworm environment header include
+ *
+ */
+#include <earthworm.h>
+#include <trace_buf.h>
+#include <libmseed.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <palert2ew.h>
+#include <palert2ew_misc.h>
+#include <palert2ew_log.h>
+#include <palert2ew_mseed.h>
+
+/**
+ * @brief Record state of each channel
+ *
+ */
+typedef struct {
+	MSTrace  *mst;         /* Samples which are not packed into a full record yet */
+	MSRecord *msr;         /* Template of the records, keeps the sequence number & the Steim state going */
+	int8_t    encoding;
+	double    flush_time;  /* The time that the partial record should be packed no matter what */
+} MSEED_STATE;
+
+/**
+ * @name Internal functions' prototype
+ *
+ */
+static MSEED_STATE *create_mseed_state( void );
+static void         pack_mseed_state( MSEED_STATE *, const int );
+
+/**
+ * @name Internal static variables
+ *
+ */
+static void  (*RecordHandler)( char *, int, void * ) = NULL;
+static void   *HandlerArg = NULL;
+static double  Latency    = PA2EW_MSEED_DEF_LATENCY;
+
+/**
+ * @brief
+ *
+ * @param record_handler It will be called with each packed record, and it should put the record into the ring.
+ * @param handler_arg
+ * @param latency
+ */
+void pa2ew_mseed_init( void (*record_handler)( char *, int, void * ), void *handler_arg, const double latency )
+{
+	RecordHandler = record_handler;
+	HandlerArg    = handler_arg;
+	Latency       = latency > 0.0 ? latency : PA2EW_MSEED_DEF_LATENCY;
+
+	return;
+}
+
+/**
+ * @brief Append the samples behind the header to the record state of the channel, and put those full
+ *        records into the ring. The state will be packed first once the samples are not contiguous.
+ *
+ * @param chaptr
+ * @param trh2 The header & the samples behind it.
+ */
+void pa2ew_mseed_append( _CHAINFO *chaptr, const TRACE2_HEADER *trh2 )
+{
+	MSEED_STATE   *state = (MSEED_STATE *)chaptr->mseed;
+	MSTrace       *mst;
+	const hptime_t start = (hptime_t)(trh2->starttime * HPTMODULUS + 0.5);
+	const hptime_t end   = (hptime_t)(trh2->endtime * HPTMODULUS + 0.5);
+	const int8_t   encoding = trh2->datatype[0] == 'f' || trh2->datatype[0] == 't' ? DE_FLOAT32 : DE_STEIM2;
+	hptime_t       gap;
+	int32_t        widened[PA2EW_OUTMSG_MAX_SAMPLES];
+	void          *samples = (void *)(trh2 + 1);
+
+/* */
+	if ( !RecordHandler || trh2->nsamp <= 0 || trh2->samprate <= 0.0 || trh2->nsamp > PA2EW_OUTMSG_MAX_SAMPLES )
+		return;
+	if ( !state && !(state = chaptr->mseed = create_mseed_state()) ) {
+		pa2ew_log("e", trh2->sta, "palert2ew: Error creating the mini-SEED state of %s.%s!\n", trh2->sta, trh2->chan);
+		return;
+	}
+	mst = state->mst;
+/* The Steim compression only takes 4 bytes integer */
+	if ( trh2->datatype[1] == '2' ) {
+		for ( int i = 0; i < trh2->nsamp; i++ )
+			widened[i] = ((int16_t *)samples)[i];
+		samples = widened;
+	}
+/* Pack the remains first, if the samples can't be appended behind them */
+	if ( mst->numsamples > 0 ) {
+		gap = start - mst->endtime - (hptime_t)(HPTMODULUS / trh2->samprate + 0.5);
+		if (
+			gap > (hptime_t)(HPTMODULUS * 0.5 / trh2->samprate) || gap < -(hptime_t)(HPTMODULUS * 0.5 / trh2->samprate) ||
+			mst->samprate != trh2->samprate || state->encoding != encoding
+		) {
+			pack_mseed_state( state, 1 );
+		}
+	}
+/* */
+	if ( mst->numsamples <= 0 ) {
+		strncpy(mst->network, trh2->net, sizeof(mst->network) - 1);
+		strncpy(mst->station, trh2->sta, sizeof(mst->station) - 1);
+		strncpy(mst->channel, trh2->chan, sizeof(mst->channel) - 1);
+	/* The blank location code of Earthworm */
+		if ( strcmp(trh2->loc, LOC_NULL_STRING) )
+			strncpy(mst->location, trh2->loc, sizeof(mst->location) - 1);
+		else
+			mst->location[0] = '\0';
+	/* */
+		mst->samprate   = trh2->samprate;
+		mst->starttime  = start;
+		mst->sampletype = encoding == DE_FLOAT32 ? 'f' : 'i';
+		state->encoding   = encoding;
+		state->flush_time = pa2ew_timenow_get() + Latency;
+	}
+	if ( mst_addspan(mst, start, end, samples, trh2->nsamp, mst->sampletype, 1) ) {
+		pa2ew_log(
+			"e", trh2->sta, "palert2ew: Error appending the samples of %s.%s to the mini-SEED state!\n", trh2->sta, trh2->chan
+		);
+		return;
+	}
+/* Only the full records */
+	pack_mseed_state( state, 0 );
+
+	return;
+}
+
+/**
+ * @brief Pack the partial record of the channel if it has been held until the deadline.
+ *
+ * @param chaptr
+ * @param deadline
+ */
+void pa2ew_mseed_flush( _CHAINFO *chaptr, const double deadline )
+{
+	MSEED_STATE *state = (MSEED_STATE *)chaptr->mseed;
+
+/* */
+	if ( state && state->mst->numsamples > 0 && state->flush_time <= deadline )
+		pack_mseed_state( state, 1 );
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param mseed
+ */
+void pa2ew_mseed_state_free( void *mseed )
+{
+	MSEED_STATE *state = (MSEED_STATE *)mseed;
+
+/* */
+	if ( state ) {
+		if ( state->mst )
+			mst_free(&state->mst);
+	/* The samples belong to the trace */
+		if ( state->msr ) {
+			state->msr->datasamples = NULL;
+			msr_free(&state->msr);
+		}
+		free(state);
+	}
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @return MSEED_STATE*
+ */
+static MSEED_STATE *create_mseed_state( void )
+{
+	MSEED_STATE *result = (MSEED_STATE *)calloc(1, sizeof(MSEED_STATE));
+
+/* */
+	if ( result ) {
+		result->mst = mst_init(NULL);
+		result->msr = msr_init(NULL);
+		if ( !result->mst || !result->msr ) {
+			pa2ew_mseed_state_free( result );
+			return NULL;
+		}
+		result->mst->dataquality     = 'D';
+		result->msr->dataquality     = 'D';
+		result->msr->sequence_number = 1;
+	}
+
+	return result;
+}
+
+/**
+ * @brief Pack the samples of the state into records, the remains are kept inside the state unless flushing.
+ *
+ * @param state
+ * @param flush
+ */
+static void pack_mseed_state( MSEED_STATE *state, const int flush )
+{
+	int64_t packed = 0;
+
+/* Big-endian as the SEED standard */
+	if (
+		mst_pack(
+			state->mst, RecordHandler, HandlerArg, PA2EW_MSEED_RECORD_LENGTH,
+			state->encoding, 1, &packed, flush, 0, state->msr
+		) < 0
+	) {
+		pa2ew_log(
+			"e", state->mst->station, "palert2ew: Error packing the mini-SEED records of %s.%s!\n",
+			state->mst->station, state->mst->channel
+		);
+		state->mst->numsamples = 0;
+	}
+/* */
+	if ( flush )
+		state->mst->numsamples = 0;
+/* The next partial record */
+	if ( state->mst->numsamples > 0 && packed > 0 )
+		state->flush_time = pa2ew_timenow_get() + Latency;
+
+	return;
+}
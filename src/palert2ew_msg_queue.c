@@ -12,8 +12,11 @@
  * @name Standard C header include
  *
  */
+#include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
+#include <sched.h>
 
 /**
  * @name Earthworm environment header include
@@ -29,6 +32,9 @@
 #include <libpalertc/libpalertc.h>
 #include <palert2ew.h>
 #include <palert2ew_list.h>
+#include <palert2ew_msg_queue.h>
+#include <palert2ew_log.h>
+#include <palert2ew_latency.h>
 
 /**
  * @brief Internal stack related struct
@@ -46,6 +52,14 @@ struct last_buffer {
 static mutex_t QueueMutex;
 static QUEUE   MsgQueue;         /* from queue.h, queue.c; sets up linked */
 static size_t  LRBufferOffset = 0;
+/* */
+static volatile uint32_t    QueueDepth    = 0;
+static uint32_t             QueueCapacity = 0;
+static uint32_t             ActiveStations = 0;
+static int                  QueuePolicy   = PA2EW_QUEUE_DROP_OLDEST;
+static unsigned int         QueueMaxWait  = 0;     /* In microseconds */
+static uint8_t             *DropBuffer    = NULL;  /* Landing space for the dropped oldest message */
+static PA2EW_MSGQUEUE_STATS QueueStats    = { 0 };
 
 /**
  * @name Internal functions' prototype
@@ -58,6 +72,11 @@ static void                 free_last_buffer_act( void *, const int, void * );
 static int pre_enqueue_check_pah1( LABELED_RECV_BUFFER *, size_t *, MSG_LOGO );
 static int pre_enqueue_check_pah4( LABELED_RECV_BUFFER *, size_t *, MSG_LOGO );
 static int pre_enqueue_check_pah16( LABELED_RECV_BUFFER *, size_t *, MSG_LOGO );
+static int  overload_shed( const _STAINFO * );
+static void drop_oldest_message( void );
+static int  wait_for_room( void );
+static void station_queued_inc( _STAINFO * );
+static void station_queued_dec( _STAINFO * );
 static int validate_pah1( const void *, const int );
 static int validate_pah4( const void *, const int );
 static int validate_pah16( const void *, const int );
@@ -67,10 +86,13 @@ static int validate_pah16( const void *, const int );
  *
  * @param queue_size
  * @param element_size
+ * @param policy
+ * @param max_wait_usec
  * @return int
  */
-int pa2ew_msgqueue_init( const unsigned long queue_size, const unsigned long element_size )
-{
+int pa2ew_msgqueue_init(
+	const unsigned long queue_size, const unsigned long element_size, const int policy, const unsigned int max_wait_usec
+) {
 	LABELED_RECV_BUFFER _lrbuf;
 
 /* Create a Mutex to control access to queue */
@@ -79,6 +101,15 @@ int pa2ew_msgqueue_init( const unsigned long queue_size, const unsigned long ele
 	initqueue( &MsgQueue, queue_size, element_size + 1 );
 /* Initialize the labeled buffer real offset */
 	LRBufferOffset = _lrbuf.recv_buffer - (uint8_t *)&_lrbuf;
+/* Setup the overload policy */
+	QueueDepth    = 0;
+	QueueCapacity = queue_size;
+	QueuePolicy   = policy;
+	QueueMaxWait  = max_wait_usec;
+	if ( (DropBuffer = calloc(1, element_size + 1)) == NULL ) {
+		logit("e", "palert2ew: Error allocating the dropping buffer of main queue!\n");
+		return -1;
+	}
 
 	return 0;
 }
@@ -91,6 +122,8 @@ void pa2ew_msgqueue_end( void )
 {
 	RequestSpecificMutex(&QueueMutex);
 	freequeue(&MsgQueue);
+	free(DropBuffer);
+	DropBuffer = NULL;
 	ReleaseSpecificMutex(&QueueMutex);
 	CloseSpecificMutex(&QueueMutex);
 
@@ -111,7 +144,11 @@ int pa2ew_msgqueue_dequeue( void *buffer, size_t *size, MSG_LOGO *logo )
 	long int _size;
 
 	RequestSpecificMutex(&QueueMutex);
-	result = dequeue(&MsgQueue, (char *)buffer, &_size, logo);
+	if ( (result = dequeue(&MsgQueue, (char *)buffer, &_size, logo)) == 0 ) {
+		QueueDepth--;
+		QueueStats.dequeued++;
+		station_queued_dec( (_STAINFO *)((LABELED_RECV_BUFFER *)buffer)->label.staptr );
+	}
 	ReleaseSpecificMutex(&QueueMutex);
 	*size = _size;
 
@@ -128,21 +165,45 @@ int pa2ew_msgqueue_dequeue( void *buffer, size_t *size, MSG_LOGO *logo )
  */
 int pa2ew_msgqueue_enqueue( void *buffer, size_t size, MSG_LOGO logo )
 {
-	int result = 0;
+	int       result = 0;
+	_STAINFO *staptr = (_STAINFO *)((LABELED_RECV_BUFFER *)buffer)->label.staptr;
 
+/* */
+	((LABELED_RECV_BUFFER *)buffer)->label.enq_time = pa2ew_latency_timenow_get();
+/* Give the main thread a chance to make room, but never sleep on the receiving thread */
+	if ( QueueMaxWait && QueueDepth >= QueueCapacity )
+		result = wait_for_room();
 /* put it into the main queue */
 	RequestSpecificMutex(&QueueMutex);
-	result = enqueue(&MsgQueue, (char *)buffer, size, logo);
+	if ( result ) {
+		QueueStats.wait_count++;
+		QueueStats.wait_timeout += result < 0 ? 1 : 0;
+	}
+/* Decide whether the new message should be shed by the overload policy */
+	if ( (result = overload_shed( staptr )) == 0 ) {
+	/*
+	 * Make room by dropping the oldest message, fresh data matters more than stale one. The queue itself is also
+	 * checked, 'cause its own overwriting (-3) would lose the evicted message without decreasing its station's count
+	 */
+		if ( QueueDepth >= QueueCapacity || getNumOfElementsInQueue( &MsgQueue ) >= (int)QueueCapacity )
+			drop_oldest_message();
+	/* */
+		if ( (result = enqueue(&MsgQueue, (char *)buffer, size, logo)) == 0 || result == -3 ) {
+			if ( !result )
+				QueueDepth++;
+			else
+				QueueStats.drop_oldest++;
+			QueueStats.enqueued++;
+			QueueStats.high_water = QueueDepth > QueueStats.high_water ? QueueDepth : QueueStats.high_water;
+			station_queued_inc( staptr );
+		}
+	}
 	ReleaseSpecificMutex(&QueueMutex);
 
-	if ( result != 0 ) {
-		if ( result == -1 )
-			logit("et", "palert2ew: Main queue cannot allocate memory, lost message!\n");
-		else if ( result == -2 )
-			logit("et", "palert2ew: Unknown error happened to main queue!\n");
-		else if ( result == -3 )
-			logit("et", "palert2ew: Main queue has lapped, please check it!\n");
-	}
+	if ( result == -1 )
+		pa2ew_log("et", NULL, "palert2ew: Main queue cannot allocate memory, lost message!\n");
+	else if ( result == -2 )
+		pa2ew_log("et", NULL, "palert2ew: Unknown error happened to main queue!\n");
 
 	return result;
 }
@@ -153,25 +214,25 @@ int pa2ew_msgqueue_enqueue( void *buffer, size_t size, MSG_LOGO logo )
  * @param label_buf
  * @param buf_len
  * @param logo
- * @return int
+ * @return int The number of the complete packets put into the queue, or -1 for sync. error.
  */
 int pa2ew_msgqueue_rawpacket( void *label_buf, size_t buf_len, MSG_LOGO logo )
 {
 	LABELED_RECV_BUFFER *lrbuf;
-	int                  sync_flag = 1;
+	int                  result = 0;
 
 /* */
 	lrbuf = draw_last_buffer( label_buf, &buf_len );
 /* Here, we don't care about the mode 2 header packet */
 	switch ( lrbuf->label.packmode ) {
 	case PALERT_PKT_MODE1: case PALERT_PKT_MODE2:
-		sync_flag = pre_enqueue_check_pah1( lrbuf, &buf_len, logo );
+		result = pre_enqueue_check_pah1( lrbuf, &buf_len, logo );
 		break;
 	case PALERT_PKT_MODE4:
-		sync_flag = pre_enqueue_check_pah4( lrbuf, &buf_len, logo );
+		result = pre_enqueue_check_pah4( lrbuf, &buf_len, logo );
 		break;
 	case PALERT_PKT_MODE16:
-		sync_flag = pre_enqueue_check_pah16( lrbuf, &buf_len, logo );
+		result = pre_enqueue_check_pah16( lrbuf, &buf_len, logo );
 		break;
 	default:
 		buf_len = 0;
@@ -183,8 +244,8 @@ int pa2ew_msgqueue_rawpacket( void *label_buf, size_t buf_len, MSG_LOGO logo )
 /* */
 	if ( lrbuf != (LABELED_RECV_BUFFER *)label_buf )
 		free(lrbuf);
-/* If it did sync. return no error with 0, otherwise return error with -1. */
-	return sync_flag ? 0 : -1;
+/* If it did sync. return the number of packets, otherwise return error with -1. */
+	return result;
 }
 
 /**
@@ -203,6 +264,137 @@ void pa2ew_msgqueue_lastbufs_reset( void *staptr )
 	return;
 }
 
+/**
+ * @brief Copy out the counters of main queue.
+ *
+ * @param dest
+ */
+void pa2ew_msgqueue_stats_get( PA2EW_MSGQUEUE_STATS *dest )
+{
+	RequestSpecificMutex(&QueueMutex);
+	*dest       = QueueStats;
+	dest->depth = QueueDepth;
+	ReleaseSpecificMutex(&QueueMutex);
+
+	return;
+}
+
+/**
+ * @brief Check if the new message from the station should be shed, it should be called within the mutex. The
+ *        message without the station label is treated as the lowest priority.
+ *
+ * @param staptr
+ * @return int
+ */
+static int overload_shed( const _STAINFO *staptr )
+{
+	const uint8_t priority = staptr ? __atomic_load_n(&staptr->priority, __ATOMIC_RELAXED) : 0;
+	uint32_t      threshold;
+
+/* */
+	switch ( QueuePolicy ) {
+	case PA2EW_QUEUE_DROP_PRIORITY:
+	/* The lower priority, the earlier shedding. And the highest priority would never be shed */
+		if ( priority < PA2EW_MAX_STA_PRIORITY ) {
+			threshold = (QueueCapacity >> 1) + (QueueCapacity >> 1) * priority / PA2EW_MAX_STA_PRIORITY;
+			if ( QueueDepth >= threshold ) {
+				QueueStats.drop_priority++;
+				return PA2EW_QUEUE_SHED;
+			}
+		}
+		break;
+	case PA2EW_QUEUE_FAIR_SHARE:
+	/* Only when the queue is crowded, limit each station to its own share */
+		if ( QueueDepth >= (QueueCapacity >> 1) ) {
+			threshold = QueueCapacity / (ActiveStations ? ActiveStations : 1);
+		/* The unlabeled one has no share to count on, so as the lowest priority, it's shed first */
+			if ( !staptr || staptr->queued >= (threshold > 1 ? threshold : 1) ) {
+				QueueStats.drop_fairshare++;
+				return PA2EW_QUEUE_SHED;
+			}
+		}
+		break;
+	case PA2EW_QUEUE_DROP_OLDEST: default:
+		break;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Drop the oldest message within the main queue, it should be called within the mutex.
+ *
+ */
+static void drop_oldest_message( void )
+{
+	long int _size;
+	MSG_LOGO _logo;
+
+/* */
+	if ( dequeue(&MsgQueue, (char *)DropBuffer, &_size, &_logo) == 0 ) {
+		QueueDepth--;
+		QueueStats.drop_oldest++;
+		station_queued_dec( (_STAINFO *)((LABELED_RECV_BUFFER *)DropBuffer)->label.staptr );
+	}
+
+	return;
+}
+
+/**
+ * @brief Busy waiting (with yielding) for the room of main queue, bounded by the maximum waiting time.
+ *
+ * @return int 1 for the room is available, -1 for timeout.
+ */
+static int wait_for_room( void )
+{
+	struct timespec now;
+	struct timespec deadline;
+
+/* */
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec  += QueueMaxWait / 1000000;
+	deadline.tv_nsec += (QueueMaxWait % 1000000) * 1000;
+	if ( deadline.tv_nsec >= 1000000000 ) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+/* */
+	while ( QueueDepth >= QueueCapacity ) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if ( now.tv_sec > deadline.tv_sec || (now.tv_sec == deadline.tv_sec && now.tv_nsec >= deadline.tv_nsec) )
+			return -1;
+		sched_yield();
+	}
+
+	return 1;
+}
+
+/**
+ * @brief
+ *
+ * @param staptr
+ */
+static void station_queued_inc( _STAINFO *staptr )
+{
+	if ( staptr && !staptr->queued++ )
+		ActiveStations++;
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param staptr
+ */
+static void station_queued_dec( _STAINFO *staptr )
+{
+	if ( staptr && staptr->queued && !--staptr->queued )
+		ActiveStations--;
+
+	return;
+}
+
 /**
  * @brief
  *
@@ -339,6 +531,7 @@ static int pre_enqueue_check_pah1( LABELED_RECV_BUFFER *lrbuf, size_t *buf_len,
 /* */
 	int               ret = 0;
 	int               sync_flag = 0;
+	int               npackets = 0;
 	size_t            comfirm_offset = 0;
 /* */
 	uint8_t           pam2_buf[PALERT_M2_PACKET_LENGTH + LRBufferOffset];
@@ -366,12 +559,12 @@ static int pre_enqueue_check_pah1( LABELED_RECV_BUFFER *lrbuf, size_t *buf_len,
 		/* Since it is the 200 bytes triggered packet(mode 2), do following process */
 			else {
 			/* */
-				((LABELED_RECV_BUFFER *)pam2_buf)->label.staptr   = lrbuf->label.staptr;
+				((LABELED_RECV_BUFFER *)pam2_buf)->label          = lrbuf->label;
 				((LABELED_RECV_BUFFER *)pam2_buf)->label.packmode = PALERT_PKT_MODE2;
 				memcpy(((LABELED_RECV_BUFFER *)pam2_buf)->recv_buffer, pah, PALERT_M2_PACKET_LENGTH);
 			/* */
-				if ( pa2ew_msgqueue_enqueue( pam2_buf, PALERT_M2_PACKET_LENGTH + LRBufferOffset, logo ) )
-					sleep_ew(50);
+				pa2ew_msgqueue_enqueue( pam2_buf, PALERT_M2_PACKET_LENGTH + LRBufferOffset, logo );
+				npackets++;
 			/* */
 				memmove(pah, pah + 1, *buf_len - PALERT_M2_PACKET_LENGTH);
 				pah--;
@@ -385,8 +578,8 @@ static int pre_enqueue_check_pah1( LABELED_RECV_BUFFER *lrbuf, size_t *buf_len,
 		/* Reach the required mode 1 packet length */
 			if ( comfirm_offset == PALERT_M1_PACKET_LENGTH ) {
 				lrbuf->label.packmode = PALERT_PKT_MODE1;
-				if ( pa2ew_msgqueue_enqueue( lrbuf, PALERT_M1_PACKET_LENGTH + LRBufferOffset, logo ) )
-					sleep_ew(50);
+				pa2ew_msgqueue_enqueue( lrbuf, PALERT_M1_PACKET_LENGTH + LRBufferOffset, logo );
+				npackets++;
 			/* */
 				comfirm_offset = 0;
 			}
@@ -399,7 +592,7 @@ static int pre_enqueue_check_pah1( LABELED_RECV_BUFFER *lrbuf, size_t *buf_len,
 	else if ( *buf_len )
 		memmove(lrbuf->recv_buffer, pah, *buf_len);
 
-	return sync_flag;
+	return sync_flag ? npackets : -1;
 }
 
 /**
@@ -417,6 +610,7 @@ static int pre_enqueue_check_pah4( LABELED_RECV_BUFFER *lrbuf, size_t *buf_len,
 /* */
 	int ret       = 0;
 	int sync_flag = 0;
+	int npackets  = 0;
 
 /* */
 	do {
@@ -430,8 +624,8 @@ static int pre_enqueue_check_pah4( LABELED_RECV_BUFFER *lrbuf, size_t *buf_len,
 			}
 		/* */
 			if ( *buf_len >= (size_t)ret ) {
-				if ( pa2ew_msgqueue_enqueue( lrbuf, ret + LRBufferOffset, logo ) )
-					sleep_ew(50);
+				pa2ew_msgqueue_enqueue( lrbuf, ret + LRBufferOffset, logo );
+				npackets++;
 			/* */
 				*buf_len -= ret;
 				pah4 = (PALERT_M4_HEADER *)(lrbuf->recv_buffer + ret);
@@ -449,7 +643,7 @@ static int pre_enqueue_check_pah4( LABELED_RECV_BUFFER *lrbuf, size_t *buf_len,
 	if ( *buf_len && (uint8_t *)pah4 != lrbuf->recv_buffer )
 		memmove(lrbuf->recv_buffer, pah4, *buf_len);
 
-	return sync_flag;
+	return sync_flag ? npackets : -1;
 }
 
 /**
@@ -467,6 +661,7 @@ static int pre_enqueue_check_pah16( LABELED_RECV_BUFFER *lrbuf, size_t *buf_len,
 /* */
 	int ret       = 0;
 	int sync_flag = 0;
+	int npackets  = 0;
 
 /* */
 	do {
@@ -480,8 +675,8 @@ static int pre_enqueue_check_pah16( LABELED_RECV_BUFFER *lrbuf, size_t *buf_len,
 			}
 		/* */
 			if ( *buf_len >= (size_t)ret ) {
-				if ( pa2ew_msgqueue_enqueue( lrbuf, ret + LRBufferOffset, logo ) )
-					sleep_ew(50);
+				pa2ew_msgqueue_enqueue( lrbuf, ret + LRBufferOffset, logo );
+				npackets++;
 			/* */
 				*buf_len -= ret;
 				pah16 = (PALERT_M16_HEADER *)(lrbuf->recv_buffer + ret);
@@ -499,7 +694,7 @@ static int pre_enqueue_check_pah16( LABELED_RECV_BUFFER *lrbuf, size_t *buf_len,
 	if ( *buf_len && (uint8_t *)pah16 != lrbuf->recv_buffer )
 		memmove(lrbuf->recv_buffer, pah16, *buf_len);
 
-	return sync_flag;
+	return sync_flag ? npackets : -1;
 }
 
 /**
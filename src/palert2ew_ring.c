@@ -0,0 +1,311 @@
+/**
+ * @file palert2ew_ring.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Write batches of messages into the Earthworm shared memory ring under one lock. The layout of the
+ *        messages (TPORT_HEAD + message) & the keys are exactly the same as those written by tport_putmsg.
+ *        Within this process, all the messages of one ring should be written by the writers or all by
+ *        tport_putmsg, since the sequence numbers are tracked separately from the ones inside transport.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/sem.h>
+
+/**
+ * @name Earthworm environment header include
+ *
+ */
+#include <transport.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <palert2ew_ring.h>
+
+/**
+ * @name Internal functions' prototype
+ *
+ */
+static uint8_t next_seq_get( const long, const MSG_LOGO * );
+static int     ring_write( SHM_INFO *, const void *, const size_t, const void *, const size_t );
+static void    ring_copy_to( const SHM_HEAD *, const long, const void *, const size_t );
+static void    ring_copy_from( const SHM_HEAD *, const long, void *, const size_t );
+
+/**
+ * @brief The sequence number of each logo in each ring, shared by all the writers just like the one inside
+ *        tport_putmsg, so the writers of the same ring won't make any false gap
+ *
+ */
+typedef struct {
+	long     key;
+	MSG_LOGO logo;
+	uint8_t  seq;
+} SEQ_TRACK;
+
+/**
+ * @name Internal static variables
+ *
+ */
+static SEQ_TRACK       SeqTracks[PA2EW_RING_MAX_TRACKS];
+static int             NumSeqTracks = 0;
+static pthread_mutex_t SeqMutex     = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief
+ *
+ * @param writer
+ * @param region The ring should be already attached.
+ * @param capacity Size of the staging area, it will be limited to a quarter of the ring.
+ * @return int
+ * @retval 0 Success.
+ * @retval PA2EW_RING_UNSUPPORTED The keys of ring might wrap on this platform, just use tport_putmsg.
+ * @retval -1 Allocating the staging area failed.
+ */
+int pa2ew_ring_writer_init( PA2EW_RING_WRITER *writer, SHM_INFO *region, const size_t capacity )
+{
+	memset(writer, 0, sizeof(PA2EW_RING_WRITER));
+/* The keys will never wrap around with 64-bit long, otherwise leave the wrapping to transport */
+	if ( sizeof(long) < sizeof(int64_t) || !region || !region->addr )
+		return PA2EW_RING_UNSUPPORTED;
+/* */
+	writer->region   = region;
+	writer->capacity = capacity < (size_t)(region->addr->keymax >> 2) ? capacity : (size_t)(region->addr->keymax >> 2);
+	if ( writer->capacity < sizeof(TPORT_HEAD) || !(writer->buffer = malloc(writer->capacity)) ) {
+		writer->capacity = 0;
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief
+ *
+ * @param writer
+ */
+void pa2ew_ring_writer_free( PA2EW_RING_WRITER *writer )
+{
+	free(writer->buffer);
+	memset(writer, 0, sizeof(PA2EW_RING_WRITER));
+
+	return;
+}
+
+/**
+ * @brief Stage the message into the batch, the batch will be committed first when there is no room for it.
+ *        The message is copied, so it can be reused right after this call.
+ *
+ * @param writer
+ * @param logo
+ * @param size
+ * @param msg
+ * @return int PUT_OK, PUT_TOOBIG or the result of committing.
+ */
+int pa2ew_ring_writer_add( PA2EW_RING_WRITER *writer, const MSG_LOGO *logo, const long size, const void *msg )
+{
+	const size_t total  = sizeof(TPORT_HEAD) + size;
+	int          result = PUT_OK;
+	TPORT_HEAD   head;
+
+/* */
+	if ( size < 0 || size > writer->region->addr->keymax - (long)sizeof(TPORT_HEAD) )
+		return PUT_TOOBIG;
+/* */
+	memset(&head, 0, sizeof(TPORT_HEAD));
+	head.start = FIRST_BYTE;
+	head.logo  = *logo;
+	head.size  = size;
+	head.seq   = next_seq_get( writer->region->key, logo );
+/* */
+	if ( writer->used + total > writer->capacity && (result = pa2ew_ring_writer_commit( writer )) < PUT_OK )
+		return result;
+/* Too large to be staged, write it directly */
+	if ( total > writer->capacity ) {
+		result = ring_write( writer->region, &head, sizeof(TPORT_HEAD), msg, size );
+		writer->commits++;
+		writer->committed++;
+		return result;
+	}
+/* */
+	memcpy(writer->buffer + writer->used, &head, sizeof(TPORT_HEAD));
+	memcpy(writer->buffer + writer->used + sizeof(TPORT_HEAD), msg, size);
+	writer->used += total;
+	writer->nmsg++;
+
+	return result;
+}
+
+/**
+ * @brief Copy the whole batch into the ring under one lock.
+ *
+ * @param writer
+ * @return int PUT_OK, PA2EW_RING_LOCK_ERROR, PA2EW_RING_CORRUPTED or PA2EW_RING_KEY_EXHAUSTED.
+ */
+int pa2ew_ring_writer_commit( PA2EW_RING_WRITER *writer )
+{
+	int result = PUT_OK;
+
+/* */
+	if ( writer->nmsg ) {
+		result = ring_write( writer->region, writer->buffer, writer->used, NULL, 0 );
+		writer->commits++;
+		writer->committed += writer->nmsg;
+		writer->used = 0;
+		writer->nmsg = 0;
+	}
+
+	return result;
+}
+
+/**
+ * @brief Get the next sequence number of the logo in the ring.
+ *
+ * @param key
+ * @param logo
+ * @return uint8_t
+ */
+static uint8_t next_seq_get( const long key, const MSG_LOGO *logo )
+{
+	SEQ_TRACK *track  = NULL;
+	uint8_t    result = 0;
+
+/* */
+	pthread_mutex_lock(&SeqMutex);
+	for ( int i = 0; i < NumSeqTracks; i++ ) {
+		if (
+			SeqTracks[i].key == key && SeqTracks[i].logo.type == logo->type &&
+			SeqTracks[i].logo.mod == logo->mod && SeqTracks[i].logo.instid == logo->instid
+		) {
+			track = &SeqTracks[i];
+			break;
+		}
+	}
+/* The new logo */
+	if ( !track && NumSeqTracks < PA2EW_RING_MAX_TRACKS ) {
+		track       = &SeqTracks[NumSeqTracks++];
+		track->key  = key;
+		track->logo = *logo;
+		track->seq  = 0;
+	}
+	if ( track )
+		result = track->seq++;
+	pthread_mutex_unlock(&SeqMutex);
+
+	return result;
+}
+
+/**
+ * @brief Write the contiguous messages (in two segments) into the ring, just like the way of tport_putmsg:
+ *        drop the oldest messages until there is room, copy them in, then move the key of insertion.
+ *
+ * @param region
+ * @param seg1
+ * @param len1
+ * @param seg2
+ * @param len2
+ * @return int
+ */
+static int ring_write( SHM_INFO *region, const void *seg1, const size_t len1, const void *seg2, const size_t len2 )
+{
+	SHM_HEAD     *shm    = region->addr;
+	const long    total  = (long)(len1 + len2);
+	struct sembuf sops   = { 0, -1, SEM_UNDO };
+	int           result = PUT_OK;
+	long          keyold;
+	TPORT_HEAD    old;
+
+/* */
+	if ( semop(region->sid, &sops, 1) == -1 )
+		return PA2EW_RING_LOCK_ERROR;
+/*
+ * The keys are always read under the lock, so those moved by the other writers are followed. And they won't
+ * overflow with 64-bit long in practice, but never let it happen silently.
+ */
+	if ( shm->keyin > LONG_MAX - total ) {
+		result = PA2EW_RING_KEY_EXHAUSTED;
+		goto unlock;
+	}
+/* Find out the oldest key to keep, but only move it after checking all the dropped messages */
+	keyold = shm->keyold;
+	while ( shm->keyin + total - keyold > shm->keymax ) {
+		ring_copy_from( shm, keyold, &old, sizeof(TPORT_HEAD) );
+	/* The ring is corrupted, leave it as it is, just like tport_putmsg (which exits) */
+		if ( (unsigned char)old.start != FIRST_BYTE ) {
+			result = PA2EW_RING_CORRUPTED;
+			goto unlock;
+		}
+		keyold += sizeof(TPORT_HEAD) + old.size;
+	}
+	shm->keyold = keyold;
+/* */
+	ring_copy_to( shm, shm->keyin, seg1, len1 );
+	if ( len2 )
+		ring_copy_to( shm, shm->keyin + len1, seg2, len2 );
+/* The readers can only see the messages after the key moved */
+	__atomic_store_n(&shm->keyin, shm->keyin + total, __ATOMIC_RELEASE);
+/* */
+unlock:
+	sops.sem_op = 1;
+	if ( semop(region->sid, &sops, 1) == -1 && result == PUT_OK )
+		result = PA2EW_RING_LOCK_ERROR;
+
+	return result;
+}
+
+/**
+ * @brief
+ *
+ * @param shm
+ * @param key
+ * @param src
+ * @param len
+ */
+static void ring_copy_to( const SHM_HEAD *shm, const long key, const void *src, const size_t len )
+{
+	uint8_t     *ring  = (uint8_t *)(shm + 1);
+	const size_t pos   = key % shm->keymax;
+	const size_t first = len < (size_t)shm->keymax - pos ? len : (size_t)shm->keymax - pos;
+
+/* */
+	memcpy(ring + pos, src, first);
+	if ( first < len )
+		memcpy(ring, (const uint8_t *)src + first, len - first);
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param shm
+ * @param key
+ * @param dest
+ * @param len
+ */
+static void ring_copy_from( const SHM_HEAD *shm, const long key, void *dest, const size_t len )
+{
+	const uint8_t *ring  = (const uint8_t *)(shm + 1);
+	const size_t   pos   = key % shm->keymax;
+	const size_t   first = len < (size_t)shm->keymax - pos ? len : (size_t)shm->keymax - pos;
+
+/* */
+	memcpy(dest, ring + pos, first);
+	if ( first < len )
+		memcpy((uint8_t *)dest + first, ring, len - first);
+
+	return;
+}
@@ -45,6 +45,10 @@
 #include <palert2ew_list.h>
 #include <palert2ew_server.h>
 #include <palert2ew_msg_queue.h>
+#include <palert2ew_log.h>
+#include <palert2ew_latency.h>
+#include <palert2ew_metrics.h>
+#include <palert2ew_capture.h>
 
 /**
  * @name Internal functions' prototype
@@ -52,8 +56,11 @@
  */
 static int construct_listen_sock( const char * );
 static int accept_palert_raw( void );
-static int find_which_station( void *, CONNDESCRIP *, int );
+static int find_which_station( void *, CONNDESCRIP *, int, const double );
 static int find_palert_tzoffset( const PALERT_M1_HEADER * );
+static void init_intake_budget( CONNDESCRIP *, const void *, const double );
+static void size_intake_budget( CONNDESCRIP *, const double, const int );
+static int  police_intake( CONNDESCRIP *, const int, const double );
 
 /**
  * @name Internal static variables
@@ -65,19 +72,25 @@ static volatile int       ThreadsNumber = 0;
 static volatile int       MaxStationNum = 0;
 static PALERT_THREAD_SET *ThreadSets    = NULL;
 static CONNDESCRIP       *PalertConns   = NULL;
+static double             FloodFactor   = 0.0;
+static int                FloodAction   = PA2EW_FLOOD_THROTTLE;
 
 /**
  * @brief Initialize the independent Palert server & return the needed threads number.
  *
  * @param max_stations
  * @param port
+ * @param flood_factor
+ * @param flood_action
  * @return int
  */
-int pa2ew_server_init( const int max_stations, const char *port )
+int pa2ew_server_init( const int max_stations, const char *port, const double flood_factor, const int flood_action )
 {
 /* Setup constants */
 	AcceptEpoll   = epoll_create(2);
 	MaxStationNum = max_stations;
+	FloodFactor   = flood_factor;
+	FloodAction   = flood_action;
 	ThreadsNumber = pa2ew_recv_thrdnum_eval( max_stations, PA2EW_RECV_SERVER_ON );
 	ThreadSets    = calloc(ThreadsNumber, sizeof(PALERT_THREAD_SET));
 /* Create epoll sets */
@@ -266,9 +279,10 @@ CONNDESCRIP pa2ew_server_common_accept( const int sock )
 	RESET_CONNDESCRIP( &result );
 /* */
 	if ( (result.sock = accept(sock, (struct sockaddr *)&cliaddr, &clilen)) == -1 ) {
-		printf("palert2ew: Accepted new Palert's connection from socket: %d error!\n", sock);
+		pa2ew_log(PA2EW_LOG_STDOUT, NULL, "palert2ew: Accepted new Palert's connection from socket: %d error!\n", sock);
 		return result;
 	}
+	pa2ew_latency_sock_setup( result.sock );
 
 	switch ( cliaddr.ss_family ) {
 	case AF_INET:
@@ -280,7 +294,7 @@ CONNDESCRIP pa2ew_server_common_accept( const int sock )
 		result.port = (int)cli6_ptr->sin6_port;
 		break;
 	default:
-		printf("palert2ew: Accept socket internet type unknown, drop it!\n");
+		pa2ew_log(PA2EW_LOG_STDOUT, NULL, "palert2ew: Accept socket internet type unknown, drop it!\n");
 		result.sock = -1;
 		return result;
 		break;
@@ -346,6 +360,12 @@ void pa2ew_server_common_pconnect_close( CONNDESCRIP *conn, const int epoll )
 {
 	if ( conn->sock != -1 ) {
 		struct epoll_event tmpev;
+	/* The common function might be called with the other connection set, which can not be indexed */
+		if ( PalertConns && conn >= PalertConns && conn < PalertConns + MaxStationNum )
+			pa2ew_capture_write(
+				PA2EW_CAPTURE_SOURCE_SERVER, PA2EW_CAPTURE_EVENT_CLOSE, conn - PalertConns,
+				conn->label.staptr ? ((_STAINFO *)conn->label.staptr)->serial : 0, pa2ew_timenow_get(), NULL, 0
+			);
 		tmpev.events   = EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLET;
 		tmpev.data.ptr = conn;
 	/* Raw connection */
@@ -368,6 +388,7 @@ void pa2ew_server_common_pconnect_close( CONNDESCRIP *conn, const int epoll )
 int pa2ew_server_proc( const int countindex, const int msec )
 {
 	int    nready;
+	int    npackets;
 	_Bool  need_update = 0;
 	double time_now;
 /* */
@@ -382,29 +403,43 @@ int pa2ew_server_proc( const int countindex, const int msec )
 		for ( int i = 0; i < nready; i++ ) {
 			if ( evts[i].events & EPOLLIN || evts[i].events & EPOLLRDHUP || evts[i].events & EPOLLERR ) {
 				int          ret  = 0;
+				double       recv_time = 0.0;
 				CONNDESCRIP *conn = (CONNDESCRIP *)evts[i].data.ptr;
 			/* */
-				if ( (ret = recv(conn->sock, buffer->recv_buffer, PA2EW_RECV_BUFFER_LENGTH, 0)) <= 0 ) {
+				if ( (ret = pa2ew_latency_recv( conn->sock, buffer->recv_buffer, PA2EW_RECV_BUFFER_LENGTH, &recv_time )) <= 0 ) {
 					if ( errno != EINTR ) {
-						printf(
-							"palert2ew: Palert IP:%s, read length:%d, errno:%d(%s), close connection!\n",
+						pa2ew_log(
+							PA2EW_LOG_STDOUT, conn->ip, "palert2ew: Palert IP:%s, read length:%d, errno:%d(%s), close connection!\n",
 							conn->ip, ret, errno, strerror(errno)
 						);
 						pa2ew_server_common_pconnect_close( conn, epoll );
 					}
 				}
 				else {
+					pa2ew_metrics_add( PA2EW_METRIC_RECV_BYTES, ret );
+					__atomic_store_n(&conn->recv_bytes, conn->recv_bytes + ret, __ATOMIC_RELAXED);
+					pa2ew_capture_write(
+						PA2EW_CAPTURE_SOURCE_SERVER, PA2EW_CAPTURE_EVENT_DATA, conn - PalertConns,
+						conn->label.staptr ? ((_STAINFO *)conn->label.staptr)->serial : 0, recv_time, buffer->recv_buffer, ret
+					);
 					if ( conn->label.staptr ) {
+					/* Drop it when this Palert is over its intake budget */
+						if ( FloodFactor > 0.0 && !police_intake( conn, epoll, time_now ) ) {
+							conn->last_act = time_now;
+							continue;
+						}
 					/* Just send it to the main queue */
 						buffer->label = conn->label;
+						buffer->label.recv_time = recv_time;
 						if (
-							pa2ew_msgqueue_rawpacket(
+							(npackets = pa2ew_msgqueue_rawpacket(
 								buffer, ret, PA2EW_GEN_MSG_LOGO_BY_SRC( PA2EW_MSG_SERVER_NORMAL )
-							)
+							)) < 0
 						) {
+							pa2ew_metrics_add( PA2EW_METRIC_SYNC_ERRORS, 1 );
 							if ( ++conn->sync_errors >= PA2EW_TCP_SYNC_ERR_LIMIT ) {
-								logit(
-									"et","palert2ew: Palert %d TCP connection sync error, close connection!\n",
+								pa2ew_log(
+									"et", conn->ip, "palert2ew: Palert %d TCP connection sync error, close connection!\n",
 									((_STAINFO *)conn->label.staptr)->serial
 								);
 								pa2ew_server_common_pconnect_close( conn, epoll );
@@ -412,21 +447,25 @@ int pa2ew_server_proc( const int countindex, const int msec )
 						}
 						else {
 							conn->sync_errors = 0;
+							pa2ew_metrics_add( PA2EW_METRIC_RECV_PACKETS, npackets );
+							__atomic_store_n(&conn->recv_packets, conn->recv_packets + npackets, __ATOMIC_RELAXED);
+							if ( FloodFactor > 0.0 )
+								pa2ew_tbucket_consume( &conn->bucket, ret, npackets );
 						}
 					}
 					else if ( ret >= PALERT_M1_HEADER_LENGTH ) {
 						if ( !pac_sync_check( buffer->recv_buffer ) ) {
-							printf("palert2ew: Palert IP:%s sync failure, close connection!\n", conn->ip);
+							pa2ew_log(PA2EW_LOG_STDOUT, conn->ip, "palert2ew: Palert IP:%s sync failure, close connection!\n", conn->ip);
 							pa2ew_server_common_pconnect_close( conn, epoll );
 						}
 						else {
-							need_update = find_which_station( buffer, conn, epoll );
+							need_update = find_which_station( buffer, conn, epoll, time_now );
 						}
 					}
 					else {
 					/* Receive data not enough, close connection */
-						printf(
-							"palert2ew: Palert IP:%s send data not enough to check, close connection!\n",
+						pa2ew_log(
+							PA2EW_LOG_STDOUT, conn->ip, "palert2ew: Palert IP:%s send data not enough to check, close connection!\n",
 							conn->ip
 						);
 						pa2ew_server_common_pconnect_close( conn, epoll );
@@ -533,13 +572,16 @@ static int accept_palert_raw( void )
 			*conn = tmpconn;
 			acceptevt.data.ptr = conn;
 			epoll_ctl(ThreadSets[i % ThreadsNumber].epoll_fd, EPOLL_CTL_ADD, conn->sock, &acceptevt);
-			printf("palert2ew: New Palert connection from %s:%d.\n", conn->ip, conn->port);
+			pa2ew_log(PA2EW_LOG_STDOUT, conn->ip, "palert2ew: New Palert connection from %s:%d.\n", conn->ip, conn->port);
 			break;
 		}
 	}
 
 	if ( i == MaxStationNum ) {
-		printf("palert2ew: Palert connection is full. Drop connection from %s:%d.\n", tmpconn.ip, tmpconn.port);
+		pa2ew_log(
+			PA2EW_LOG_STDOUT, tmpconn.ip, "palert2ew: Palert connection is full. Drop connection from %s:%d.\n",
+			tmpconn.ip, tmpconn.port
+		);
 		close(tmpconn.sock);
 		return -2;
 	}
@@ -553,9 +595,10 @@ static int accept_palert_raw( void )
  * @param buffer
  * @param conn
  * @param epoll
+ * @param time_now
  * @return int
  */
-static int find_which_station( void *buffer, CONNDESCRIP *conn, int epoll )
+static int find_which_station( void *buffer, CONNDESCRIP *conn, int epoll, const double time_now )
 {
 	int       result   = 0;
 	int       tzoffset = 0;
@@ -565,7 +608,7 @@ static int find_which_station( void *buffer, CONNDESCRIP *conn, int epoll )
 /* */
 	if ( !staptr ) {
 	/* Not found in Palert table */
-		printf("palert2ew: Serial(%d) not found in station list, maybe it's a new palert.\n", serial);
+		pa2ew_log(PA2EW_LOG_STDOUT, conn->ip, "palert2ew: Serial(%d) not found in station list, maybe it's a new palert.\n", serial);
 		result = -1;
 	/* Drop the connection */
 		pa2ew_server_common_pconnect_close( conn, epoll );
@@ -577,7 +620,8 @@ static int find_which_station( void *buffer, CONNDESCRIP *conn, int epoll )
 			int i = (_conn - PalertConns) % ThreadsNumber;
 			pa2ew_server_common_pconnect_close( _conn, ThreadSets[i].epoll_fd );
 		}
-	/* */
+	/* The serial is kept in the connection, so the other threads don't have to reach the station */
+		__atomic_store_n(&conn->serial, serial, __ATOMIC_RELAXED);
 		conn->label.staptr   = staptr;
 		conn->label.packmode = pac_mode_get( ((LABELED_RECV_BUFFER *)buffer)->recv_buffer );
 	/* */
@@ -589,7 +633,10 @@ static int find_which_station( void *buffer, CONNDESCRIP *conn, int epoll )
 			staptr->timeshift = 0;
 		}
 	/* */
-		printf("palert2ew: Palert %s in UTC%+.2d:00 with mode %02d packet now online.\n", staptr->sta, tzoffset, conn->label.packmode);
+		if ( FloodFactor > 0.0 )
+			init_intake_budget( conn, ((LABELED_RECV_BUFFER *)buffer)->recv_buffer, time_now );
+	/* */
+		pa2ew_log(PA2EW_LOG_STDOUT, staptr->sta, "palert2ew: Palert %s in UTC%+.2d:00 with mode %02d packet now online.\n", staptr->sta, tzoffset, conn->label.packmode);
 	}
 
 	return result;
@@ -614,3 +661,144 @@ static int find_palert_tzoffset( const PALERT_M1_HEADER *pah )
 
 	return result;
 }
+
+/**
+ * @brief Initialize the intake budget of the connection by the expected sampling rate & channel number.
+ *
+ * @param conn
+ * @param packet
+ * @param time_now
+ */
+static void init_intake_budget( CONNDESCRIP *conn, const void *packet, const double time_now )
+{
+	INTAKE_BUDGET *budget   = &conn->budget;
+	double         samprate = PALERT_DEFAULT_SAMPRATE;
+/* */
+	const PALERT_M4_SMSR_HEADER *smsrh = (PALERT_M4_SMSR_HEADER *)((PALERT_M4_HEADER *)packet + 1);
+	double                       reclen;
+	double                       min_nsamp;
+
+/* */
+	memset(budget, 0, sizeof(INTAKE_BUDGET));
+	switch ( conn->label.packmode ) {
+	case PALERT_PKT_MODE4:
+	/* The first record is always inside the first chunk, which is longer than the mode 1 header */
+		reclen = 512.0;
+		if ( PALERT_M4_PACKETLEN_GET( (PALERT_M4_HEADER *)packet ) >= PALERT_M4_HEADER_LENGTH + sizeof(PALERT_M4_SMSR_HEADER) ) {
+			if ( pac_m4_smsr_samprate_get( smsrh ) > 0.0 )
+				samprate = pac_m4_smsr_samprate_get( smsrh );
+			if ( PALERT_M4_SMSR_LENGTH_GET( smsrh ) > 2 * PALERT_M4_STEIM_FRAME_LENGTH )
+				reclen = PALERT_M4_SMSR_LENGTH_GET( smsrh );
+		}
+	/*
+	 * Each record only carries one channel, and it holds the fewest samples under strong shaking, that is one
+	 * sample per word of Steim2 (15 words per frame, and X0 & Xn in the first frame). Round it up & take one
+	 * more partial record per channel each second, and each record sent in its own packet as the upper bound.
+	 */
+		min_nsamp = (reclen / PALERT_M4_STEIM_FRAME_LENGTH - 1.0) * 15.0 - 2.0;
+		budget->pkt_per_chan  = (int)(samprate / min_nsamp) + 2.0;
+		budget->byte_per_chan = budget->pkt_per_chan * (reclen + PALERT_M4_HEADER_LENGTH);
+		break;
+	case PALERT_PKT_MODE16:
+		if ( PALERT_M16_SAMPRATE_GET( (PALERT_M16_HEADER *)packet ) )
+			samprate = PALERT_M16_SAMPRATE_GET( (PALERT_M16_HEADER *)packet );
+	/* */
+		budget->min_nchannel  = ((PALERT_M16_HEADER *)packet)->nchannel;
+		budget->pkt_fixed     = PALERT_M16_SAMPNUM_GET( (PALERT_M16_HEADER *)packet ) ?
+			samprate / PALERT_M16_SAMPNUM_GET( (PALERT_M16_HEADER *)packet ) : samprate;
+		budget->byte_fixed    = budget->pkt_fixed * PALERT_M16_HEADER_LENGTH;
+		budget->byte_per_chan = samprate * 4.0;
+		break;
+	case PALERT_PKT_MODE1: case PALERT_PKT_MODE2: default:
+		samprate           = PALERT_M1_SAMPRATE_GET( (PALERT_M1_HEADER *)packet );
+		budget->pkt_fixed  = samprate / PALERT_M1_SAMPLE_NUMBER;
+		budget->byte_fixed = budget->pkt_fixed * PALERT_M1_PACKET_LENGTH;
+		break;
+	}
+/* */
+	size_intake_budget( conn, time_now, 1 );
+
+	return;
+}
+
+/**
+ * @brief Size the token bucket of the connection by the current channel number of the station.
+ *
+ * @param conn
+ * @param time_now
+ * @param init Nonzero for refilling the bucket, otherwise the remained tokens are kept.
+ */
+static void size_intake_budget( CONNDESCRIP *conn, const double time_now, const int init )
+{
+	const _STAINFO *staptr = (_STAINFO *)conn->label.staptr;
+	INTAKE_BUDGET  *budget = &conn->budget;
+	double          nchannel;
+	double          byte_rate;
+	double          pkt_rate;
+
+/* Take the sequence first, the later resizing will be caught by the next check */
+	budget->seq = __atomic_load_n(&staptr->budget_seq, __ATOMIC_RELAXED);
+	nchannel    = staptr->nchannel > budget->min_nchannel ? staptr->nchannel : budget->min_nchannel;
+/* One more packet per second for the triggered mode 2 packets & the jitter of network */
+	byte_rate = (budget->byte_fixed + budget->byte_per_chan * nchannel) * FloodFactor;
+	pkt_rate  = (budget->pkt_fixed + budget->pkt_per_chan * nchannel + 1.0) * FloodFactor;
+	if ( init )
+		pa2ew_tbucket_init( &conn->bucket, byte_rate, pkt_rate, PA2EW_FLOOD_BURST_SEC, time_now );
+	else
+		pa2ew_tbucket_resize( &conn->bucket, byte_rate, pkt_rate );
+
+	return;
+}
+
+/**
+ * @brief Check the intake budget of the connection before putting the data into the main queue.
+ *
+ * @param conn
+ * @param epoll
+ * @param time_now
+ * @return int 1 for accepting the data, 0 for dropping it.
+ */
+static int police_intake( CONNDESCRIP *conn, const int epoll, const double time_now )
+{
+	PA2EW_TBUCKET  *bucket = &conn->bucket;
+	const _STAINFO *staptr = (_STAINFO *)conn->label.staptr;
+
+/* The channel number of this station has been changed by the list updating */
+	if ( __atomic_load_n(&staptr->budget_seq, __ATOMIC_RELAXED) != conn->budget.seq )
+		size_intake_budget( conn, time_now, 0 );
+/* Only back to normal when the bucket has been half refilled */
+	if ( pa2ew_tbucket_refill( bucket, time_now ) ) {
+		if (
+			bucket->over_since > 0.0 &&
+			bucket->byte_tokens >= bucket->byte_rate * bucket->burst * 0.5 &&
+			bucket->pkt_tokens >= bucket->pkt_rate * bucket->burst * 0.5
+		) {
+			pa2ew_log(
+				"t", staptr->sta, "palert2ew: Palert %s intake back to normal after %.0f seconds.\n",
+				staptr->sta, time_now - bucket->over_since
+			);
+			bucket->over_since = 0.0;
+		}
+		return 1;
+	}
+/* Log it once per episode */
+	if ( bucket->over_since <= 0.0 ) {
+		bucket->over_since = time_now;
+		pa2ew_log(
+			"et", staptr->sta, "palert2ew: Palert %s exceeds its intake budget (%.0f bytes/s, %.1f packets/s), throttling!\n",
+			staptr->sta, bucket->byte_rate, bucket->pkt_rate
+		);
+	}
+/* The remained incomplete packet is useless after dropping */
+	pa2ew_msgqueue_lastbufs_reset( conn->label.staptr );
+/* */
+	if ( FloodAction == PA2EW_FLOOD_DISCONNECT && (time_now - bucket->over_since) >= (double)PA2EW_FLOOD_DISCONNECT_SEC ) {
+		pa2ew_log(
+			"et", staptr->sta, "palert2ew: Palert %s keeps flooding over %d seconds, close connection!\n",
+			staptr->sta, PA2EW_FLOOD_DISCONNECT_SEC
+		);
+		pa2ew_server_common_pconnect_close( conn, epoll );
+	}
+
+	return 0;
+}
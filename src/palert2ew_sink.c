@@ -0,0 +1,584 @@
+/**
+ * @file palert2ew_sink.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Output sinks: the Earthworm ring (by transport or by batch), the lock-free ring inside this process,
+ *        the file of records and the discard one. The callers only see the same put/commit/close calls.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @name Earthworm environment header include
+ *
+ */
+#include <earthworm.h>
+#include <transport.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <palert2ew_ring.h>
+#include <palert2ew_sink.h>
+
+/**
+ * @brief Backend of the Earthworm ring
+ *
+ */
+typedef struct {
+	SHM_INFO          region;
+	int               batch;
+	PA2EW_RING_WRITER writer;
+} TPORT_BACKEND;
+
+/**
+ * @brief Backend of the memory ring, single writer & multiple readers. The keys never wrap (64-bit), the
+ *        position inside the ring is the key modulo the size.
+ *
+ */
+typedef struct {
+	uint8_t  *ring;
+	uint64_t  size;
+	uint64_t  keyin;   /* Key of the next message, only moved by the writer after the message is in */
+	uint64_t  keyold;  /* Key of the oldest message, moved by the writer before overwriting it       */
+} MEMRING_BACKEND;
+
+/**
+ * @name Internal functions' prototype
+ *
+ */
+static PA2EW_SINK *create_sink( const PA2EW_SINK_OPS *, void * );
+static int         tport_put( PA2EW_SINK *, const MSG_LOGO *, const long, const void * );
+static int         tport_commit( PA2EW_SINK * );
+static int         check_ring_result( TPORT_BACKEND *, const int );
+static void        tport_close( PA2EW_SINK * );
+static int         memring_put( PA2EW_SINK *, const MSG_LOGO *, const long, const void * );
+static void        memring_close( PA2EW_SINK * );
+static void        memring_copy_to( MEMRING_BACKEND *, const uint64_t, const void *, const size_t );
+static void        memring_copy_from( const MEMRING_BACKEND *, const uint64_t, void *, const size_t );
+static int         file_put( PA2EW_SINK *, const MSG_LOGO *, const long, const void * );
+static int         file_commit( PA2EW_SINK * );
+static void        file_close( PA2EW_SINK * );
+static int         discard_put( PA2EW_SINK *, const MSG_LOGO *, const long, const void * );
+
+/**
+ * @name Internal static variables
+ *
+ */
+static const PA2EW_SINK_OPS TportOps   = { "tport", tport_put, tport_commit, tport_close };
+static const PA2EW_SINK_OPS MemringOps = { "memory", memring_put, NULL, memring_close };
+static const PA2EW_SINK_OPS FileOps    = { "file", file_put, file_commit, file_close };
+static const PA2EW_SINK_OPS DiscardOps = { "discard", discard_put, NULL, NULL };
+
+/**
+ * @brief Attach to the Earthworm ring.
+ *
+ * @param key
+ * @param batch Commit the messages by batch under one ring lock or not.
+ * @return PA2EW_SINK*
+ */
+PA2EW_SINK *pa2ew_sink_tport_open( const long key, const int batch )
+{
+	TPORT_BACKEND *backend = (TPORT_BACKEND *)calloc(1, sizeof(TPORT_BACKEND));
+	PA2EW_SINK    *result  = NULL;
+
+/* */
+	if ( !backend )
+		return NULL;
+	tport_attach(&backend->region, key);
+/* The batch writer needs the ring attached; it fails the same way for all the rings on the unsupported platform */
+	if ( batch ) {
+		switch ( pa2ew_ring_writer_init( &backend->writer, &backend->region, PA2EW_RING_DEF_BATCH_SIZE ) ) {
+		case 0:
+			backend->batch = 1;
+			break;
+		case PA2EW_RING_UNSUPPORTED:
+			logit("e", "palert2ew: Cannot commit the messages by batch on this platform, put them one by one!\n");
+			break;
+		default:
+		/* Never mix tport_putmsg with the writers in the same ring, the sequence numbers would be broken */
+			logit("e", "palert2ew: Error allocating the batch of ring %ld!\n", key);
+			tport_detach(&backend->region);
+			free(backend);
+			return NULL;
+		}
+	}
+/* */
+	if ( !(result = create_sink( &TportOps, backend )) ) {
+		pa2ew_ring_writer_free( &backend->writer );
+		tport_detach(&backend->region);
+		free(backend);
+	}
+
+	return result;
+}
+
+/**
+ * @brief
+ *
+ * @param size Size of the memory ring in bytes.
+ * @return PA2EW_SINK*
+ */
+PA2EW_SINK *pa2ew_sink_memring_open( const size_t size )
+{
+	MEMRING_BACKEND *backend = (MEMRING_BACKEND *)calloc(1, sizeof(MEMRING_BACKEND));
+	PA2EW_SINK      *result  = NULL;
+
+/* */
+	if ( !backend )
+		return NULL;
+	backend->size = size > sizeof(PA2EW_SINK_RECORD_HEAD) ? size : PA2EW_SINK_DEF_MEMRING_SIZE;
+	if ( !(backend->ring = malloc(backend->size)) || !(result = create_sink( &MemringOps, backend )) ) {
+		free(backend->ring);
+		free(backend);
+	}
+
+	return result;
+}
+
+/**
+ * @brief
+ *
+ * @param path The records will be appended behind the existing ones.
+ * @return PA2EW_SINK*
+ */
+PA2EW_SINK *pa2ew_sink_file_open( const char *path )
+{
+	FILE       *fp     = fopen(path, "ab");
+	PA2EW_SINK *result = NULL;
+
+/* */
+	if ( !fp )
+		return NULL;
+	setvbuf(fp, NULL, _IOFBF, PA2EW_SINK_FILE_BUFFER_SIZE);
+	if ( !(result = create_sink( &FileOps, fp )) )
+		fclose(fp);
+
+	return result;
+}
+
+/**
+ * @brief
+ *
+ * @return PA2EW_SINK*
+ */
+PA2EW_SINK *pa2ew_sink_discard_open( void )
+{
+	return create_sink( &DiscardOps, NULL );
+}
+
+/**
+ * @brief Put the message into the sink, it might be staged until committing.
+ *
+ * @param sink
+ * @param logo
+ * @param size
+ * @param msg
+ * @return int PUT_OK or the error of the backend.
+ */
+int pa2ew_sink_put( PA2EW_SINK *sink, const MSG_LOGO *logo, const long size, const void *msg )
+{
+	const int result = sink->ops->put( sink, logo, size, msg );
+
+/* */
+/* The counters are read by the metrics endpoint thread at the same time */
+	if ( result == PUT_OK ) {
+		__atomic_fetch_add(&sink->nmsg, 1, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&sink->nbytes, size, __ATOMIC_RELAXED);
+	}
+	else {
+		__atomic_fetch_add(&sink->nfail, 1, __ATOMIC_RELAXED);
+	}
+
+	return result;
+}
+
+/**
+ * @brief Commit all the staged messages of the sink.
+ *
+ * @param sink
+ * @return int
+ */
+int pa2ew_sink_commit( PA2EW_SINK *sink )
+{
+	return sink && sink->ops->commit ? sink->ops->commit( sink ) : PUT_OK;
+}
+
+/**
+ * @brief Commit the staged messages, then close the sink & free it.
+ *
+ * @param sink
+ */
+void pa2ew_sink_close( PA2EW_SINK *sink )
+{
+	if ( sink ) {
+		pa2ew_sink_commit( sink );
+		if ( sink->ops->close )
+			sink->ops->close( sink );
+		free(sink);
+	}
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param name
+ * @return int The backend number or -1 for unknown name.
+ */
+int pa2ew_sink_backend_get( const char *name )
+{
+	if ( !strcmp(name, TportOps.name) )
+		return PA2EW_SINK_TPORT;
+	else if ( !strcmp(name, MemringOps.name) )
+		return PA2EW_SINK_MEMRING;
+	else if ( !strcmp(name, FileOps.name) )
+		return PA2EW_SINK_FILE;
+	else if ( !strcmp(name, DiscardOps.name) )
+		return PA2EW_SINK_DISCARD;
+
+	return -1;
+}
+
+/**
+ * @brief
+ *
+ * @param sink
+ * @return SHM_INFO* The attached region, or NULL if it's not an Earthworm ring.
+ */
+SHM_INFO *pa2ew_sink_region_get( PA2EW_SINK *sink )
+{
+	return sink && sink->ops == &TportOps ? &((TPORT_BACKEND *)sink->backend)->region : NULL;
+}
+
+/**
+ * @brief Start reading from the newest message of the memory ring.
+ *
+ * @param reader
+ * @param sink
+ */
+void pa2ew_memring_reader_init( PA2EW_MEMRING_READER *reader, const PA2EW_SINK *sink )
+{
+	reader->sink   = sink && sink->ops == &MemringOps ? sink : NULL;
+	reader->pos    = reader->sink ? __atomic_load_n(&((MEMRING_BACKEND *)sink->backend)->keyin, __ATOMIC_ACQUIRE) : 0;
+	reader->missed = 0;
+
+	return;
+}
+
+/**
+ * @brief Get the next message from the memory ring, just like tport_getmsg without the logo filter.
+ *
+ * @param reader
+ * @param logo
+ * @param length
+ * @param msg
+ * @param maxsize
+ * @return int GET_OK, GET_MISS (some messages are overwritten before reading), GET_TOOBIG or GET_NONE.
+ */
+int pa2ew_memring_getmsg( PA2EW_MEMRING_READER *reader, MSG_LOGO *logo, long *length, void *msg, const long maxsize )
+{
+	const MEMRING_BACKEND *backend;
+	PA2EW_SINK_RECORD_HEAD head;
+	uint64_t               keyold;
+	int                    result = GET_OK;
+
+/* */
+	if ( !reader->sink )
+		return GET_NONE;
+	backend = (const MEMRING_BACKEND *)reader->sink->backend;
+/* */
+	while ( reader->pos != __atomic_load_n(&backend->keyin, __ATOMIC_ACQUIRE) ) {
+	/* Overrun by the writer, jump to the oldest one */
+		if ( reader->pos < (keyold = __atomic_load_n(&backend->keyold, __ATOMIC_ACQUIRE)) ) {
+			reader->missed++;
+			reader->pos = keyold;
+			result      = GET_MISS;
+			continue;
+		}
+	/* */
+		memring_copy_from( backend, reader->pos, &head, sizeof(PA2EW_SINK_RECORD_HEAD) );
+		if ( head.size <= maxsize && head.size <= backend->size )
+			memring_copy_from( backend, reader->pos + sizeof(PA2EW_SINK_RECORD_HEAD), msg, head.size );
+	/* The copies might be overwritten during copying, check it again */
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if ( reader->pos < __atomic_load_n(&backend->keyold, __ATOMIC_RELAXED) )
+			continue;
+	/* */
+		reader->pos += sizeof(PA2EW_SINK_RECORD_HEAD) + head.size;
+		logo->type   = head.type;
+		logo->mod    = head.mod;
+		logo->instid = head.instid;
+		*length      = head.size;
+
+		return head.size <= maxsize ? result : GET_TOOBIG;
+	}
+
+	return GET_NONE;
+}
+
+/**
+ * @brief
+ *
+ * @param ops
+ * @param backend
+ * @return PA2EW_SINK*
+ */
+static PA2EW_SINK *create_sink( const PA2EW_SINK_OPS *ops, void *backend )
+{
+	PA2EW_SINK *result = (PA2EW_SINK *)calloc(1, sizeof(PA2EW_SINK));
+
+/* */
+	if ( result ) {
+		result->ops     = ops;
+		result->backend = backend;
+	}
+
+	return result;
+}
+
+/**
+ * @brief
+ *
+ * @param sink
+ * @param logo
+ * @param size
+ * @param msg
+ * @return int
+ */
+static int tport_put( PA2EW_SINK *sink, const MSG_LOGO *logo, const long size, const void *msg )
+{
+	TPORT_BACKEND *backend = (TPORT_BACKEND *)sink->backend;
+
+/* */
+	if ( backend->batch )
+		return check_ring_result( backend, pa2ew_ring_writer_add( &backend->writer, logo, size, msg ) );
+
+	return tport_putmsg(&backend->region, (MSG_LOGO *)logo, size, (char *)msg);
+}
+
+/**
+ * @brief
+ *
+ * @param sink
+ * @return int
+ */
+static int tport_commit( PA2EW_SINK *sink )
+{
+	TPORT_BACKEND *backend = (TPORT_BACKEND *)sink->backend;
+
+	return backend->batch ? check_ring_result( backend, pa2ew_ring_writer_commit( &backend->writer ) ) : PUT_OK;
+}
+
+/**
+ * @brief The corrupted ring is fatal, just like the way of tport_putmsg.
+ *
+ * @param backend
+ * @param result
+ * @return int
+ */
+static int check_ring_result( TPORT_BACKEND *backend, const int result )
+{
+	if ( result == PA2EW_RING_CORRUPTED ) {
+		logit("et", "palert2ew: ERROR, keyold not at FIRST_BYTE, region %ld is corrupted. Exiting!\n", backend->region.key);
+		exit(-1);
+	}
+
+	return result;
+}
+
+/**
+ * @brief
+ *
+ * @param sink
+ */
+static void tport_close( PA2EW_SINK *sink )
+{
+	TPORT_BACKEND *backend = (TPORT_BACKEND *)sink->backend;
+
+/* */
+	pa2ew_ring_writer_free( &backend->writer );
+	tport_detach(&backend->region);
+	free(backend);
+
+	return;
+}
+
+/**
+ * @brief Drop the oldest messages until there is room, copy the message in, then move the key of insertion.
+ *
+ * @param sink
+ * @param logo
+ * @param size
+ * @param msg
+ * @return int
+ */
+static int memring_put( PA2EW_SINK *sink, const MSG_LOGO *logo, const long size, const void *msg )
+{
+	MEMRING_BACKEND       *backend = (MEMRING_BACKEND *)sink->backend;
+	const uint64_t         total   = sizeof(PA2EW_SINK_RECORD_HEAD) + size;
+	uint64_t               keyold  = backend->keyold;
+	PA2EW_SINK_RECORD_HEAD head;
+
+/* */
+	if ( size < 0 || total > backend->size )
+		return PUT_TOOBIG;
+/* Only the writer moves the keys, so the old headers are still there */
+	while ( backend->keyin + total - keyold > backend->size ) {
+		memring_copy_from( backend, keyold, &head, sizeof(PA2EW_SINK_RECORD_HEAD) );
+		keyold += sizeof(PA2EW_SINK_RECORD_HEAD) + head.size;
+	}
+/* The readers must see the moved key before the old messages are overwritten */
+	if ( keyold != backend->keyold ) {
+		__atomic_store_n(&backend->keyold, keyold, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	}
+/* */
+	head.type     = logo->type;
+	head.mod      = logo->mod;
+	head.instid   = logo->instid;
+	head.reserved = 0;
+	head.size     = (uint32_t)size;
+	memring_copy_to( backend, backend->keyin, &head, sizeof(PA2EW_SINK_RECORD_HEAD) );
+	memring_copy_to( backend, backend->keyin + sizeof(PA2EW_SINK_RECORD_HEAD), msg, size );
+/* The readers can only see the message after the key moved */
+	__atomic_store_n(&backend->keyin, backend->keyin + total, __ATOMIC_RELEASE);
+
+	return PUT_OK;
+}
+
+/**
+ * @brief
+ *
+ * @param sink
+ */
+static void memring_close( PA2EW_SINK *sink )
+{
+	MEMRING_BACKEND *backend = (MEMRING_BACKEND *)sink->backend;
+
+/* */
+	free(backend->ring);
+	free(backend);
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param backend
+ * @param key
+ * @param src
+ * @param len
+ */
+static void memring_copy_to( MEMRING_BACKEND *backend, const uint64_t key, const void *src, const size_t len )
+{
+	const size_t pos   = key % backend->size;
+	const size_t first = len < backend->size - pos ? len : backend->size - pos;
+
+/* */
+	memcpy(backend->ring + pos, src, first);
+	if ( first < len )
+		memcpy(backend->ring, (const uint8_t *)src + first, len - first);
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param backend
+ * @param key
+ * @param dest
+ * @param len
+ */
+static void memring_copy_from( const MEMRING_BACKEND *backend, const uint64_t key, void *dest, const size_t len )
+{
+	const size_t pos   = key % backend->size;
+	const size_t first = len < backend->size - pos ? len : backend->size - pos;
+
+/* */
+	memcpy(dest, backend->ring + pos, first);
+	if ( first < len )
+		memcpy((uint8_t *)dest + first, backend->ring, len - first);
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param sink
+ * @param logo
+ * @param size
+ * @param msg
+ * @return int
+ */
+static int file_put( PA2EW_SINK *sink, const MSG_LOGO *logo, const long size, const void *msg )
+{
+	FILE                        *fp   = (FILE *)sink->backend;
+	const PA2EW_SINK_RECORD_HEAD head = {
+		.type     = logo->type,
+		.mod      = logo->mod,
+		.instid   = logo->instid,
+		.reserved = 0,
+		.size     = (uint32_t)size
+	};
+
+/* */
+	if ( size < 0 )
+		return PUT_TOOBIG;
+	if ( fwrite(&head, sizeof(PA2EW_SINK_RECORD_HEAD), 1, fp) != 1 || (size && fwrite(msg, size, 1, fp) != 1) )
+		return PUT_NOTRACK;
+
+	return PUT_OK;
+}
+
+/**
+ * @brief Flush the buffered records once each round.
+ *
+ * @param sink
+ * @return int
+ */
+static int file_commit( PA2EW_SINK *sink )
+{
+	return fflush((FILE *)sink->backend) ? PUT_NOTRACK : PUT_OK;
+}
+
+/**
+ * @brief
+ *
+ * @param sink
+ */
+static void file_close( PA2EW_SINK *sink )
+{
+	fclose((FILE *)sink->backend);
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param sink
+ * @param logo
+ * @param size
+ * @param msg
+ * @return int
+ */
+static int discard_put( PA2EW_SINK *sink, const MSG_LOGO *logo, const long size, const void *msg )
+{
+	return size < 0 ? PUT_TOOBIG : PUT_OK;
+}
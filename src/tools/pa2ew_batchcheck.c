@@ -0,0 +1,341 @@
+/**
+ * @file pa2ew_batchcheck.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Checking of the batch decoding inside libpalertc: the batch mixed with the good, CRC mismatched, malformed,
+ *        missing & other mode packets is decoded into the buffer that still holds the previous batch. The good ones
+ *        should be the same as the single packet decoding, the others should leave nothing stale & write nothing
+ *        out of their own rows.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <libpalertc/libpalertc.h>
+#include <pa2ew_synth.h>
+
+/**
+ * @name Check constants
+ *
+ */
+#define CHECK_PACKETS     40
+#define CHECK_KINDS       8
+#define CHECK_START_TIME  1700000000.0
+#define CHECK_CANARY      ((int32_t)0x5a5a5a5a)
+
+/**
+ * @name Kind of each packet in the mixed batch, by the index
+ *
+ */
+#define KIND_GOOD       0
+#define KIND_CRC        1
+#define KIND_TRUNCATED  3  /* Mode 16 with an incomplete row, mode 4 with the record over the packet */
+#define KIND_MISSING    4
+#define KIND_OTHER      5
+#define KIND_OVERSIZE   7  /* Mode 16 with the data over the packet, mode 4 with too many samples */
+
+/**
+ * @brief Setting of each mode, the sample capacity of batch is exactly the sample number, so any write over the
+ *        rows goes into the next channel.
+ *
+ */
+typedef struct {
+	int mode;
+	int samprate;
+	int nsamp;
+	int nchannel;
+	int flags;
+} CHECK_SETTING;
+
+/**
+ * @name Internal functions' prototype
+ *
+ */
+static int  run_case( const CHECK_SETTING *, const char * );
+static int  kind_get( const int );
+static void packet_damage( const int, const int, uint8_t *, PA2EW_SYNTH * );
+static int  reference_decode( const CHECK_SETTING *, const uint8_t *, int32_t *, double * );
+static int  check_packet( const CHECK_SETTING *, const PALERT_BATCH *, const int, const int, const char * );
+
+/**
+ * @name Internal static variables
+ *
+ */
+static uint8_t Packets[CHECK_PACKETS][PALERT_M16_PACKET_MAX_LENGTH];
+static int32_t Reference[PA2EW_SYNTH_MAX_CHANNELS * PALERT_MAX_SAMPRATE];
+
+/**
+ * @brief Usage: pa2ew_batchcheck
+ *
+ * @return int
+ */
+int main( void )
+{
+	const CHECK_SETTING settings[] = {
+		{ PALERT_PKT_MODE1,  100, PALERT_M1_SAMPLE_NUMBER, PALERT_M1_CHAN_COUNT, PALERT_BATCH_CHECK_CRC },
+		{ PALERT_PKT_MODE4,  100, 100, 3, PALERT_BATCH_CHECK_CRC },
+		{ PALERT_PKT_MODE16, 200, 200, 4, PALERT_BATCH_CHECK_CRC | PALERT_BATCH_INT_DATA },
+		{ PALERT_PKT_MODE16, 200, 200, 4, PALERT_BATCH_INT_DATA }
+	};
+	const char *names[] = { "mode 1, CRC", "mode 4, CRC", "mode 16, CRC & integer", "mode 16, integer" };
+	int         failed  = 0;
+
+/* */
+	for ( size_t i = 0; i < sizeof(settings) / sizeof(settings[0]); i++ )
+		failed |= run_case( &settings[i], names[i] );
+
+	fprintf(stdout, "pa2ew_batchcheck: %s!\n", failed ? "FAILED" : "All the batches are decoded as expected");
+
+	return failed ? -1 : 0;
+}
+
+/**
+ * @brief Decode the batch of all good packets first, then the mixed one into the same buffer.
+ *
+ * @param setting
+ * @param name
+ * @return int
+ */
+static int run_case( const CHECK_SETTING *setting, const char *name )
+{
+	PALERT_BATCH *batch;
+	PA2EW_SYNTH   synth[CHECK_PACKETS];
+	PA2EW_SYNTH   other;
+	const void   *packets[CHECK_PACKETS];
+	int           errors = 0;
+	int           kind;
+
+/* */
+	batch = pac_batch_create( CHECK_PACKETS, setting->nchannel, setting->nsamp );
+	if ( !batch ) {
+		fprintf(stderr, "pa2ew_batchcheck: Error creating the batch of %s!\n", name);
+		return -1;
+	}
+	for ( int i = 0; i < CHECK_PACKETS; i++ ) {
+		if ( pa2ew_synth_init( &synth[i], setting->mode, i, 1000 + i, setting->samprate, setting->nsamp, setting->nchannel ) < 0 ) {
+			fprintf(stderr, "pa2ew_batchcheck: Unsupported setting of %s!\n", name);
+			pac_batch_free( batch );
+			return -1;
+		}
+		pa2ew_synth_packet_build( &synth[i], Packets[i], CHECK_START_TIME );
+		packets[i] = Packets[i];
+	}
+/* Every field of the buffer is filled by the good ones */
+	pac_batch_decode( batch, packets, CHECK_PACKETS, setting->mode, setting->flags );
+	for ( int i = 0; i < CHECK_PACKETS; i++ )
+		errors += check_packet( setting, batch, i, KIND_GOOD, name );
+/* */
+	pa2ew_synth_init(
+		&other, setting->mode == PALERT_PKT_MODE1 ? PALERT_PKT_MODE16 : PALERT_PKT_MODE1, 0, 999,
+		setting->samprate, setting->nsamp, setting->nchannel
+	);
+	for ( int i = 0; i < CHECK_PACKETS; i++ ) {
+		kind = kind_get( i );
+		pa2ew_synth_packet_build( &synth[i], Packets[i], CHECK_START_TIME + 1.0 );
+		if ( kind == KIND_OTHER )
+			pa2ew_synth_packet_build( &other, Packets[i], CHECK_START_TIME + 1.0 );
+		else if ( kind != KIND_GOOD )
+			packet_damage( setting->mode, kind, Packets[i], &synth[i] );
+		packets[i] = kind == KIND_MISSING ? NULL : Packets[i];
+	}
+/* Those never decoded rows should keep the canary */
+	for ( size_t i = 0; i < (size_t)CHECK_PACKETS * setting->nchannel * setting->nsamp; i++ )
+		batch->data[i] = CHECK_CANARY;
+	pac_batch_decode( batch, packets, CHECK_PACKETS, setting->mode, setting->flags );
+	for ( int i = 0; i < CHECK_PACKETS; i++ ) {
+	/* Without the CRC checking, the CRC mismatched one is just a good one */
+		kind = kind_get( i );
+		if ( kind == KIND_CRC && !(setting->flags & PALERT_BATCH_CHECK_CRC) )
+			kind = KIND_GOOD;
+		errors += check_packet( setting, batch, i, kind, name );
+	}
+/* */
+	fprintf(stdout, "pa2ew_batchcheck: %-24s %3d packets, %s\n", name, CHECK_PACKETS, errors ? "MISMATCH" : "OK");
+	pac_batch_free( batch );
+
+	return errors ? -1 : 0;
+}
+
+/**
+ * @brief
+ *
+ * @param index
+ * @return int
+ */
+static int kind_get( const int index )
+{
+	const int kind = index % CHECK_KINDS;
+
+	return kind == KIND_CRC || kind == KIND_TRUNCATED || kind == KIND_MISSING || kind == KIND_OTHER || kind == KIND_OVERSIZE ?
+		kind : KIND_GOOD;
+}
+
+/**
+ * @brief Damage the built packet, the check sum is kept right for the malformed ones, so only the length checking
+ *        would stop them.
+ *
+ * @param mode
+ * @param kind
+ * @param packet
+ * @param synth
+ */
+static void packet_damage( const int mode, const int kind, uint8_t *packet, PA2EW_SYNTH *synth )
+{
+	PALERT_M16_HEADER     *pah16 = (PALERT_M16_HEADER *)packet;
+	PALERT_M4_SMSR_HEADER *smsrh = (PALERT_M4_SMSR_HEADER *)(packet + PALERT_M4_HEADER_LENGTH);
+	int                    length;
+	int                    data_len;
+	uint16_t               crc;
+
+/* */
+	if ( kind == KIND_CRC || mode == PALERT_PKT_MODE1 ) {
+		pa2ew_synth_packet_corrupt( synth, packet, pa2ew_synth_length_get( synth ) );
+		return;
+	}
+/* */
+	if ( mode == PALERT_PKT_MODE4 ) {
+		smsrh = (PALERT_M4_SMSR_HEADER *)((uint8_t *)smsrh + PALERT_M4_SMSR_LENGTH_GET( smsrh ));
+		if ( kind == KIND_TRUNCATED ) {
+			smsrh->smsrlength[0] = 0xff;
+			smsrh->smsrlength[1] = 0xff;
+		}
+		else {
+			smsrh->numsamples[0] = (synth->nsamp + 1) >> 8;
+			smsrh->numsamples[1] = (synth->nsamp + 1) & 0xff;
+		}
+		return;
+	}
+/* Mode 16, one more incomplete row inside the packet or the data length over the packet */
+	length = pa2ew_synth_length_get( synth );
+	if ( kind == KIND_TRUNCATED ) {
+		data_len = PALERT_M16_WORD_GET( pah16->data_len ) + 4;
+		length  += 4;
+		pah16->data_len[0] = data_len & 0xff;
+		pah16->data_len[1] = data_len >> 8;
+		memmove(packet + length - 2, packet + length - 6, 2);
+		memset(packet + length - 6, 0x41, 4);
+		pah16->packet_len[0] = length & 0xff;
+		pah16->packet_len[1] = length >> 8;
+	}
+	else {
+		pah16->packet_len[0] = (PALERT_M16_HEADER_LENGTH + 2) & 0xff;
+		pah16->packet_len[1] = (PALERT_M16_HEADER_LENGTH + 2) >> 8;
+		length = PALERT_M16_HEADER_LENGTH + 2;
+	}
+/* Rebuild the check sum after the header changed */
+	crc = pac_crc16_cal( packet, length - 2 );
+	packet[length - 2] = crc & 0xff;
+	packet[length - 1] = crc >> 8;
+
+	return;
+}
+
+/**
+ * @brief Decode the good packet by the single packet functions.
+ *
+ * @param setting
+ * @param packet
+ * @param data Samples of each channel, one after another by the sample number.
+ * @param starttime
+ * @return int The sampling rate.
+ */
+static int reference_decode( const CHECK_SETTING *setting, const uint8_t *packet, int32_t *data, double *starttime )
+{
+	int32_t                     *buffer[PA2EW_SYNTH_MAX_CHANNELS];
+	const PALERT_M4_SMSR_HEADER *smsrh = (const PALERT_M4_SMSR_HEADER *)(packet + PALERT_M4_HEADER_LENGTH);
+
+/* */
+	for ( int i = 0; i < setting->nchannel; i++ )
+		buffer[i] = data + i * setting->nsamp;
+	switch ( setting->mode ) {
+	case PALERT_PKT_MODE1:
+		pac_m1_data_extract( (const PALERT_M1_PACKET *)packet, buffer );
+		*starttime = pac_m1_systime_get( (const PALERT_M1_HEADER *)packet, 0 );
+		return PALERT_M1_SAMPRATE_GET( (const PALERT_M1_HEADER *)packet );
+	case PALERT_PKT_MODE4:
+		*starttime = pac_m4_smsr_starttime_get( smsrh );
+		for ( int i = 0; i < setting->nchannel; i++ ) {
+			pac_m4_smsr_data_extract( smsrh, buffer[i], setting->nsamp );
+			smsrh = (const PALERT_M4_SMSR_HEADER *)((const uint8_t *)smsrh + PALERT_M4_SMSR_LENGTH_GET( smsrh ));
+		}
+		return (int)pac_m4_smsr_samprate_get( (const PALERT_M4_SMSR_HEADER *)(packet + PALERT_M4_HEADER_LENGTH) );
+	case PALERT_PKT_MODE16: default:
+		pac_m16_idata_extract( (const PALERT_M16_PACKET *)packet, setting->nchannel, buffer );
+		*starttime = pac_m16_sptime_get( (const PALERT_M16_HEADER *)packet );
+		return PALERT_M16_SAMPRATE_GET( (const PALERT_M16_HEADER *)packet );
+	}
+}
+
+/**
+ * @brief
+ *
+ * @param setting
+ * @param batch
+ * @param index
+ * @param kind
+ * @param name
+ * @return int The number of mismatches.
+ */
+static int check_packet( const CHECK_SETTING *setting, const PALERT_BATCH *batch, const int index, const int kind, const char *name )
+{
+	const int32_t *data;
+	double         starttime;
+	int            samprate;
+	int            errors = 0;
+
+/* */
+	if ( kind == KIND_GOOD ) {
+		samprate = reference_decode( setting, Packets[index], Reference, &starttime );
+		if ( !PALERT_BATCH_BIT_GET( batch->crc_pass, index ) || batch->nchannel[index] != setting->nchannel || (int)batch->samprate[index] != samprate ) {
+			fprintf(stderr, "pa2ew_batchcheck: %s, the good packet %d is decoded with wrong status!\n", name, index);
+			return 1;
+		}
+		for ( int i = 0; i < setting->nchannel; i++ ) {
+			if ( batch->nsamp[PALERT_BATCH_INDEX( batch, index, i )] != setting->nsamp || batch->starttime[PALERT_BATCH_INDEX( batch, index, i )] != starttime )
+				errors++;
+			if ( memcmp(PALERT_BATCH_DATA_GET( batch, index, i ), Reference + i * setting->nsamp, setting->nsamp * sizeof(int32_t)) )
+				errors++;
+		}
+		if ( errors )
+			fprintf(stderr, "pa2ew_batchcheck: %s, the samples of the good packet %d are different from the reference!\n", name, index);
+		return errors;
+	}
+/* Nothing of the previous batch remains */
+	if ( PALERT_BATCH_BIT_GET( batch->crc_pass, index ) || batch->nchannel[index] || batch->samprate[index] != 0.0 )
+		errors++;
+	for ( int i = 0; i < setting->nchannel; i++ )
+		if ( batch->nsamp[PALERT_BATCH_INDEX( batch, index, i )] || batch->starttime[PALERT_BATCH_INDEX( batch, index, i )] != 0.0 )
+			errors++;
+	if ( errors )
+		fprintf(stderr, "pa2ew_batchcheck: %s, the skipped packet %d (kind %d) still has the stale fields!\n", name, index, kind);
+/*
+ * The CRC mismatched ones are extracted in the same pass, so as the damaged mode 1 ones. And the malformed mode 4
+ * ones fail after the first record.
+ */
+	if ( kind == KIND_CRC || (kind != KIND_MISSING && kind != KIND_OTHER && setting->mode != PALERT_PKT_MODE16) )
+		return errors;
+	for ( int i = 0; i < setting->nchannel; i++ ) {
+		data = PALERT_BATCH_DATA_GET( batch, index, i );
+		for ( int j = 0; j < setting->nsamp; j++ ) {
+			if ( data[j] != CHECK_CANARY ) {
+				fprintf(stderr, "pa2ew_batchcheck: %s, the rows of skipped packet %d (kind %d) are written!\n", name, index, kind);
+				return errors + 1;
+			}
+		}
+	}
+
+	return errors;
+}
@@ -0,0 +1,271 @@
+/**
+ * @file pa2ew_crcbench.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Micro-benchmark & checking of the CRC-16 implementations inside libpalertc, and the slicing-by-8 CRC-8
+ *        of the client mode framing inside palert2ew.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @name Earthworm environment header include
+ *
+ */
+#include <trace_buf.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <libpalertc/libpalertc.h>
+#include <palert2ew.h>
+#include <palert2ew_misc.h>
+
+/**
+ * @name Benchmark constants
+ *
+ */
+#define BENCH_BUFFER_SIZE  PALERT_M16_PACKET_MAX_LENGTH
+#define BENCH_CHECK_SIZE   4096
+#define BENCH_DEF_ROUNDS   2000
+#define BENCH_CRC8_CHECKS  200000
+
+/**
+ * @name Internal functions' prototype
+ *
+ */
+static uint16_t crc16_bitwise( const uint8_t *, size_t );
+static double   bench_crc16( uint16_t (*)( const void *, const size_t ), const size_t, const int );
+static uint16_t crc16_bitwise_wrap( const void *, const size_t );
+static uint8_t  crc8_bitwise( const uint8_t *, size_t );
+static int      check_crc8( void );
+static double   bench_crc8( uint8_t (*)( const void *, const size_t ), const size_t, const int );
+static double   time_now_get( void );
+
+/**
+ * @name Internal static variables
+ *
+ */
+static uint8_t     Buffer[BENCH_BUFFER_SIZE + 16];
+static const char *LevelNames[] = { "tables", "tables", "tables", "clmul", "clmul" };
+
+/**
+ * @brief Usage: pa2ew_crcbench [rounds]
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main( int argc, char **argv )
+{
+	const size_t sizes[] = { 16, 200, 1200, BENCH_BUFFER_SIZE };
+	int          rounds  = argc > 1 ? atoi(argv[1]) : BENCH_DEF_ROUNDS;
+	int          max_level = pac_simd_level_set( -1 );
+	double       time_ref;
+	double       time_used;
+
+/* */
+	if ( rounds <= 0 )
+		rounds = BENCH_DEF_ROUNDS;
+	srand(1);
+	for ( size_t i = 0; i < sizeof(Buffer); i++ )
+		Buffer[i] = rand() & 0xff;
+/* Check every length & alignment against the bitwise one */
+	for ( int level = PALERT_SIMD_NONE; level <= max_level; level = level == PALERT_SIMD_NONE ? max_level : level + 1 ) {
+		pac_simd_level_set( level );
+		for ( size_t i = 0; i < BENCH_CHECK_SIZE; i++ ) {
+			for ( int j = 0; j < 16; j++ ) {
+				if ( pac_crc16_cal( Buffer + j, i ) != crc16_bitwise( Buffer + j, i ) ) {
+					fprintf(stderr, "pa2ew_crcbench: CRC-16 by %s mismatched at length %ld!\n", LevelNames[level], (long)i);
+					return -1;
+				}
+			}
+		}
+		if ( pac_crc16_cal( Buffer, BENCH_BUFFER_SIZE ) != crc16_bitwise( Buffer, BENCH_BUFFER_SIZE ) ) {
+			fprintf(stderr, "pa2ew_crcbench: CRC-16 by %s mismatched at length %d!\n", LevelNames[level], BENCH_BUFFER_SIZE);
+			return -1;
+		}
+		fprintf(stdout, "pa2ew_crcbench: CRC-16 by %s is correct.\n", LevelNames[level]);
+		if ( level == max_level )
+			break;
+	}
+	if ( check_crc8() )
+		return -1;
+/* */
+	for ( size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++ ) {
+		time_ref = bench_crc16( crc16_bitwise_wrap, sizes[i], rounds / 10 + 1 ) * 10.0;
+		fprintf(stdout, "%6ld bytes, bitwise: %10.1f ns\n", (long)sizes[i], time_ref * 1.0e9 / rounds);
+		pac_simd_level_set( PALERT_SIMD_NONE );
+		time_used = bench_crc16( pac_crc16_cal, sizes[i], rounds );
+		fprintf(stdout, "%6ld bytes, tables : %10.1f ns (%.2f GB/s)\n", (long)sizes[i], time_used * 1.0e9 / rounds, sizes[i] * rounds / time_used / 1.0e9);
+		pac_simd_level_set( max_level );
+		time_used = bench_crc16( pac_crc16_cal, sizes[i], rounds );
+		fprintf(
+			stdout, "%6ld bytes, %-7s: %10.1f ns (%.2f GB/s)\n", (long)sizes[i],
+			LevelNames[max_level], time_used * 1.0e9 / rounds, sizes[i] * rounds / time_used / 1.0e9
+		);
+	}
+/* The client mode frames are short, the header is only 16 bytes */
+	for ( size_t i = 0; i < 3; i++ ) {
+		time_used = bench_crc8( pa2ew_crc8_cal, sizes[i], rounds );
+		fprintf(stdout, "%6ld bytes, CRC-8  : %10.1f ns (%.2f GB/s)\n", (long)sizes[i], time_used * 1.0e9 / rounds, sizes[i] * rounds / time_used / 1.0e9);
+	}
+
+	return 0;
+}
+
+/**
+ * @brief The reference CRC-16, bit by bit.
+ *
+ * @param ptr
+ * @param size
+ * @return uint16_t
+ */
+static uint16_t crc16_bitwise( const uint8_t *ptr, size_t size )
+{
+	uint16_t result = 0xFFFF;
+
+/* */
+	while ( size-- ) {
+		result ^= *ptr++;
+		for ( int i = 0; i < 8; i++ )
+			result = (result & 0x01) ? (result >> 1) ^ 0xA001 : result >> 1;
+	}
+
+	return result;
+}
+
+/**
+ * @brief
+ *
+ * @param data
+ * @param size
+ * @return uint16_t
+ */
+static uint16_t crc16_bitwise_wrap( const void *data, const size_t size )
+{
+	return crc16_bitwise( data, size );
+}
+
+/**
+ * @brief The reference CRC-8 of the client mode framing, bit by bit & MSB first.
+ *
+ * @param ptr
+ * @param size
+ * @return uint8_t
+ */
+static uint8_t crc8_bitwise( const uint8_t *ptr, size_t size )
+{
+	uint8_t result = PA2EW_RECV_SERVER_CRC8_INIT;
+
+/* */
+	while ( size-- ) {
+		result ^= *ptr++;
+		for ( int i = 0; i < 8; i++ )
+			result = (result & 0x80) ? (result << 1) ^ PA2EW_RECV_SERVER_CRC8_POLY : result << 1;
+	}
+
+	return result;
+}
+
+/**
+ * @brief Check the slicing-by-8 CRC-8 against the bitwise one: every length up to two rounds of slicing from every
+ *        alignment, then the random lengths & alignments over the whole buffer.
+ *
+ * @return int
+ */
+static int check_crc8( void )
+{
+	size_t offset;
+	size_t length;
+
+/* */
+	for ( size_t i = 0; i <= 2 * PA2EW_CRC8_SLICES + 1; i++ ) {
+		for ( int j = 0; j < 16; j++ ) {
+			if ( pa2ew_crc8_cal( Buffer + j, i ) != crc8_bitwise( Buffer + j, i ) ) {
+				fprintf(stderr, "pa2ew_crcbench: CRC-8 mismatched at length %ld & offset %d!\n", (long)i, j);
+				return -1;
+			}
+		}
+	}
+/* */
+	for ( int i = 0; i < BENCH_CRC8_CHECKS; i++ ) {
+		offset = rand() % 16;
+		length = i & 1 ? (size_t)rand() % 64 : (size_t)rand() % (BENCH_BUFFER_SIZE + 1);
+		if ( pa2ew_crc8_cal( Buffer + offset, length ) != crc8_bitwise( Buffer + offset, length ) ) {
+			fprintf(stderr, "pa2ew_crcbench: CRC-8 mismatched at length %ld & offset %ld!\n", (long)length, (long)offset);
+			return -1;
+		}
+	}
+	fprintf(stdout, "pa2ew_crcbench: CRC-8 by slicing-by-%d is correct.\n", PA2EW_CRC8_SLICES);
+
+	return 0;
+}
+
+/**
+ * @brief
+ *
+ * @param func
+ * @param size
+ * @param rounds
+ * @return double
+ */
+static double bench_crc16( uint16_t (*func)( const void *, const size_t ), const size_t size, const int rounds )
+{
+	volatile uint16_t sink = 0;
+	double            result = time_now_get();
+
+/* */
+	for ( int i = 0; i < rounds; i++ )
+		sink ^= func( Buffer + (i & 0x0f), size );
+	(void)sink;
+
+	return time_now_get() - result;
+}
+
+/**
+ * @brief
+ *
+ * @param func
+ * @param size
+ * @param rounds
+ * @return double
+ */
+static double bench_crc8( uint8_t (*func)( const void *, const size_t ), const size_t size, const int rounds )
+{
+	volatile uint8_t sink = 0;
+	double           result = time_now_get();
+
+/* */
+	for ( int i = 0; i < rounds; i++ )
+		sink ^= func( Buffer + (i & 0x0f), size );
+	(void)sink;
+
+	return time_now_get() - result;
+}
+
+/**
+ * @brief
+ *
+ * @return double
+ */
+static double time_now_get( void )
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
@@ -0,0 +1,736 @@
+/**
+ * @file pa2ew_fwsim.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Stand-in forward server, it multiplexes the synthetic or recorded Palert packets into the FW_PCK stream
+ *        for benchmarking palert2ew in client mode.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <libpalertc/libpalertc.h>
+#include <palert2ew_misc.h>
+#include <pa2ew_synth.h>
+
+/**
+ * @name Simulator constants
+ *
+ */
+#define FWSIM_DEF_PORT         "23000"
+#define FWSIM_DEF_SERIAL       10000
+#define FWSIM_DEF_CHANNELS     3
+#define FWSIM_DEF_REPORT_SEC   10
+#define FWSIM_HEADER_LENGTH    16
+#define FWSIM_OUTPUT_SIZE      (256 * 1024)  /* Packets are gathered & sent together when it's behind schedule */
+#define FWSIM_MAX_GAP          3             /* Max. seq numbers skipped by one gap */
+#define FWSIM_STRATUM_SYNCED   2
+#define FWSIM_STRATUM_UNSYNCED 16
+
+/**
+ * @brief One recorded packet inside the file
+ *
+ */
+typedef struct {
+	const uint8_t *packet;
+	int            length;
+	int            mode;
+	uint32_t       serial;
+} FWSIM_RECORD;
+
+/**
+ * @name Internal functions' prototype
+ *
+ */
+static int    parse_args( int, char ** );
+static void   usage( const char * );
+static int    stations_init( void );
+static int    records_load( const char * );
+static int    serial_compare( const void *, const void * );
+static int    listen_sock_construct( void );
+static void   stream_session( const int );
+static int    stream_packet_append( uint8_t *, const int, const int, const uint8_t *, const int, const uint32_t, const int );
+static int    stream_flush( const int, uint8_t *, int * );
+static int    send_all( const int, const uint8_t *, const int );
+static double rand_uniform( void );
+static void   report_print( const double, const int );
+static double time_now_get( void );
+static double time_real_get( void );
+static void   sleep_until( const double );
+static void   handle_terminate( int );
+
+/**
+ * @name Internal static variables
+ *
+ */
+static const char   *Port          = FWSIM_DEF_PORT;
+static const char   *ListFile      = NULL;
+static const char   *RecordFile    = NULL;
+static int           Mode          = PALERT_PKT_MODE1;
+static int           NumStations   = 1;
+static uint32_t      SerialBase    = FWSIM_DEF_SERIAL;
+static int           SampRate      = PALERT_DEFAULT_SAMPRATE;
+static int           PacketRate    = 1;     /* Packets per second of mode 4 & 16 for each station */
+static int           NumChannels   = FWSIM_DEF_CHANNELS;
+static double        UnsyncRatio   = 0.0;
+static double        AggregateRate = 0.0;   /* 0 for the real-time rate & negative for as fast as possible */
+static double        GapRatio      = 0.0;
+static double        CRCErrorRatio = 0.0;
+static double        KeepAliveSec  = 0.0;
+static int           TZOffset      = 0;
+static double        Duration      = 0.0;
+static int           ReportSec     = FWSIM_DEF_REPORT_SEC;
+static int           MaxSessions   = 0;
+/* Derived from the above */
+static double        PacketPeriod  = 1.0;
+static int           PacketLength  = PALERT_M1_PACKET_LENGTH;
+static double        StartReal     = 0.0;   /* Calendar time of the first data window */
+static double        TimeStart     = 0.0;
+/* */
+static PA2EW_SYNTH  *Stations      = NULL;
+static uint8_t      *RecordData    = NULL;
+static FWSIM_RECORD *Records       = NULL;
+static int           NumRecords    = 0;
+static uint64_t      RandState     = 0x9e3779b97f4a7c15ULL;
+static volatile sig_atomic_t Terminate = 0;
+/* Counters */
+static uint64_t      PacketCount    = 0;
+static uint64_t      ByteCount      = 0;
+static uint64_t      GapCount       = 0;
+static uint64_t      CRCErrorCount  = 0;
+static uint64_t      KeepAliveCount = 0;
+static uint64_t      SessionCount   = 0;
+
+/**
+ * @brief Usage: pa2ew_fwsim [options], see usage() for the options.
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main( int argc, char **argv )
+{
+	struct pollfd pfd;
+	int           ret;
+	int           sock;
+
+/* */
+	if ( (ret = parse_args( argc, argv )) )
+		return ret < 0 ? -1 : 0;
+	if ( RecordFile ? records_load( RecordFile ) : stations_init() )
+		return -1;
+	if ( ListFile && !RecordFile && pa2ew_synth_list_write( ListFile, Mode, SerialBase, NumStations, NumChannels ) )
+		return -1;
+/* */
+	signal(SIGINT, handle_terminate);
+	signal(SIGTERM, handle_terminate);
+	signal(SIGPIPE, SIG_IGN);
+	if ( (pfd.fd = listen_sock_construct()) < 0 )
+		return -1;
+	pfd.events = POLLIN;
+	printf("Waiting for palert2ew on port %s...\n", Port);
+/* Serve one client at a time, just like the real forward server for one palert2ew */
+	TimeStart = time_now_get();
+	while ( !Terminate && (!MaxSessions || SessionCount < (uint64_t)MaxSessions) ) {
+		if ( Duration > 0.0 && time_now_get() - TimeStart >= Duration )
+			break;
+		if ( poll(&pfd, 1, 200) <= 0 || (sock = accept(pfd.fd, NULL, NULL)) < 0 )
+			continue;
+		SessionCount++;
+		printf("Client connected, session #%lu started.\n", (unsigned long)SessionCount);
+		stream_session( sock );
+		close(sock);
+		printf("Session #%lu ended.\n", (unsigned long)SessionCount);
+	}
+	close(pfd.fd);
+	report_print( time_now_get() - TimeStart, 1 );
+/* */
+	free(Stations);
+	free(Records);
+	free(RecordData);
+
+	return 0;
+}
+
+/**
+ * @brief
+ *
+ * @param argc
+ * @param argv
+ * @return int 0 for going on, 1 for the usage only & -1 for the wrong arguments.
+ */
+static int parse_args( int argc, char **argv )
+{
+	int opt;
+
+/* */
+	while ( (opt = getopt(argc, argv, "p:m:n:s:S:r:c:u:R:A:g:x:k:z:d:i:N:l:h")) != -1 ) {
+		switch ( opt ) {
+		case 'p': Port          = optarg; break;
+		case 'm': Mode          = atoi(optarg); break;
+		case 'n': NumStations   = atoi(optarg); break;
+		case 's': SerialBase    = strtoul(optarg, NULL, 10); break;
+		case 'S': SampRate      = atoi(optarg); break;
+		case 'r': PacketRate    = atoi(optarg); break;
+		case 'c': NumChannels   = atoi(optarg); break;
+		case 'u': UnsyncRatio   = atof(optarg); break;
+		case 'R': RecordFile    = optarg; break;
+		case 'A': AggregateRate = atof(optarg); break;
+		case 'g': GapRatio      = atof(optarg); break;
+		case 'x': CRCErrorRatio = atof(optarg); break;
+		case 'k': KeepAliveSec  = atof(optarg); break;
+		case 'z': TZOffset      = atoi(optarg); break;
+		case 'd': Duration      = atof(optarg); break;
+		case 'i': ReportSec     = atoi(optarg); break;
+		case 'N': MaxSessions   = atoi(optarg); break;
+		case 'l': ListFile      = optarg; break;
+		case 'h':
+			usage( argv[0] );
+			return 1;
+		default:
+			usage( argv[0] );
+			return -1;
+		}
+	}
+/* */
+	if ( NumStations <= 0 || SampRate <= 0 || PacketRate <= 0 || TZOffset < -12 || TZOffset > 14 ) {
+		fprintf(stderr, "The stations, the sampling rate & the packet rate should be positive, the time zone should be -12~14!\n");
+		return -1;
+	}
+/* Always 100 samples of 5 channels in mode 1, so the packet rate follows the sampling rate */
+	if ( Mode == PALERT_PKT_MODE1 ) {
+		PacketPeriod = (double)PALERT_M1_SAMPLE_NUMBER / SampRate;
+	}
+	else if ( SampRate % PacketRate ) {
+		fprintf(stderr, "The sampling rate should be a multiple of the packet rate!\n");
+		return -1;
+	}
+	else {
+		PacketPeriod = 1.0 / PacketRate;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief
+ *
+ * @param prog
+ */
+static void usage( const char *prog )
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -p <port>      Listening port, it should be the ServerPort of palert2ew, default is %s\n"
+		"  -m <mode>      Packet mode of the synthetic Palerts, 1, 4 or 16, default is 1\n"
+		"  -n <number>    Number of the synthetic Palerts, default is 1\n"
+		"  -s <serial>    Serial of the first synthetic Palert, the others follow it, default is %d\n"
+		"  -S <rate>      Sampling rate, mode 1 always carries 100 samples in one packet, default is %d\n"
+		"  -r <rate>      Packets per second of mode 4 & 16 for each Palert, default is 1\n"
+		"  -c <number>    Channels of mode 4 & 16, or listed channels of mode 1, default is %d\n"
+		"  -u <ratio>     Ratio of the synthetic Palerts without NTP synchronization, default is 0\n"
+		"  -R <file>      Recorded packets (raw Palert packets one after another) instead of the synthetic ones\n"
+		"  -A <rate>      Aggregate packets per second, 0 for the real-time rate & negative for as fast as possible,\n"
+		"                 default is 0 (one packet per second for each Palert of the recorded packets)\n"
+		"  -g <ratio>     Ratio of the packets behind a seq gap, default is 0\n"
+		"  -x <ratio>     Ratio of the packets with a corrupted FW_PCK header (CRC8 error), default is 0\n"
+		"  -k <seconds>   Interval of the keep-alive packets, default is 0 (off)\n"
+		"  -z <hours>     Time zone offset in the FW_PCK header, default is 0\n"
+		"  -d <seconds>   Duration of the simulation, default is 0 (until SIGINT or SIGTERM)\n"
+		"  -N <number>    Sessions to serve before exiting, default is 0 (unlimited)\n"
+		"  -i <seconds>   Interval of the report, 0 for the final one only, default is %d\n"
+		"  -l <file>      Write the station list of the synthetic Palerts into the file\n",
+		prog, FWSIM_DEF_PORT, FWSIM_DEF_SERIAL, PALERT_DEFAULT_SAMPRATE, FWSIM_DEF_CHANNELS, FWSIM_DEF_REPORT_SEC
+	);
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @return int
+ */
+static int stations_init( void )
+{
+/* */
+	if ( !(Stations = calloc(NumStations, sizeof(PA2EW_SYNTH))) ) {
+		fprintf(stderr, "Error allocating the stations!\n");
+		return -1;
+	}
+/* */
+	for ( int i = 0; i < NumStations; i++ ) {
+		if ( (PacketLength = pa2ew_synth_init( Stations + i, Mode, i, SerialBase + i, SampRate, SampRate / PacketRate, NumChannels )) < 0 ) {
+			fprintf(
+				stderr, "Only mode 1, 4 & 16 are supported, the serial of mode 1 & 4 is only 16 bits, the channels should be 1~%d & the packet should be less than %d bytes!\n",
+				PA2EW_SYNTH_MAX_CHANNELS, PALERT_M16_PACKET_MAX_LENGTH
+			);
+			return -1;
+		}
+		Stations[i].ntp_synced = rand_uniform() >= UnsyncRatio;
+	}
+	NumChannels = Stations[0].nchannel;
+/* The data windows of the first packets have just ended */
+	StartReal = floor(time_real_get() - PacketPeriod);
+/* The natural aggregate rate of the real-time stream */
+	if ( AggregateRate == 0.0 )
+		AggregateRate = NumStations / PacketPeriod;
+	printf(
+		"Simulating %d Palerts of mode %d (serial %u~%u), %d bytes every %.3f seconds for each.\n",
+		NumStations, Mode, SerialBase, SerialBase + NumStations - 1, PacketLength, PacketPeriod
+	);
+
+	return 0;
+}
+
+/**
+ * @brief Load the raw Palert packets one after another, the garbage between them is skipped.
+ *
+ * @param path
+ * @return int
+ */
+static int records_load( const char *path )
+{
+	FILE    *fp = fopen(path, "rb");
+	long     size;
+	long     offset = 0;
+	int      length;
+	int      skipped = 0;
+	uint32_t *serials;
+
+/* */
+	if ( !fp ) {
+		fprintf(stderr, "Error opening the recorded packets %s: %s!\n", path, strerror(errno));
+		return -1;
+	}
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	rewind(fp);
+	if ( size <= 0 || !(RecordData = malloc(size)) || fread(RecordData, 1, size, fp) != (size_t)size ) {
+		fprintf(stderr, "Error reading the recorded packets %s!\n", path);
+		fclose(fp);
+		return -1;
+	}
+	fclose(fp);
+/* The mode 1 sync. characters are the farthest, so there should be a whole header at least */
+	for ( ; size - offset >= PALERT_M1_HEADER_LENGTH; offset += length ) {
+		const uint8_t *packet = RecordData + offset;
+		const int      mode   = pac_mode_get( packet );
+
+		switch ( mode ) {
+		case PALERT_PKT_MODE1:
+			length = PALERT_M1_PACKET_LENGTH;
+			break;
+		case PALERT_PKT_MODE2:
+			length = PALERT_M2_PACKET_LENGTH;
+			break;
+		case PALERT_PKT_MODE4:
+			length = PALERT_M4_PACKETLEN_GET( (PALERT_M4_HEADER *)packet );
+			break;
+		case PALERT_PKT_MODE16:
+			length = PALERT_M16_PACKETLEN_GET( (PALERT_M16_HEADER *)packet );
+			break;
+		default:
+			length = 0;
+			break;
+		}
+	/* */
+		if ( length <= 0 || length > size - offset ) {
+			skipped++;
+			length = 1;
+			continue;
+		}
+		if ( !(NumRecords & (NumRecords + 1)) ) {
+			FWSIM_RECORD *_records = realloc(Records, (NumRecords + 1) * 2 * sizeof(FWSIM_RECORD));
+
+			if ( !_records ) {
+				fprintf(stderr, "Error allocating the recorded packets!\n");
+				return -1;
+			}
+			Records = _records;
+		}
+		Records[NumRecords].packet = packet;
+		Records[NumRecords].length = length;
+		Records[NumRecords].mode   = mode == PALERT_PKT_MODE2 ? PALERT_PKT_MODE1 : mode;
+		Records[NumRecords].serial = pac_serial_get( packet );
+		NumRecords++;
+	}
+/* */
+	if ( !NumRecords ) {
+		fprintf(stderr, "There is no Palert packet inside %s!\n", path);
+		return -1;
+	}
+/* Count the distinct serials for the default rate */
+	if ( !(serials = malloc(NumRecords * sizeof(uint32_t))) ) {
+		fprintf(stderr, "Error allocating the recorded packets!\n");
+		return -1;
+	}
+	for ( int i = 0; i < NumRecords; i++ )
+		serials[i] = Records[i].serial;
+	qsort(serials, NumRecords, sizeof(uint32_t), serial_compare);
+	NumStations = 1;
+	for ( int i = 1; i < NumRecords; i++ )
+		if ( serials[i] != serials[i - 1] )
+			NumStations++;
+	free(serials);
+	if ( AggregateRate == 0.0 )
+		AggregateRate = NumStations;
+	printf(
+		"Loaded %d packets of %d Palerts from %s, %d bytes of garbage skipped.\n",
+		NumRecords, NumStations, path, skipped
+	);
+
+	return 0;
+}
+
+/**
+ * @brief
+ *
+ * @param a
+ * @param b
+ * @return int
+ */
+static int serial_compare( const void *a, const void *b )
+{
+	const uint32_t _a = *(const uint32_t *)a;
+	const uint32_t _b = *(const uint32_t *)b;
+
+	return _a < _b ? -1 : _a > _b ? 1 : 0;
+}
+
+/**
+ * @brief
+ *
+ * @return int
+ */
+static int listen_sock_construct( void )
+{
+	struct addrinfo  hints;
+	struct addrinfo *servinfo, *p;
+	int              sock     = -1;
+	int              sock_opt = 1;
+
+/* */
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family   = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags    = AI_PASSIVE;
+	if ( getaddrinfo(NULL, Port, &hints, &servinfo) ) {
+		fprintf(stderr, "Error getting the address of port %s!\n", Port);
+		return -1;
+	}
+/* */
+	for ( p = servinfo; p != NULL; p = p->ai_next ) {
+		if ( (sock = socket(p->ai_family, p->ai_socktype, p->ai_protocol)) < 0 )
+			continue;
+		setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &sock_opt, sizeof(sock_opt));
+		if ( bind(sock, p->ai_addr, p->ai_addrlen) == 0 && listen(sock, 1) == 0 )
+			break;
+		close(sock);
+		sock = -1;
+	}
+	freeaddrinfo(servinfo);
+	if ( sock < 0 )
+		fprintf(stderr, "Error listening on port %s: %s!\n", Port, strerror(errno));
+
+	return sock;
+}
+
+/**
+ * @brief Stream the packets to the client until it's gone. The seq restarts from zero in each session, but the
+ *        data time of the synthetic packets keeps going.
+ *
+ * @param sock
+ */
+static void stream_session( const int sock )
+{
+	static uint64_t packet_index = 0;  /* Over all the sessions, for the data time */
+
+	uint8_t *output = malloc(FWSIM_OUTPUT_SIZE + FWSIM_HEADER_LENGTH + PALERT_M16_PACKET_MAX_LENGTH);
+	uint8_t *packet = malloc(PALERT_M16_PACKET_MAX_LENGTH);
+	int      out_len = 0;
+	uint32_t seq     = 0;
+	uint64_t nsent   = 0;
+	double   time_session = time_now_get();
+	double   time_keepalive = time_session;
+	double   time_report = time_session + ReportSec;
+	double   time_now;
+	double   due;
+	int      length;
+	int      flags;
+	uint32_t serial;
+	int      mode;
+
+/* */
+	if ( !output || !packet ) {
+		fprintf(stderr, "Error allocating the output buffer!\n");
+		goto end;
+	}
+/* */
+	while ( !Terminate ) {
+		time_now = time_now_get();
+		if ( Duration > 0.0 && time_now - TimeStart >= Duration )
+			break;
+		if ( ReportSec > 0 && time_now >= time_report ) {
+			report_print( time_now - TimeStart, 0 );
+			time_report += ReportSec;
+		}
+	/* The keep-alive packet has no payload & the serial of it is zero, but it still takes a seq */
+		if ( KeepAliveSec > 0.0 && time_now - time_keepalive >= KeepAliveSec ) {
+			out_len += stream_packet_append( output + out_len, 0, 0, NULL, 0, seq++, 0 );
+			time_keepalive = time_now;
+			KeepAliveCount++;
+		}
+	/* Send the gathered packets before waiting, the gathering only happens when it's behind schedule */
+		due = AggregateRate > 0.0 ? time_session + nsent / AggregateRate : time_now;
+		if ( due > time_now || out_len >= FWSIM_OUTPUT_SIZE ) {
+			if ( stream_flush( sock, output, &out_len ) )
+				break;
+			if ( due > time_now ) {
+				sleep_until( due - time_now > 0.2 ? time_now + 0.2 : due );
+				continue;
+			}
+		}
+	/* */
+		if ( Records ) {
+			const FWSIM_RECORD *record = Records + (packet_index % NumRecords);
+
+			memcpy(packet, record->packet, record->length);
+			length = record->length;
+			serial = record->serial;
+			mode   = record->mode;
+		}
+		else {
+			PA2EW_SYNTH *synth = Stations + (packet_index % NumStations);
+
+		/* The system time of mode 1 is in the local time of the time zone offset */
+			length = pa2ew_synth_packet_build(
+				synth, packet,
+				StartReal + (packet_index / NumStations) * PacketPeriod + (Mode == PALERT_PKT_MODE1 ? TZOffset * 3600.0 : 0.0)
+			);
+			serial = synth->serial;
+			mode   = synth->mode;
+		}
+		packet_index++;
+		nsent++;
+	/* Skip some seq numbers, palert2ew should take it after the CRC8 check */
+		flags = 0;
+		if ( GapRatio > 0.0 && rand_uniform() < GapRatio ) {
+			seq += 1 + (uint32_t)(pa2ew_synth_rand( &RandState ) % FWSIM_MAX_GAP);
+			GapCount++;
+		}
+		if ( CRCErrorRatio > 0.0 && rand_uniform() < CRCErrorRatio ) {
+			flags = 0x01;
+			CRCErrorCount++;
+		}
+	/* The stratum follows the NTP flag of the packet */
+		out_len += stream_packet_append(
+			output + out_len, serial, mode, packet, length, seq++, flags | (pac_ntp_sync_check( packet ) ? 0x02 : 0x00)
+		);
+		PacketCount++;
+	}
+/* */
+	stream_flush( sock, output, &out_len );
+end:
+	free(output);
+	free(packet);
+
+	return;
+}
+
+/**
+ * @brief Append the FW_PCK header & the packet, the fields of the header are in little-endian.
+ *
+ * @param output
+ * @param serial
+ * @param mode
+ * @param packet
+ * @param length
+ * @param seq
+ * @param flags Bit 0 for corrupting the header after the CRC8, bit 1 for the NTP synchronized packet.
+ * @return int
+ */
+static int stream_packet_append(
+	uint8_t *output, const int serial, const int mode, const uint8_t *packet, const int length, const uint32_t seq, const int flags
+) {
+/* */
+	output[0]  = serial & 0xff;
+	output[1]  = (serial >> 8) & 0xff;
+	output[2]  = length & 0xff;
+	output[3]  = (length >> 8) & 0xff;
+	output[4]  = seq & 0xff;
+	output[5]  = (seq >> 8) & 0xff;
+	output[6]  = (seq >> 16) & 0xff;
+	output[7]  = (seq >> 24) & 0xff;
+	output[8]  = mode & 0xff;
+	output[9]  = (mode >> 8) & 0xff;
+	output[10] = output[11] = output[12] = 0;
+	output[13] = (uint8_t)(int8_t)TZOffset;
+	output[14] = flags & 0x02 ? FWSIM_STRATUM_SYNCED : FWSIM_STRATUM_UNSYNCED;
+	output[15] = pa2ew_crc8_cal( output, FWSIM_HEADER_LENGTH - 1 );
+/* Palert2ew only checks the CRC8 when the seq is unexpected, so the corrupted one is the seq */
+	if ( flags & 0x01 )
+		output[7] ^= 0x5a;
+/* */
+	if ( length > 0 )
+		memcpy(output + FWSIM_HEADER_LENGTH, packet, length);
+	ByteCount += FWSIM_HEADER_LENGTH + length;
+
+	return FWSIM_HEADER_LENGTH + length;
+}
+
+/**
+ * @brief
+ *
+ * @param sock
+ * @param output
+ * @param out_len
+ * @return int
+ */
+static int stream_flush( const int sock, uint8_t *output, int *out_len )
+{
+	int result = 0;
+
+/* */
+	if ( *out_len > 0 && send_all( sock, output, *out_len ) ) {
+		printf("Error sending to the client: %s!\n", strerror(errno));
+		result = -1;
+	}
+	*out_len = 0;
+
+	return result;
+}
+
+/**
+ * @brief
+ *
+ * @param sock
+ * @param buffer
+ * @param length
+ * @return int
+ */
+static int send_all( const int sock, const uint8_t *buffer, const int length )
+{
+	ssize_t ret;
+
+	for ( int sent = 0; sent < length; sent += ret ) {
+		if ( (ret = send(sock, buffer + sent, length - sent, MSG_NOSIGNAL)) <= 0 ) {
+			if ( ret < 0 && errno == EINTR && !Terminate ) {
+				ret = 0;
+				continue;
+			}
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief
+ *
+ * @return double Within [0, 1)
+ */
+static double rand_uniform( void )
+{
+	return (pa2ew_synth_rand( &RandState ) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @brief
+ *
+ * @param elapsed
+ * @param final
+ */
+static void report_print( const double elapsed, const int final )
+{
+	printf(
+		"%s %.1f sec: %lu packets (%.1f/sec), %.2f MB (%.2f MB/sec), %lu gaps, %lu CRC8 errors, %lu keep-alives in %lu sessions.\n",
+		final ? "Total" : "Elapsed", elapsed, (unsigned long)PacketCount, elapsed > 0.0 ? PacketCount / elapsed : 0.0,
+		ByteCount / 1048576.0, elapsed > 0.0 ? ByteCount / 1048576.0 / elapsed : 0.0,
+		(unsigned long)GapCount, (unsigned long)CRCErrorCount, (unsigned long)KeepAliveCount, (unsigned long)SessionCount
+	);
+	fflush(stdout);
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @return double
+ */
+static double time_now_get( void )
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
+
+/**
+ * @brief
+ *
+ * @return double
+ */
+static double time_real_get( void )
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
+
+/**
+ * @brief
+ *
+ * @param time_mono
+ */
+static void sleep_until( const double time_mono )
+{
+	struct timespec ts;
+
+	ts.tv_sec  = (time_t)time_mono;
+	ts.tv_nsec = (long)((time_mono - ts.tv_sec) * 1.0e9);
+	while ( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR && !Terminate );
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param sig
+ */
+static void handle_terminate( int sig )
+{
+	Terminate = 1;
+
+	return;
+}
@@ -0,0 +1,695 @@
+/**
+ * @file pa2ew_loadgen.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Synthetic Palert load generator for the capacity testing of palert2ew running as the server of Palert.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <libpalertc/libpalertc.h>
+#include <pa2ew_synth.h>
+
+/**
+ * @name Load generator constants
+ *
+ */
+#define LOADGEN_DEF_PORT           "502"
+#define LOADGEN_DEF_SERIAL         10000
+#define LOADGEN_DEF_CHANNELS       3
+#define LOADGEN_DEF_REPORT_SEC     10
+#define LOADGEN_MAX_THREADS        64
+#define LOADGEN_MAX_FRAGMENTS      16
+#define LOADGEN_FRAGMENT_GAP       0.001  /* Seconds between the fragments of the same packet */
+#define LOADGEN_RECONNECT_SEC      1.0
+
+/**
+ * @brief The simulated Palert, owned by one sending thread
+ *
+ */
+typedef struct {
+	int         sock;
+	int         index;
+	int         fresh;         /* The next packet is the first one of this connection */
+	PA2EW_SYNTH synth;
+	uint64_t    seq;           /* Index of the next packet since the start */
+	double      due;           /* Monotonic time of the next sending event */
+	double      packet_due;    /* Monotonic time of the next packet */
+	int         frag_count;
+	int         frag_next;
+	int         frag_ends[LOADGEN_MAX_FRAGMENTS];
+	uint8_t    *packet;
+} LOADGEN_CONN;
+
+/**
+ * @brief The sending thread & its counters, only the owner thread writes them
+ *
+ */
+typedef struct {
+	pthread_t      tid;
+	LOADGEN_CONN **heap;     /* Min-heap of the connections ordered by the due time */
+	int            nheap;
+	uint64_t       rand_state;
+	uint64_t       packets;
+	uint64_t       bytes;
+	uint64_t       corrupted;
+	uint64_t       late;
+	uint64_t       errors;
+	uint64_t       connects;
+} LOADGEN_THREAD;
+
+/**
+ * @name Internal functions' prototype
+ *
+ */
+static int      parse_args( int, char ** );
+static void     usage( const char * );
+static void    *thread_sender( void * );
+static void     conn_event( LOADGEN_THREAD *, LOADGEN_CONN *, const double );
+static int      conn_connect( LOADGEN_CONN * );
+static int      send_all( const int, const uint8_t *, const int );
+static void     fragment_plan( LOADGEN_THREAD *, LOADGEN_CONN *, const int );
+static void     heap_push( LOADGEN_THREAD *, LOADGEN_CONN * );
+static LOADGEN_CONN *heap_pop( LOADGEN_THREAD * );
+static uint64_t rand_next( LOADGEN_THREAD * );
+static double   rand_uniform( LOADGEN_THREAD * );
+static void     report_print( const double, const int );
+static double   time_now_get( void );
+static double   time_real_get( void );
+static void     sleep_until( const double );
+static void     handle_terminate( int );
+
+/**
+ * @name Internal static variables
+ *
+ */
+static const char     *Host          = NULL;
+static const char     *Port          = LOADGEN_DEF_PORT;
+static const char     *ListFile      = NULL;
+static int             Mode          = PALERT_PKT_MODE1;
+static int             NumConns      = 1;
+static int             NumThreads    = 1;
+static uint32_t        SerialBase    = LOADGEN_DEF_SERIAL;
+static int             SampRate      = PALERT_DEFAULT_SAMPRATE;
+static int             PacketRate    = 1;     /* Packets per second of mode 4 & 16 */
+static int             NumChannels   = LOADGEN_DEF_CHANNELS;
+static double          JitterSec     = 0.0;
+static int             MaxFragments  = 1;
+static double          CorruptRatio  = 0.0;
+static double          UnsyncRatio   = 0.0;
+static double          Duration      = 0.0;
+static int             ReportSec     = LOADGEN_DEF_REPORT_SEC;
+/* Derived from the above */
+static double          PacketPeriod  = 1.0;
+static int             PacketLength  = PALERT_M1_PACKET_LENGTH;
+static double          StartMono     = 0.0;   /* Monotonic time of the first data window */
+static double          StartReal     = 0.0;   /* Calendar time of the first data window */
+/* */
+static LOADGEN_CONN   *Conns         = NULL;
+static LOADGEN_THREAD *Threads       = NULL;
+static volatile sig_atomic_t Terminate = 0;
+
+/**
+ * @brief Usage: pa2ew_loadgen [options] <host>, see usage() for the options.
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main( int argc, char **argv )
+{
+	double time_start;
+	double time_next_report;
+	double time_now;
+	int    ret;
+
+/* */
+	if ( (ret = parse_args( argc, argv )) )
+		return ret < 0 ? -1 : 0;
+/* The station list matches the generated serials, so it can be loaded by palert2ew directly */
+	if ( ListFile && pa2ew_synth_list_write( ListFile, Mode, SerialBase, NumConns, NumChannels ) )
+		return -1;
+	if ( !Host )
+		return 0;
+/* */
+	signal(SIGINT, handle_terminate);
+	signal(SIGTERM, handle_terminate);
+	signal(SIGPIPE, SIG_IGN);
+/* */
+	Conns   = calloc(NumConns, sizeof(LOADGEN_CONN));
+	Threads = calloc(NumThreads, sizeof(LOADGEN_THREAD));
+	if ( !Conns || !Threads ) {
+		fprintf(stderr, "Error allocating the connections!\n");
+		return -1;
+	}
+/* The first data window starts at the next whole second */
+	StartReal = floor(time_real_get()) + 1.0;
+	StartMono = time_now_get() + (StartReal - time_real_get());
+	for ( int i = 0; i < NumThreads; i++ ) {
+		Threads[i].rand_state = 0x9e3779b97f4a7c15ULL * (i + 1);
+		if ( !(Threads[i].heap = calloc(NumConns / NumThreads + 1, sizeof(LOADGEN_CONN *))) ) {
+			fprintf(stderr, "Error allocating the connections!\n");
+			return -1;
+		}
+	}
+	for ( int i = 0; i < NumConns; i++ ) {
+		LOADGEN_CONN   *conn   = Conns + i;
+		LOADGEN_THREAD *thread = Threads + (i % NumThreads);
+
+		conn->sock       = -1;
+		conn->index      = i;
+		pa2ew_synth_init( &conn->synth, Mode, i, SerialBase + i, SampRate, SampRate / PacketRate, NumChannels );
+		conn->synth.ntp_synced = rand_uniform( thread ) >= UnsyncRatio;
+	/* Spread the connections over the packet period, the real Palerts won't send at the same moment */
+		conn->packet_due = StartMono + PacketPeriod + PacketPeriod * i / NumConns;
+		conn->due        = conn->packet_due;
+		if ( !(conn->packet = malloc(PacketLength)) ) {
+			fprintf(stderr, "Error allocating the packet buffers!\n");
+			return -1;
+		}
+		heap_push( thread, conn );
+	}
+/* */
+	printf(
+		"Generating mode %d packets to %s:%s with %d connections (serial %u~%u) in %d threads, %d bytes every %.3f seconds for each.\n",
+		Mode, Host, Port, NumConns, SerialBase, SerialBase + NumConns - 1, NumThreads, PacketLength, PacketPeriod
+	);
+	for ( int i = 0; i < NumThreads; i++ ) {
+		if ( pthread_create(&Threads[i].tid, NULL, thread_sender, Threads + i) ) {
+			fprintf(stderr, "Error creating the sending thread!\n");
+			Terminate = 1;
+			NumThreads = i;
+			break;
+		}
+	}
+/* */
+	time_start       = time_now_get();
+	time_next_report = time_start + ReportSec;
+	while ( !Terminate ) {
+		sleep_until( time_now_get() + 0.2 );
+		time_now = time_now_get();
+		if ( Duration > 0.0 && time_now - time_start >= Duration )
+			Terminate = 1;
+		if ( ReportSec > 0 && time_now >= time_next_report ) {
+			report_print( time_now - time_start, 0 );
+			time_next_report += ReportSec;
+		}
+	}
+/* */
+	for ( int i = 0; i < NumThreads; i++ )
+		pthread_join(Threads[i].tid, NULL);
+	report_print( time_now_get() - time_start, 1 );
+/* */
+	for ( int i = 0; i < NumConns; i++ ) {
+		if ( Conns[i].sock >= 0 )
+			close(Conns[i].sock);
+		free(Conns[i].packet);
+	}
+	for ( int i = 0; i < NumThreads; i++ )
+		free(Threads[i].heap);
+	free(Conns);
+	free(Threads);
+
+	return 0;
+}
+
+/**
+ * @brief
+ *
+ * @param argc
+ * @param argv
+ * @return int 0 for going on, 1 for the usage only & -1 for the wrong arguments.
+ */
+static int parse_args( int argc, char **argv )
+{
+	PA2EW_SYNTH synth;
+	int         opt;
+
+/* */
+	while ( (opt = getopt(argc, argv, "p:m:n:t:s:S:r:c:j:f:e:u:d:l:i:h")) != -1 ) {
+		switch ( opt ) {
+		case 'p': Port         = optarg; break;
+		case 'm': Mode         = atoi(optarg); break;
+		case 'n': NumConns     = atoi(optarg); break;
+		case 't': NumThreads   = atoi(optarg); break;
+		case 's': SerialBase   = strtoul(optarg, NULL, 10); break;
+		case 'S': SampRate     = atoi(optarg); break;
+		case 'r': PacketRate   = atoi(optarg); break;
+		case 'c': NumChannels  = atoi(optarg); break;
+		case 'j': JitterSec    = atof(optarg) / 1000.0; break;
+		case 'f': MaxFragments = atoi(optarg); break;
+		case 'e': CorruptRatio = atof(optarg); break;
+		case 'u': UnsyncRatio  = atof(optarg); break;
+		case 'd': Duration     = atof(optarg); break;
+		case 'l': ListFile     = optarg; break;
+		case 'i': ReportSec    = atoi(optarg); break;
+		case 'h':
+			usage( argv[0] );
+			return 1;
+		default:
+			usage( argv[0] );
+			return -1;
+		}
+	}
+	Host = optind < argc ? argv[optind] : NULL;
+	if ( !Host && !ListFile ) {
+		usage( argv[0] );
+		return -1;
+	}
+/* */
+	if ( NumConns <= 0 || NumThreads <= 0 || NumThreads > LOADGEN_MAX_THREADS ) {
+		fprintf(stderr, "The number of connections should be positive & the threads should be 1~%d!\n", LOADGEN_MAX_THREADS);
+		return -1;
+	}
+	NumThreads = NumThreads > NumConns ? NumConns : NumThreads;
+	if ( SampRate <= 0 || SampRate > PALERT_MAX_SAMPRATE || PacketRate <= 0 || MaxFragments < 1 || MaxFragments > LOADGEN_MAX_FRAGMENTS ) {
+		fprintf(
+			stderr, "The sampling rate should be 1~%d, the packet rate should be positive & the fragments should be 1~%d!\n",
+			PALERT_MAX_SAMPRATE, LOADGEN_MAX_FRAGMENTS
+		);
+		return -1;
+	}
+/* Always 100 samples of 5 channels in mode 1, so the packet rate follows the sampling rate */
+	if ( Mode == PALERT_PKT_MODE1 ) {
+		PacketPeriod = (double)PALERT_M1_SAMPLE_NUMBER / SampRate;
+	}
+	else if ( SampRate % PacketRate ) {
+		fprintf(stderr, "The sampling rate should be a multiple of the packet rate!\n");
+		return -1;
+	}
+	else {
+		PacketPeriod = 1.0 / PacketRate;
+	}
+/* Just try the last one, the serial of it is the largest */
+	if ( (PacketLength = pa2ew_synth_init( &synth, Mode, 0, SerialBase + NumConns - 1, SampRate, SampRate / PacketRate, NumChannels )) < 0 ) {
+		fprintf(
+			stderr, "Only mode 1, 4 & 16 are supported, the serial of mode 1 & 4 is only 16 bits, the channels should be 1~%d & the packet should be less than %d bytes!\n",
+			PA2EW_SYNTH_MAX_CHANNELS, PALERT_M16_PACKET_MAX_LENGTH
+		);
+		return -1;
+	}
+	NumChannels = synth.nchannel;
+
+	return 0;
+}
+
+/**
+ * @brief
+ *
+ * @param prog
+ */
+static void usage( const char *prog )
+{
+	fprintf(stderr,
+		"Usage: %s [options] <host>\n"
+		"  -p <port>      Port of palert2ew as the server of Palert, default is %s\n"
+		"  -m <mode>      Packet mode, 1, 4 or 16, default is 1\n"
+		"  -n <number>    Number of the simulated Palerts (TCP connections), default is 1\n"
+		"  -t <number>    Number of the sending threads, default is 1\n"
+		"  -s <serial>    Serial of the first Palert, the others follow it, default is %d\n"
+		"  -S <rate>      Sampling rate, mode 1 always sends 100 samples in one packet, default is %d\n"
+		"  -r <rate>      Packets per second of mode 4 & 16, default is 1\n"
+		"  -c <number>    Channels of mode 4 & 16, or listed channels of mode 1, default is %d\n"
+		"  -j <msec>      Max. random delay of each packet, default is 0\n"
+		"  -f <number>    Max. fragments of each packet, default is 1\n"
+		"  -e <ratio>     Ratio of the packets with a corrupted byte in the data (CRC failure), default is 0\n"
+		"  -u <ratio>     Ratio of the Palerts without NTP synchronization, default is 0\n"
+		"  -d <seconds>   Duration of the test, default is 0 (until SIGINT or SIGTERM)\n"
+		"  -l <file>      Write the matching station list into the file, it can be used without the host\n"
+		"  -i <seconds>   Interval of the report, 0 for the final one only, default is %d\n",
+		prog, LOADGEN_DEF_PORT, LOADGEN_DEF_SERIAL, PALERT_DEFAULT_SAMPRATE, LOADGEN_DEF_CHANNELS, LOADGEN_DEF_REPORT_SEC
+	);
+
+	return;
+}
+
+/**
+ * @brief The sending thread, it keeps popping the earliest connection & handling its event.
+ *
+ * @param arg
+ * @return void*
+ */
+static void *thread_sender( void *arg )
+{
+	LOADGEN_THREAD *thread = (LOADGEN_THREAD *)arg;
+	LOADGEN_CONN   *conn;
+	double          time_now;
+
+/* */
+	while ( !Terminate && thread->nheap ) {
+		conn     = heap_pop( thread );
+		time_now = time_now_get();
+	/* Wake up in short steps, so the termination won't wait for the slow packet rate */
+		while ( !Terminate && time_now < conn->due ) {
+			sleep_until( conn->due - time_now > 0.2 ? time_now + 0.2 : conn->due );
+			time_now = time_now_get();
+		}
+	/* */
+		if ( !Terminate )
+			conn_event( thread, conn, time_now );
+		heap_push( thread, conn );
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Handle the event of the connection: (re)connecting, the following fragment or the new packet.
+ *
+ * @param thread
+ * @param conn
+ * @param time_now
+ */
+static void conn_event( LOADGEN_THREAD *thread, LOADGEN_CONN *conn, const double time_now )
+{
+	int start;
+	int length;
+
+/* */
+	if ( conn->sock < 0 ) {
+		if ( conn_connect( conn ) ) {
+			__atomic_store_n(&thread->errors, thread->errors + 1, __ATOMIC_RELAXED);
+			conn->due = time_now + LOADGEN_RECONNECT_SEC;
+			return;
+		}
+		__atomic_store_n(&thread->connects, thread->connects + 1, __ATOMIC_RELAXED);
+		conn->fresh      = 1;
+		conn->frag_count = 0;
+	}
+/* A new packet, the data window of it just ended */
+	if ( conn->frag_next >= conn->frag_count ) {
+		if ( time_now - conn->packet_due > PacketPeriod )
+			__atomic_store_n(&thread->late, thread->late + 1, __ATOMIC_RELAXED);
+		length = pa2ew_synth_packet_build( &conn->synth, conn->packet, StartReal + conn->seq * PacketPeriod );
+		conn->seq++;
+		conn->packet_due = StartMono + (conn->seq + 1) * PacketPeriod + PacketPeriod * conn->index / NumConns;
+	/* The first packet is only used for identifying by palert2ew, keep it complete & correct */
+		if ( !conn->fresh && CorruptRatio > 0.0 && rand_uniform( thread ) < CorruptRatio ) {
+			pa2ew_synth_packet_corrupt( &conn->synth, conn->packet, length );
+			__atomic_store_n(&thread->corrupted, thread->corrupted + 1, __ATOMIC_RELAXED);
+		}
+		fragment_plan( thread, conn, length );
+		conn->fresh = 0;
+	}
+/* */
+	start = conn->frag_next ? conn->frag_ends[conn->frag_next - 1] : 0;
+	if ( send_all( conn->sock, conn->packet + start, conn->frag_ends[conn->frag_next] - start ) ) {
+		__atomic_store_n(&thread->errors, thread->errors + 1, __ATOMIC_RELAXED);
+		close(conn->sock);
+		conn->sock       = -1;
+		conn->frag_next  = conn->frag_count = 0;
+		conn->due        = time_now + LOADGEN_RECONNECT_SEC;
+		return;
+	}
+	__atomic_store_n(&thread->bytes, thread->bytes + conn->frag_ends[conn->frag_next] - start, __ATOMIC_RELAXED);
+/* */
+	if ( ++conn->frag_next < conn->frag_count ) {
+		conn->due = time_now + LOADGEN_FRAGMENT_GAP;
+	}
+	else {
+		__atomic_store_n(&thread->packets, thread->packets + 1, __ATOMIC_RELAXED);
+		conn->due = conn->packet_due + (JitterSec > 0.0 ? rand_uniform( thread ) * JitterSec : 0.0);
+	}
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param conn
+ * @return int
+ */
+static int conn_connect( LOADGEN_CONN *conn )
+{
+	struct addrinfo  hints;
+	struct addrinfo *servinfo, *p;
+	int              sock     = -1;
+	int              sock_opt = 1;
+
+/* */
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family   = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if ( getaddrinfo(Host, Port, &hints, &servinfo) )
+		return -1;
+/* */
+	for ( p = servinfo; p != NULL; p = p->ai_next ) {
+		if ( (sock = socket(p->ai_family, p->ai_socktype, p->ai_protocol)) < 0 )
+			continue;
+		if ( connect(sock, p->ai_addr, p->ai_addrlen) == 0 )
+			break;
+		close(sock);
+		sock = -1;
+	}
+	freeaddrinfo(servinfo);
+	if ( sock < 0 )
+		return -1;
+/* Without Nagle, the fragments really go out one by one */
+	setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &sock_opt, sizeof(sock_opt));
+	conn->sock = sock;
+
+	return 0;
+}
+
+/**
+ * @brief
+ *
+ * @param sock
+ * @param buffer
+ * @param length
+ * @return int
+ */
+static int send_all( const int sock, const uint8_t *buffer, const int length )
+{
+	ssize_t ret;
+
+	for ( int sent = 0; sent < length; sent += ret ) {
+		if ( (ret = send(sock, buffer + sent, length - sent, MSG_NOSIGNAL)) <= 0 ) {
+			if ( ret < 0 && errno == EINTR ) {
+				ret = 0;
+				continue;
+			}
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Cut the packet at the random positions, the first packet of each connection won't be cut.
+ *
+ * @param thread
+ * @param conn
+ * @param length
+ */
+static void fragment_plan( LOADGEN_THREAD *thread, LOADGEN_CONN *conn, const int length )
+{
+	int count = 1;
+	int cut;
+	int i;
+
+/* */
+	if ( MaxFragments > 1 && !conn->fresh && length > 1 )
+		count += rand_next( thread ) % MaxFragments;
+/* Insert the cuts in ascending order, the duplicated ones are just dropped */
+	conn->frag_count = 0;
+	while ( --count > 0 ) {
+		cut = 1 + (int)(rand_next( thread ) % (length - 1));
+		for ( i = conn->frag_count; i > 0 && conn->frag_ends[i - 1] > cut; i-- );
+		if ( i > 0 && conn->frag_ends[i - 1] == cut )
+			continue;
+		memmove(conn->frag_ends + i + 1, conn->frag_ends + i, (conn->frag_count - i) * sizeof(int));
+		conn->frag_ends[i] = cut;
+		conn->frag_count++;
+	}
+	conn->frag_ends[conn->frag_count++] = length;
+	conn->frag_next = 0;
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param thread
+ * @param conn
+ */
+static void heap_push( LOADGEN_THREAD *thread, LOADGEN_CONN *conn )
+{
+	int i = thread->nheap++;
+	int parent;
+
+	for ( ; i > 0 && thread->heap[(parent = (i - 1) >> 1)]->due > conn->due; i = parent )
+		thread->heap[i] = thread->heap[parent];
+	thread->heap[i] = conn;
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param thread
+ * @return LOADGEN_CONN*
+ */
+static LOADGEN_CONN *heap_pop( LOADGEN_THREAD *thread )
+{
+	LOADGEN_CONN *result = thread->heap[0];
+	LOADGEN_CONN *last   = thread->heap[--thread->nheap];
+	int           i      = 0;
+	int           child;
+
+	while ( (child = (i << 1) + 1) < thread->nheap ) {
+		if ( child + 1 < thread->nheap && thread->heap[child + 1]->due < thread->heap[child]->due )
+			child++;
+		if ( thread->heap[child]->due >= last->due )
+			break;
+		thread->heap[i] = thread->heap[child];
+		i = child;
+	}
+	thread->heap[i] = last;
+
+	return result;
+}
+
+/**
+ * @brief Each thread has its own state.
+ *
+ * @param thread
+ * @return uint64_t
+ */
+static uint64_t rand_next( LOADGEN_THREAD *thread )
+{
+	return pa2ew_synth_rand( &thread->rand_state );
+}
+
+/**
+ * @brief
+ *
+ * @param thread
+ * @return double Within [0, 1)
+ */
+static double rand_uniform( LOADGEN_THREAD *thread )
+{
+	return (rand_next( thread ) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @brief
+ *
+ * @param elapsed
+ * @param final
+ */
+static void report_print( const double elapsed, const int final )
+{
+	uint64_t packets    = 0;
+	uint64_t bytes      = 0;
+	uint64_t corrupted  = 0;
+	uint64_t late       = 0;
+	uint64_t errors     = 0;
+	uint64_t connects = 0;
+
+/* */
+	for ( int i = 0; i < NumThreads; i++ ) {
+		packets    += __atomic_load_n(&Threads[i].packets, __ATOMIC_RELAXED);
+		bytes      += __atomic_load_n(&Threads[i].bytes, __ATOMIC_RELAXED);
+		corrupted  += __atomic_load_n(&Threads[i].corrupted, __ATOMIC_RELAXED);
+		late       += __atomic_load_n(&Threads[i].late, __ATOMIC_RELAXED);
+		errors     += __atomic_load_n(&Threads[i].errors, __ATOMIC_RELAXED);
+		connects += __atomic_load_n(&Threads[i].connects, __ATOMIC_RELAXED);
+	}
+/* The first connections are also counted */
+	printf(
+		"%s %.1f sec: %lu packets (%.1f/sec), %.2f MB (%.2f MB/sec), %lu corrupted, %lu late, %lu errors, %lu connections made.\n",
+		final ? "Total" : "Elapsed", elapsed, (unsigned long)packets, elapsed > 0.0 ? packets / elapsed : 0.0,
+		bytes / 1048576.0, elapsed > 0.0 ? bytes / 1048576.0 / elapsed : 0.0,
+		(unsigned long)corrupted, (unsigned long)late, (unsigned long)errors, (unsigned long)connects
+	);
+	fflush(stdout);
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @return double
+ */
+static double time_now_get( void )
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
+
+/**
+ * @brief
+ *
+ * @return double
+ */
+static double time_real_get( void )
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
+
+/**
+ * @brief
+ *
+ * @param time_mono
+ */
+static void sleep_until( const double time_mono )
+{
+	struct timespec ts;
+
+	ts.tv_sec  = (time_t)time_mono;
+	ts.tv_nsec = (long)((time_mono - ts.tv_sec) * 1.0e9);
+	while ( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR && !Terminate );
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param sig
+ */
+static void handle_terminate( int sig )
+{
+	Terminate = 1;
+
+	return;
+}
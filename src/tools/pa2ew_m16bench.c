@@ -0,0 +1,216 @@
+/**
+ * @file pa2ew_m16bench.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Micro-benchmark & bit-exact checking of the mode 16 data extracting kernels inside libpalertc.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <libpalertc/libpalertc.h>
+
+/**
+ * @name Benchmark constants
+ *
+ */
+#define BENCH_PACKETS     16
+#define BENCH_DEF_ROUNDS  200
+#define BENCH_DEF_SPS     2000
+#define BENCH_SPS_LIMIT   ((PALERT_M16_PACKET_MAX_LENGTH - PALERT_M16_HEADER_LENGTH) / BENCH_MAX_CHANNELS / 4)
+#define BENCH_MAX_CHANNELS  8
+
+/**
+ * @name Internal functions' prototype
+ *
+ */
+static void   gen_packets( const int, const int );
+static int    extract_all( const int, const int, const int, const int, uint32_t * );
+static double bench_level( const int, const int, const int, const int, const int );
+static double time_now_get( void );
+
+/**
+ * @name Internal static variables
+ *
+ */
+static PALERT_M16_PACKET Packets[BENCH_PACKETS];
+static uint32_t          Reference[BENCH_PACKETS][BENCH_MAX_CHANNELS][PALERT_MAX_SAMPRATE];
+static uint32_t          Output[BENCH_PACKETS][BENCH_MAX_CHANNELS][PALERT_MAX_SAMPRATE];
+static const char       *LevelNames[] = { "scalar", "sse2", "ssse3", "sse4.1", "avx2" };
+
+/**
+ * @brief Usage: pa2ew_m16bench [rounds] [samples per packet]
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main( int argc, char **argv )
+{
+	const int channels[] = { 3, 4, 6, 8 };
+	int       rounds     = argc > 1 ? atoi(argv[1]) : BENCH_DEF_ROUNDS;
+	int       nsamp      = argc > 2 ? atoi(argv[2]) : BENCH_DEF_SPS;
+	int       max_level  = pac_simd_level_set( -1 );
+	double    time_ref;
+	double    time_used;
+
+/* */
+	if ( rounds <= 0 )
+		rounds = BENCH_DEF_ROUNDS;
+	if ( nsamp <= 0 || nsamp > BENCH_SPS_LIMIT || nsamp > PALERT_MAX_SAMPRATE )
+		nsamp = BENCH_SPS_LIMIT < PALERT_MAX_SAMPRATE ? BENCH_SPS_LIMIT : PALERT_MAX_SAMPRATE;
+/* */
+	for ( size_t c = 0; c < sizeof(channels) / sizeof(channels[0]); c++ ) {
+		gen_packets( channels[c], nsamp );
+		for ( int to_int = 0; to_int < 2; to_int++ ) {
+		/* The scalar kernel is the reference */
+			extract_all( PALERT_SIMD_NONE, channels[c], nsamp, to_int, &Reference[0][0][0] );
+			time_ref = bench_level( PALERT_SIMD_NONE, channels[c], nsamp, to_int, rounds );
+			fprintf(
+				stdout, "%d ch. %s %-7s: %9.1f ns/packet\n", channels[c], to_int ? "int  " : "float",
+				LevelNames[PALERT_SIMD_NONE], time_ref * 1.0e9 / ((double)rounds * BENCH_PACKETS)
+			);
+		/* */
+			for ( int i = PALERT_SIMD_SSE2; i <= max_level; i++ ) {
+				if ( extract_all( i, channels[c], nsamp, to_int, &Output[0][0][0] ) != i )
+					continue;
+				if ( memcmp(Output, Reference, sizeof(Reference)) ) {
+					fprintf(
+						stderr, "pa2ew_m16bench: The %s output of %s kernel with %d channels is different from scalar one!\n",
+						to_int ? "integer" : "float", LevelNames[i], channels[c]
+					);
+					return -1;
+				}
+				time_used = bench_level( i, channels[c], nsamp, to_int, rounds );
+				fprintf(
+					stdout, "%d ch. %s %-7s: %9.1f ns/packet (%.2fx), bit-exact\n", channels[c], to_int ? "int  " : "float",
+					LevelNames[i], time_used * 1.0e9 / ((double)rounds * BENCH_PACKETS), time_ref / time_used
+				);
+			}
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Fill the packets with random samples, including those edge values of rounding & conversion.
+ *
+ * @param nchannel
+ * @param nsamp
+ */
+static void gen_packets( const int nchannel, const int nsamp )
+{
+	const uint32_t specials[] = {
+		0x00000000, 0x80000000, 0x7f800000, 0xff800000, 0x7fc00000, 0x00000001, 0x80000001,
+		0x4f000000, 0xcf000000, 0x3f800000, 0xbf800000
+	};
+	const int      data_len = nsamp * nchannel * 4;
+	uint8_t       *data;
+	union {
+		float    real;
+		uint32_t dword;
+	} sample;
+
+/* */
+	srand(1);
+	memset(Packets, 0, sizeof(Packets));
+	for ( int i = 0; i < BENCH_PACKETS; i++ ) {
+		Packets[i].header.nchannel    = nchannel;
+		Packets[i].header.data_len[0] = data_len & 0xff;
+		Packets[i].header.data_len[1] = (data_len >> 8) & 0xff;
+		data = &Packets[i].bytes[PALERT_M16_HEADER_LENGTH];
+		for ( int j = 0; j < nsamp * nchannel; j++, data += 4 ) {
+		/* Mostly the values near the rounding edge, and some specials */
+			if ( j % 97 == 0 )
+				sample.dword = specials[(j / 97) % (sizeof(specials) / sizeof(specials[0]))];
+			else if ( j & 1 )
+				sample.real = ((rand() % 2000001) - 1000000) / (float)PALERT_M16_COUNT_OVER_GAL / 100.0f;
+			else
+				sample.real = ((rand() % 2001) - 1000) / 1000.0f;
+			data[0] = sample.dword & 0xff;
+			data[1] = (sample.dword >> 8) & 0xff;
+			data[2] = (sample.dword >> 16) & 0xff;
+			data[3] = (sample.dword >> 24) & 0xff;
+		}
+	}
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param level
+ * @param nchannel
+ * @param nsamp
+ * @param to_int
+ * @param output
+ * @return int The applied SIMD level.
+ */
+static int extract_all( const int level, const int nchannel, const int nsamp, const int to_int, uint32_t *output )
+{
+	uint32_t *buffer[BENCH_MAX_CHANNELS];
+	int       result = pac_simd_level_set( level );
+
+/* */
+	for ( int i = 0; i < BENCH_PACKETS; i++ ) {
+		for ( int j = 0; j < nchannel; j++ )
+			buffer[j] = output + (i * BENCH_MAX_CHANNELS + j) * PALERT_MAX_SAMPRATE;
+		if ( to_int )
+			pac_m16_idata_extract( &Packets[i], nchannel, (int32_t **)buffer );
+		else
+			pac_m16_data_extract( &Packets[i], nchannel, (float **)buffer );
+	}
+
+	return result;
+}
+
+/**
+ * @brief
+ *
+ * @param level
+ * @param nchannel
+ * @param nsamp
+ * @param to_int
+ * @param rounds
+ * @return double
+ */
+static double bench_level( const int level, const int nchannel, const int nsamp, const int to_int, const int rounds )
+{
+	double result = time_now_get();
+
+/* */
+	for ( int i = 0; i < rounds; i++ )
+		extract_all( level, nchannel, nsamp, to_int, &Output[0][0][0] );
+
+	return time_now_get() - result;
+}
+
+/**
+ * @brief
+ *
+ * @return double
+ */
+static double time_now_get( void )
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
@@ -0,0 +1,286 @@
+/**
+ * @file pa2ew_m1bench.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Micro-benchmark & bit-exact checking of the mode 1 data extracting kernels inside libpalertc, also
+ *        checking the fused CRC & extracting functions against the separate ones on the damaged packets.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <libpalertc/libpalertc.h>
+#include <pa2ew_synth.h>
+
+/**
+ * @name Benchmark constants
+ *
+ */
+#define BENCH_PACKETS     1024
+#define BENCH_DEF_ROUNDS  200
+#define FUSED_CHECK_TRIES 4096
+
+/**
+ * @name Internal functions' prototype
+ *
+ */
+static void   gen_packets( void );
+static int    extract_all( const int, const int, void * );
+static double bench_level( const int, const int, const int );
+static double time_now_get( void );
+static int    check_fused( const int );
+
+/**
+ * @name Internal static variables
+ *
+ */
+static PALERT_M1_PACKET Packets[BENCH_PACKETS];
+static int32_t          Reference[BENCH_PACKETS][PALERT_M1_CHAN_COUNT][PALERT_M1_SAMPLE_NUMBER];
+static int32_t          Output[BENCH_PACKETS][PALERT_M1_CHAN_COUNT][PALERT_M1_SAMPLE_NUMBER];
+static int16_t          SOutput[BENCH_PACKETS][PALERT_M1_CHAN_COUNT][PALERT_M1_SAMPLE_NUMBER];
+static const char      *LevelNames[] = { "scalar", "sse2", "ssse3", "sse4.1", "avx2" };
+
+/**
+ * @brief Usage: pa2ew_m1bench [rounds]
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main( int argc, char **argv )
+{
+	int    rounds = argc > 1 ? atoi(argv[1]) : BENCH_DEF_ROUNDS;
+	int    level;
+	int    max_level = pac_simd_level_set( -1 );
+	double time_ref;
+	double time_used;
+
+/* */
+	if ( rounds <= 0 )
+		rounds = BENCH_DEF_ROUNDS;
+	gen_packets();
+/* The scalar kernel is the reference */
+	extract_all( PALERT_SIMD_NONE, 0, &Reference[0][0][0] );
+	time_ref = bench_level( PALERT_SIMD_NONE, 0, rounds );
+	fprintf(stdout, "int32 %-7s: %8.1f ns/packet\n", LevelNames[PALERT_SIMD_NONE], time_ref * 1.0e9 / ((double)rounds * BENCH_PACKETS));
+/* */
+	for ( int i = PALERT_SIMD_NONE; i <= max_level; i++ ) {
+		for ( int to_short = 0; to_short < 2; to_short++ ) {
+		/* The scalar int32 one is the reference */
+			if ( (i == PALERT_SIMD_NONE && !to_short) || (level = extract_all( i, to_short, to_short ? (void *)SOutput : (void *)Output )) != i )
+				continue;
+		/* The 16-bit words should be the same as the truncated reference */
+			for ( size_t j = 0; to_short && j < sizeof(SOutput) / sizeof(int16_t); j++ )
+				(&Output[0][0][0])[j] = (&SOutput[0][0][0])[j];
+			if ( memcmp(Output, Reference, sizeof(Reference)) ) {
+				fprintf(
+					stderr, "pa2ew_m1bench: The %s output of %s kernel is different from scalar one!\n",
+					to_short ? "int16" : "int32", LevelNames[i]
+				);
+				return -1;
+			}
+			time_used = bench_level( i, to_short, rounds );
+			fprintf(
+				stdout, "%s %-7s: %8.1f ns/packet (%.2fx), bit-exact\n", to_short ? "int16" : "int32",
+				LevelNames[i], time_used * 1.0e9 / ((double)rounds * BENCH_PACKETS), time_ref / time_used
+			);
+		}
+	}
+/* */
+	for ( int i = PALERT_SIMD_NONE; i <= max_level; i++ ) {
+		if ( pac_simd_level_set( i ) != i )
+			continue;
+		if ( check_fused( i ) )
+			return -1;
+		fprintf(stdout, "fused %-7s: CRC & samples agree with the separate path on %d damaged packets\n", LevelNames[i], FUSED_CHECK_TRIES);
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Fill the packets with random bytes, including the extreme values of 16-bit words.
+ *
+ */
+static void gen_packets( void )
+{
+	uint8_t *ptr = (uint8_t *)Packets;
+
+/* */
+	srand(1);
+	for ( size_t i = 0; i < sizeof(Packets); i++ )
+		ptr[i] = rand() & 0xff;
+/* */
+	Packets[0].data[0].cmp[0][0] = 0xff;
+	Packets[0].data[0].cmp[0][1] = 0x7f;
+	Packets[0].data[0].cmp[1][0] = 0x00;
+	Packets[0].data[0].cmp[1][1] = 0x80;
+	Packets[0].data[99].cmp[4][0] = 0xff;
+	Packets[0].data[99].cmp[4][1] = 0xff;
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param level
+ * @param to_short
+ * @param output
+ * @return int The applied SIMD level.
+ */
+static int extract_all( const int level, const int to_short, void *output )
+{
+	int32_t *buffer[PALERT_M1_CHAN_COUNT];
+	int16_t *sbuffer[PALERT_M1_CHAN_COUNT];
+	int      result = pac_simd_level_set( level );
+
+/* */
+	for ( int i = 0; i < BENCH_PACKETS; i++ ) {
+		for ( int j = 0; j < PALERT_M1_CHAN_COUNT; j++ ) {
+			buffer[j]  = (int32_t *)output + (i * PALERT_M1_CHAN_COUNT + j) * PALERT_M1_SAMPLE_NUMBER;
+			sbuffer[j] = (int16_t *)output + (i * PALERT_M1_CHAN_COUNT + j) * PALERT_M1_SAMPLE_NUMBER;
+		}
+		if ( to_short )
+			pac_m1_sdata_extract( &Packets[i], sbuffer );
+		else
+			pac_m1_data_extract( &Packets[i], buffer );
+	}
+
+	return result;
+}
+
+/**
+ * @brief
+ *
+ * @param level
+ * @param to_short
+ * @param rounds
+ * @return double
+ */
+static double bench_level( const int level, const int to_short, const int rounds )
+{
+	double result = time_now_get();
+
+/* */
+	for ( int i = 0; i < rounds; i++ )
+		extract_all( level, to_short, to_short ? (void *)SOutput : (void *)Output );
+
+	return time_now_get() - result;
+}
+
+/**
+ * @brief Damage the synthetic packets in different ways, the result & the samples of the fused CRC & extracting
+ *        functions should be the same as those from pac_m1_crc_check() & pac_m1_data_extract().
+ *
+ * @param level
+ * @return int 0 for all agreed, -1 for the first disagreement.
+ */
+static int check_fused( const int level )
+{
+	PA2EW_SYNTH       synth;
+	PALERT_M1_PACKET  packet;
+	uint8_t          *ptr = (uint8_t *)&packet;
+	uint64_t          seed = 1;
+	int32_t           expect[PALERT_M1_CHAN_COUNT][PALERT_M1_SAMPLE_NUMBER];
+	int32_t           fused[PALERT_M1_CHAN_COUNT][PALERT_M1_SAMPLE_NUMBER];
+	int16_t           sfused[PALERT_M1_CHAN_COUNT][PALERT_M1_SAMPLE_NUMBER];
+	int32_t          *ebuffer[PALERT_M1_CHAN_COUNT];
+	int32_t          *fbuffer[PALERT_M1_CHAN_COUNT];
+	int16_t          *sbuffer[PALERT_M1_CHAN_COUNT];
+	int               ncorrect = 0;
+	int               expect_crc;
+	int               pos;
+
+/* Leave the last channel unwanted, the NULL buffer should also be handled */
+	for ( int i = 0; i < PALERT_M1_CHAN_COUNT; i++ ) {
+		ebuffer[i] = i < PALERT_M1_CHAN_COUNT - 1 ? expect[i] : NULL;
+		fbuffer[i] = i < PALERT_M1_CHAN_COUNT - 1 ? fused[i] : NULL;
+		sbuffer[i] = i < PALERT_M1_CHAN_COUNT - 1 ? sfused[i] : NULL;
+	}
+	pa2ew_synth_init( &synth, PALERT_PKT_MODE1, 0, 1, 100, PALERT_M1_SAMPLE_NUMBER, PALERT_M1_CHAN_COUNT );
+/* */
+	for ( int i = 0; i < FUSED_CHECK_TRIES; i++ ) {
+		pa2ew_synth_packet_build( &synth, ptr, 1.0e9 + i );
+		switch ( i % 4 ) {
+		case 1:
+			pa2ew_synth_packet_corrupt( &synth, ptr, PALERT_M1_PACKET_LENGTH );
+			break;
+		case 2:
+		/* Any byte might be flipped, including the header & the check sum itself, except the packet length */
+			do {
+				pos = pa2ew_synth_rand( &seed ) % PALERT_M1_PACKET_LENGTH;
+			} while ( ptr + pos == packet.header.packet_len || ptr + pos == packet.header.packet_len + 1 );
+			ptr[pos] ^= 1 << (pa2ew_synth_rand( &seed ) % 8);
+			break;
+		case 3:
+		/* The non-standard packet length goes thru the separate path inside */
+			pos = PALERT_M1_HEADER_LENGTH + pa2ew_synth_rand( &seed ) % (PALERT_M1_PACKET_LENGTH - PALERT_M1_HEADER_LENGTH);
+			packet.header.packet_len[0] = pos & 0xff;
+			packet.header.packet_len[1] = pos >> 8;
+			break;
+		default:
+			break;
+		}
+	/* */
+		memset(expect, 0, sizeof(expect));
+		memset(fused, 0, sizeof(fused));
+		memset(sfused, 0, sizeof(sfused));
+		expect_crc = pac_m1_crc_check( &packet );
+		if ( PALERT_M1_PACKETLEN_GET( &packet.header ) > PALERT_M1_HEADER_LENGTH )
+			pac_m1_data_extract( &packet, ebuffer );
+		ncorrect += expect_crc;
+	/* */
+		if ( pac_m1_crc_data_extract( &packet, fbuffer ) != expect_crc || memcmp(fused, expect, sizeof(expect)) ) {
+			fprintf(stderr, "pa2ew_m1bench: The fused int32 output of %s kernel is different at packet %d!\n", LevelNames[level], i);
+			return -1;
+		}
+		if ( pac_m1_crc_sdata_extract( &packet, sbuffer ) != expect_crc ) {
+			fprintf(stderr, "pa2ew_m1bench: The fused int16 CRC of %s kernel is different at packet %d!\n", LevelNames[level], i);
+			return -1;
+		}
+		for ( int j = 0; j < PALERT_M1_CHAN_COUNT - 1; j++ ) {
+			for ( int k = 0; k < PALERT_M1_SAMPLE_NUMBER; k++ ) {
+				if ( sfused[j][k] != (int16_t)expect[j][k] ) {
+					fprintf(stderr, "pa2ew_m1bench: The fused int16 output of %s kernel is different at packet %d!\n", LevelNames[level], i);
+					return -1;
+				}
+			}
+		}
+	}
+/* Both results should be exercised, or the checking above means nothing */
+	if ( ncorrect == 0 || ncorrect == FUSED_CHECK_TRIES ) {
+		fprintf(stderr, "pa2ew_m1bench: %d of %d damaged packets passed the CRC, something wrong!\n", ncorrect, FUSED_CHECK_TRIES);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief
+ *
+ * @return double
+ */
+static double time_now_get( void )
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
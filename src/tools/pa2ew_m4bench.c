@@ -0,0 +1,320 @@
+/**
+ * @file pa2ew_m4bench.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Micro-benchmark of the mode 4 (Streamline mini-SEED) decoder inside libpalertc against libmseed.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @name Earthworm environment header include
+ *
+ */
+#include <libmseed.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <libpalertc/libpalertc.h>
+
+/**
+ * @name Benchmark constants
+ *
+ */
+#define BENCH_RECORD_LENGTH  512
+#define BENCH_MAX_RECORDS    4096
+#define BENCH_SAMPLES        200000
+#define BENCH_DEF_ROUNDS     50
+#define BENCH_MAX_NSAMP      2048
+#define BENCH_DAMAGE_EVERY   10   /* Damage the reverse integration constant of every this number of records */
+
+/**
+ * @name Internal functions' prototype
+ *
+ */
+static void   record_handler( char *, int, void * );
+static int    gen_records( const int );
+static double bench_libmseed( const int, int64_t * );
+static double bench_libpalertc( const int, int64_t * );
+static int    verify_records( void );
+static int    verify_damaged_records( void );
+static void   reverse_constant_flip( uint8_t * );
+static double time_now_get( void );
+
+/**
+ * @name Internal static variables
+ *
+ */
+static uint8_t Records[BENCH_MAX_RECORDS][BENCH_RECORD_LENGTH];
+static int     RecordCount = 0;
+
+/**
+ * @brief Usage: pa2ew_m4bench [encoding(1 for Steim1, 2 for Steim2)] [rounds]
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main( int argc, char **argv )
+{
+	int     encoding = argc > 1 ? atoi(argv[1]) : 2;
+	int     rounds   = argc > 2 ? atoi(argv[2]) : BENCH_DEF_ROUNDS;
+	int64_t nsamp_ms = 0;
+	int64_t nsamp_pa = 0;
+	double  time_ms;
+	double  time_pa;
+
+/* */
+	if ( rounds <= 0 )
+		rounds = BENCH_DEF_ROUNDS;
+	if ( gen_records( encoding == 1 ? DE_STEIM1 : DE_STEIM2 ) <= 0 ) {
+		fprintf(stderr, "pa2ew_m4bench: Generating the Steim records failed!\n");
+		return -1;
+	}
+	fprintf(stdout, "pa2ew_m4bench: %d Steim%d records of %d bytes generated.\n", RecordCount, encoding == 1 ? 1 : 2, BENCH_RECORD_LENGTH);
+/* Both decoders should give the same samples */
+	if ( verify_records() ) {
+		fprintf(stderr, "pa2ew_m4bench: The decoded samples are different from libmseed!\n");
+		return -1;
+	}
+	fprintf(stdout, "pa2ew_m4bench: The decoded samples are bit-exact with libmseed.\n");
+/* The records failed the integrity check are still decoded by libmseed, with a warning */
+	if ( verify_damaged_records() ) {
+		fprintf(stderr, "pa2ew_m4bench: The records with damaged reverse integration constant are decoded differently!\n");
+		return -1;
+	}
+	fprintf(stdout, "pa2ew_m4bench: The records with damaged reverse integration constant are kept & counted as libmseed.\n");
+/* */
+	time_ms = bench_libmseed( rounds, &nsamp_ms );
+	time_pa = bench_libpalertc( rounds, &nsamp_pa );
+	fprintf(
+		stdout, "libmseed  : %8.1f ns/record, %8.2f Msamples/s\n",
+		time_ms * 1.0e9 / ((double)rounds * RecordCount), nsamp_ms / time_ms / 1.0e6
+	);
+	fprintf(
+		stdout, "libpalertc: %8.1f ns/record, %8.2f Msamples/s (%.2fx)\n",
+		time_pa * 1.0e9 / ((double)rounds * RecordCount), nsamp_pa / time_pa / 1.0e6, time_ms / time_pa
+	);
+
+	return 0;
+}
+
+/**
+ * @brief Keep the packed record & fill the Streamline length into the padding between blockette 1000 & data.
+ *
+ * @param record
+ * @param reclen
+ * @param arg
+ */
+static void record_handler( char *record, int reclen, void *arg )
+{
+	PALERT_M4_SMSR_HEADER *smsrh;
+
+/* */
+	if ( RecordCount < BENCH_MAX_RECORDS && reclen == BENCH_RECORD_LENGTH ) {
+		memcpy(Records[RecordCount], record, reclen);
+		smsrh = (PALERT_M4_SMSR_HEADER *)Records[RecordCount];
+		smsrh->smsrlength[0] = (reclen >> 8) & 0xff;
+		smsrh->smsrlength[1] = reclen & 0xff;
+		RecordCount++;
+	}
+
+	return;
+}
+
+/**
+ * @brief Pack a random walk with some strong motion bursts into Steim records by libmseed.
+ *
+ * @param encoding
+ * @return int
+ */
+static int gen_records( const int encoding )
+{
+	MSRecord *msr     = msr_init(NULL);
+	int32_t  *samples = calloc(BENCH_SAMPLES, sizeof(int32_t));
+	int64_t   packed  = 0;
+	int32_t   value   = 0;
+
+/* */
+	if ( !msr || !samples )
+		return -1;
+	srand(1);
+	for ( int i = 0; i < BENCH_SAMPLES; i++ ) {
+		value += (i % 20000) < 2000 ? (rand() % 20001) - 10000 : (rand() % 65) - 32;
+		samples[i] = value;
+	}
+/* */
+	strcpy(msr->network, "TW");
+	strcpy(msr->station, "BENCH");
+	strcpy(msr->location, "--");
+	strcpy(msr->channel, "HLZ");
+	msr->starttime   = ms_time2hptime(2024, 1, 0, 0, 0, 0);
+	msr->samprate    = 100.0;
+	msr->reclen      = BENCH_RECORD_LENGTH;
+	msr->encoding    = encoding;
+	msr->byteorder   = 1;
+	msr->datasamples = samples;
+	msr->numsamples  = BENCH_SAMPLES;
+	msr->sampletype  = 'i';
+/* */
+	msr_pack(msr, record_handler, NULL, &packed, 1, 0);
+	msr->datasamples = NULL;
+	msr_free(&msr);
+	free(samples);
+
+	return RecordCount;
+}
+
+/**
+ * @brief
+ *
+ * @param rounds
+ * @param nsamp
+ * @return double
+ */
+static double bench_libmseed( const int rounds, int64_t *nsamp )
+{
+	MSRecord *msr = NULL;
+	double    result = time_now_get();
+
+/* */
+	for ( int i = 0; i < rounds; i++ ) {
+		for ( int j = 0; j < RecordCount; j++ ) {
+			if ( msr_parse((char *)Records[j], BENCH_RECORD_LENGTH, &msr, BENCH_RECORD_LENGTH, 1, 0) )
+				continue;
+			*nsamp += msr->numsamples;
+			msr_free(&msr);
+		}
+	}
+
+	return time_now_get() - result;
+}
+
+/**
+ * @brief
+ *
+ * @param rounds
+ * @param nsamp
+ * @return double
+ */
+static double bench_libpalertc( const int rounds, int64_t *nsamp )
+{
+	int32_t buffer[BENCH_MAX_NSAMP];
+	int     ret;
+	double  result = time_now_get();
+
+/* */
+	for ( int i = 0; i < rounds; i++ ) {
+		for ( int j = 0; j < RecordCount; j++ ) {
+			ret = pac_m4_smsr_data_extract( (PALERT_M4_SMSR_HEADER *)Records[j], buffer, BENCH_MAX_NSAMP );
+			if ( ret > 0 )
+				*nsamp += ret;
+		}
+	}
+
+	return time_now_get() - result;
+}
+
+/**
+ * @brief
+ *
+ * @return int
+ */
+static int verify_records( void )
+{
+	MSRecord *msr = NULL;
+	int32_t   buffer[BENCH_MAX_NSAMP];
+	int       ret;
+	double    dtime;
+
+/* */
+	for ( int i = 0; i < RecordCount; i++ ) {
+		if ( msr_parse((char *)Records[i], BENCH_RECORD_LENGTH, &msr, BENCH_RECORD_LENGTH, 1, 0) )
+			return -1;
+		ret   = pac_m4_smsr_data_extract( (PALERT_M4_SMSR_HEADER *)Records[i], buffer, BENCH_MAX_NSAMP );
+		dtime = pac_m4_smsr_starttime_get( (PALERT_M4_SMSR_HEADER *)Records[i] ) - (double)msr->starttime / HPTMODULUS;
+	/* */
+		if (
+			ret != msr->numsamples || memcmp(buffer, msr->datasamples, ret * sizeof(int32_t)) ||
+			dtime > 1.0e-6 || dtime < -1.0e-6
+		) {
+			fprintf(stderr, "pa2ew_m4bench: Record %d mismatched!\n", i);
+			msr_free(&msr);
+			return -1;
+		}
+		msr_free(&msr);
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Damage the reverse integration constant of some records, both decoders should still give the same samples,
+ *        and each damaged one should be counted once. The records are restored at the end.
+ *
+ * @return int
+ */
+static int verify_damaged_records( void )
+{
+	const uint64_t before = pac_m4_steim_mismatch_get();
+	int            ndamaged = 0;
+	int            result;
+
+/* */
+	for ( int i = 0; i < RecordCount; i += BENCH_DAMAGE_EVERY, ndamaged++ ) {
+		reverse_constant_flip( Records[i] );
+	}
+	result = verify_records();
+	if ( !result && pac_m4_steim_mismatch_get() - before != (uint64_t)ndamaged ) {
+		fprintf(stderr, "pa2ew_m4bench: %lu of %d damaged records are counted!\n", (unsigned long)(pac_m4_steim_mismatch_get() - before), ndamaged);
+		result = -1;
+	}
+/* */
+	for ( int i = 0; i < RecordCount; i += BENCH_DAMAGE_EVERY ) {
+		reverse_constant_flip( Records[i] );
+	}
+
+	return result;
+}
+
+/**
+ * @brief Flip the lowest bit of the reverse integration constant, it's the word 2 of the first frame & big-endian
+ *        as the generating.
+ *
+ * @param record
+ */
+static void reverse_constant_flip( uint8_t *record )
+{
+	const PALERT_M4_SMSR_HEADER *smsrh = (const PALERT_M4_SMSR_HEADER *)record;
+
+	record[((smsrh->data_offset[0] << 8) | smsrh->data_offset[1]) + 11] ^= 0x01;
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @return double
+ */
+static double time_now_get( void )
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
@@ -0,0 +1,297 @@
+/**
+ * @file pa2ew_mseedcheck.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Round-trip check of the mini-SEED output: pack the synthetic channels by palert2ew_mseed, parse the
+ *        records back by msr_parse of libmseed, then compare the samples, start times & sequence numbers
+ *        against the input. It covers the i4 (Steim2), i2 (widened) & f4 (FLOAT32) data, the gaps, the
+ *        changing of sampling rate & the flushing of the partial records.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @name Earthworm environment header include
+ *
+ */
+#include <earthworm.h>
+#include <trace_buf.h>
+#include <libmseed.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <palert2ew.h>
+#include <palert2ew_mseed.h>
+
+/**
+ * @name Check constants
+ *
+ */
+#define CHECK_MAX_RECORDS   8192
+#define CHECK_MAX_SAMPLES   (1024 * 1024)
+#define CHECK_PACKETS       600
+#define CHECK_START_TIME    1700000000.125
+#define CHECK_TIME_TOL      (HPTMODULUS / 10000)  /* The resolution of SEED time, 100 us */
+
+/**
+ * @brief One input sample with its expected time
+ *
+ */
+typedef struct {
+	hptime_t time;
+	double   value;
+} CHECK_SAMPLE;
+
+/**
+ * @name Internal functions' prototype
+ *
+ */
+static void record_handler( char *, int, void * );
+static int  run_case( const char *, const char [2], const int, const int );
+static void gen_packet( TRACE2_HEADER *, const char [2], const double, const double, const int, uint64_t * );
+static int  verify_records( const char *, const char [2] );
+
+/**
+ * @name Internal static variables
+ *
+ */
+static uint8_t      Records[CHECK_MAX_RECORDS][PA2EW_MSEED_RECORD_LENGTH];
+static int          RecordCount = 0;
+static CHECK_SAMPLE Expected[CHECK_MAX_SAMPLES];
+static int          ExpectedCount = 0;
+static uint8_t      Packet[sizeof(TRACE2_HEADER) + PA2EW_OUTMSG_MAX_SAMPLES * sizeof(int32_t)];
+
+/**
+ * @brief Usage: pa2ew_mseedcheck
+ *
+ * @return int
+ */
+int main( void )
+{
+	int failed = 0;
+
+/* */
+	pa2ew_mseed_init( record_handler, NULL, PA2EW_MSEED_DEF_LATENCY );
+	failed |= run_case( "i4 Steim2, contiguous", "i4", 0, 0 );
+	failed |= run_case( "i4 Steim2, with gaps & rate change", "i4", 1, 1 );
+	failed |= run_case( "i2 widened Steim2, with gaps", "i2", 1, 0 );
+	failed |= run_case( "f4 FLOAT32, with gaps & rate change", "f4", 1, 1 );
+
+	fprintf(stdout, "pa2ew_mseedcheck: %s!\n", failed ? "FAILED" : "All the records match the input");
+
+	return failed ? -1 : 0;
+}
+
+/**
+ * @brief Collect the packed records.
+ *
+ * @param record
+ * @param reclen
+ * @param arg
+ */
+static void record_handler( char *record, int reclen, void *arg )
+{
+	if ( RecordCount < CHECK_MAX_RECORDS && reclen == PA2EW_MSEED_RECORD_LENGTH )
+		memcpy(Records[RecordCount++], record, reclen);
+	else
+		fprintf(stderr, "pa2ew_mseedcheck: Unexpected record (%d bytes) or too many records!\n", reclen);
+
+	return;
+}
+
+/**
+ * @brief Feed the packets of one second into a fresh channel, then flush it & check the records.
+ *
+ * @param name
+ * @param datatype
+ * @param with_gaps Skip some packets & shift some by a fraction of second.
+ * @param rate_change Switch the sampling rate in the middle.
+ * @return int
+ */
+static int run_case( const char *name, const char datatype[2], const int with_gaps, const int rate_change )
+{
+	_CHAINFO chainfo;
+	double   samprate = 100.0;
+	double   start    = CHECK_START_TIME;
+	uint64_t seed     = 0x9e3779b97f4a7c15ULL;
+
+/* */
+	memset(&chainfo, 0, sizeof(_CHAINFO));
+	RecordCount   = 0;
+	ExpectedCount = 0;
+	for ( int i = 0; i < CHECK_PACKETS; i++ ) {
+		if ( with_gaps && i % 97 == 50 ) {
+		/* The whole lost packet */
+			start += 1.0;
+			continue;
+		}
+		if ( with_gaps && i % 131 == 70 ) {
+		/* Less than one sample, but over the tolerance */
+			start += 0.6 / samprate;
+		}
+		if ( rate_change && i == CHECK_PACKETS / 2 )
+			samprate = 200.0;
+		gen_packet( (TRACE2_HEADER *)Packet, datatype, start, samprate, (int)samprate, &seed );
+		pa2ew_mseed_append( &chainfo, (TRACE2_HEADER *)Packet );
+		start += 1.0;
+	/* The partial record held over the latency cap */
+		if ( i % 173 == 172 )
+			pa2ew_mseed_flush( &chainfo, 1.0e12 );
+	}
+	pa2ew_mseed_flush( &chainfo, 1.0e12 );
+	pa2ew_mseed_state_free( chainfo.mseed );
+
+	return verify_records( name, datatype );
+}
+
+/**
+ * @brief The random walk with the large steps sometimes, within the range of Steim2 differences.
+ *
+ * @param trh2
+ * @param datatype
+ * @param start
+ * @param samprate
+ * @param nsamp
+ * @param seed
+ */
+static void gen_packet(
+	TRACE2_HEADER *trh2, const char datatype[2], const double start, const double samprate, const int nsamp, uint64_t *seed
+) {
+	static double value = 0.0;
+	double        step;
+
+/* */
+	memset(trh2, 0, sizeof(TRACE2_HEADER));
+	strcpy(trh2->sta, "CHECK");
+	strcpy(trh2->net, "TW");
+	strcpy(trh2->chan, "HLZ");
+	strcpy(trh2->loc, LOC_NULL_STRING);
+	trh2->datatype[0] = datatype[0];
+	trh2->datatype[1] = datatype[1];
+	trh2->nsamp       = nsamp;
+	trh2->samprate    = samprate;
+	trh2->starttime   = start;
+	trh2->endtime     = start + (nsamp - 1) / samprate;
+/* */
+	for ( int i = 0; i < nsamp; i++ ) {
+		*seed ^= *seed << 13;
+		*seed ^= *seed >> 7;
+		*seed ^= *seed << 17;
+		step   = (double)(int64_t)(*seed % 2001) - 1000.0;
+		if ( *seed % 50 == 0 )
+			step *= datatype[1] == '2' ? 10.0 : 100000.0;
+		value += step;
+	/* Keep it inside the type */
+		if ( datatype[1] == '2' && (value > 32767.0 || value < -32768.0) )
+			value = 0.0;
+		if ( value > 5.0e8 || value < -5.0e8 )
+			value = 0.0;
+	/* */
+		if ( datatype[0] == 'f' )
+			((float *)(trh2 + 1))[i] = (float)(value / 16.0);
+		else if ( datatype[1] == '2' )
+			((int16_t *)(trh2 + 1))[i] = (int16_t)value;
+		else
+			((int32_t *)(trh2 + 1))[i] = (int32_t)value;
+	/* */
+		if ( ExpectedCount < CHECK_MAX_SAMPLES ) {
+			Expected[ExpectedCount].time  = (hptime_t)((start + i / samprate) * HPTMODULUS + 0.5);
+			Expected[ExpectedCount].value = datatype[0] == 'f' ? (double)(float)(value / 16.0) :
+				datatype[1] == '2' ? (double)(int16_t)value : (double)(int32_t)value;
+			ExpectedCount++;
+		}
+	}
+
+	return;
+}
+
+/**
+ * @brief Parse all the records back, each sample should be the same one at the same time of the input.
+ *
+ * @param name
+ * @param datatype
+ * @return int
+ */
+static int verify_records( const char *name, const char datatype[2] )
+{
+	MSRecord *msr      = NULL;
+	int       index    = 0;
+	int       errors   = 0;
+	int32_t   seq_next = 1;
+	hptime_t  delta;
+	double    value;
+
+/* */
+	for ( int i = 0; i < RecordCount; i++ ) {
+		if ( msr_parse((char *)Records[i], PA2EW_MSEED_RECORD_LENGTH, &msr, PA2EW_MSEED_RECORD_LENGTH, 1, 0) != MS_NOERROR ) {
+			fprintf(stderr, "pa2ew_mseedcheck: %s, record %d can't be parsed!\n", name, i);
+			errors++;
+			continue;
+		}
+	/* */
+		if ( msr->sequence_number != seq_next ) {
+			fprintf(stderr, "pa2ew_mseedcheck: %s, record %d has sequence number %d, not %d!\n", name, i, msr->sequence_number, seq_next);
+			errors++;
+		}
+		seq_next = msr->sequence_number + 1;
+		if ( msr->encoding != (datatype[0] == 'f' ? DE_FLOAT32 : DE_STEIM2) || msr->numsamples <= 0 ) {
+			fprintf(stderr, "pa2ew_mseedcheck: %s, record %d has encoding %d & %ld samples!\n", name, i, msr->encoding, (long)msr->numsamples);
+			errors++;
+			continue;
+		}
+		if ( strcmp(msr->station, "CHECK") || strcmp(msr->network, "TW") || strcmp(msr->channel, "HLZ") || msr->location[0] ) {
+			fprintf(stderr, "pa2ew_mseedcheck: %s, record %d has wrong SCNL!\n", name, i);
+			errors++;
+		}
+	/* The first sample of the record should be the next input sample & at its time */
+		if ( index >= ExpectedCount || llabs(msr->starttime - Expected[index].time) > CHECK_TIME_TOL ) {
+			fprintf(stderr, "pa2ew_mseedcheck: %s, record %d starts at a wrong time!\n", name, i);
+			errors++;
+		}
+	/* No record can go across a gap or the changing of sampling rate */
+		delta = (hptime_t)(HPTMODULUS / msr->samprate + 0.5);
+		for ( int j = 0; j < msr->numsamples; j++, index++ ) {
+			if ( index >= ExpectedCount ) {
+				fprintf(stderr, "pa2ew_mseedcheck: %s, record %d has more samples than the input!\n", name, i);
+				errors++;
+				break;
+			}
+			if ( llabs(msr->starttime + j * delta - Expected[index].time) > CHECK_TIME_TOL ) {
+				fprintf(stderr, "pa2ew_mseedcheck: %s, sample %d of record %d is at a wrong time!\n", name, j, i);
+				errors++;
+				index = ExpectedCount;
+				break;
+			}
+			value = msr->sampletype == 'f' ? ((float *)msr->datasamples)[j] : ((int32_t *)msr->datasamples)[j];
+			if ( value != Expected[index].value ) {
+				fprintf(stderr, "pa2ew_mseedcheck: %s, sample %d of record %d is %f, not %f!\n", name, j, i, value, Expected[index].value);
+				errors++;
+				break;
+			}
+		}
+	}
+	msr_free(&msr);
+/* */
+	if ( index != ExpectedCount ) {
+		fprintf(stderr, "pa2ew_mseedcheck: %s, only %d of %d samples are packed!\n", name, index, ExpectedCount);
+		errors++;
+	}
+	fprintf(
+		stdout, "pa2ew_mseedcheck: %-36s %5d records, %7d samples, %s\n",
+		name, RecordCount, index, errors ? "MISMATCH" : "OK"
+	);
+
+	return errors ? -1 : 0;
+}
@@ -0,0 +1,1029 @@
+/**
+ * @file pa2ew_replay.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Replay the raw stream captured by palert2ew (CaptureRawStream) in the original pace, N times faster or
+ *        as fast as possible. The chunks can be sent over TCP again, as the Palerts or the forward server, or be
+ *        fed into the same framing (main queue) & decoding of palert2ew offline. The FW_PCK stream goes through
+ *        the client reader of palert2ew itself, over a local socket pair for each captured connection.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+/**
+ * @name Earthworm environment header include
+ *
+ */
+#include <earthworm.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <libpalertc/libpalertc.h>
+#include <palert2ew.h>
+#include <palert2ew_misc.h>
+#include <palert2ew_list.h>
+#include <palert2ew_msg_queue.h>
+#include <palert2ew_capture.h>
+#include <palert2ew_client.h>
+#include <palert2ew_decode.h>
+#include <palert2ew_metrics.h>
+
+/**
+ * @name Replay constants
+ *
+ */
+#define REPLAY_DEF_FWSERV_PORT  "23000"
+#define REPLAY_DEF_REPORT_SEC   10
+#define REPLAY_DEF_MAX_GAP      10.0
+#define REPLAY_QUEUE_SIZE       1024
+#define REPLAY_MAX_CONNS        65536              /* The connection index is 16 bits */
+#define REPLAY_MAX_CHUNK        (16 * 1024 * 1024) /* Larger than this, the record must be broken */
+
+/**
+ * @name Where the chunks go
+ *
+ */
+#define REPLAY_TARGET_DECODE  0  /* The framing & decoding of palert2ew, offline             */
+#define REPLAY_TARGET_PALERT  1  /* Over TCP as the Palerts, for palert2ew in server mode    */
+#define REPLAY_TARGET_FWSERV  2  /* Over TCP as the forward server, for palert2ew in client mode */
+
+/**
+ * @name States of the replayed Palert connection
+ *
+ */
+#define REPLAY_CONN_IDLE    0  /* Waiting for the first chunk to identify the Palert */
+#define REPLAY_CONN_ONLINE  1
+#define REPLAY_CONN_DEAD    2  /* palert2ew closed it, the rest is ignored until the close record */
+
+/**
+ * @brief The replayed Palert connection
+ *
+ */
+typedef struct {
+	int       sock;
+	int       state;
+	_STAINFO *staptr;
+	uint16_t  packmode;
+	uint8_t   sync_errors;
+} REPLAY_CONN;
+
+/**
+ * @name Internal functions' prototype
+ *
+ */
+static int    parse_args( int, char ** );
+static void   usage( const char * );
+static int    capture_map( const char * );
+static int    record_next( size_t *, PA2EW_CAPTURE_RECORD_HEAD *, const uint8_t ** );
+static int    record_serial_get( const PA2EW_CAPTURE_RECORD_HEAD *, const uint8_t * );
+static int    pipeline_init( void );
+static int    list_load( const char * );
+static void   pace_wait( const double );
+static void   replay_palert( const PA2EW_CAPTURE_RECORD_HEAD *, const uint8_t * );
+static void   replay_fwserv( const PA2EW_CAPTURE_RECORD_HEAD *, const uint8_t * );
+static void   decode_palert_chunk( const PA2EW_CAPTURE_RECORD_HEAD *, const uint8_t * );
+static void   feed_fw_chunk( const PA2EW_CAPTURE_RECORD_HEAD *, const uint8_t * );
+static int    feed_connect( void );
+static void   feed_end( void );
+static void  *stream_thread( void * );
+static void   queue_drain( void );
+static int    conn_connect( REPLAY_CONN * );
+static int    client_accept( void );
+static int    listen_sock_construct( void );
+static int    send_all( const int, const uint8_t *, const int );
+static void   report_print( const double, const int );
+static double time_now_get( void );
+static void   sleep_until( const double );
+static void   handle_terminate( int );
+
+/**
+ * @name Internal static variables
+ *
+ */
+static const char       *CaptureFile  = NULL;
+static const char       *Host         = NULL;
+static const char       *Port         = NULL;
+static const char       *ListFile     = NULL;
+static int               Target       = REPLAY_TARGET_DECODE;
+static double            Speed        = 1.0;   /* 0 for as fast as possible */
+static double            MaxGap       = REPLAY_DEF_MAX_GAP;
+static int               Loops        = 1;
+static int               FilterSerial = 0;
+static int               ReportSec    = REPLAY_DEF_REPORT_SEC;
+/* */
+static uint8_t          *MapData      = NULL;
+static size_t            MapSize      = 0;
+static REPLAY_CONN      *Conns        = NULL;
+static int               ListenSock   = -1;
+static int               ClientSock   = -1;
+static LABELED_RECV_BUFFER *Input     = NULL;
+static LABELED_RECV_BUFFER *Output    = NULL;
+static PA2EW_DECODED     Decoded      = { 0 };
+static volatile sig_atomic_t Terminate = 0;
+/* The FW_PCK stream, the read end of each socket pair is handed to the stream thread thru the control pipe */
+static CLIENT_STREAM     Stream       = { 0 };
+static int               FeedSock     = -1;
+static int               FeedCtrl[2]  = { -1, -1 };
+static pthread_t         StreamThread;
+static int               StreamStarted = 0;
+static pthread_mutex_t   DecodeMutex  = PTHREAD_MUTEX_INITIALIZER;  /* Both threads drain the main queue */
+/* Pace of the replay */
+static double            PaceStart    = 0.0;
+static double            VirtualTime  = 0.0;
+static double            LastRecTime  = 0.0;
+static int               PaceStarted  = 0;
+/* Counters */
+static uint64_t          RecordCount   = 0;
+static uint64_t          ByteCount     = 0;
+static uint64_t          SkippedCount  = 0;
+static uint64_t          GarbageBytes  = 0;
+static uint64_t          ConnectCount  = 0;
+static uint64_t          FailureCount  = 0;
+static uint64_t          FramedCount   = 0;
+static uint64_t          ModeCount[3]  = { 0 };  /* Mode 1 (& 2), 4 & 16 */
+static uint64_t          SyncErrors    = 0;
+static uint64_t          CRCFailures   = 0;
+static uint64_t          NTPQuestion   = 0;
+static uint64_t          UnknownCount  = 0;
+static double            DecodeTime    = 0.0;
+
+/**
+ * @brief Usage: pa2ew_replay [options] <capture file> [host], see usage() for the options.
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main( int argc, char **argv )
+{
+	PA2EW_CAPTURE_RECORD_HEAD head;
+	const uint8_t            *chunk;
+	size_t                    offset;
+	double                    time_start;
+	double                    time_report;
+	double                    time_now;
+	int                       ret;
+
+/* */
+	if ( (ret = parse_args( argc, argv )) )
+		return ret < 0 ? -1 : 0;
+	if ( capture_map( CaptureFile ) )
+		return -1;
+	if ( !(Conns = calloc(REPLAY_MAX_CONNS, sizeof(REPLAY_CONN))) ) {
+		fprintf(stderr, "Error allocating the connections!\n");
+		return -1;
+	}
+	for ( int i = 0; i < REPLAY_MAX_CONNS; i++ )
+		Conns[i].sock = -1;
+	if ( Target == REPLAY_TARGET_DECODE && pipeline_init() )
+		return -1;
+	if ( Target == REPLAY_TARGET_FWSERV && (ListenSock = listen_sock_construct()) < 0 )
+		return -1;
+/* */
+	signal(SIGINT, handle_terminate);
+	signal(SIGTERM, handle_terminate);
+	signal(SIGPIPE, SIG_IGN);
+	time_start = time_report = time_now_get();
+	for ( int loop = 0; loop < Loops && !Terminate; loop++ ) {
+		for ( offset = 0; !Terminate && record_next( &offset, &head, &chunk ); ) {
+		/* Only those chunks that the target can take */
+			if (
+				(Target == REPLAY_TARGET_PALERT && head.source != PA2EW_CAPTURE_SOURCE_SERVER) ||
+				(Target == REPLAY_TARGET_FWSERV && head.source != PA2EW_CAPTURE_SOURCE_CLIENT) ||
+				(FilterSerial && (head.source != PA2EW_CAPTURE_SOURCE_SERVER || record_serial_get( &head, chunk ) != FilterSerial))
+			) {
+				SkippedCount += !loop;
+				continue;
+			}
+		/* The forward server can't go on without the client */
+			if ( Target == REPLAY_TARGET_FWSERV && ClientSock < 0 && head.event != PA2EW_CAPTURE_EVENT_CLOSE && client_accept() )
+				break;
+			pace_wait( head.time );
+		/* */
+			RecordCount++;
+			ByteCount += head.length;
+			if ( Target == REPLAY_TARGET_PALERT )
+				replay_palert( &head, chunk );
+			else if ( Target == REPLAY_TARGET_FWSERV )
+				replay_fwserv( &head, chunk );
+			else if ( head.source == PA2EW_CAPTURE_SOURCE_SERVER )
+				decode_palert_chunk( &head, chunk );
+			else
+				feed_fw_chunk( &head, chunk );
+		/* */
+			if ( ReportSec > 0 && (time_now = time_now_get()) - time_report >= ReportSec ) {
+				time_report = time_now;
+				report_print( time_now - time_start, 0 );
+			}
+		}
+	}
+/* The rest of the FW_PCK stream should be decoded before the final report */
+	feed_end();
+	report_print( time_now_get() - time_start, 1 );
+/* */
+	for ( int i = 0; i < REPLAY_MAX_CONNS; i++ )
+		if ( Conns[i].sock >= 0 )
+			close(Conns[i].sock);
+	if ( ClientSock >= 0 )
+		close(ClientSock);
+	if ( ListenSock >= 0 )
+		close(ListenSock);
+	if ( Target == REPLAY_TARGET_DECODE ) {
+		pa2ew_msgqueue_end();
+		pa2ew_list_end();
+		pa2ew_client_stream_end( &Stream );
+		free(Input);
+		free(Output);
+		free(Decoded.outmsg);
+	}
+	free(Conns);
+	munmap(MapData, MapSize);
+
+	return 0;
+}
+
+/**
+ * @brief
+ *
+ * @param argc
+ * @param argv
+ * @return int 0 for going on, 1 for the usage only & -1 for the wrong arguments.
+ */
+static int parse_args( int argc, char **argv )
+{
+	int opt;
+	int fwserv = 0;
+
+/* */
+	while ( (opt = getopt(argc, argv, "Fp:s:G:n:S:l:i:h")) != -1 ) {
+		switch ( opt ) {
+		case 'F': fwserv       = 1; break;
+		case 'p': Port         = optarg; break;
+		case 's': Speed        = atof(optarg); break;
+		case 'G': MaxGap       = atof(optarg); break;
+		case 'n': Loops        = atoi(optarg); break;
+		case 'S': FilterSerial = atoi(optarg); break;
+		case 'l': ListFile     = optarg; break;
+		case 'i': ReportSec    = atoi(optarg); break;
+		case 'h':
+			usage( argv[0] );
+			return 1;
+		default:
+			usage( argv[0] );
+			return -1;
+		}
+	}
+/* */
+	CaptureFile = optind < argc ? argv[optind++] : NULL;
+	Host        = optind < argc ? argv[optind++] : NULL;
+	if ( !CaptureFile || (fwserv && Host) ) {
+		usage( argv[0] );
+		return -1;
+	}
+	if ( Speed < 0.0 || MaxGap < 0.0 || Loops <= 0 ) {
+		fprintf(stderr, "The speed & the max. gap should not be negative, the loops should be positive!\n");
+		return -1;
+	}
+/* */
+	if ( fwserv ) {
+		Target = REPLAY_TARGET_FWSERV;
+		Port   = Port ? Port : REPLAY_DEF_FWSERV_PORT;
+	}
+	else if ( Host ) {
+		Target = REPLAY_TARGET_PALERT;
+		Port   = Port ? Port : PA2EW_PALERT_PORT;
+	}
+	else if ( !ListFile ) {
+		fprintf(stderr, "The station list is needed for the offline decoding!\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief
+ *
+ * @param prog
+ */
+static void usage( const char *prog )
+{
+	fprintf(stderr,
+		"Usage: %s [options] <capture file> [host]\n"
+		"  Without the host, the chunks are fed into the framing & decoding of palert2ew offline (with -l);\n"
+		"  with the host, the chunks of server mode are sent to it as the Palerts, one TCP connection for each;\n"
+		"  with -F, the chunks of client mode are sent to palert2ew as the forward server.\n"
+		"  -F             Replay the FW_PCK stream as the forward server, listening on the port\n"
+		"  -p <port>      Port of palert2ew as the server of Palert (default is %s), or the listening port\n"
+		"                 of the forward server (default is %s)\n"
+		"  -s <speed>     Multiple of the original pace, 0 for as fast as possible, default is 1\n"
+		"  -G <seconds>   Longer idle gaps between the chunks are shortened to this, default is %.0f\n"
+		"  -n <loops>     Times of replaying the whole file, default is 1\n"
+		"  -S <serial>    Only replay the connections of this Palert (server mode only)\n"
+		"  -l <file>      Station list (the Palert lines of palert2ew) for the offline decoding\n"
+		"  -i <seconds>   Interval of the report, 0 for the final one only, default is %d\n",
+		prog, PA2EW_PALERT_PORT, REPLAY_DEF_FWSERV_PORT, REPLAY_DEF_MAX_GAP, REPLAY_DEF_REPORT_SEC
+	);
+
+	return;
+}
+
+/**
+ * @brief Map the whole capture file, the records are read one after another straight from it.
+ *
+ * @param path
+ * @return int
+ */
+static int capture_map( const char *path )
+{
+	struct stat st;
+	int         fd = open(path, O_RDONLY);
+
+/* */
+	if ( fd < 0 || fstat(fd, &st) || st.st_size < (off_t)sizeof(PA2EW_CAPTURE_RECORD_HEAD) ) {
+		fprintf(stderr, "Error opening the capture file %s, or it's empty!\n", path);
+		if ( fd >= 0 )
+			close(fd);
+		return -1;
+	}
+	MapSize = st.st_size;
+	MapData = mmap(NULL, MapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if ( MapData == MAP_FAILED ) {
+		fprintf(stderr, "Error mapping the capture file %s: %s!\n", path, strerror(errno));
+		return -1;
+	}
+	madvise(MapData, MapSize, MADV_SEQUENTIAL);
+
+	return 0;
+}
+
+/**
+ * @brief Read the next record, the broken & truncated ones (e.g. palert2ew was killed) are skipped.
+ *
+ * @param offset
+ * @param head
+ * @param chunk
+ * @return int 1 for the record, 0 for the end of file.
+ */
+static int record_next( size_t *offset, PA2EW_CAPTURE_RECORD_HEAD *head, const uint8_t **chunk )
+{
+	static size_t scanned = 0;
+
+/* The header might not be aligned inside the file */
+	for ( ; MapSize - *offset >= sizeof(PA2EW_CAPTURE_RECORD_HEAD); (*offset)++ ) {
+		memcpy(head, MapData + *offset, sizeof(PA2EW_CAPTURE_RECORD_HEAD));
+		if (
+			head->magic == PA2EW_CAPTURE_MAGIC && head->length <= REPLAY_MAX_CHUNK &&
+			MapSize - *offset - sizeof(PA2EW_CAPTURE_RECORD_HEAD) >= head->length
+		) {
+			*chunk   = MapData + *offset + sizeof(PA2EW_CAPTURE_RECORD_HEAD);
+			*offset += sizeof(PA2EW_CAPTURE_RECORD_HEAD) + head->length;
+			scanned  = *offset > scanned ? *offset : scanned;
+			return 1;
+		}
+	/* Only counted in the first pass */
+		if ( *offset >= scanned ) {
+			GarbageBytes++;
+			scanned = *offset + 1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief The serial of the Palert connection. Before the Palert is identified, the chunk should start with the
+ *        packet header.
+ *
+ * @param head
+ * @param chunk
+ * @return int
+ */
+static int record_serial_get( const PA2EW_CAPTURE_RECORD_HEAD *head, const uint8_t *chunk )
+{
+	if ( head->serial )
+		return head->serial;
+	if ( head->length >= PALERT_M1_HEADER_LENGTH && pac_sync_check( chunk ) )
+		return pac_serial_get( chunk );
+
+	return 0;
+}
+
+/**
+ * @brief Initialize the station list & the main queue, just like palert2ew does.
+ *
+ * @return int
+ */
+static int pipeline_init( void )
+{
+/* */
+	logit_init("pa2ew_replay", 0, 256, 0);
+	pac_init();
+	pa2ew_crc8_init();
+	if ( list_load( ListFile ) )
+		return -1;
+/* */
+	if ( pa2ew_msgqueue_init( REPLAY_QUEUE_SIZE, sizeof(LABELED_RECV_BUFFER), PA2EW_QUEUE_DROP_OLDEST, 0 ) ) {
+		fprintf(stderr, "Error initializing the main queue!\n");
+		return -1;
+	}
+	Input          = calloc(1, sizeof(LABELED_RECV_BUFFER));
+	Output         = calloc(1, sizeof(LABELED_RECV_BUFFER));
+	Decoded.outmsg = calloc(PA2EW_MAX_CHAN_PER_STA, sizeof(PA2EW_OUTMSG));
+	if ( !Input || !Output || !Decoded.outmsg || pa2ew_client_stream_init( &Stream ) ) {
+		fprintf(stderr, "Error allocating the buffers!\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Load the Palert lines of the station list, the other lines are ignored.
+ *
+ * @param path
+ * @return int
+ */
+static int list_load( const char *path )
+{
+	FILE *fp = fopen(path, "r");
+	char  line[1024];
+	char *str;
+
+/* */
+	if ( !fp ) {
+		fprintf(stderr, "Error opening the station list %s: %s!\n", path, strerror(errno));
+		return -1;
+	}
+	while ( fgets(line, sizeof(line), fp) ) {
+		for ( str = line; isspace(*str); str++ );
+		if ( strncmp(str, "Palert", 6) || !isspace(str[6]) )
+			continue;
+		for ( str += 6; isspace(*str); str++ );
+		if ( pa2ew_list_station_line_parse( str, PA2EW_LIST_INITIALIZING ) ) {
+			fprintf(stderr, "Error parsing the station list %s: %s", path, line);
+			fclose(fp);
+			return -1;
+		}
+	}
+	fclose(fp);
+/* */
+	if ( !pa2ew_list_total_station_get() ) {
+		fprintf(stderr, "There is not any station in the list %s!\n", path);
+		return -1;
+	}
+	pa2ew_list_tree_activate();
+	printf("There are total %d stations in the list.\n", pa2ew_list_total_station_get());
+
+	return 0;
+}
+
+/**
+ * @brief Wait until the time of the record in the replayed pace. The idle gaps are shortened, and the time going
+ *        backward (e.g. the next run appended to the same file) is treated as no gap.
+ *
+ * @param rec_time
+ */
+static void pace_wait( const double rec_time )
+{
+	double delta;
+
+/* */
+	if ( Speed <= 0.0 )
+		return;
+	if ( !PaceStarted ) {
+		PaceStarted = 1;
+		PaceStart   = time_now_get() - VirtualTime / Speed;
+	}
+	else {
+		delta = rec_time - LastRecTime;
+		VirtualTime += delta < 0.0 ? 0.0 : delta > MaxGap ? MaxGap : delta;
+	}
+	LastRecTime = rec_time;
+	sleep_until( PaceStart + VirtualTime / Speed );
+
+	return;
+}
+
+/**
+ * @brief Send the chunk through the connection of the same index, connect or close it as the record says.
+ *
+ * @param head
+ * @param chunk
+ */
+static void replay_palert( const PA2EW_CAPTURE_RECORD_HEAD *head, const uint8_t *chunk )
+{
+	REPLAY_CONN *conn = Conns + head->conn;
+
+/* */
+	if ( head->event == PA2EW_CAPTURE_EVENT_CLOSE ) {
+		if ( conn->sock >= 0 )
+			close(conn->sock);
+		conn->sock = -1;
+		return;
+	}
+/* */
+	if ( conn->sock < 0 ) {
+		if ( conn_connect( conn ) ) {
+			FailureCount++;
+			return;
+		}
+		ConnectCount++;
+	}
+	if ( send_all( conn->sock, chunk, head->length ) ) {
+		FailureCount++;
+		close(conn->sock);
+		conn->sock = -1;
+	}
+
+	return;
+}
+
+/**
+ * @brief Send the chunk to palert2ew as the forward server, the flushed chunks were also on the wire.
+ *
+ * @param head
+ * @param chunk
+ */
+static void replay_fwserv( const PA2EW_CAPTURE_RECORD_HEAD *head, const uint8_t *chunk )
+{
+/* palert2ew reconnected here, so does the replay */
+	if ( head->event == PA2EW_CAPTURE_EVENT_CLOSE ) {
+		if ( ClientSock >= 0 ) {
+			close(ClientSock);
+			printf("Closed the client as the capture did.\n");
+		}
+		ClientSock = -1;
+		return;
+	}
+/* */
+	if ( ClientSock >= 0 && send_all( ClientSock, chunk, head->length ) ) {
+		printf("Error sending to the client: %s!\n", strerror(errno));
+		FailureCount++;
+		close(ClientSock);
+		ClientSock = -1;
+	}
+
+	return;
+}
+
+/**
+ * @brief Feed the chunk of the Palert connection just like the server of palert2ew, the first chunk is only for
+ *        identifying the Palert.
+ *
+ * @param head
+ * @param chunk
+ */
+static void decode_palert_chunk( const PA2EW_CAPTURE_RECORD_HEAD *head, const uint8_t *chunk )
+{
+	REPLAY_CONN *conn = Conns + head->conn;
+	int          ret;
+	int          tzoffset;
+	double       offset;
+
+/* */
+	if ( head->event == PA2EW_CAPTURE_EVENT_CLOSE ) {
+		conn->state       = REPLAY_CONN_IDLE;
+		conn->staptr      = NULL;
+		conn->sync_errors = 0;
+		return;
+	}
+	if ( head->event != PA2EW_CAPTURE_EVENT_DATA || conn->state == REPLAY_CONN_DEAD )
+		return;
+/* */
+	if ( conn->state == REPLAY_CONN_IDLE ) {
+		if ( head->length < PALERT_M1_HEADER_LENGTH || !pac_sync_check( chunk ) ) {
+			SyncErrors++;
+			conn->state = REPLAY_CONN_DEAD;
+		}
+		else if ( !(conn->staptr = pa2ew_list_find( pac_serial_get( chunk ) )) ) {
+			__atomic_fetch_add(&UnknownCount, 1, __ATOMIC_RELAXED);
+			conn->state = REPLAY_CONN_DEAD;
+		}
+		else {
+			conn->state    = REPLAY_CONN_ONLINE;
+			conn->packmode = pac_mode_get( chunk );
+		/* The time zone is derived from the receiving time, instead of now */
+			tzoffset = 0;
+			if ( conn->packmode == PALERT_PKT_MODE1 || conn->packmode == PALERT_PKT_MODE2 ) {
+				offset   = (pac_m1_systime_get( (PALERT_M1_HEADER *)chunk, 0 ) - head->time) / 3600.0;
+				tzoffset = (int)(offset + (offset > 0.0 ? 0.5 : -0.5));
+			}
+			conn->staptr->timeshift = -(tzoffset * 3600);
+		}
+		return;
+	}
+/* */
+	if ( head->length > PA2EW_RECV_BUFFER_LENGTH )
+		return;
+	Input->label.staptr    = conn->staptr;
+	Input->label.packmode  = conn->packmode;
+	Input->label.recv_time = head->time;
+	memcpy(Input->recv_buffer, chunk, head->length);
+	if ( (ret = pa2ew_msgqueue_rawpacket( Input, head->length, PA2EW_GEN_MSG_LOGO_BY_SRC( PA2EW_MSG_SERVER_NORMAL ) )) < 0 ) {
+		SyncErrors++;
+		if ( ++conn->sync_errors >= PA2EW_TCP_SYNC_ERR_LIMIT )
+			conn->state = REPLAY_CONN_DEAD;
+	}
+	else {
+		conn->sync_errors = 0;
+		FramedCount += ret;
+	}
+	queue_drain();
+
+	return;
+}
+
+/**
+ * @brief Feed the chunk of the FW_PCK stream into the socket pair of the captured connection, the flushed chunks
+ *        were also on the wire. The client reader of palert2ew frames it inside the stream thread.
+ *
+ * @param head
+ * @param chunk
+ */
+static void feed_fw_chunk( const PA2EW_CAPTURE_RECORD_HEAD *head, const uint8_t *chunk )
+{
+/* palert2ew reconnected here, the reader sees the end of this connection & goes on with the next one */
+	if ( head->event == PA2EW_CAPTURE_EVENT_CLOSE ) {
+		if ( FeedSock >= 0 )
+			close(FeedSock);
+		FeedSock = -1;
+		return;
+	}
+/* */
+	if ( FeedSock < 0 && feed_connect() ) {
+		FailureCount++;
+		return;
+	}
+/* The reader gave up this connection (e.g. too many sync errors), the rest goes to the next one */
+	if ( send_all( FeedSock, chunk, head->length ) ) {
+		FailureCount++;
+		close(FeedSock);
+		FeedSock = -1;
+	}
+
+	return;
+}
+
+/**
+ * @brief Open the socket pair for the next captured connection, the stream thread is started with the first one.
+ *
+ * @return int
+ */
+static int feed_connect( void )
+{
+	int pair[2];
+
+/* */
+	if ( !StreamStarted ) {
+		if ( pipe(FeedCtrl) || pthread_create(&StreamThread, NULL, stream_thread, NULL) ) {
+			fprintf(stderr, "Error starting the stream thread!\n");
+			return -1;
+		}
+		StreamStarted = 1;
+	}
+	if ( socketpair(AF_UNIX, SOCK_STREAM, 0, pair) )
+		return -1;
+/* */
+	if ( write(FeedCtrl[1], &pair[0], sizeof(int)) != sizeof(int) ) {
+		close(pair[0]);
+		close(pair[1]);
+		return -1;
+	}
+	FeedSock = pair[1];
+	ConnectCount++;
+
+	return 0;
+}
+
+/**
+ * @brief Close the last connection & wait for the stream thread to finish the rest of the stream.
+ *
+ */
+static void feed_end( void )
+{
+	if ( FeedSock >= 0 )
+		close(FeedSock);
+	FeedSock = -1;
+/* */
+	if ( StreamStarted ) {
+		close(FeedCtrl[1]);
+		pthread_join(StreamThread, NULL);
+		close(FeedCtrl[0]);
+		StreamStarted = 0;
+	}
+
+	return;
+}
+
+/**
+ * @brief Read each captured connection by the client reader of palert2ew until it's closed or given up, and
+ *        decode the framed packets.
+ *
+ * @param arg
+ * @return void*
+ */
+static void *stream_thread( void *arg )
+{
+	int sock;
+	int ret;
+
+/* */
+	while ( read(FeedCtrl[0], &sock, sizeof(int)) == sizeof(int) ) {
+		do {
+			if ( (ret = pa2ew_client_stream( &Stream, sock )) == PA2EW_RECV_NEED_UPDATE )
+				__atomic_fetch_add(&UnknownCount, 1, __ATOMIC_RELAXED);
+			queue_drain();
+		} while ( ret == PA2EW_RECV_NORMAL || ret == PA2EW_RECV_NEED_UPDATE );
+		close(sock);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Decode all the complete packets inside the main queue, the same as palert2ew with CheckCRC16 on. The
+ *        mode 4 records are decoded in the output stage of palert2ew, so do they here.
+ *
+ */
+static void queue_drain( void )
+{
+	static const char idatatype[2] = { 'i', '4' };  /* The default data types of palert2ew */
+	static const char fdatatype[2] = { 'f', '4' };
+
+	size_t    size;
+	MSG_LOGO  logo;
+	_STAINFO *staptr;
+	double    time_start;
+	int       ret;
+
+/* */
+	pthread_mutex_lock(&DecodeMutex);
+	while ( pa2ew_msgqueue_dequeue( Output, &size, &logo ) == 0 ) {
+		if ( !(staptr = (_STAINFO *)Output->label.staptr) )
+			continue;
+	/* */
+		time_start = time_now_get();
+		ret = pa2ew_decode_packet(
+			Output->recv_buffer, Output->label.packmode, staptr,
+			Output->label.packmode == PALERT_PKT_MODE16 ? fdatatype : idatatype, 1, &Decoded
+		);
+		if ( !ret && Output->label.packmode == PALERT_PKT_MODE4 )
+			ret = pac_m4_data_extract( (PALERT_M4_PACKET *)Output->recv_buffer, PA2EW_MAX_CHAN_PER_STA, (int32_t **)Decoded.data ) < 0 ? -1 : 0;
+		if ( ret < 0 )
+			CRCFailures++;
+		else if ( !pac_ntp_sync_check( Output->recv_buffer ) )
+			NTPQuestion++;
+		DecodeTime += time_now_get() - time_start;
+	/* */
+		ModeCount[Output->label.packmode == PALERT_PKT_MODE16 ? 2 : Output->label.packmode == PALERT_PKT_MODE4 ? 1 : 0]++;
+	}
+	pthread_mutex_unlock(&DecodeMutex);
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param conn
+ * @return int
+ */
+static int conn_connect( REPLAY_CONN *conn )
+{
+	struct addrinfo  hints;
+	struct addrinfo *servinfo, *p;
+	int              sock     = -1;
+	int              sock_opt = 1;
+
+/* */
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family   = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if ( getaddrinfo(Host, Port, &hints, &servinfo) )
+		return -1;
+/* */
+	for ( p = servinfo; p != NULL; p = p->ai_next ) {
+		if ( (sock = socket(p->ai_family, p->ai_socktype, p->ai_protocol)) < 0 )
+			continue;
+		if ( connect(sock, p->ai_addr, p->ai_addrlen) == 0 )
+			break;
+		close(sock);
+		sock = -1;
+	}
+	freeaddrinfo(servinfo);
+	if ( sock < 0 )
+		return -1;
+/* Without Nagle, the chunks go out one by one as they were received */
+	setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &sock_opt, sizeof(sock_opt));
+	conn->sock = sock;
+
+	return 0;
+}
+
+/**
+ * @brief Wait for palert2ew in client mode, the pace restarts from the current record.
+ *
+ * @return int
+ */
+static int client_accept( void )
+{
+	struct pollfd pfd;
+
+/* */
+	printf("Waiting for palert2ew on port %s...\n", Port);
+	fflush(stdout);
+	pfd.fd     = ListenSock;
+	pfd.events = POLLIN;
+	while ( !Terminate ) {
+		if ( poll(&pfd, 1, 200) <= 0 || (ClientSock = accept(ListenSock, NULL, NULL)) < 0 )
+			continue;
+		ConnectCount++;
+		printf("Client connected.\n");
+		PaceStarted = 0;
+		return 0;
+	}
+
+	return -1;
+}
+
+/**
+ * @brief
+ *
+ * @return int
+ */
+static int listen_sock_construct( void )
+{
+	struct addrinfo  hints;
+	struct addrinfo *servinfo, *p;
+	int              sock     = -1;
+	int              sock_opt = 1;
+
+/* */
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family   = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags    = AI_PASSIVE;
+	if ( getaddrinfo(NULL, Port, &hints, &servinfo) ) {
+		fprintf(stderr, "Error getting the address of port %s!\n", Port);
+		return -1;
+	}
+/* */
+	for ( p = servinfo; p != NULL; p = p->ai_next ) {
+		if ( (sock = socket(p->ai_family, p->ai_socktype, p->ai_protocol)) < 0 )
+			continue;
+		setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &sock_opt, sizeof(sock_opt));
+		if ( bind(sock, p->ai_addr, p->ai_addrlen) == 0 && listen(sock, 1) == 0 )
+			break;
+		close(sock);
+		sock = -1;
+	}
+	freeaddrinfo(servinfo);
+	if ( sock < 0 )
+		fprintf(stderr, "Error listening on port %s: %s!\n", Port, strerror(errno));
+
+	return sock;
+}
+
+/**
+ * @brief
+ *
+ * @param sock
+ * @param buffer
+ * @param length
+ * @return int
+ */
+static int send_all( const int sock, const uint8_t *buffer, const int length )
+{
+	ssize_t ret;
+
+	for ( int sent = 0; sent < length; sent += ret ) {
+		if ( (ret = send(sock, buffer + sent, length - sent, MSG_NOSIGNAL)) <= 0 ) {
+			if ( ret < 0 && errno == EINTR && !Terminate ) {
+				ret = 0;
+				continue;
+			}
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief
+ *
+ * @param elapsed
+ * @param final
+ */
+static void report_print( const double elapsed, const int final )
+{
+	uint64_t decoded;
+	uint64_t framed;
+	uint64_t sync_errors;
+
+/* The client reader counts its own framing into the metrics */
+	pthread_mutex_lock(&DecodeMutex);
+	decoded     = ModeCount[0] + ModeCount[1] + ModeCount[2];
+	framed      = FramedCount + pa2ew_metrics_get( PA2EW_METRIC_RECV_PACKETS );
+	sync_errors = SyncErrors + pa2ew_metrics_get( PA2EW_METRIC_SYNC_ERRORS );
+/* */
+	printf(
+		"%s %.1f sec: %lu chunks (%.1f/sec), %.2f MB (%.2f MB/sec)",
+		final ? "Total" : "Elapsed", elapsed, (unsigned long)RecordCount, elapsed > 0.0 ? RecordCount / elapsed : 0.0,
+		ByteCount / 1048576.0, elapsed > 0.0 ? ByteCount / 1048576.0 / elapsed : 0.0
+	);
+	if ( Target == REPLAY_TARGET_DECODE ) {
+		printf(
+			", %lu packets framed (%.1f/sec), %lu sync errors, %lu CRC failures, %lu NTP questionable, %lu unknown.\n",
+			(unsigned long)framed, elapsed > 0.0 ? framed / elapsed : 0.0, (unsigned long)sync_errors,
+			(unsigned long)CRCFailures, (unsigned long)NTPQuestion, (unsigned long)__atomic_load_n(&UnknownCount, __ATOMIC_RELAXED)
+		);
+		if ( final )
+			printf(
+				"Decoded %lu packets of mode 1, %lu of mode 4 & %lu of mode 16, %.2f usec per packet.\n",
+				(unsigned long)ModeCount[0], (unsigned long)ModeCount[1], (unsigned long)ModeCount[2],
+				decoded ? DecodeTime * 1.0e6 / decoded : 0.0
+			);
+	}
+	else {
+		printf(", %lu connections, %lu failures.\n", (unsigned long)ConnectCount, (unsigned long)FailureCount);
+	}
+	if ( final && (SkippedCount || GarbageBytes) )
+		printf("Skipped %lu chunks for the other target or Palert, %lu bytes of broken records.\n", (unsigned long)SkippedCount, (unsigned long)GarbageBytes);
+	pthread_mutex_unlock(&DecodeMutex);
+	fflush(stdout);
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @return double
+ */
+static double time_now_get( void )
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
+
+/**
+ * @brief
+ *
+ * @param time_mono
+ */
+static void sleep_until( const double time_mono )
+{
+	struct timespec ts;
+
+	ts.tv_sec  = (time_t)time_mono;
+	ts.tv_nsec = (long)((time_mono - ts.tv_sec) * 1.0e9);
+	while ( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR && !Terminate );
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param sig
+ */
+static void handle_terminate( int sig )
+{
+	Terminate = 1;
+
+	return;
+}
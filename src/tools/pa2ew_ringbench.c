@@ -0,0 +1,440 @@
+/**
+ * @file pa2ew_ringbench.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Benchmark of putting messages one by one by tport_putmsg against committing them by batch, and
+ *        checking the batch written messages by tport_getmsg on a private ring: interleaved with tport_putmsg,
+ *        two writers of the same logo, and wrapping around a small ring many times. During the benchmark, a
+ *        tport_getmsg reader in another process reads the ring concurrently.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/**
+ * @name Earthworm environment header include
+ *
+ */
+#include <earthworm.h>
+#include <transport.h>
+#include <trace_buf.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <palert2ew_ring.h>
+
+/**
+ * @name Benchmark constants
+ *
+ */
+#define BENCH_DEF_RING_KEY   1047
+#define BENCH_RING_SIZE      (16 * 1024 * 1024)
+#define BENCH_DEF_PACKETS    200000
+#define BENCH_CHANNELS       5
+#define BENCH_SAMPLES        100
+#define BENCH_CHECK_PACKETS  1000
+#define BENCH_WRAP_RING_SIZE (256 * 1024)
+#define BENCH_WRAP_PACKETS   20000
+#define BENCH_MSG_SIZE       (sizeof(TRACE2_HEADER) + BENCH_SAMPLES * sizeof(int32_t))
+
+/**
+ * @name Internal functions' prototype
+ *
+ */
+static void   gen_messages( void );
+static double bench_putmsg( SHM_INFO *, const int );
+static double bench_batch( SHM_INFO *, const int, const int );
+static int    check_messages( SHM_INFO * );
+static int    check_wrapping( SHM_INFO * );
+static int    read_message( SHM_INFO *, MSG_LOGO *, int [2] );
+static pid_t  reader_start( const long );
+static void   reader_stop( SHM_INFO *, const pid_t );
+static double time_now_get( void );
+
+/**
+ * @name Internal static variables
+ *
+ */
+static uint8_t  Messages[BENCH_CHANNELS][BENCH_MSG_SIZE];
+static MSG_LOGO PutLogo   = { 19, 0, 0 };
+static MSG_LOGO BatchLogo = { 19, 1, 0 };
+static MSG_LOGO StopLogo  = { 20, 0, 0 };
+
+/**
+ * @brief Usage: pa2ew_ringbench [packets] [ring key]
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main( int argc, char **argv )
+{
+	int      npacket = argc > 1 ? atoi(argv[1]) : BENCH_DEF_PACKETS;
+	long     key     = argc > 2 ? atol(argv[2]) : BENCH_DEF_RING_KEY;
+	double   time_ref;
+	double   time_used;
+	double   total;
+	pid_t    reader;
+	SHM_INFO region;
+
+/* */
+	if ( npacket <= 0 )
+		npacket = BENCH_DEF_PACKETS;
+	total = (double)npacket * BENCH_CHANNELS;
+	gen_messages();
+/* Check the layout first, on a clean ring */
+	tport_create(&region, BENCH_RING_SIZE, key);
+	if ( check_messages( &region ) ) {
+		tport_destroy(&region);
+		return -1;
+	}
+	tport_destroy(&region);
+	fprintf(
+		stdout, "pa2ew_ringbench: %d messages interleaved with tport_putmsg & two writers are read back by tport_getmsg without any miss.\n",
+		BENCH_CHECK_PACKETS * BENCH_CHANNELS * 3
+	);
+/* Then wrap around the small ring many times, with the reader keeping up; each ring has its own key for the tracking */
+	tport_create(&region, BENCH_WRAP_RING_SIZE, key + 1);
+	if ( check_wrapping( &region ) ) {
+		tport_destroy(&region);
+		return -1;
+	}
+	fprintf(
+		stdout, "pa2ew_ringbench: %d messages wrapped around the %d KiB ring %ld times are read back without any miss.\n",
+		BENCH_WRAP_PACKETS * BENCH_CHANNELS, BENCH_WRAP_RING_SIZE >> 10, region.addr->keyin / region.addr->keymax
+	);
+	tport_destroy(&region);
+/* */
+	tport_create(&region, BENCH_RING_SIZE, key + 2);
+	reader   = reader_start( key + 2 );
+	time_ref = bench_putmsg( &region, npacket );
+	reader_stop( &region, reader );
+	fprintf(stdout, "tport_putmsg         : %10.0f msgs/s\n", total / time_ref);
+	reader    = reader_start( key + 2 );
+	time_used = bench_batch( &region, npacket, 1 );
+	reader_stop( &region, reader );
+	fprintf(stdout, "batch of one packet  : %10.0f msgs/s (%.2fx)\n", total / time_used, time_ref / time_used);
+	reader    = reader_start( key + 2 );
+	time_used = bench_batch( &region, npacket, npacket );
+	reader_stop( &region, reader );
+	fprintf(stdout, "batch of %d KiB      : %10.0f msgs/s (%.2fx)\n", PA2EW_RING_DEF_BATCH_SIZE >> 10, total / time_used, time_ref / time_used);
+	tport_destroy(&region);
+
+	return 0;
+}
+
+/**
+ * @brief Trace buffers of 100 samples, just like the mode 1 packets.
+ *
+ */
+static void gen_messages( void )
+{
+	TRACE2_HEADER *trh2;
+	int32_t       *data;
+
+/* */
+	srand(1);
+	for ( int i = 0; i < BENCH_CHANNELS; i++ ) {
+		trh2 = (TRACE2_HEADER *)Messages[i];
+		memset(trh2, 0, sizeof(TRACE2_HEADER));
+		trh2->nsamp    = BENCH_SAMPLES;
+		trh2->samprate = 100.0;
+		snprintf(trh2->sta, TRACE2_STA_LEN, "B%04d", i);
+		data = (int32_t *)(trh2 + 1);
+		for ( int j = 0; j < BENCH_SAMPLES; j++ )
+			data[j] = rand();
+	}
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param region
+ * @param npacket
+ * @return double
+ */
+static double bench_putmsg( SHM_INFO *region, const int npacket )
+{
+	double result = time_now_get();
+
+/* */
+	for ( int i = 0; i < npacket; i++ )
+		for ( int j = 0; j < BENCH_CHANNELS; j++ )
+			tport_putmsg(region, &PutLogo, BENCH_MSG_SIZE, (char *)Messages[j]);
+
+	return time_now_get() - result;
+}
+
+/**
+ * @brief
+ *
+ * @param region
+ * @param npacket
+ * @param commit_every Commit after these number of packets, the full batch is committed anyway.
+ * @return double
+ */
+static double bench_batch( SHM_INFO *region, const int npacket, const int commit_every )
+{
+	PA2EW_RING_WRITER writer;
+	double            result;
+
+/* */
+	pa2ew_ring_writer_init( &writer, region, PA2EW_RING_DEF_BATCH_SIZE );
+	result = time_now_get();
+	for ( int i = 0; i < npacket; i++ ) {
+		for ( int j = 0; j < BENCH_CHANNELS; j++ )
+			pa2ew_ring_writer_add( &writer, &BatchLogo, BENCH_MSG_SIZE, Messages[j] );
+		if ( (i + 1) % commit_every == 0 )
+			pa2ew_ring_writer_commit( &writer );
+	}
+	pa2ew_ring_writer_commit( &writer );
+	result = time_now_get() - result;
+	pa2ew_ring_writer_free( &writer );
+
+	return result;
+}
+
+/**
+ * @brief Interleave the messages put by tport_putmsg & the batch, and two writers sharing the same logo, then
+ *        read all of them back.
+ *
+ * @param region
+ * @return int
+ */
+static int check_messages( SHM_INFO *region )
+{
+	PA2EW_RING_WRITER writer[2];
+	MSG_LOGO          getlogo = { 19, WILD, WILD };
+	int               count[2] = { 0 };
+	int               ret;
+
+/* */
+	if (
+		pa2ew_ring_writer_init( &writer[0], region, PA2EW_RING_DEF_BATCH_SIZE ) ||
+		pa2ew_ring_writer_init( &writer[1], region, PA2EW_RING_DEF_BATCH_SIZE )
+	) {
+		fprintf(stderr, "pa2ew_ringbench: The batch writer is not supported on this platform!\n");
+		return -1;
+	}
+/* The messages of the same logo from two writers should be in order, so commit the first one before adding */
+	for ( int i = 0; i < BENCH_CHECK_PACKETS; i++ ) {
+		for ( int j = 0; j < BENCH_CHANNELS; j++ ) {
+			pa2ew_ring_writer_add( &writer[0], &BatchLogo, BENCH_MSG_SIZE, Messages[j] );
+			tport_putmsg(region, &PutLogo, BENCH_MSG_SIZE, (char *)Messages[j]);
+		}
+		if ( i % 7 == 0 || i % 11 == 0 ) {
+			pa2ew_ring_writer_commit( &writer[0] );
+			for ( int j = 0; j < BENCH_CHANNELS; j++ )
+				pa2ew_ring_writer_add( &writer[1], &BatchLogo, BENCH_MSG_SIZE, Messages[(count[1] + j) % BENCH_CHANNELS] );
+			pa2ew_ring_writer_commit( &writer[1] );
+		}
+		else {
+			for ( int j = 0; j < BENCH_CHANNELS; j++ )
+				pa2ew_ring_writer_add( &writer[0], &BatchLogo, BENCH_MSG_SIZE, Messages[j] );
+		}
+	}
+	pa2ew_ring_writer_commit( &writer[0] );
+	pa2ew_ring_writer_free( &writer[0] );
+	pa2ew_ring_writer_free( &writer[1] );
+/* */
+	while ( (ret = read_message( region, &getlogo, count )) > 0 );
+	if ( ret < 0 )
+		return -1;
+	if ( count[0] != BENCH_CHECK_PACKETS * BENCH_CHANNELS || count[1] != BENCH_CHECK_PACKETS * BENCH_CHANNELS * 2 ) {
+		fprintf(stderr, "pa2ew_ringbench: Only %d & %d messages are read back!\n", count[0], count[1]);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Write & read much more than the ring can hold, the reader reads after each commit.
+ *
+ * @param region
+ * @return int
+ */
+static int check_wrapping( SHM_INFO *region )
+{
+	PA2EW_RING_WRITER writer;
+	MSG_LOGO          getlogo = { 19, WILD, WILD };
+	int               count[2] = { 0 };
+	int               ret;
+
+/* */
+	if ( pa2ew_ring_writer_init( &writer, region, PA2EW_RING_DEF_BATCH_SIZE ) ) {
+		fprintf(stderr, "pa2ew_ringbench: The batch writer is not supported on this platform!\n");
+		return -1;
+	}
+	for ( int i = 0; i < BENCH_WRAP_PACKETS; i++ ) {
+		for ( int j = 0; j < BENCH_CHANNELS; j++ )
+			pa2ew_ring_writer_add( &writer, &BatchLogo, BENCH_MSG_SIZE, Messages[j] );
+		if ( i % 13 == 0 ) {
+			pa2ew_ring_writer_commit( &writer );
+			while ( (ret = read_message( region, &getlogo, count )) > 0 );
+			if ( ret < 0 )
+				break;
+		}
+	}
+	pa2ew_ring_writer_commit( &writer );
+	pa2ew_ring_writer_free( &writer );
+/* */
+	while ( (ret = read_message( region, &getlogo, count )) > 0 );
+	if ( ret < 0 )
+		return -1;
+	if ( count[1] != BENCH_WRAP_PACKETS * BENCH_CHANNELS ) {
+		fprintf(stderr, "pa2ew_ringbench: Only %d messages are read back!\n", count[1]);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Get one message from the ring, it should be got without any miss & be the next one of its module.
+ *
+ * @param region
+ * @param getlogo
+ * @param count
+ * @return int 1 for one message, 0 for none & -1 for error.
+ */
+static int read_message( SHM_INFO *region, MSG_LOGO *getlogo, int count[2] )
+{
+	static char msg[BENCH_MSG_SIZE];
+	MSG_LOGO    logo;
+	long        length;
+	int         ret;
+
+/* */
+	if ( (ret = tport_getmsg(region, getlogo, 1, &logo, &length, msg, BENCH_MSG_SIZE)) == GET_NONE )
+		return 0;
+	if ( ret != GET_OK || length != BENCH_MSG_SIZE || logo.mod > 1 ) {
+		fprintf(stderr, "pa2ew_ringbench: Getting message from the ring failed (%d)!\n", ret);
+		return -1;
+	}
+	if ( memcmp(msg, Messages[count[logo.mod] % BENCH_CHANNELS], BENCH_MSG_SIZE) ) {
+		fprintf(stderr, "pa2ew_ringbench: The message from module %d is different!\n", logo.mod);
+		return -1;
+	}
+	count[logo.mod]++;
+
+	return 1;
+}
+
+/**
+ * @brief Start a tport_getmsg reader in another process, it keeps reading until the stop message.
+ *
+ * @param key
+ * @return pid_t
+ */
+static pid_t reader_start( const long key )
+{
+	SHM_INFO region;
+	MSG_LOGO getlogo[2] = { { 19, WILD, WILD }, { 20, WILD, WILD } };
+	MSG_LOGO logo;
+	long     length;
+	long     got     = 0;
+	long     lapped  = 0;
+	long     seqgaps = 0;
+	long     others  = 0;
+	int      ret;
+	int      ready[2];
+	char     dummy = 0;
+	pid_t    result;
+	static char msg[BENCH_MSG_SIZE];
+
+/* */
+	fflush(stdout);
+	if ( pipe(ready) )
+		return -1;
+	if ( (result = fork()) ) {
+	/* Wait for the reader skipping the previous messages */
+		if ( result < 0 || read(ready[0], &dummy, 1) != 1 )
+			fprintf(stderr, "pa2ew_ringbench: Cannot start the reader!\n");
+		close(ready[0]);
+		close(ready[1]);
+		return result;
+	}
+/* Start from the latest message */
+	tport_attach(&region, key);
+	while ( tport_getmsg(&region, getlogo, 2, &logo, &length, msg, BENCH_MSG_SIZE) != GET_NONE );
+	if ( write(ready[1], &dummy, 1) != 1 )
+		exit(-1);
+	do {
+		if ( (ret = tport_getmsg(&region, getlogo, 2, &logo, &length, msg, BENCH_MSG_SIZE)) == GET_NONE ) {
+			usleep(100);
+			continue;
+		}
+		switch ( ret ) {
+		case GET_OK:
+			got++;
+			break;
+		case GET_MISS_LAPPED:
+			got++;
+			lapped++;
+			break;
+		case GET_MISS_SEQGAP:
+			got++;
+			seqgaps++;
+			break;
+		default:
+			others++;
+			break;
+		}
+	} while ( ret == GET_NONE || logo.type != StopLogo.type );
+/* Exclude the stop message */
+	fprintf(
+		stdout, "  reader: %ld got, %ld lapped, %ld sequence gaps, %ld the others\n", got - 1, lapped, seqgaps, others
+	);
+	tport_detach(&region);
+	exit(0);
+}
+
+/**
+ * @brief
+ *
+ * @param region
+ * @param reader
+ */
+static void reader_stop( SHM_INFO *region, const pid_t reader )
+{
+	char stop = 0;
+
+/* */
+	if ( reader > 0 ) {
+		tport_putmsg(region, &StopLogo, 1, &stop);
+		waitpid(reader, NULL, 0);
+	}
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @return double
+ */
+static double time_now_get( void )
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
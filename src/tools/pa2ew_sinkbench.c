@@ -0,0 +1,258 @@
+/**
+ * @file pa2ew_sinkbench.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Benchmark of the output sinks without any Earthworm ring, and checking the memory ring sink with a
+ *        concurrent reader.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+/**
+ * @name Earthworm environment header include
+ *
+ */
+#include <earthworm.h>
+#include <transport.h>
+#include <trace_buf.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <palert2ew_sink.h>
+
+/**
+ * @name Benchmark constants
+ *
+ */
+#define BENCH_DEF_PACKETS    200000
+#define BENCH_DEF_FILE       "/dev/null"
+#define BENCH_CHANNELS       5
+#define BENCH_SAMPLES        100
+#define BENCH_CHECK_MESSAGES 2000000
+#define BENCH_CHECK_RINGSIZE (256 * 1024)
+#define BENCH_MSG_SIZE       (sizeof(TRACE2_HEADER) + BENCH_SAMPLES * sizeof(int32_t))
+
+/**
+ * @brief Result of the concurrent reader
+ *
+ */
+typedef struct {
+	PA2EW_SINK *sink;
+	uint64_t    read;
+	uint64_t    missed;
+	uint64_t    torn;
+} CHECK_READER;
+
+/**
+ * @name Internal functions' prototype
+ *
+ */
+static void   gen_messages( void );
+static double bench_sink( PA2EW_SINK *, const int );
+static int    check_memring( void );
+static void  *check_reader_thread( void * );
+static double time_now_get( void );
+
+/**
+ * @name Internal static variables
+ *
+ */
+static uint8_t         Messages[BENCH_CHANNELS][BENCH_MSG_SIZE];
+static MSG_LOGO        PutLogo = { 19, 0, 0 };
+static volatile int    WriterDone = 0;
+
+/**
+ * @brief Usage: pa2ew_sinkbench [packets] [file of the file sink]
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main( int argc, char **argv )
+{
+	int         npacket = argc > 1 ? atoi(argv[1]) : BENCH_DEF_PACKETS;
+	const char *path    = argc > 2 ? argv[2] : BENCH_DEF_FILE;
+	double      total;
+	double      time_used;
+	PA2EW_SINK *sink;
+
+/* */
+	if ( npacket <= 0 )
+		npacket = BENCH_DEF_PACKETS;
+	total = (double)npacket * BENCH_CHANNELS;
+	gen_messages();
+/* */
+	if ( check_memring() )
+		return -1;
+/* */
+	sink = pa2ew_sink_discard_open();
+	time_used = bench_sink( sink, npacket );
+	fprintf(stdout, "discard sink : %10.0f msgs/s\n", total / time_used);
+	pa2ew_sink_close( sink );
+/* */
+	sink = pa2ew_sink_memring_open( PA2EW_SINK_DEF_MEMRING_SIZE );
+	time_used = bench_sink( sink, npacket );
+	fprintf(stdout, "memory sink  : %10.0f msgs/s\n", total / time_used);
+	pa2ew_sink_close( sink );
+/* */
+	if ( (sink = pa2ew_sink_file_open( path )) ) {
+		time_used = bench_sink( sink, npacket );
+		fprintf(stdout, "file sink    : %10.0f msgs/s (%s)\n", total / time_used, path);
+		pa2ew_sink_close( sink );
+	}
+	else {
+		fprintf(stderr, "pa2ew_sinkbench: Cannot open the file %s, skip the file sink!\n", path);
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Trace buffers of 100 samples, just like the mode 1 packets.
+ *
+ */
+static void gen_messages( void )
+{
+	TRACE2_HEADER *trh2;
+	int32_t       *data;
+
+/* */
+	srand(1);
+	for ( int i = 0; i < BENCH_CHANNELS; i++ ) {
+		trh2 = (TRACE2_HEADER *)Messages[i];
+		memset(trh2, 0, sizeof(TRACE2_HEADER));
+		trh2->nsamp    = BENCH_SAMPLES;
+		trh2->samprate = 100.0;
+		snprintf(trh2->sta, TRACE2_STA_LEN, "B%04d", i);
+		data = (int32_t *)(trh2 + 1);
+		for ( int j = 0; j < BENCH_SAMPLES; j++ )
+			data[j] = rand();
+	}
+
+	return;
+}
+
+/**
+ * @brief Put all the channels of each packet, then commit it just like the main loop.
+ *
+ * @param sink
+ * @param npacket
+ * @return double
+ */
+static double bench_sink( PA2EW_SINK *sink, const int npacket )
+{
+	double result = time_now_get();
+
+/* */
+	for ( int i = 0; i < npacket; i++ ) {
+		for ( int j = 0; j < BENCH_CHANNELS; j++ )
+			pa2ew_sink_put( sink, &PutLogo, BENCH_MSG_SIZE, Messages[j] );
+		pa2ew_sink_commit( sink );
+	}
+
+	return time_now_get() - result;
+}
+
+/**
+ * @brief Write the numbered messages into a small memory ring as fast as possible, the reader should never
+ *        get a torn message or a number out of order, but it might miss some of them.
+ *
+ * @return int
+ */
+static int check_memring( void )
+{
+	CHECK_READER reader = { 0 };
+	pthread_t    tid;
+	uint8_t      msg[BENCH_MSG_SIZE];
+	int32_t     *data = (int32_t *)(msg + sizeof(TRACE2_HEADER));
+
+/* */
+	if ( !(reader.sink = pa2ew_sink_memring_open( BENCH_CHECK_RINGSIZE )) )
+		return -1;
+	memcpy(msg, Messages[0], BENCH_MSG_SIZE);
+	if ( pthread_create(&tid, NULL, check_reader_thread, &reader) ) {
+		pa2ew_sink_close( reader.sink );
+		return -1;
+	}
+/* The number at the both ends */
+	for ( int32_t i = 1; i <= BENCH_CHECK_MESSAGES; i++ ) {
+		data[0] = data[BENCH_SAMPLES - 1] = i;
+		pa2ew_sink_put( reader.sink, &PutLogo, BENCH_MSG_SIZE, msg );
+	}
+	__atomic_store_n(&WriterDone, 1, __ATOMIC_RELEASE);
+	pthread_join(tid, NULL);
+	pa2ew_sink_close( reader.sink );
+/* */
+	fprintf(
+		stdout, "pa2ew_sinkbench: The memory ring reader got %lu messages (overrun %lu times), %lu torn.\n",
+		(unsigned long)reader.read, (unsigned long)reader.missed, (unsigned long)reader.torn
+	);
+
+	return reader.torn || !reader.read ? -1 : 0;
+}
+
+/**
+ * @brief
+ *
+ * @param arg
+ * @return void*
+ */
+static void *check_reader_thread( void *arg )
+{
+	CHECK_READER        *reader = (CHECK_READER *)arg;
+	PA2EW_MEMRING_READER memring;
+	MSG_LOGO             logo;
+	long                 length;
+	int                  ret;
+	int32_t              last = 0;
+	uint8_t              msg[BENCH_MSG_SIZE];
+	const int32_t       *data = (const int32_t *)(msg + sizeof(TRACE2_HEADER));
+
+/* */
+	pa2ew_memring_reader_init( &memring, reader->sink );
+	while ( 1 ) {
+		ret = pa2ew_memring_getmsg( &memring, &logo, &length, msg, BENCH_MSG_SIZE );
+		if ( ret == GET_NONE ) {
+			if ( __atomic_load_n(&WriterDone, __ATOMIC_ACQUIRE) && (ret = pa2ew_memring_getmsg( &memring, &logo, &length, msg, BENCH_MSG_SIZE )) == GET_NONE )
+				break;
+			else if ( ret == GET_NONE )
+				continue;
+		}
+	/* */
+		if ( ret == GET_TOOBIG || length != BENCH_MSG_SIZE || data[0] != data[BENCH_SAMPLES - 1] || data[0] <= last )
+			reader->torn++;
+		last = data[0];
+		reader->read++;
+	}
+	reader->missed = memring.missed;
+
+	return NULL;
+}
+
+/**
+ * @brief
+ *
+ * @return double
+ */
+static double time_now_get( void )
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
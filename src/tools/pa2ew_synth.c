@@ -0,0 +1,453 @@
+/**
+ * @file pa2ew_synth.c
+ * @author Benjamin Ming Yang @ Department of Geology, National Taiwan University
+ * @brief Synthetic Palert packets built on the header definitions of libpalertc, for the testing tools.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+/**
+ * @name Standard C header include
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+
+/**
+ * @name Local header include
+ *
+ */
+#include <libpalertc/libpalertc.h>
+#include <pa2ew_synth.h>
+
+/**
+ * @name Internal functions' prototype
+ *
+ */
+static int     build_packet_m1( PA2EW_SYNTH *, uint8_t *, const double );
+static int     build_packet_m4( PA2EW_SYNTH *, uint8_t *, const double );
+static int     build_packet_m16( PA2EW_SYNTH *, uint8_t *, const double );
+static int32_t sample_gen( PA2EW_SYNTH *, const int, const int64_t );
+static void    word_set( uint8_t *, const uint16_t );
+static void    word_set_be( uint8_t *, const uint16_t );
+
+/**
+ * @name Internal static variables
+ *
+ */
+static const char *ChanCodes[PA2EW_SYNTH_MAX_CHANNELS] = { "HLZ", "HLN", "HLE", "HHZ", "HHN", "HHE", "HGZ", "HGN" };
+static int32_t     SineTable[PALERT_MAX_SAMPRATE];  /* One period of the sine wave, so sin() won't be the bottleneck */
+static int         SineRate = 0;
+
+/**
+ * @brief Setup the simulated Palert, mode 1 always carries 100 samples of 5 channels, the channel number of it
+ *        only limits the listed channels.
+ *
+ * @param synth
+ * @param mode
+ * @param index
+ * @param serial
+ * @param samprate
+ * @param nsamp
+ * @param nchannel
+ * @return int The packet length, or -1 for the unsupported setting.
+ */
+int pa2ew_synth_init(
+	PA2EW_SYNTH *synth, const int mode, const int index, const uint32_t serial, const int samprate, const int nsamp, const int nchannel
+) {
+	memset(synth, 0, sizeof(PA2EW_SYNTH));
+	synth->mode       = mode;
+	synth->index      = index;
+	synth->serial     = serial;
+	synth->ntp_synced = 1;
+	synth->samprate   = samprate;
+	synth->nsamp      = mode == PALERT_PKT_MODE1 ? PALERT_M1_SAMPLE_NUMBER : nsamp;
+	synth->nchannel   = mode == PALERT_PKT_MODE1 && nchannel > PALERT_M1_CHAN_COUNT ? PALERT_M1_CHAN_COUNT : nchannel;
+	synth->rand_state = 0x9e3779b97f4a7c15ULL * (serial + 1);
+/* */
+	if ( samprate <= 0 || samprate > PALERT_MAX_SAMPRATE || synth->nsamp <= 0 || synth->nsamp > PALERT_MAX_SAMPRATE )
+		return -1;
+	if ( synth->nchannel <= 0 || synth->nchannel > PA2EW_SYNTH_MAX_CHANNELS )
+		return -1;
+	if ( mode != PALERT_PKT_MODE16 && serial > UINT16_MAX )
+		return -1;
+	if ( mode != PALERT_PKT_MODE1 && mode != PALERT_PKT_MODE4 && mode != PALERT_PKT_MODE16 )
+		return -1;
+/* The table is shared by all the Palerts, so it should be built before any packet building */
+	if ( SineRate != samprate ) {
+		for ( int i = 0; i < samprate; i++ )
+			SineTable[i] = (int32_t)lround(PA2EW_SYNTH_SIGNAL_AMP * sin(2.0 * M_PI * i / samprate));
+		SineRate = samprate;
+	}
+
+	return pa2ew_synth_length_get( synth ) <= PALERT_M16_PACKET_MAX_LENGTH ? pa2ew_synth_length_get( synth ) : -1;
+}
+
+/**
+ * @brief
+ *
+ * @param synth
+ * @return int
+ */
+int pa2ew_synth_length_get( const PA2EW_SYNTH *synth )
+{
+	switch ( synth->mode ) {
+	case PALERT_PKT_MODE1: default:
+		return PALERT_M1_PACKET_LENGTH;
+/* Mode 4 carries one Streamline mini-SEED record in 32-bit integer for each channel */
+	case PALERT_PKT_MODE4:
+		return PALERT_M4_HEADER_LENGTH + synth->nchannel * (sizeof(PALERT_M4_SMSR_HEADER) + synth->nsamp * 4);
+	case PALERT_PKT_MODE16:
+		return PALERT_M16_HEADER_LENGTH + synth->nchannel * synth->nsamp * 4 + 2;
+	}
+}
+
+/**
+ * @brief
+ *
+ * @param synth
+ * @param buffer
+ * @param data_time Calendar time of the first sample.
+ * @return int The packet length.
+ */
+int pa2ew_synth_packet_build( PA2EW_SYNTH *synth, uint8_t *buffer, const double data_time )
+{
+	switch ( synth->mode ) {
+	case PALERT_PKT_MODE1: default:
+		return build_packet_m1( synth, buffer, data_time );
+	case PALERT_PKT_MODE4:
+		return build_packet_m4( synth, buffer, data_time );
+	case PALERT_PKT_MODE16:
+		return build_packet_m16( synth, buffer, data_time );
+	}
+}
+
+/**
+ * @brief Corrupt one byte, so the CRC check fails while the framing still holds.
+ *
+ * @param synth
+ * @param buffer
+ * @param length
+ */
+void pa2ew_synth_packet_corrupt( PA2EW_SYNTH *synth, uint8_t *buffer, const int length )
+{
+/* The check sum of mode 4 only covers the first 8 bytes, so the check sum itself is corrupted */
+	if ( synth->mode == PALERT_PKT_MODE4 )
+		((PALERT_M4_HEADER *)buffer)->crc16_byte[0] ^= 0x5a;
+	else
+		buffer[length - 1 - (int)(pa2ew_synth_rand( &synth->rand_state ) % (length / 4))] ^= 0x5a;
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param mode
+ * @param chan
+ * @return const char*
+ */
+const char *pa2ew_synth_chan_code_get( const int mode, const int chan )
+{
+/* The channels of mode 1 are fixed by libpalertc */
+	if ( mode == PALERT_PKT_MODE1 )
+		return pac_m1_chan_code_get( chan );
+
+	return chan >= 0 && chan < PA2EW_SYNTH_MAX_CHANNELS ? ChanCodes[chan] : "NULL";
+}
+
+/**
+ * @brief Write the station list in the format of the palert2ew local list.
+ *
+ * @param path
+ * @param mode
+ * @param serial_base
+ * @param nstation
+ * @param nchannel
+ * @return int
+ */
+int pa2ew_synth_list_write( const char *path, const int mode, const uint32_t serial_base, const int nstation, const int nchannel )
+{
+	FILE *fp = fopen(path, "w");
+
+/* */
+	if ( !fp ) {
+		fprintf(stderr, "Error opening the station list %s: %s!\n", path, strerror(errno));
+		return -1;
+	}
+/* */
+	fprintf(fp, "# Generated for the synthetic mode %d packets\n", mode);
+	fprintf(fp, "# Palert   Serial   Station   Network   Location   Nchannel   Channel_0   Channel_1   Channel_2 ...\n");
+	for ( int i = 0; i < nstation; i++ ) {
+		fprintf(
+			fp, "Palert   %u   " PA2EW_SYNTH_STA_FORMAT "   %s   %s   %d",
+			serial_base + i, i, PA2EW_SYNTH_NETWORK, PA2EW_SYNTH_LOCATION, nchannel
+		);
+		for ( int j = 0; j < nchannel; j++ )
+			fprintf(fp, "   %s", pa2ew_synth_chan_code_get( mode, j ));
+		fprintf(fp, "\n");
+	}
+	fclose(fp);
+	printf("Station list of %d Palerts is written to %s.\n", nstation, path);
+
+	return 0;
+}
+
+/**
+ * @brief xorshift64*
+ *
+ * @param state
+ * @return uint64_t
+ */
+uint64_t pa2ew_synth_rand( uint64_t *state )
+{
+	uint64_t x = *state;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+
+	return x * 0x2545f4914f6cdd1dULL;
+}
+
+/**
+ * @brief Mode 1 packet with the system time in UTC, so palert2ew will find the zero time zone offset.
+ *
+ * @param synth
+ * @param buffer
+ * @param data_time
+ * @return int
+ */
+static int build_packet_m1( PA2EW_SYNTH *synth, uint8_t *buffer, const double data_time )
+{
+	static const uint8_t sync_char[8] = {
+		PALERT_M1_SYNC_CHAR_0, PALERT_M1_SYNC_CHAR_1, PALERT_M1_SYNC_CHAR_2, PALERT_M1_SYNC_CHAR_3,
+		PALERT_M1_SYNC_CHAR_4, PALERT_M1_SYNC_CHAR_5, PALERT_M1_SYNC_CHAR_6, PALERT_M1_SYNC_CHAR_7
+	};
+	PALERT_M1_PACKET *packet = (PALERT_M1_PACKET *)buffer;
+	PALERT_M1_HEADER *pah    = &packet->header;
+	const time_t      sec    = (time_t)data_time;
+	const int         msec   = (int)((data_time - sec) * 1000.0 + 0.5);
+	const int64_t     first  = llround(data_time * synth->samprate);
+	struct tm         tm;
+	uint16_t          crc;
+
+/* */
+	memset(packet, 0, PALERT_M1_PACKET_LENGTH);
+	gmtime_r(&sec, &tm);
+	word_set( pah->packet_type, PALERT_M1_PACKETTYPE_NORMAL );
+	word_set( pah->sys_year, tm.tm_year + 1900 );
+	word_set( pah->sys_month, tm.tm_mon + 1 );
+	word_set( pah->sys_day, tm.tm_mday );
+	word_set( pah->sys_hour, tm.tm_hour );
+	word_set( pah->sys_minute, tm.tm_min );
+	pah->sys_tenmsec = msec / 10;
+	pah->sys_second  = tm.tm_sec;
+	word_set( pah->serial_no, synth->serial );
+	word_set( pah->firmware, PA2EW_SYNTH_FIRMWARE );
+	pah->connection_flag[0] = synth->ntp_synced ? 0x01 : 0x00;
+	memcpy(pah->sync_char, sync_char, sizeof(sync_char));
+	word_set( pah->packet_len, PALERT_M1_PACKET_LENGTH );
+	word_set( pah->samprate, synth->samprate );
+/* */
+	for ( int i = 0; i < PALERT_M1_SAMPLE_NUMBER; i++ )
+		for ( int j = 0; j < PALERT_M1_CHAN_COUNT; j++ )
+			word_set( packet->data[i].cmp[j], (uint16_t)(int16_t)sample_gen( synth, j, first + i ) );
+/* The check sum is calculated with the zero check sum bytes */
+	crc = pac_crc16_cal( packet, PALERT_M1_PACKET_LENGTH );
+	word_set( pah->crc16_byte, crc );
+
+	return PALERT_M1_PACKET_LENGTH;
+}
+
+/**
+ * @brief Mode 4 packet with one Streamline mini-SEED record in big-endian 32-bit integer for each channel.
+ *
+ * @param synth
+ * @param buffer
+ * @param data_time
+ * @return int
+ */
+static int build_packet_m4( PA2EW_SYNTH *synth, uint8_t *buffer, const double data_time )
+{
+	static const uint8_t sync_char[4] = {
+		PALERT_M4_SYNC_CHAR_0, PALERT_M4_SYNC_CHAR_1, PALERT_M4_SYNC_CHAR_2, PALERT_M4_SYNC_CHAR_3
+	};
+	PALERT_M4_HEADER      *pah4      = (PALERT_M4_HEADER *)buffer;
+	uint8_t               *dataptr   = (uint8_t *)(pah4 + 1);
+	PALERT_M4_SMSR_HEADER *smsrh;
+	const int              length    = pa2ew_synth_length_get( synth );
+	const int              msrlength = sizeof(PALERT_M4_SMSR_HEADER) + synth->nsamp * 4;
+	const time_t           sec       = (time_t)data_time;
+	const int              fract     = (int)((data_time - sec) * 10000.0 + 0.5);
+	const int64_t          first     = llround(data_time * synth->samprate);
+	char                   sta[8];
+	struct tm              tm;
+	uint16_t               crc;
+	int32_t                sample;
+
+/* */
+	memset(pah4, 0, length);
+	gmtime_r(&sec, &tm);
+	snprintf(sta, sizeof(sta), PA2EW_SYNTH_STA_FORMAT, synth->index);
+	word_set( pah4->packet_type, PALERT_PKT_MODE4 );
+	word_set( pah4->packet_len, length );
+	pah4->channel_number = synth->nchannel;
+	word_set( pah4->firmware, PA2EW_SYNTH_FIRMWARE );
+	word_set( pah4->serial, synth->serial );
+	pah4->connection_flag[0] = synth->ntp_synced ? 0x01 : 0x00;
+	memcpy(pah4->sync_char, sync_char, sizeof(sync_char));
+/* The check sum of the first 8 bytes including itself should be zero */
+	crc = pac_crc16_cal( pah4, PALERT_M4_CRC16_CAL_LENGTH - 2 );
+	word_set( pah4->crc16_byte, crc );
+/* */
+	for ( int i = 0; i < synth->nchannel; i++, dataptr += msrlength ) {
+		smsrh = (PALERT_M4_SMSR_HEADER *)dataptr;
+		memcpy(smsrh->sequence_number, "000001", 6);
+		smsrh->dataquality = 'D';
+		smsrh->reserved    = ' ';
+		memset(smsrh->station, ' ', sizeof(smsrh->station));
+		memcpy(smsrh->station, sta, strlen(sta) < sizeof(smsrh->station) ? strlen(sta) : sizeof(smsrh->station));
+		memset(smsrh->location, ' ', sizeof(smsrh->location));
+		memcpy(smsrh->channel, ChanCodes[i], sizeof(smsrh->channel));
+		memcpy(smsrh->network, PA2EW_SYNTH_NETWORK, sizeof(smsrh->network));
+		word_set_be( smsrh->year, tm.tm_year + 1900 );
+		word_set_be( smsrh->day, tm.tm_yday + 1 );
+		smsrh->hour = tm.tm_hour;
+		smsrh->min  = tm.tm_min;
+		smsrh->sec  = tm.tm_sec;
+		word_set_be( smsrh->fract, fract );
+		word_set_be( smsrh->numsamples, synth->nsamp );
+		word_set_be( smsrh->samprate_fact, synth->samprate );
+		word_set_be( smsrh->samprate_mult, 1 );
+	/* The time correction is applied already */
+		smsrh->act_flags     = 0x02;
+		smsrh->numblockettes = 1;
+		word_set_be( smsrh->data_offset, sizeof(PALERT_M4_SMSR_HEADER) );
+		word_set_be( smsrh->blockette_offset, offsetof(PALERT_M4_SMSR_HEADER, blkt_type) );
+		word_set_be( smsrh->blkt_type, 1000 );
+		smsrh->encoding  = PALERT_M4_ENCODING_INT32;
+		smsrh->byteorder = 1;
+		smsrh->reclen    = 9;
+		word_set_be( smsrh->smsrlength, msrlength );
+	/* */
+		for ( int j = 0; j < synth->nsamp; j++ ) {
+			sample = sample_gen( synth, i, first + j );
+			word_set_be( dataptr + sizeof(PALERT_M4_SMSR_HEADER) + j * 4, (uint32_t)sample >> 16 );
+			word_set_be( dataptr + sizeof(PALERT_M4_SMSR_HEADER) + j * 4 + 2, (uint32_t)sample & 0xffff );
+		}
+	}
+
+	return length;
+}
+
+/**
+ * @brief Mode 16 packet with the interleaved samples in gal & the check sum at the end.
+ *
+ * @param synth
+ * @param buffer
+ * @param data_time
+ * @return int
+ */
+static int build_packet_m16( PA2EW_SYNTH *synth, uint8_t *buffer, const double data_time )
+{
+	PALERT_M16_PACKET *packet   = (PALERT_M16_PACKET *)buffer;
+	PALERT_M16_HEADER *pah16    = &packet->header;
+	uint8_t           *dataptr  = &packet->bytes[PALERT_M16_HEADER_LENGTH];
+	const int          length   = pa2ew_synth_length_get( synth );
+	const int          data_len = synth->nchannel * synth->nsamp * 4;
+	const uint64_t     sec      = (uint64_t)data_time;
+	const int          msec     = (int)((data_time - sec) * 10000.0 + 0.5);
+	const int64_t      first    = llround(data_time * synth->samprate);
+	PALERT_M16_DATA    data;
+	uint16_t           crc;
+
+/* */
+	memset(pah16, 0, PALERT_M16_HEADER_LENGTH);
+	pah16->sync_char[0] = PALERT_M16_SYNC_CHAR_0;
+	pah16->sync_char[1] = PALERT_M16_SYNC_CHAR_1;
+	pah16->sync_char[2] = PALERT_M16_SYNC_CHAR_2;
+	pah16->sync_char[3] = PALERT_M16_SYNC_CHAR_3;
+	word_set( pah16->packet_no, synth->packet_no++ );
+	pah16->header_len = PALERT_M16_HEADER_LENGTH;
+	word_set( pah16->data_len, data_len );
+	word_set( pah16->packet_len, length );
+	for ( int i = 0; i < 5; i++ )
+		pah16->unixtime[i] = (sec >> (i * 8)) & 0xff;
+	word_set( pah16->msec, msec );
+	pah16->ntp_sync = synth->ntp_synced ? 0x01 : 0x00;
+	data.data_real = 1.0f;
+	for ( int i = 0; i < 4; i++ )
+		pah16->scale[i] = (data.data_dword >> (i * 8)) & 0xff;
+	word_set( pah16->sps, synth->samprate );
+	pah16->nchannel = synth->nchannel;
+	for ( int i = 0; i < 4; i++ )
+		pah16->serial[i] = (synth->serial >> (i * 8)) & 0xff;
+/* */
+	for ( int i = 0; i < synth->nsamp; i++ ) {
+		for ( int j = 0; j < synth->nchannel; j++, dataptr += 4 ) {
+			data.data_real = sample_gen( synth, j, first + i ) / (float)PALERT_M16_COUNT_OVER_GAL;
+			word_set( dataptr, data.data_dword & 0xffff );
+			word_set( dataptr + 2, data.data_dword >> 16 );
+		}
+	}
+/* The check sum in little-endian at the end makes the one of the whole packet zero */
+	crc = pac_crc16_cal( packet, length - 2 );
+	word_set( dataptr, crc );
+
+	return length;
+}
+
+/**
+ * @brief Sine wave of 1 Hz with the phase shifted by the serial & the channel, plus some noise.
+ *
+ * @param synth
+ * @param chan
+ * @param sample_no Sample number since the epoch.
+ * @return int32_t
+ */
+static int32_t sample_gen( PA2EW_SYNTH *synth, const int chan, const int64_t sample_no )
+{
+	const int64_t shift = (int64_t)(synth->serial % 360 + chan * 120) * synth->samprate / 360;
+
+	return
+		SineTable[(sample_no + shift) % synth->samprate] +
+		(int32_t)(pa2ew_synth_rand( &synth->rand_state ) % (2 * PA2EW_SYNTH_NOISE_AMP + 1)) - PA2EW_SYNTH_NOISE_AMP;
+}
+
+/**
+ * @brief
+ *
+ * @param word
+ * @param value
+ */
+static void word_set( uint8_t *word, const uint16_t value )
+{
+	word[0] = value & 0xff;
+	word[1] = value >> 8;
+
+	return;
+}
+
+/**
+ * @brief
+ *
+ * @param word
+ * @param value
+ */
+static void word_set_be( uint8_t *word, const uint16_t value )
+{
+	word[0] = value >> 8;
+	word[1] = value & 0xff;
+
+	return;
+}